@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+
+"""
+Load test for the JSON IPC server.
+
+Connects N clients to a running mpv instance (started with
+--input-ipc-server=PATH), and makes each of them send commands as fast as it
+can, with up to --depth requests in flight. Each client can also observe some
+properties, so that event traffic is mixed with the replies.
+
+At the end, the total throughput and the latency distribution of the replies
+is printed.
+
+Example:
+
+    mpv --idle --input-ipc-server=/tmp/mpvsock &
+    TOOLS/ipc-load-test.py /tmp/mpvsock -n 50 -c 2000 --observe time-pos
+"""
+
+import argparse
+import json
+import selectors
+import socket
+import sys
+import time
+
+class Client:
+    def __init__(self, path, args, index):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+        self.sock.setblocking(False)
+        self.args = args
+        self.index = index
+        self.inbuf = b""
+        self.outbuf = b""
+        self.sent = 0
+        self.replies = 0
+        self.events = 0
+        self.errors = 0
+        self.in_flight = {}
+        self.latencies = []
+        for n, name in enumerate(args.observe):
+            self.queue({"command": ["observe_property", n + 1, name]})
+
+    def queue(self, cmd):
+        self.outbuf += json.dumps(cmd).encode("utf-8") + b"\n"
+
+    def fill(self):
+        while (self.sent < self.args.count and
+               len(self.in_flight) < self.args.depth):
+            req = self.sent + 1
+            self.in_flight[req] = time.perf_counter()
+            self.queue({"command": self.args.command, "request_id": req})
+            self.sent += 1
+
+    def done(self):
+        return self.replies >= self.args.count
+
+    def on_read(self):
+        data = self.sock.recv(65536)
+        if not data:
+            raise Exception("client %d: connection closed" % self.index)
+        self.inbuf += data
+        *lines, self.inbuf = self.inbuf.split(b"\n")
+        now = time.perf_counter()
+        for line in lines:
+            msg = json.loads(line)
+            if "event" in msg:
+                self.events += 1
+                continue
+            req = msg.get("request_id", 0)
+            if req in self.in_flight:
+                self.latencies.append(now - self.in_flight.pop(req))
+                self.replies += 1
+                if msg.get("error") != "success":
+                    self.errors += 1
+
+    def on_write(self):
+        if self.outbuf:
+            n = self.sock.send(self.outbuf)
+            self.outbuf = self.outbuf[n:]
+
+def percentile(values, p):
+    if not values:
+        return 0
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+def main():
+    parser = argparse.ArgumentParser(description="mpv IPC load test")
+    parser.add_argument("socket", help="path of the --input-ipc-server socket")
+    parser.add_argument("-n", "--clients", type=int, default=20,
+                        help="number of concurrent clients")
+    parser.add_argument("-c", "--count", type=int, default=1000,
+                        help="number of commands sent by each client")
+    parser.add_argument("-d", "--depth", type=int, default=1,
+                        help="maximum number of requests in flight per client")
+    parser.add_argument("--command", default='["get_property", "time-pos"]',
+                        help="command to send, as JSON array")
+    parser.add_argument("--observe", action="append", default=[],
+                        help="property to observe with each client "
+                             "(can be repeated)")
+    args = parser.parse_args()
+    args.command = json.loads(args.command)
+
+    sel = selectors.DefaultSelector()
+    clients = [Client(args.socket, args, n) for n in range(args.clients)]
+    for c in clients:
+        sel.register(c.sock, selectors.EVENT_READ | selectors.EVENT_WRITE, c)
+
+    start = time.perf_counter()
+    pending = len(clients)
+    while pending:
+        for key, mask in sel.select(timeout=10):
+            c = key.data
+            if mask & selectors.EVENT_READ:
+                c.on_read()
+            c.fill()
+            if mask & selectors.EVENT_WRITE:
+                c.on_write()
+            if c.done() and not c.outbuf:
+                sel.unregister(c.sock)
+                c.sock.close()
+                pending -= 1
+            else:
+                events = selectors.EVENT_READ
+                if c.outbuf:
+                    events |= selectors.EVENT_WRITE
+                sel.modify(c.sock, events, c)
+    elapsed = time.perf_counter() - start
+
+    replies = sum(c.replies for c in clients)
+    events = sum(c.events for c in clients)
+    errors = sum(c.errors for c in clients)
+    lat = sorted(l for c in clients for l in c.latencies)
+
+    print("clients:     %d" % len(clients))
+    print("replies:     %d (%d errors)" % (replies, errors))
+    print("events:      %d" % events)
+    print("time:        %.3f s" % elapsed)
+    print("throughput:  %.0f replies/s" % (replies / elapsed))
+    for p in (50, 90, 99, 100):
+        print("latency p%-3d %.3f ms" % (p, percentile(lat, p) * 1000))
+
+    return 1 if errors else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -33,6 +33,7 @@ struct mp_aframe {
     int format;
     double pts;
     double speed;
+    int64_t stage_time;
 };
 
 struct avframe_opaque {
@@ -67,6 +68,7 @@ struct mp_aframe *mp_aframe_new_ref(struct mp_aframe *frame)
     dst->format = frame->format;
     dst->pts = frame->pts;
     dst->speed = frame->speed;
+    dst->stage_time = frame->stage_time;
 
     if (mp_aframe_is_allocated(frame)) {
         if (av_frame_ref(dst->av_frame, frame->av_frame) < 0)
@@ -215,6 +217,7 @@ void mp_aframe_copy_attributes(struct mp_aframe *dst, struct mp_aframe *src)
 {
     dst->pts = src->pts;
     dst->speed = src->speed;
+    dst->stage_time = src->stage_time;
 
     int rate = dst->av_frame->sample_rate;
 
@@ -367,6 +370,18 @@ double mp_aframe_get_speed(struct mp_aframe *frame)
     return frame->speed;
 }
 
+// mp_time_us() when the last pipeline stage passed on the frame, or 0. This is
+// only used for latency stats.
+int64_t mp_aframe_get_stage_time(struct mp_aframe *frame)
+{
+    return frame->stage_time;
+}
+
+void mp_aframe_set_stage_time(struct mp_aframe *frame, int64_t time)
+{
+    frame->stage_time = time;
+}
+
 // Matters for speed changed frames (such as a frame which has been resampled
 // to play at a different speed).
 // Return the sample rate at which the frame would have to be played to result
@@ -585,9 +600,17 @@ int mp_aframe_approx_byte_size(struct mp_aframe *frame)
     return plane_size * planes + sizeof(*frame);
 }
 
+// Pool buffers are grouped into size classes. Class n holds buffers of
+// (1 << (POOL_MIN_SIZE_LOG2 + n)) bytes. This way a single pool can serve
+// frames of different formats, channel counts and sizes (such as a pool shared
+// by all filters in a chain) without throwing away its cached buffers every
+// time a larger frame is requested.
+#define POOL_MIN_SIZE_LOG2 12
+#define POOL_NUM_CLASSES 18
+
 struct mp_aframe_pool {
-    AVBufferPool *avpool;
-    int element_size;
+    AVBufferPool *avpools[POOL_NUM_CLASSES];
+    struct mp_aframe_pool_stats stats;
 };
 
 struct mp_aframe_pool *mp_aframe_pool_create(void *ta_parent)
@@ -598,7 +621,38 @@ struct mp_aframe_pool *mp_aframe_pool_create(void *ta_parent)
 static void mp_aframe_pool_destructor(void *p)
 {
     struct mp_aframe_pool *pool = p;
-    av_buffer_pool_uninit(&pool->avpool);
+    for (int n = 0; n < POOL_NUM_CLASSES; n++)
+        av_buffer_pool_uninit(&pool->avpools[n]);
+}
+
+// Called by av_buffer_pool_get() if there is no free buffer in the pool.
+#if LIBAVUTIL_VERSION_MAJOR >= 57
+static AVBufferRef *pool_alloc_buffer(void *opaque, size_t size)
+#else
+static AVBufferRef *pool_alloc_buffer(void *opaque, int size)
+#endif
+{
+    struct mp_aframe_pool *pool = opaque;
+    pool->stats.num_new += 1;
+    return av_buffer_alloc(size);
+}
+
+static AVBufferPool *get_avpool(struct mp_aframe_pool *pool, int size)
+{
+    int cls = 0;
+    while ((1 << (POOL_MIN_SIZE_LOG2 + cls)) < size) {
+        cls++;
+        if (cls >= POOL_NUM_CLASSES)
+            return NULL;
+    }
+
+    if (!pool->avpools[cls]) {
+        pool->avpools[cls] =
+            av_buffer_pool_init2(1 << (POOL_MIN_SIZE_LOG2 + cls), pool,
+                                 pool_alloc_buffer, NULL);
+        talloc_set_destructor(pool, mp_aframe_pool_destructor);
+    }
+    return pool->avpools[cls];
 }
 
 // Like mp_aframe_allocate(), but use the pool to allocate data.
@@ -617,17 +671,9 @@ int mp_aframe_pool_allocate(struct mp_aframe_pool *pool, struct mp_aframe *frame
     if (size <= 0 || mp_aframe_is_allocated(frame))
         return -1;
 
-    if (!pool->avpool || size > pool->element_size) {
-        size_t alloc = ta_calc_prealloc_elems(size);
-        if (alloc >= INT_MAX)
-            return -1;
-        av_buffer_pool_uninit(&pool->avpool);
-        pool->element_size = alloc;
-        pool->avpool = av_buffer_pool_init(pool->element_size, NULL);
-        if (!pool->avpool)
-            return -1;
-        talloc_set_destructor(pool, mp_aframe_pool_destructor);
-    }
+    AVBufferPool *avpool = get_avpool(pool, size);
+    if (!avpool)
+        return -1;
 
     // Yes, you have to do all this shit manually.
     // At least it's less stupid than av_frame_get_buffer(), which just wipes
@@ -643,9 +689,10 @@ int mp_aframe_pool_allocate(struct mp_aframe_pool *pool, struct mp_aframe *frame
     } else {
         av_frame->extended_data = av_frame->data;
     }
-    av_frame->buf[0] = av_buffer_pool_get(pool->avpool);
+    av_frame->buf[0] = av_buffer_pool_get(avpool);
     if (!av_frame->buf[0])
         return -1;
+    pool->stats.num_allocs += 1;
     av_frame->linesize[0] = samples * sstride;
     for (int n = 0; n < planes; n++)
         av_frame->extended_data[n] = av_frame->buf[0]->data + n * plane_size;
@@ -657,3 +704,10 @@ int mp_aframe_pool_allocate(struct mp_aframe_pool *pool, struct mp_aframe *frame
 
     return 0;
 }
+
+// Return the allocation statistics of the pool.
+void mp_aframe_pool_get_stats(struct mp_aframe_pool *pool,
+                              struct mp_aframe_pool_stats *st)
+{
+    *st = pool->stats;
+}
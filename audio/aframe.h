@@ -38,6 +38,7 @@ int mp_aframe_get_rate(struct mp_aframe *frame);
 int mp_aframe_get_size(struct mp_aframe *frame);
 double mp_aframe_get_pts(struct mp_aframe *frame);
 double mp_aframe_get_speed(struct mp_aframe *frame);
+int64_t mp_aframe_get_stage_time(struct mp_aframe *frame);
 double mp_aframe_get_effective_rate(struct mp_aframe *frame);
 
 bool mp_aframe_set_format(struct mp_aframe *frame, int format);
@@ -47,6 +48,7 @@ bool mp_aframe_set_size(struct mp_aframe *frame, int samples);
 void mp_aframe_set_pts(struct mp_aframe *frame, double pts);
 void mp_aframe_set_speed(struct mp_aframe *frame, double factor);
 void mp_aframe_mul_speed(struct mp_aframe *frame, double factor);
+void mp_aframe_set_stage_time(struct mp_aframe *frame, int64_t time);
 
 int mp_aframe_get_planes(struct mp_aframe *frame);
 int mp_aframe_get_total_plane_samples(struct mp_aframe *frame);
@@ -72,3 +74,11 @@ struct mp_aframe_pool;
 struct mp_aframe_pool *mp_aframe_pool_create(void *ta_parent);
 int mp_aframe_pool_allocate(struct mp_aframe_pool *pool, struct mp_aframe *frame,
                             int samples);
+
+struct mp_aframe_pool_stats {
+    int64_t num_allocs;     // successful mp_aframe_pool_allocate() calls
+    int64_t num_new;        // number of buffers which could not be reused
+};
+
+void mp_aframe_pool_get_stats(struct mp_aframe_pool *pool,
+                              struct mp_aframe_pool_stats *st);
@@ -304,7 +304,7 @@ static struct mp_filter *af_rubberband_create(struct mp_filter *parent,
     p->speed = 1.0;
     p->pitch = p->opts->scale;
     p->cur_format = talloc_steal(p, mp_aframe_create());
-    p->out_pool = mp_aframe_pool_create(p);
+    p->out_pool = mp_filter_get_aframe_pool(f);
 
     struct mp_autoconvert *conv = mp_autoconvert_create(f);
     if (!conv)
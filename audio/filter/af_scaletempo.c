@@ -580,7 +580,7 @@ static struct mp_filter *af_scaletempo_create(struct mp_filter *parent,
     s->opts = talloc_steal(s, options);
     s->speed = 1.0;
     s->cur_format = talloc_steal(s, mp_aframe_create());
-    s->out_pool = mp_aframe_pool_create(s);
+    s->out_pool = mp_filter_get_aframe_pool(f);
 
     struct mp_autoconvert *conv = mp_autoconvert_create(f);
     if (!conv)
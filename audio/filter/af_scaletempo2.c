@@ -200,7 +200,7 @@ static struct mp_filter *af_scaletempo2_create(
     p->data.opts = talloc_steal(p, options);
     p->speed = 1.0;
     p->cur_format = talloc_steal(p, mp_aframe_create());
-    p->out_pool = mp_aframe_pool_create(p);
+    p->out_pool = mp_filter_get_aframe_pool(f);
     p->pending = NULL;
     p->initialized = false;
 
@@ -0,0 +1,309 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "common/common.h"
+
+#include "aframe.h"
+#include "chmap.h"
+#include "format.h"
+#include "loudness.h"
+
+// Gating blocks are 400ms long, and overlap by 75%. Each block is made of 4
+// consecutive 100ms sub-blocks.
+#define SUB_BLOCKS 4
+
+// Gated block loudness values are collected in a histogram with 0.1 LU wide
+// bins covering -70 LUFS (absolute gate) to +5 LUFS. This keeps memory usage
+// constant regardless of the measured duration.
+#define HIST_MIN -70.0
+#define HIST_STEP 0.1
+#define HIST_BINS 750
+
+// Maximum timestamp jitter between frames that are considered contiguous.
+#define PTS_TOLERANCE 0.005
+
+struct biquad {
+    double b0, b1, b2, a1, a2;
+};
+
+struct mp_loudness {
+    // Current input format.
+    int format;
+    int rate;
+    struct mp_chmap chmap;
+
+    // K-weighting filter (pre-filter and RLB high-pass).
+    struct biquad pre, rlb;
+    double state[MP_NUM_CHANNELS][4];
+    double weights[MP_NUM_CHANNELS];
+
+    int sub_block_size;     // samples per sub-block
+    int sub_block_pos;      // samples added to cur_energy
+    double cur_energy;      // weighted sum of squares of current sub-block
+    double sub_energy[SUB_BLOCKS];
+    int num_sub_blocks;     // valid entries in sub_energy[] (at most 4)
+
+    uint64_t hist[HIST_BINS];
+    double peak;
+    double start, end;      // timestamp range of the measured audio
+};
+
+struct mp_loudness *mp_loudness_create(void *ta_parent)
+{
+    struct mp_loudness *m = talloc_zero(ta_parent, struct mp_loudness);
+    m->start = m->end = MP_NOPTS_VALUE;
+    return m;
+}
+
+static double energy_to_lufs(double e)
+{
+    return -0.691 + 10.0 * log10(e);
+}
+
+static double lufs_to_energy(double l)
+{
+    return pow(10.0, (l + 0.691) / 10.0);
+}
+
+// Filter coefficients from ITU BS.1770, recomputed for the given samplerate.
+static void init_filters(struct mp_loudness *m)
+{
+    double f0 = 1681.974450955533;
+    double g = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / m->rate);
+    double vh = pow(10.0, g / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m->pre = (struct biquad){
+        .b0 = (vh + vb * k / q + k * k) / a0,
+        .b1 = 2.0 * (k * k - vh) / a0,
+        .b2 = (vh - vb * k / q + k * k) / a0,
+        .a1 = 2.0 * (k * k - 1.0) / a0,
+        .a2 = (1.0 - k / q + k * k) / a0,
+    };
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / m->rate);
+    a0 = 1.0 + k / q + k * k;
+    m->rlb = (struct biquad){
+        .b0 = 1.0,
+        .b1 = -2.0,
+        .b2 = 1.0,
+        .a1 = 2.0 * (k * k - 1.0) / a0,
+        .a2 = (1.0 - k / q + k * k) / a0,
+    };
+
+    memset(m->state, 0, sizeof(m->state));
+}
+
+static void init_weights(struct mp_loudness *m)
+{
+    for (int c = 0; c < m->chmap.num; c++) {
+        switch (m->chmap.speaker[c]) {
+        case MP_SPEAKER_ID_LFE:
+        case MP_SPEAKER_ID_LFE2:
+            m->weights[c] = 0.0;
+            break;
+        case MP_SPEAKER_ID_BL:
+        case MP_SPEAKER_ID_BR:
+        case MP_SPEAKER_ID_SL:
+        case MP_SPEAKER_ID_SR:
+        case MP_SPEAKER_ID_SDL:
+        case MP_SPEAKER_ID_SDR:
+            m->weights[c] = 1.41;
+            break;
+        default:
+            m->weights[c] = 1.0;
+        }
+    }
+}
+
+static bool reconfig(struct mp_loudness *m, struct mp_aframe *frame)
+{
+    int format = mp_aframe_get_format(frame);
+    int rate = mp_aframe_get_rate(frame);
+    struct mp_chmap chmap;
+    if (!af_fmt_is_pcm(format) || af_fmt_is_spdif(format) || rate < 1 ||
+        !mp_aframe_get_chmap(frame, &chmap))
+        return false;
+
+    if (format == m->format && rate == m->rate &&
+        mp_chmap_equals(&chmap, &m->chmap))
+        return true;
+
+    // The histogram and peak are kept, but the block state can't be continued.
+    m->format = format;
+    m->rate = rate;
+    m->chmap = chmap;
+    m->sub_block_size = MPMAX(rate / 10, 1);
+    m->sub_block_pos = 0;
+    m->cur_energy = 0;
+    m->num_sub_blocks = 0;
+    init_filters(m);
+    init_weights(m);
+    return true;
+}
+
+static double filter_sample(struct biquad *f, double *z, double x)
+{
+    // Direct form II transposed.
+    double y = f->b0 * x + z[0];
+    z[0] = f->b1 * x - f->a1 * y + z[1];
+    z[1] = f->b2 * x - f->a2 * y;
+    return y;
+}
+
+static void add_sub_block(struct mp_loudness *m)
+{
+    memmove(&m->sub_energy[0], &m->sub_energy[1],
+            sizeof(m->sub_energy[0]) * (SUB_BLOCKS - 1));
+    m->sub_energy[SUB_BLOCKS - 1] = m->cur_energy / m->sub_block_size;
+    m->num_sub_blocks = MPMIN(m->num_sub_blocks + 1, SUB_BLOCKS);
+    m->cur_energy = 0;
+    m->sub_block_pos = 0;
+
+    if (m->num_sub_blocks < SUB_BLOCKS)
+        return;
+
+    double energy = 0;
+    for (int n = 0; n < SUB_BLOCKS; n++)
+        energy += m->sub_energy[n];
+    energy /= SUB_BLOCKS;
+
+    if (energy <= 0)
+        return;
+    double l = energy_to_lufs(energy);
+    if (l < HIST_MIN)
+        return;
+    int bin = (l - HIST_MIN) / HIST_STEP;
+    m->hist[MPCLAMP(bin, 0, HIST_BINS - 1)] += 1;
+}
+
+static inline void add_sample(struct mp_loudness *m, int c, double x)
+{
+    m->peak = MPMAX(m->peak, fabs(x));
+    double y = filter_sample(&m->pre, &m->state[c][0], x);
+    y = filter_sample(&m->rlb, &m->state[c][2], y);
+    m->cur_energy += m->weights[c] * y * y;
+}
+
+// Sample n of channel c is at ((T *)ptr[c])[n * stride]. Converted to the
+// range [-1, 1] with (sample + offset) * scale.
+#define ADD_SAMPLES(T, offset, scale)                                       \
+    for (int s = start; s < samples; s++) {                                 \
+        for (int c = 0; c < channels; c++) {                                \
+            const T *p = ptr[c];                                            \
+            add_sample(m, c, (p[s * stride] + (offset)) * (scale));         \
+        }                                                                   \
+        if (++m->sub_block_pos == m->sub_block_size)                        \
+            add_sub_block(m);                                               \
+    }
+
+void mp_loudness_add(struct mp_loudness *m, struct mp_aframe *frame)
+{
+    int samples = mp_aframe_get_size(frame);
+    double pts = mp_aframe_get_pts(frame);
+    double end = mp_aframe_end_pts(frame);
+    if (!samples || pts == MP_NOPTS_VALUE || end == MP_NOPTS_VALUE)
+        return;
+
+    // Only audio that continues the measured range is used, so that seeking
+    // back does not count audio twice, and seeking forward does not leave
+    // gaps. Frames overlapping the end of the range are cut.
+    int start = 0;
+    if (m->end == MP_NOPTS_VALUE) {
+        m->start = pts;
+    } else {
+        if (pts > m->end + PTS_TOLERANCE || end <= m->end + PTS_TOLERANCE)
+            return;
+        if (pts < m->end) {
+            start = lrint((m->end - pts) * mp_aframe_get_effective_rate(frame));
+            start = MPCLAMP(start, 0, samples);
+        }
+    }
+
+    if (!reconfig(m, frame))
+        return;
+
+    uint8_t **data = mp_aframe_get_data_ro(frame);
+    if (!data)
+        return;
+
+    int channels = m->chmap.num;
+    int bps = af_fmt_to_bytes(m->format);
+    bool planar = af_fmt_is_planar(m->format);
+    int stride = planar ? 1 : channels;
+    const void *ptr[MP_NUM_CHANNELS];
+    for (int c = 0; c < channels; c++)
+        ptr[c] = planar ? data[c] : data[0] + c * bps;
+
+    switch (af_fmt_from_planar(m->format)) {
+    case AF_FORMAT_U8:      ADD_SAMPLES(uint8_t, -128, 1 / 128.0); break;
+    case AF_FORMAT_S16:     ADD_SAMPLES(int16_t, 0, 1 / 32768.0); break;
+    case AF_FORMAT_S32:     ADD_SAMPLES(int32_t, 0, 1 / 2147483648.0); break;
+    case AF_FORMAT_S64:     ADD_SAMPLES(int64_t, 0, 1 / 9223372036854775808.0);
+                            break;
+    case AF_FORMAT_FLOAT:   ADD_SAMPLES(float, 0, 1); break;
+    case AF_FORMAT_DOUBLE:  ADD_SAMPLES(double, 0, 1); break;
+    default:                return;
+    }
+
+    m->end = end;
+}
+
+static double bin_lufs(int bin)
+{
+    return HIST_MIN + (bin + 0.5) * HIST_STEP;
+}
+
+bool mp_loudness_get(struct mp_loudness *m, struct mp_loudness_result *res)
+{
+    // Absolute gate (everything in the histogram passed it).
+    double energy = 0;
+    uint64_t count = 0;
+    for (int n = 0; n < HIST_BINS; n++) {
+        energy += m->hist[n] * lufs_to_energy(bin_lufs(n));
+        count += m->hist[n];
+    }
+    if (!count)
+        return false;
+
+    // Relative gate, 10 LU below the absolute-gated loudness.
+    double gate = energy_to_lufs(energy / count) - 10.0;
+    energy = 0;
+    count = 0;
+    for (int n = 0; n < HIST_BINS; n++) {
+        if (bin_lufs(n) >= gate) {
+            energy += m->hist[n] * lufs_to_energy(bin_lufs(n));
+            count += m->hist[n];
+        }
+    }
+    if (!count)
+        return false;
+
+    *res = (struct mp_loudness_result){
+        .integrated = energy_to_lufs(energy / count),
+        .peak = m->peak,
+        .duration = m->end - m->start,
+    };
+    return true;
+}
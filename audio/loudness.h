@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+
+struct mp_aframe;
+struct mp_loudness;
+
+// Incremental loudness measurement as specified by EBU R128 (ITU BS.1770).
+// (Free with talloc_free().)
+struct mp_loudness *mp_loudness_create(void *ta_parent);
+
+// Add the audio of the frame to the measurement. Non-PCM frames, frames
+// without timestamps, and audio outside of the contiguous timestamp range
+// measured so far are ignored.
+void mp_loudness_add(struct mp_loudness *m, struct mp_aframe *frame);
+
+struct mp_loudness_result {
+    double integrated;      // integrated (gated) loudness in LUFS
+    double peak;            // sample peak (linear, 1.0 is full scale)
+    double duration;        // length of the measured timestamp range in seconds
+};
+
+// Return the current measurement. Returns false if there is not enough data
+// for an integrated loudness value yet.
+bool mp_loudness_get(struct mp_loudness *m, struct mp_loudness_result *res);
@@ -30,6 +30,7 @@
 
 #include "common/msg.h"
 #include "common/common.h"
+#include "common/stats.h"
 
 #include "filters/f_async_queue.h"
 #include "filters/filter_internal.h"
@@ -51,6 +52,7 @@ struct buffer_state {
 
     // Immutable.
     struct mp_async_queue *queue;
+    struct stats_ctx *stats;
 
     // --- protected by lock
 
@@ -134,6 +136,8 @@ static int read_buffer(struct ao *ao, void **data, int samples, bool *eof)
                 continue;
             }
             p->pending = frame.data;
+            stats_latency(p->stats, "filter-ao",
+                          mp_aframe_get_stage_time(p->pending));
         }
 
         if (!data)
@@ -507,6 +511,7 @@ bool init_buffer_post(struct ao *ao)
     pthread_cond_init(&p->pt_wakeup, NULL);
 
     p->queue = mp_async_queue_create();
+    p->stats = stats_ctx_create(p, ao->global, "audio");
     p->filter_root = mp_filter_create_root(ao->global);
     p->input = mp_async_queue_create_filter(p->filter_root, MP_PIN_OUT, p->queue);
 
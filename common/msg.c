@@ -22,6 +22,7 @@
 #include <unistd.h>
 #include <assert.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
 
 #include "mpv_talloc.h"
@@ -30,6 +31,7 @@
 #include "osdep/atomic.h"
 #include "common/common.h"
 #include "common/global.h"
+#include "common/trace.h"
 #include "misc/bstr.h"
 #include "options/options.h"
 #include "options/path.h"
@@ -45,6 +47,32 @@
 
 #define TERM_BUF 100
 
+// Messages which fit into a record are queued in a lock-free ring buffer, and
+// output by whichever thread gets the lock next. Everything else (partial
+// lines, status lines, very long messages, full ring) is output directly with
+// the lock held.
+#define LOG_RING_SIZE 256           // number of records, power of 2
+#define LOG_RECORD_DATA 480         // prefixes and text of a queued message
+
+struct log_record {
+    atomic_ulong seq;               // see push_record()
+    int64_t time;
+    int level;
+    int terminal_level;
+    bool has_prefix;
+    // verbose_prefix, prefix (if has_prefix) and text, each 0-terminated
+    char data[LOG_RECORD_DATA];
+};
+
+// Describes where a message comes from. This is copied from mp_log, because
+// queued messages can be output after the mp_log was destroyed.
+struct msg_header {
+    const char *prefix;
+    const char *verbose_prefix;
+    int terminal_level;
+    int64_t time;
+};
+
 struct mp_log_root {
     struct mpv_global *global;
     pthread_mutex_t lock;
@@ -66,7 +94,13 @@ struct mp_log_root {
     struct mp_log_buffer *early_buffer;
     FILE *stats_file;
     bstr buffer;
+    // --- immutable
+    struct mp_tracer *tracer;
+    struct log_record *ring;        // LOG_RING_SIZE records
     // --- must be accessed atomically
+    atomic_bool have_stats_file; // stats_file != NULL (lock-free hint)
+    atomic_ulong ring_write;        // next record to allocate
+    atomic_ulong ring_read;         // next record to output (written with lock)
     /* This is incremented every time the msglevels must be reloaded.
      * (This is perhaps better than maintaining a globally accessible and
      * synchronized mp_log tree.) */
@@ -74,6 +108,7 @@ struct mp_log_root {
     // --- owner thread only (caller of mp_msg_init() etc.)
     char *log_path;
     char *stats_path;
+    char *trace_path;
     pthread_t log_file_thread;
     // --- owner thread only, but frozen while log_file_thread is running
     FILE *log_file;
@@ -90,14 +125,20 @@ struct mp_log {
     int level;                  // minimum log level for any outputs
     int terminal_level;         // minimum log level for terminal output
     atomic_ulong reload_counter;
-    char *partial;
+    char *partial;              // protected by root->lock
+    atomic_bool has_partial;    // partial[0] != '\0'
+};
+
+struct log_buffer_entry {
+    int level;
+    char *data;                 // "prefix\0text\0"; reused for later entries
 };
 
 struct mp_log_buffer {
     struct mp_log_root *root;
     pthread_mutex_t lock;
     // --- protected by lock
-    struct mp_log_buffer_entry **entries;   // ringbuffer
+    struct log_buffer_entry *entries;       // ringbuffer
     int capacity;                           // total space in entries[]
     int entry0;                             // first (oldest) entry index
     int num_entries;                        // number of valid entries after entry0
@@ -112,6 +153,8 @@ struct mp_log_buffer {
 static const struct mp_log null_log = {0};
 struct mp_log *const mp_null_log = (struct mp_log *)&null_log;
 
+static void unlock_root(struct mp_log_root *root);
+
 static bool match_mod(const char *name, const char *mod)
 {
     if (!strcmp(mod, "all"))
@@ -142,11 +185,11 @@ static void update_loglevel(struct mp_log *log)
     }
     if (log->root->log_file)
         log->level = MPMAX(log->level, MSGL_DEBUG);
-    if (log->root->stats_file)
+    if (log->root->stats_file || mp_tracer_active(log->root->tracer))
         log->level = MPMAX(log->level, MSGL_STATS);
     log->level = MPMIN(log->level, log->max_level);
     atomic_store(&log->reload_counter, atomic_load(&log->root->reload_counter));
-    pthread_mutex_unlock(&root->lock);
+    unlock_root(root);
 }
 
 // Set (numerically) the maximum level that should still be output for this log
@@ -157,7 +200,7 @@ void mp_msg_set_max_level(struct mp_log *log, int lev)
         return;
     pthread_mutex_lock(&log->root->lock);
     log->max_level = MPCLAMP(lev, -1, MSGL_MAX);
-    pthread_mutex_unlock(&log->root->lock);
+    unlock_root(log->root);
     update_loglevel(log);
 }
 
@@ -226,7 +269,7 @@ void mp_msg_flush_status_line(struct mp_log *log)
     if (log->root) {
         pthread_mutex_lock(&log->root->lock);
         flush_status_line(log->root);
-        pthread_mutex_unlock(&log->root->lock);
+        unlock_root(log->root);
     }
 }
 
@@ -236,7 +279,7 @@ void mp_msg_set_term_title(struct mp_log *log, const char *title)
         // Lock because printf to terminal is not necessarily atomic.
         pthread_mutex_lock(&log->root->lock);
         fprintf(stderr, "\e]0;%s\007", title);
-        pthread_mutex_unlock(&log->root->lock);
+        unlock_root(log->root);
     }
 }
 
@@ -245,7 +288,7 @@ bool mp_msg_has_status_line(struct mpv_global *global)
     struct mp_log_root *root = global->log->root;
     pthread_mutex_lock(&root->lock);
     bool r = root->status_lines > 0;
-    pthread_mutex_unlock(&root->lock);
+    unlock_root(root);
     return r;
 }
 
@@ -284,19 +327,19 @@ static void pretty_print_module(FILE* stream, const char *prefix, bool use_color
         set_msg_color(stream, lev);
 }
 
-static bool test_terminal_level(struct mp_log *log, int lev)
+static bool test_terminal_level(struct mp_log_root *root,
+                                struct msg_header *hdr, int lev)
 {
-    return lev <= log->terminal_level && log->root->use_terminal &&
+    return lev <= hdr->terminal_level && root->use_terminal &&
            !(lev == MSGL_STATUS && terminal_in_background());
 }
 
-static void print_terminal_line(struct mp_log *log, int lev,
-                                char *text,  char *trail)
+static void print_terminal_line(struct mp_log_root *root, struct msg_header *hdr,
+                                int lev, char *text,  char *trail)
 {
-    if (!test_terminal_level(log, lev))
+    if (!test_terminal_level(root, hdr, lev))
         return;
 
-    struct mp_log_root *root = log->root;
     FILE *stream = (root->force_stderr || lev == MSGL_STATUS) ? stderr : stdout;
 
     if (lev != MSGL_STATUS)
@@ -306,11 +349,11 @@ static void print_terminal_line(struct mp_log *log, int lev,
         set_msg_color(stream, lev);
 
     if (root->show_time)
-        fprintf(stream, "[%10.6f] ", (mp_time_us() - MP_START_TIME) / 1e6);
+        fprintf(stream, "[%10.6f] ", (hdr->time - MP_START_TIME) / 1e6);
 
-    const char *prefix = log->prefix;
+    const char *prefix = hdr->prefix;
     if ((lev >= MSGL_V) || root->verbose || root->module)
-        prefix = log->verbose_prefix;
+        prefix = hdr->verbose_prefix;
 
     if (prefix) {
         if (root->module) {
@@ -327,74 +370,216 @@ static void print_terminal_line(struct mp_log *log, int lev,
     fflush(stream);
 }
 
-static struct mp_log_buffer_entry *log_buffer_read(struct mp_log_buffer *buffer)
+static void write_msg_to_buffers(struct mp_log_root *root,
+                                 struct msg_header *hdr, int lev, char *text)
 {
-    assert(buffer->num_entries);
-    struct mp_log_buffer_entry *res = buffer->entries[buffer->entry0];
-    buffer->entry0 = (buffer->entry0 + 1) % buffer->capacity;
-    buffer->num_entries -= 1;
-    return res;
-}
-
-static void write_msg_to_buffers(struct mp_log *log, int lev, char *text)
-{
-    struct mp_log_root *root = log->root;
     for (int n = 0; n < root->num_buffers; n++) {
         struct mp_log_buffer *buffer = root->buffers[n];
-        bool wakeup = false;
-        pthread_mutex_lock(&buffer->lock);
         int buffer_level = buffer->level;
         if (buffer_level == MP_LOG_BUFFER_MSGL_TERM)
-            buffer_level = log->terminal_level;
+            buffer_level = hdr->terminal_level;
         if (buffer_level == MP_LOG_BUFFER_MSGL_LOGFILE)
-            buffer_level = MPMAX(log->terminal_level, MSGL_DEBUG);
-        if (lev <= buffer_level && lev != MSGL_STATUS) {
-            if (buffer->level == MP_LOG_BUFFER_MSGL_LOGFILE) {
-                // If the buffer is full, block until we can write again.
-                bool dead = false;
-                while (buffer->num_entries == buffer->capacity && !dead) {
-                    // Temporary unlock is OK; buffer->level is immutable, and
-                    // buffer can't go away because the global log lock is held.
-                    pthread_mutex_unlock(&buffer->lock);
-                    pthread_mutex_lock(&root->log_file_lock);
-                    if (root->log_file_thread_active) {
-                        pthread_cond_wait(&root->log_file_wakeup,
-                                          &root->log_file_lock);
-                    } else {
-                        dead = true;
-                    }
-                    pthread_mutex_unlock(&root->log_file_lock);
-                    pthread_mutex_lock(&buffer->lock);
-                }
-            }
-            if (buffer->num_entries == buffer->capacity) {
-                struct mp_log_buffer_entry *skip = log_buffer_read(buffer);
-                talloc_free(skip);
-                buffer->dropped += 1;
-            }
-            struct mp_log_buffer_entry *entry = talloc_ptrtype(NULL, entry);
-            *entry = (struct mp_log_buffer_entry) {
-                .prefix = talloc_strdup(entry, log->verbose_prefix),
-                .level = lev,
-                .text = talloc_strdup(entry, text),
-            };
-            int pos = (buffer->entry0 + buffer->num_entries) % buffer->capacity;
-            buffer->entries[pos] = entry;
-            buffer->num_entries += 1;
-            if (buffer->wakeup_cb && !buffer->silent)
-                wakeup = true;
+            buffer_level = MPMAX(hdr->terminal_level, MSGL_DEBUG);
+        if (lev > buffer_level || lev == MSGL_STATUS)
+            continue;
+
+        size_t prefix_len = strlen(hdr->verbose_prefix) + 1;
+        size_t text_len = strlen(text) + 1;
+
+        bool wakeup = false;
+        pthread_mutex_lock(&buffer->lock);
+        if (buffer->num_entries == buffer->capacity) {
+            // Overwrite the oldest entry.
+            buffer->entry0 = (buffer->entry0 + 1) % buffer->capacity;
+            buffer->num_entries -= 1;
+            buffer->dropped += 1;
         }
+        int pos = (buffer->entry0 + buffer->num_entries) % buffer->capacity;
+        struct log_buffer_entry *entry = &buffer->entries[pos];
+        // Only allocates until the entries have grown to the common size.
+        if (talloc_get_size(entry->data) < prefix_len + text_len) {
+            entry->data = talloc_realloc(buffer->entries, entry->data, char,
+                                         prefix_len + text_len);
+        }
+        entry->level = lev;
+        memcpy(entry->data, hdr->verbose_prefix, prefix_len);
+        memcpy(entry->data + prefix_len, text, text_len);
+        buffer->num_entries += 1;
+        if (buffer->wakeup_cb && !buffer->silent)
+            wakeup = true;
         pthread_mutex_unlock(&buffer->lock);
         if (wakeup)
             buffer->wakeup_cb(buffer->wakeup_cb_ctx);
     }
 }
 
-static void dump_stats(struct mp_log *log, int lev, char *text)
+// Output each full line in text, and return the remaining partial line.
+// text is temporarily modified. Call with root->lock held.
+static char *output_lines(struct mp_log_root *root, struct msg_header *hdr,
+                          int lev, char *text)
+{
+    while (1) {
+        char *end = strchr(text, '\n');
+        if (!end)
+            break;
+        char *next = &end[1];
+        char saved = next[0];
+        next[0] = '\0';
+        print_terminal_line(root, hdr, lev, text, "");
+        write_msg_to_buffers(root, hdr, lev, text);
+        next[0] = saved;
+        text = next;
+    }
+    return text;
+}
+
+// Queue a message without taking any locks. This is a bounded MPMC queue as
+// described by Dmitry Vyukov, restricted to a single consumer: a record at
+// position pos has seq==pos if it is free, and seq==pos+1 if it can be output.
+// Returns false if the ring is full.
+static bool push_record(struct mp_log_root *root, struct msg_header *hdr,
+                        int lev, const char *data, size_t size)
+{
+    struct log_record *rec;
+    unsigned long pos = atomic_load(&root->ring_write);
+    while (1) {
+        rec = &root->ring[pos & (LOG_RING_SIZE - 1)];
+        long diff = (long)(atomic_load(&rec->seq) - pos);
+        if (diff < 0)
+            return false;
+        if (diff == 0) {
+            if (atomic_compare_exchange_strong(&root->ring_write, &pos, pos + 1))
+                break;
+        } else {
+            pos = atomic_load(&root->ring_write);
+        }
+    }
+
+    rec->time = hdr->time;
+    rec->level = lev;
+    rec->terminal_level = hdr->terminal_level;
+    rec->has_prefix = !!hdr->prefix;
+    memcpy(rec->data, data, size);
+    atomic_store(&rec->seq, pos + 1);
+    return true;
+}
+
+static bool record_ready(struct mp_log_root *root, unsigned long pos)
+{
+    struct log_record *rec = &root->ring[pos & (LOG_RING_SIZE - 1)];
+    return atomic_load(&rec->seq) == pos + 1;
+}
+
+// Output all queued messages. Call with root->lock held. If wait is set, also
+// wait for messages which are currently being queued by other threads, which
+// ensures that they are output before anything the caller outputs.
+static void drain_ring(struct mp_log_root *root, bool wait)
+{
+    unsigned long end = wait ? atomic_load(&root->ring_write) : 0;
+
+    while (1) {
+        unsigned long pos = atomic_load(&root->ring_read);
+        if (!record_ready(root, pos)) {
+            if (!wait || (long)(end - pos) <= 0)
+                break;
+            // Another thread is between allocating and filling the record.
+            sched_yield();
+            continue;
+        }
+
+        struct log_record *rec = &root->ring[pos & (LOG_RING_SIZE - 1)];
+        struct msg_header hdr = {
+            .verbose_prefix = rec->data,
+            .terminal_level = rec->terminal_level,
+            .time = rec->time,
+        };
+        char *text = rec->data + strlen(rec->data) + 1;
+        if (rec->has_prefix) {
+            hdr.prefix = text;
+            text += strlen(text) + 1;
+        }
+        output_lines(root, &hdr, rec->level, text);
+
+        atomic_store(&rec->seq, pos + LOG_RING_SIZE);
+        atomic_store(&root->ring_read, pos + 1);
+    }
+}
+
+// Release root->lock, and output messages that other threads queued while it
+// was held. These threads did not get the lock, so they left it to us.
+static void unlock_root(struct mp_log_root *root)
+{
+    while (1) {
+        drain_ring(root, false);
+        pthread_mutex_unlock(&root->lock);
+        // If a record becomes ready after this check, the thread which queued
+        // it will try to get the lock itself.
+        if (!record_ready(root, atomic_load(&root->ring_read)) ||
+            pthread_mutex_trylock(&root->lock))
+            break;
+    }
+}
+
+// Format the message into a record on the stack, and queue it. Returns false
+// if the message needs to be output with the lock held.
+static bool msg_queue(struct mp_log *log, int lev, const char *format,
+                      va_list va)
 {
     struct mp_log_root *root = log->root;
-    if (lev == MSGL_STATS && root->stats_file)
-        fprintf(root->stats_file, "%"PRId64" %s\n", mp_time_us(), text);
+
+    if (lev == MSGL_STATUS || atomic_load(&log->has_partial))
+        return false;
+
+    char data[LOG_RECORD_DATA];
+    size_t size = 0;
+    const char *prefixes[2] = {log->verbose_prefix, log->prefix};
+    for (int n = 0; n < 2 && prefixes[n]; n++) {
+        size_t len = strlen(prefixes[n]) + 1;
+        if (len > sizeof(data) - size)
+            return false;
+        memcpy(data + size, prefixes[n], len);
+        size += len;
+    }
+
+    va_list copy;
+    va_copy(copy, va);
+    int len = vsnprintf(data + size, sizeof(data) - size, format, copy);
+    va_end(copy);
+    if (len <= 0 || len >= sizeof(data) - size || data[size + len - 1] != '\n')
+        return false;
+    size += len + 1;
+
+    struct msg_header hdr = {
+        .prefix = log->prefix,
+        .terminal_level = log->terminal_level,
+        .time = mp_time_us(),
+    };
+    if (!push_record(root, &hdr, lev, data, size))
+        return false;
+
+    // If this fails, the lock holder outputs the message in unlock_root().
+    if (pthread_mutex_trylock(&root->lock) == 0)
+        unlock_root(root);
+    return true;
+}
+
+// Stats don't go through the normal message path, so that tracing can avoid
+// the global lock.
+static void dump_stats(struct mp_log *log, const char *format, va_list va)
+{
+    struct mp_log_root *root = log->root;
+
+    char text[256];
+    vsnprintf(text, sizeof(text), format, va);
+
+    mp_tracer_add_stats(root->tracer, log->verbose_prefix, text);
+
+    if (atomic_load_explicit(&root->have_stats_file, memory_order_relaxed)) {
+        pthread_mutex_lock(&root->lock);
+        if (root->stats_file)
+            fprintf(root->stats_file, "%"PRId64" %s\n", mp_time_us(), text);
+        unlock_root(root);
+    }
 }
 
 void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
@@ -404,8 +589,19 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
 
     struct mp_log_root *root = log->root;
 
+    if (lev == MSGL_STATS) {
+        dump_stats(log, format, va);
+        return;
+    }
+
+    if (msg_queue(log, lev, format, va))
+        return;
+
     pthread_mutex_lock(&root->lock);
 
+    // Keep the order of messages queued before this one.
+    drain_ring(root, true);
+
     root->buffer.len = 0;
 
     if (log->partial[0])
@@ -416,9 +612,14 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
 
     char *text = root->buffer.start;
 
-    if (lev == MSGL_STATS) {
-        dump_stats(log, lev, text);
-    } else if (lev == MSGL_STATUS && !test_terminal_level(log, lev)) {
+    struct msg_header hdr = {
+        .prefix = log->prefix,
+        .verbose_prefix = log->verbose_prefix,
+        .terminal_level = log->terminal_level,
+        .time = mp_time_us(),
+    };
+
+    if (lev == MSGL_STATUS && !test_terminal_level(root, &hdr, lev)) {
         /* discard */
     } else {
         if (lev == MSGL_STATUS)
@@ -426,22 +627,11 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
 
         // Split away each line. Normally we require full lines; buffer partial
         // lines if they happen.
-        while (1) {
-            char *end = strchr(text, '\n');
-            if (!end)
-                break;
-            char *next = &end[1];
-            char saved = next[0];
-            next[0] = '\0';
-            print_terminal_line(log, lev, text, "");
-            write_msg_to_buffers(log, lev, text);
-            next[0] = saved;
-            text = next;
-        }
+        text = output_lines(root, &hdr, lev, text);
 
         if (lev == MSGL_STATUS) {
             if (text[0])
-                print_terminal_line(log, lev, text, "\r");
+                print_terminal_line(root, &hdr, lev, text, "\r");
         } else if (text[0]) {
             int size = strlen(text) + 1;
             if (talloc_get_size(log->partial) < size)
@@ -450,7 +640,9 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
         }
     }
 
-    pthread_mutex_unlock(&root->lock);
+    atomic_store(&log->has_partial, !!log->partial[0]);
+
+    unlock_root(root);
 }
 
 static void destroy_log(void *ptr)
@@ -515,6 +707,10 @@ void mp_msg_init(struct mpv_global *global)
         .global = global,
         .reload_counter = ATOMIC_VAR_INIT(1),
     };
+    root->tracer = mp_tracer_create(root);
+    root->ring = talloc_zero_array(root, struct log_record, LOG_RING_SIZE);
+    for (int n = 0; n < LOG_RING_SIZE; n++)
+        atomic_store(&root->ring[n].seq, n);
 
     pthread_mutex_init(&root->lock, NULL);
     pthread_mutex_init(&root->log_file_lock, NULL);
@@ -534,7 +730,7 @@ static void *log_file_thread(void *p)
 
     pthread_mutex_lock(&root->log_file_lock);
 
-    while (root->log_file_thread_active) {
+    while (1) {
         struct mp_log_buffer_entry *e =
             mp_msg_log_buffer_read(root->log_file_buffer);
         if (e) {
@@ -542,13 +738,17 @@ static void *log_file_thread(void *p)
             fprintf(root->log_file, "[%8.3f][%c][%s] %s",
                     (mp_time_us() - MP_START_TIME) / 1e6,
                     mp_log_levels[e->level][0], e->prefix, e->text);
-            fflush(root->log_file);
             pthread_mutex_lock(&root->log_file_lock);
             talloc_free(e);
-            // Multiple threads might be blocked if the log buffer was full.
-            pthread_cond_broadcast(&root->log_file_wakeup);
-        } else {
+            continue;
+        }
+        // Flush only when caught up; lines still queued would be lost on a
+        // crash just the same.
+        fflush(root->log_file);
+        if (root->log_file_thread_active) {
             pthread_cond_wait(&root->log_file_wakeup, &root->log_file_lock);
+        } else {
+            break; // terminate after writing everything
         }
     }
 
@@ -634,15 +834,18 @@ void mp_msg_update_msglevels(struct mpv_global *global, struct MPOpts *opts)
     m_option_type_msglevels.copy(NULL, &root->msg_levels, &opts->msg_levels);
 
     atomic_fetch_add(&root->reload_counter, 1);
-    pthread_mutex_unlock(&root->lock);
+    unlock_root(root);
 
     if (check_new_path(global, opts->log_file, &root->log_path)) {
         terminate_log_file_thread(root);
         if (root->log_path) {
             root->log_file = fopen(root->log_path, "wb");
             if (root->log_file) {
+                // Messages are dropped if the thread can't keep up, so make
+                // this large enough to absorb bursts of debug output.
                 root->log_file_buffer =
-                    mp_msg_log_buffer_new(global, 100, MP_LOG_BUFFER_MSGL_LOGFILE,
+                    mp_msg_log_buffer_new(global, 10000,
+                                          MP_LOG_BUFFER_MSGL_LOGFILE,
                                           wakeup_log_file, root);
                 root->log_file_thread_active = true;
                 if (pthread_create(&root->log_file_thread, NULL, log_file_thread,
@@ -669,13 +872,25 @@ void mp_msg_update_msglevels(struct mpv_global *global, struct MPOpts *opts)
             root->stats_file = fopen(root->stats_path, "wb");
             open_error = !root->stats_file;
         }
-        pthread_mutex_unlock(&root->lock);
+        atomic_store(&root->have_stats_file, !!root->stats_file);
+        atomic_fetch_add(&root->reload_counter, 1);
+        unlock_root(root);
 
         if (open_error) {
             mp_err(global->log, "Failed to open stats file '%s'\n",
                    root->stats_path);
         }
     }
+
+    if (check_new_path(global, opts->dump_trace, &root->trace_path) &&
+        root->tracer)
+    {
+        if (!mp_tracer_set_file(root->tracer, root->trace_path)) {
+            mp_err(global->log, "Failed to open trace file '%s'\n",
+                   root->trace_path);
+        }
+        atomic_fetch_add(&root->reload_counter, 1);
+    }
 }
 
 void mp_msg_force_stderr(struct mpv_global *global, bool force_stderr)
@@ -684,7 +899,7 @@ void mp_msg_force_stderr(struct mpv_global *global, bool force_stderr)
 
     pthread_mutex_lock(&root->lock);
     root->force_stderr = force_stderr;
-    pthread_mutex_unlock(&root->lock);
+    unlock_root(root);
 }
 
 // Only to be called from the main thread.
@@ -698,12 +913,17 @@ bool mp_msg_has_log_file(struct mpv_global *global)
 void mp_msg_uninit(struct mpv_global *global)
 {
     struct mp_log_root *root = global->log->root;
+    pthread_mutex_lock(&root->lock);
+    drain_ring(root, true);
+    unlock_root(root);
     terminate_log_file_thread(root);
     mp_msg_log_buffer_destroy(root->early_buffer);
     assert(root->num_buffers == 0);
+    talloc_free(root->tracer);
     if (root->stats_file)
         fclose(root->stats_file);
     talloc_free(root->stats_path);
+    talloc_free(root->trace_path);
     talloc_free(root->log_path);
     m_option_type_msglevels.free(&root->msg_levels);
     pthread_mutex_destroy(&root->lock);
@@ -720,7 +940,7 @@ void mp_msg_set_early_logging(struct mpv_global *global, bool enable)
 
     if (enable != !!root->early_buffer) {
         if (enable) {
-            pthread_mutex_unlock(&root->lock);
+            unlock_root(root);
             struct mp_log_buffer *buf =
                 mp_msg_log_buffer_new(global, TERM_BUF, MP_LOG_BUFFER_MSGL_TERM,
                                       NULL, NULL);
@@ -730,13 +950,13 @@ void mp_msg_set_early_logging(struct mpv_global *global, bool enable)
         } else {
             struct mp_log_buffer *buf = root->early_buffer;
             root->early_buffer = NULL;
-            pthread_mutex_unlock(&root->lock);
+            unlock_root(root);
             mp_msg_log_buffer_destroy(buf);
             return;
         }
     }
 
-    pthread_mutex_unlock(&root->lock);
+    unlock_root(root);
 }
 
 struct mp_log_buffer *mp_msg_log_buffer_new(struct mpv_global *global,
@@ -760,7 +980,7 @@ struct mp_log_buffer *mp_msg_log_buffer_new(struct mpv_global *global,
             root->early_buffer = NULL;
             buffer->wakeup_cb = wakeup_cb;
             buffer->wakeup_cb_ctx = wakeup_cb_ctx;
-            pthread_mutex_unlock(&root->lock);
+            unlock_root(root);
             return buffer;
         }
     }
@@ -771,7 +991,7 @@ struct mp_log_buffer *mp_msg_log_buffer_new(struct mpv_global *global,
     *buffer = (struct mp_log_buffer) {
         .root = root,
         .level = level,
-        .entries = talloc_array(buffer, struct mp_log_buffer_entry *, size),
+        .entries = talloc_zero_array(buffer, struct log_buffer_entry, size),
         .capacity = size,
         .wakeup_cb = wakeup_cb,
         .wakeup_cb_ctx = wakeup_cb_ctx,
@@ -782,7 +1002,7 @@ struct mp_log_buffer *mp_msg_log_buffer_new(struct mpv_global *global,
     MP_TARRAY_APPEND(root, root->buffers, root->num_buffers, buffer);
 
     atomic_fetch_add(&root->reload_counter, 1);
-    pthread_mutex_unlock(&root->lock);
+    unlock_root(root);
 
     return buffer;
 }
@@ -814,14 +1034,11 @@ void mp_msg_log_buffer_destroy(struct mp_log_buffer *buffer)
 
 found:
 
-    while (buffer->num_entries)
-        talloc_free(log_buffer_read(buffer));
-
     pthread_mutex_destroy(&buffer->lock);
     talloc_free(buffer);
 
     atomic_fetch_add(&root->reload_counter, 1);
-    pthread_mutex_unlock(&root->lock);
+    unlock_root(root);
 }
 
 // Return a queued message, or if the buffer is empty, NULL.
@@ -844,7 +1061,15 @@ struct mp_log_buffer_entry *mp_msg_log_buffer_read(struct mp_log_buffer *buffer)
             };
             buffer->dropped = 0;
         } else {
-            res = log_buffer_read(buffer);
+            struct log_buffer_entry *entry = &buffer->entries[buffer->entry0];
+            res = talloc_ptrtype(NULL, res);
+            *res = (struct mp_log_buffer_entry) {
+                .prefix = talloc_strdup(res, entry->data),
+                .level = entry->level,
+                .text = talloc_strdup(res, entry->data + strlen(entry->data) + 1),
+            };
+            buffer->entry0 = (buffer->entry0 + 1) % buffer->capacity;
+            buffer->num_entries -= 1;
         }
     }
 
@@ -51,23 +51,286 @@ void playlist_entry_add_params(struct playlist_entry *e,
         playlist_entry_add_param(e, params[n].name, params[n].value);
 }
 
-static void playlist_update_indexes(struct playlist *pl, int start, int end)
+// Entries are stored in blocks of up to MAX_BLOCK_SIZE entries, so inserting
+// or removing an entry only moves and renumbers the entries of one block. The
+// index of the first entry of each block is updated lazily.
+#define BLOCK_SIZE 256
+#define MAX_BLOCK_SIZE (BLOCK_SIZE * 2)
+
+struct playlist_block {
+    struct playlist_entry **entries;
+    int num_entries;
+    int pos;        // pl->blocks[pos] == this
+    int start;      // index of entries[0] (if pos < pl->num_valid_blocks)
+};
+
+static void update_entries(struct playlist_block *b, int start)
 {
-    start = MPMAX(start, 0);
-    end = end < 0 ? pl->num_entries : MPMIN(end, pl->num_entries);
+    for (int n = start; n < b->num_entries; n++) {
+        b->entries[n]->pl_block = b;
+        b->entries[n]->pl_block_index = n;
+    }
+}
+
+static void block_insert(struct playlist_block *b, int at,
+                         struct playlist_entry **entries, int count)
+{
+    MP_TARRAY_INSERT_N_AT(b, b->entries, b->num_entries, at, count);
+    memcpy(&b->entries[at], entries, count * sizeof(entries[0]));
+    update_entries(b, at);
+}
+
+// Call if blocks were added or removed at pos.
+static void update_blocks(struct playlist *pl, int pos)
+{
+    for (int n = pos; n < pl->num_blocks; n++)
+        pl->blocks[n]->pos = n;
+    pl->num_valid_blocks = MPMIN(pl->num_valid_blocks, pos);
+}
+
+// Call if the number of entries in blocks[pos] changed.
+static void invalidate_blocks(struct playlist *pl, int pos)
+{
+    pl->num_valid_blocks = MPMIN(pl->num_valid_blocks, pos + 1);
+}
+
+// Make sure blocks[0] up to blocks[pos] have a valid start index.
+static void validate_blocks(struct playlist *pl, int pos)
+{
+    for (int n = pl->num_valid_blocks; n <= pos; n++) {
+        struct playlist_block *prev = n ? pl->blocks[n - 1] : NULL;
+        pl->blocks[n]->start = prev ? prev->start + prev->num_entries : 0;
+    }
+    pl->num_valid_blocks = MPMAX(pl->num_valid_blocks, pos + 1);
+}
+
+// Return the position of the block containing the entry with the given index.
+static int find_block(struct playlist *pl, int index)
+{
+    assert(index >= 0 && index < pl->num_entries);
+
+    while (1) {
+        int valid = pl->num_valid_blocks;
+        struct playlist_block *last = valid ? pl->blocks[valid - 1] : NULL;
+        if (last && index < last->start + last->num_entries)
+            break;
+        validate_blocks(pl, valid);
+    }
+
+    int lo = 0, hi = pl->num_valid_blocks - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (pl->blocks[mid]->start <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// Merge blocks[pos + 1] into blocks[pos] if they're small enough.
+static void merge_blocks(struct playlist *pl, int pos)
+{
+    if (pos < 0 || pos + 1 >= pl->num_blocks)
+        return;
+    struct playlist_block *a = pl->blocks[pos];
+    struct playlist_block *b = pl->blocks[pos + 1];
+    if (a->num_entries + b->num_entries > BLOCK_SIZE)
+        return;
+    block_insert(a, a->num_entries, b->entries, b->num_entries);
+    MP_TARRAY_REMOVE_AT(pl->blocks, pl->num_blocks, pos + 1);
+    talloc_free(b);
+    update_blocks(pl, pos + 1);
+}
+
+// Insert the given entries at the given index. Only the fields used for the
+// entry position are updated.
+static void insert_entries(struct playlist *pl, int index,
+                           struct playlist_entry **entries, int count)
+{
+    assert(index >= 0 && index <= pl->num_entries);
+    if (!count)
+        return;
+
+    int pos = 0, at = 0;
+    if (index < pl->num_entries) {
+        pos = find_block(pl, index);
+        at = index - pl->blocks[pos]->start;
+    } else if (pl->num_blocks) {
+        pos = pl->num_blocks - 1;
+        at = pl->blocks[pos]->num_entries;
+    }
+    struct playlist_block *b = pl->num_blocks ? pl->blocks[pos] : NULL;
+    pl->num_entries += count;
+
+    if (b && b->num_entries + count <= MAX_BLOCK_SIZE) {
+        block_insert(b, at, entries, count);
+        invalidate_blocks(pl, pos);
+        return;
+    }
+
+    // Split b at the insertion point, and add new blocks between the halves.
+    if (b && at > 0) {
+        pos += 1;
+        if (at < b->num_entries) {
+            struct playlist_block *tail = talloc_zero(pl, struct playlist_block);
+            block_insert(tail, 0, &b->entries[at], b->num_entries - at);
+            b->num_entries = at;
+            MP_TARRAY_INSERT_AT(pl, pl->blocks, pl->num_blocks, pos, tail);
+        }
+    }
+    int num_new = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    MP_TARRAY_INSERT_N_AT(pl, pl->blocks, pl->num_blocks, pos, num_new);
+    for (int n = 0; n < num_new; n++) {
+        struct playlist_block *nb = talloc_zero(pl, struct playlist_block);
+        int offset = n * BLOCK_SIZE;
+        block_insert(nb, 0, &entries[offset], MPMIN(count - offset, BLOCK_SIZE));
+        pl->blocks[pos + n] = nb;
+    }
+    update_blocks(pl, MPMAX(pos - 1, 0));
+}
+
+// Remove the entry from the block structure.
+static void unlink_entry(struct playlist *pl, struct playlist_entry *e)
+{
+    struct playlist_block *b = e->pl_block;
+    int pos = b->pos;
+    MP_TARRAY_REMOVE_AT(b->entries, b->num_entries, e->pl_block_index);
+    update_entries(b, e->pl_block_index);
+    pl->num_entries--;
+    e->pl_block = NULL;
+    e->pl_block_index = -1;
+
+    if (!b->num_entries) {
+        MP_TARRAY_REMOVE_AT(pl->blocks, pl->num_blocks, pos);
+        talloc_free(b);
+        update_blocks(pl, pos);
+    } else {
+        invalidate_blocks(pl, pos);
+        merge_blocks(pl, pos);
+        merge_blocks(pl, pos - 1);
+    }
+}
+
+// Return all entries as an array (allocated with ta_parent).
+static struct playlist_entry **get_entries(void *ta_parent, struct playlist *pl)
+{
+    struct playlist_entry **entries =
+        talloc_array(ta_parent, struct playlist_entry *, pl->num_entries);
+    int num = 0;
+    for (int n = 0; n < pl->num_blocks; n++) {
+        struct playlist_block *b = pl->blocks[n];
+        memcpy(&entries[num], b->entries, b->num_entries * sizeof(entries[0]));
+        num += b->num_entries;
+    }
+    return entries;
+}
+
+// Remove all entries from the block structure.
+static void clear_blocks(struct playlist *pl)
+{
+    for (int n = 0; n < pl->num_blocks; n++)
+        talloc_free(pl->blocks[n]);
+    pl->num_blocks = 0;
+    pl->num_valid_blocks = 0;
+    pl->num_entries = 0;
+}
+
+// Number of changes kept by playlist_get_changes(). If there are more changes
+// in between, the caller has to re-read the whole playlist.
+#define MAX_CHANGES 256
+
+// Remember newly inserted entries for playlist_get_added_entry(). Call before
+// add_change(). IDs are allocated sequentially, so they are contiguous.
+static void add_added(struct playlist *pl, struct playlist_entry **entries,
+                      int count)
+{
+    if (!pl->track_changes || !count)
+        return;
+
+    if (!pl->num_added)
+        pl->added_id = entries[0]->id;
+    assert(pl->added_id + pl->num_added == entries[0]->id);
+    MP_TARRAY_GROW(pl, pl->added, pl->num_added + count - 1);
+    memcpy(&pl->added[pl->num_added], entries, count * sizeof(entries[0]));
+    pl->num_added += count;
+}
+
+static void remove_added(struct playlist *pl, struct playlist_entry *entry)
+{
+    if (entry->id >= pl->added_id && entry->id - pl->added_id < pl->num_added)
+        pl->added[entry->id - pl->added_id] = NULL;
+}
+
+// Drop the entries which are not referenced by recorded changes anymore. The
+// array is compacted only if that frees a large part of it.
+static void trim_added(struct playlist *pl)
+{
+    for (int n = 0; n < pl->num_changes; n++) {
+        struct playlist_change *c = &pl->changes[n];
+        if (c->type == PLAYLIST_CHANGE_INSERT) {
+            int drop = c->id - pl->added_id;
+            if (drop > pl->num_added / 2) {
+                pl->num_added -= drop;
+                memmove(&pl->added[0], &pl->added[drop],
+                        pl->num_added * sizeof(pl->added[0]));
+                pl->added_id = c->id;
+            }
+            return;
+        }
+    }
+    pl->num_added = 0;
+}
+
+static void add_change(struct playlist *pl, struct playlist_change change)
+{
+    if (!pl->track_changes)
+        return;
+
+    change.generation = ++pl->generation;
+    bool dropped = false;
+    if (pl->num_changes >= MAX_CHANGES) {
+        int drop = MAX_CHANGES / 2;
+        pl->changes_base = pl->changes[drop - 1].generation;
+        pl->num_changes -= drop;
+        memmove(&pl->changes[0], &pl->changes[drop],
+                pl->num_changes * sizeof(pl->changes[0]));
+        dropped = true;
+    }
+    MP_TARRAY_APPEND(pl, pl->changes, pl->num_changes, change);
+    if (dropped)
+        trim_added(pl);
+}
 
-    for (int n = start; n < end; n++)
-        pl->entries[n]->pl_index = n;
+// For changes which can't be represented as list of changes.
+static void reset_changes(struct playlist *pl)
+{
+    if (!pl->track_changes)
+        return;
+
+    pl->generation++;
+    pl->num_changes = 0;
+    pl->changes_base = pl->generation;
+    pl->num_added = 0;
 }
 
 void playlist_add(struct playlist *pl, struct playlist_entry *add)
 {
     assert(add->filename);
-    MP_TARRAY_APPEND(pl, pl->entries, pl->num_entries, add);
+    int index = pl->num_entries;
+    insert_entries(pl, index, &add, 1);
     add->pl = pl;
-    add->pl_index = pl->num_entries - 1;
     add->id = ++pl->id_alloc;
     talloc_steal(pl, add);
+
+    add_added(pl, &add, 1);
+    add_change(pl, (struct playlist_change){
+        .type = PLAYLIST_CHANGE_INSERT,
+        .index = index,
+        .count = 1,
+        .id = add->id,
+    });
 }
 
 void playlist_entry_unref(struct playlist_entry *e)
@@ -79,7 +342,7 @@ void playlist_entry_unref(struct playlist_entry *e)
     }
 }
 
-void playlist_remove(struct playlist *pl, struct playlist_entry *entry)
+static void remove_entry(struct playlist *pl, struct playlist_entry *entry)
 {
     assert(pl && entry->pl == pl);
 
@@ -88,31 +351,49 @@ void playlist_remove(struct playlist *pl, struct playlist_entry *entry)
         pl->current_was_replaced = true;
     }
 
-    MP_TARRAY_REMOVE_AT(pl->entries, pl->num_entries, entry->pl_index);
-    playlist_update_indexes(pl, entry->pl_index, -1);
+    unlink_entry(pl, entry);
+    remove_added(pl, entry);
 
     entry->pl = NULL;
-    entry->pl_index = -1;
     ta_set_parent(entry, NULL);
 
     entry->removed = true;
     playlist_entry_unref(entry);
 }
 
+void playlist_remove(struct playlist *pl, struct playlist_entry *entry)
+{
+    struct playlist_change change = {
+        .type = PLAYLIST_CHANGE_REMOVE,
+        .index = playlist_entry_to_index(pl, entry),
+        .id = entry->id,
+    };
+    remove_entry(pl, entry);
+    add_change(pl, change);
+}
+
 void playlist_clear(struct playlist *pl)
 {
-    for (int n = pl->num_entries - 1; n >= 0; n--)
-        playlist_remove(pl, pl->entries[n]);
+    while (pl->num_entries)
+        remove_entry(pl, playlist_get_last(pl));
     assert(!pl->current);
     pl->current_was_replaced = false;
+    add_change(pl, (struct playlist_change){.type = PLAYLIST_CHANGE_CLEAR});
 }
 
 void playlist_clear_except_current(struct playlist *pl)
 {
-    for (int n = pl->num_entries - 1; n >= 0; n--) {
-        if (pl->entries[n] != pl->current)
-            playlist_remove(pl, pl->entries[n]);
+    struct playlist_entry *e = playlist_get_last(pl);
+    while (e) {
+        struct playlist_entry *prev = playlist_entry_get_rel(e, -1);
+        if (e != pl->current)
+            remove_entry(pl, e);
+        e = prev;
     }
+    add_change(pl, (struct playlist_change){
+        .type = PLAYLIST_CHANGE_CLEAR,
+        .id = pl->current ? pl->current->id : 0,
+    });
 }
 
 // Moves the entry so that it takes "at"'s place (or move to end, if at==NULL).
@@ -125,16 +406,20 @@ void playlist_move(struct playlist *pl, struct playlist_entry *entry,
     assert(entry && entry->pl == pl);
     assert(!at || at->pl == pl);
 
-    int index = at ? at->pl_index : pl->num_entries;
-    MP_TARRAY_INSERT_AT(pl, pl->entries, pl->num_entries, index, entry);
+    int index = at ? playlist_entry_to_index(pl, at) : pl->num_entries;
+    int old_index = playlist_entry_to_index(pl, entry);
+    if (old_index < index)
+        index -= 1;
 
-    int old_index = entry->pl_index;
-    if (old_index >= index)
-        old_index += 1;
-    MP_TARRAY_REMOVE_AT(pl->entries, pl->num_entries, old_index);
+    unlink_entry(pl, entry);
+    insert_entries(pl, index, &entry, 1);
 
-    playlist_update_indexes(pl, MPMIN(index - 1, old_index - 1),
-                                MPMAX(index + 1, old_index + 1));
+    add_change(pl, (struct playlist_change){
+        .type = PLAYLIST_CHANGE_MOVE,
+        .index = old_index,
+        .new_index = index,
+        .id = entry->id,
+    });
 }
 
 void playlist_add_file(struct playlist *pl, const char *filename)
@@ -144,44 +429,70 @@ void playlist_add_file(struct playlist *pl, const char *filename)
 
 void playlist_shuffle(struct playlist *pl)
 {
-    for (int n = 0; n < pl->num_entries; n++)
-        pl->entries[n]->original_index = n;
-    for (int n = 0; n < pl->num_entries - 1; n++) {
-        int j = (int)((double)(pl->num_entries - n) * rand() / (RAND_MAX + 1.0));
-        MPSWAP(struct playlist_entry *, pl->entries[n], pl->entries[n + j]);
+    int num = pl->num_entries;
+    struct playlist_entry **entries = get_entries(NULL, pl);
+    for (int n = 0; n < num; n++)
+        entries[n]->original_index = n;
+    for (int n = 0; n < num - 1; n++) {
+        int j = (int)((double)(num - n) * rand() / (RAND_MAX + 1.0));
+        MPSWAP(struct playlist_entry *, entries[n], entries[n + j]);
     }
-    playlist_update_indexes(pl, 0, -1);
+    clear_blocks(pl);
+    insert_entries(pl, 0, entries, num);
+    talloc_free(entries);
+    reset_changes(pl);
 }
 
 #define CMP_INT(a, b) ((a) == (b) ? 0 : ((a) > (b) ? 1 : -1))
 
+struct unshuffle_item {
+    struct playlist_entry *e;
+    int index;
+};
+
 static int cmp_unshuffle(const void *a, const void *b)
 {
-    struct playlist_entry *ea = *(struct playlist_entry **)a;
-    struct playlist_entry *eb = *(struct playlist_entry **)b;
+    const struct unshuffle_item *ia = a;
+    const struct unshuffle_item *ib = b;
+    struct playlist_entry *ea = ia->e;
+    struct playlist_entry *eb = ib->e;
 
     if (ea->original_index >= 0 && ea->original_index != eb->original_index)
         return CMP_INT(ea->original_index, eb->original_index);
-    return CMP_INT(ea->pl_index, eb->pl_index);
+    return CMP_INT(ia->index, ib->index);
 }
 
 void playlist_unshuffle(struct playlist *pl)
 {
-    if (pl->num_entries)
-        qsort(pl->entries, pl->num_entries, sizeof(pl->entries[0]), cmp_unshuffle);
-    playlist_update_indexes(pl, 0, -1);
+    int num = pl->num_entries;
+    struct playlist_entry **entries = get_entries(NULL, pl);
+    struct unshuffle_item *items =
+        talloc_array(entries, struct unshuffle_item, num);
+    for (int n = 0; n < num; n++)
+        items[n] = (struct unshuffle_item){entries[n], n};
+    if (num)
+        qsort(items, num, sizeof(items[0]), cmp_unshuffle);
+    for (int n = 0; n < num; n++)
+        entries[n] = items[n].e;
+    clear_blocks(pl);
+    insert_entries(pl, 0, entries, num);
+    talloc_free(entries);
+    reset_changes(pl);
 }
 
 // (Explicitly ignores current_was_replaced.)
 struct playlist_entry *playlist_get_first(struct playlist *pl)
 {
-    return pl->num_entries ? pl->entries[0] : NULL;
+    return pl->num_blocks ? pl->blocks[0]->entries[0] : NULL;
 }
 
 // (Explicitly ignores current_was_replaced.)
 struct playlist_entry *playlist_get_last(struct playlist *pl)
 {
-    return pl->num_entries ? pl->entries[pl->num_entries - 1] : NULL;
+    if (!pl->num_blocks)
+        return NULL;
+    struct playlist_block *b = pl->blocks[pl->num_blocks - 1];
+    return b->entries[b->num_entries - 1];
 }
 
 struct playlist_entry *playlist_get_next(struct playlist *pl, int direction)
@@ -203,15 +514,25 @@ struct playlist_entry *playlist_entry_get_rel(struct playlist_entry *e,
     assert(direction == -1 || direction == +1);
     if (!e->pl)
         return NULL;
-    return playlist_entry_from_index(e->pl, e->pl_index + direction);
+    struct playlist *pl = e->pl;
+    struct playlist_block *b = e->pl_block;
+    int index = e->pl_block_index + direction;
+    if (index >= 0 && index < b->num_entries)
+        return b->entries[index];
+    int pos = b->pos + direction;
+    if (pos < 0 || pos >= pl->num_blocks)
+        return NULL;
+    b = pl->blocks[pos];
+    return b->entries[direction > 0 ? 0 : b->num_entries - 1];
 }
 
 void playlist_add_base_path(struct playlist *pl, bstr base_path)
 {
     if (base_path.len == 0 || bstrcmp0(base_path, ".") == 0)
         return;
-    for (int n = 0; n < pl->num_entries; n++) {
-        struct playlist_entry *e = pl->entries[n];
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+    {
         if (!mp_is_url(bstr0(e->filename))) {
             char *new_file = mp_path_join_bstr(e, base_path, bstr0(e->filename));
             talloc_free(e->filename);
@@ -223,8 +544,9 @@ void playlist_add_base_path(struct playlist *pl, bstr base_path)
 // Add redirected_from as new redirect entry to each item in pl.
 void playlist_add_redirect(struct playlist *pl, const char *redirected_from)
 {
-    for (int n = 0; n < pl->num_entries; n++) {
-        struct playlist_entry *e = pl->entries[n];
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+    {
         if (e->num_redirects >= 10) // arbitrary limit for sanity
             continue;
         char *s = talloc_strdup(e, redirected_from);
@@ -235,8 +557,9 @@ void playlist_add_redirect(struct playlist *pl, const char *redirected_from)
 
 void playlist_set_stream_flags(struct playlist *pl, int flags)
 {
-    for (int n = 0; n < pl->num_entries; n++)
-        pl->entries[n]->stream_flags = flags;
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+        e->stream_flags = flags;
 }
 
 static int64_t playlist_transfer_entries_to(struct playlist *pl, int dst_index,
@@ -246,19 +569,27 @@ static int64_t playlist_transfer_entries_to(struct playlist *pl, int dst_index,
     struct playlist_entry *first = playlist_get_first(source_pl);
 
     int count = source_pl->num_entries;
-    MP_TARRAY_INSERT_N_AT(pl, pl->entries, pl->num_entries, dst_index, count);
+    struct playlist_entry **entries = get_entries(NULL, source_pl);
+    clear_blocks(source_pl);
 
     for (int n = 0; n < count; n++) {
-        struct playlist_entry *e = source_pl->entries[n];
+        struct playlist_entry *e = entries[n];
         e->pl = pl;
-        e->pl_index = dst_index + n;
         e->id = ++pl->id_alloc;
-        pl->entries[e->pl_index] = e;
         talloc_steal(pl, e);
     }
-
-    playlist_update_indexes(pl, dst_index + count, -1);
-    source_pl->num_entries = 0;
+    insert_entries(pl, dst_index, entries, count);
+    add_added(pl, entries, count);
+    talloc_free(entries);
+
+    if (count) {
+        add_change(pl, (struct playlist_change){
+            .type = PLAYLIST_CHANGE_INSERT,
+            .index = dst_index,
+            .count = count,
+            .id = first->id,
+        });
+    }
 
     return first ? first->id : 0;
 }
@@ -273,7 +604,7 @@ int64_t playlist_transfer_entries(struct playlist *pl, struct playlist *source_p
 
     int add_at = pl->num_entries;
     if (pl->current) {
-        add_at = pl->current->pl_index + 1;
+        add_at = playlist_entry_to_index(pl, pl->current) + 1;
         if (pl->current_was_replaced)
             add_at += 1;
     }
@@ -294,7 +625,9 @@ int playlist_entry_to_index(struct playlist *pl, struct playlist_entry *e)
 {
     if (!e || e->pl != pl)
         return -1;
-    return e->pl_index;
+    struct playlist_block *b = e->pl_block;
+    validate_blocks(pl, b->pos);
+    return b->start + e->pl_block_index;
 }
 
 int playlist_entry_count(struct playlist *pl)
@@ -306,7 +639,35 @@ int playlist_entry_count(struct playlist *pl)
 // Return NULL if not found.
 struct playlist_entry *playlist_entry_from_index(struct playlist *pl, int index)
 {
-    return index >= 0 && index < pl->num_entries ? pl->entries[index] : NULL;
+    if (index < 0 || index >= pl->num_entries)
+        return NULL;
+    struct playlist_block *b = pl->blocks[find_block(pl, index)];
+    return b->entries[index - b->start];
+}
+
+// Return the changes done after the given generation (pl->generation at the
+// time), oldest first. *out points into pl and is valid until the next change.
+// Returns the number of changes, or -1 if they were not recorded or are not
+// remembered anymore; the caller has to re-read the entire playlist then.
+int playlist_get_changes(struct playlist *pl, uint64_t since,
+                         struct playlist_change **out)
+{
+    if (!pl->track_changes || since < pl->changes_base || since > pl->generation)
+        return -1;
+    int start = since - pl->changes_base;
+    *out = pl->changes + start;
+    return pl->num_changes - start;
+}
+
+// Return the entry with the given ID, which must be one of the IDs inserted by
+// a change returned by playlist_get_changes(). Returns NULL if the entry was
+// removed again.
+struct playlist_entry *playlist_get_added_entry(struct playlist *pl,
+                                                uint64_t id)
+{
+    if (id < pl->added_id || id - pl->added_id >= pl->num_added)
+        return NULL;
+    return pl->added[id - pl->added_id];
 }
 
 struct playlist *playlist_parse_file(const char *file, struct mp_cancel *cancel,
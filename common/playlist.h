@@ -26,9 +26,11 @@ struct playlist_param {
 };
 
 struct playlist_entry {
-    // Invariant: (pl && pl->entries[pl_index] == this) || (!pl && pl_index < 0)
+    // Invariant: (pl && pl_block) || (!pl && !pl_block)
     struct playlist *pl;
-    int pl_index;
+    // Position within pl; use playlist_entry_to_index() to get the index.
+    struct playlist_block *pl_block;
+    int pl_block_index;
 
     uint64_t id;
 
@@ -64,8 +66,30 @@ struct playlist_entry {
     int stream_flags;
 };
 
+enum playlist_change_type {
+    PLAYLIST_CHANGE_INSERT,     // count entries with IDs id..id+count-1 were
+                                // inserted at index
+    PLAYLIST_CHANGE_REMOVE,     // entry id was removed from index
+    PLAYLIST_CHANGE_MOVE,       // entry id was moved from index to new_index
+    PLAYLIST_CHANGE_CLEAR,      // all entries were removed, except id (if != 0)
+};
+
+struct playlist_change {
+    uint64_t generation;        // playlist generation after this change
+    enum playlist_change_type type;
+    int index;
+    int new_index;
+    int count;
+    uint64_t id;
+};
+
 struct playlist {
-    struct playlist_entry **entries;
+    // Entries are split into blocks (internal to playlist.c). Use
+    // playlist_entry_from_index() or playlist_get_first() and
+    // playlist_entry_get_rel() to access them.
+    struct playlist_block **blocks;
+    int num_blocks;
+    int num_valid_blocks;
     int num_entries;
 
     // This provides some sort of stable iterator. If this entry is removed from
@@ -75,6 +99,22 @@ struct playlist {
     bool current_was_replaced;
 
     uint64_t id_alloc;
+
+    // If set, changes to the entry list are recorded, and every change
+    // increments generation. Must be set before the first change.
+    bool track_changes;
+    uint64_t generation;
+    // Recent changes, oldest first. changes[n].generation == changes_base+n+1.
+    // Changes that can't be represented (like shuffling) drop all entries.
+    struct playlist_change *changes;
+    int num_changes;
+    uint64_t changes_base;
+    // Entries inserted by the INSERT changes in changes: added[n] is the entry
+    // with the ID added_id+n, or NULL if it was removed again. Entries before
+    // the oldest recorded INSERT change are stale until they are compacted.
+    struct playlist_entry **added;
+    int num_added;
+    uint64_t added_id;
 };
 
 void playlist_entry_add_param(struct playlist_entry *e, bstr name, bstr value);
@@ -110,6 +150,11 @@ int playlist_entry_to_index(struct playlist *pl, struct playlist_entry *e);
 int playlist_entry_count(struct playlist *pl);
 struct playlist_entry *playlist_entry_from_index(struct playlist *pl, int index);
 
+int playlist_get_changes(struct playlist *pl, uint64_t since,
+                         struct playlist_change **out);
+struct playlist_entry *playlist_get_added_entry(struct playlist *pl,
+                                                uint64_t id);
+
 struct mp_cancel;
 struct mpv_global;
 struct playlist *playlist_parse_file(const char *file, struct mp_cancel *cancel,
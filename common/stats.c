@@ -4,9 +4,11 @@
 
 #include "common.h"
 #include "global.h"
+#include "misc/histogram.h"
 #include "misc/linked_list.h"
 #include "misc/node.h"
 #include "msg.h"
+#include "options/m_config_core.h"
 #include "options/m_option.h"
 #include "osdep/atomic.h"
 #include "osdep/timer.h"
@@ -16,6 +18,7 @@ struct stats_base {
     struct mpv_global *global;
 
     atomic_bool active;
+    atomic_bool handlers_active; // see stats_handlers_enabled()
 
     pthread_mutex_t lock;
 
@@ -27,6 +30,7 @@ struct stats_base {
     int num_entries;
 
     int64_t last_time;
+    uint64_t last_option_checks, last_option_scans;
 };
 
 struct stats_ctx {
@@ -48,10 +52,12 @@ enum val_type {
     VAL_INC,
     VAL_TIME,
     VAL_THREAD_CPU_TIME,
+    VAL_LATENCY,
+    VAL_HANDLER,
 };
 
 struct stat_entry {
-    char name[32];
+    char name[64];
     const char *full_name; // including stats_ctx.prefix
 
     enum val_type type;
@@ -61,11 +67,17 @@ struct stat_entry {
     int64_t time_start_us;
     int64_t cpu_start_ns;
     pthread_t thread;
+    struct mp_histogram *hist; // VAL_LATENCY
+    // VAL_HANDLER
+    int64_t calls, total_us, max_us, max_latency_us;
 };
 
 #define IS_ACTIVE(ctx) \
     (atomic_load_explicit(&(ctx)->base->active, memory_order_relaxed))
 
+#define HANDLERS_ACTIVE(ctx) \
+    (atomic_load_explicit(&(ctx)->base->handlers_active, memory_order_relaxed))
+
 // Overflows only after I'm dead.
 static int64_t get_thread_cpu_time_ns(pthread_t thread)
 {
@@ -121,15 +133,9 @@ static int cmp_entry(const void *p1, const void *p2)
     return strcmp((*e1)->full_name, (*e2)->full_name);
 }
 
-void stats_global_query(struct mpv_global *global, struct mpv_node *out)
+// Rebuild the sorted list of all entries if it was invalidated.
+static void update_entries(struct stats_base *stats)
 {
-    struct stats_base *stats = global->stats;
-    assert(stats);
-
-    pthread_mutex_lock(&stats->lock);
-
-    atomic_store(&stats->active, true);
-
     if (!stats->num_entries) {
         for (struct stats_ctx *ctx = stats->list.head; ctx; ctx = ctx->list.next)
         {
@@ -143,6 +149,28 @@ void stats_global_query(struct mpv_global *global, struct mpv_node *out)
                   cmp_entry);
         }
     }
+}
+
+static void add_rate(struct mpv_node *list, const char *name, uint64_t count,
+                     double t_ms)
+{
+    double rate = t_ms > 0 ? count / (t_ms / 1e3) : 0;
+    struct mpv_node *ne = node_array_add(list, MPV_FORMAT_NODE_MAP);
+    node_map_add_string(ne, "name", name);
+    node_map_add_double(ne, "value", rate);
+    node_map_add_string(ne, "text", mp_tprintf(80, "%.1f/s", rate));
+}
+
+void stats_global_query(struct mpv_global *global, struct mpv_node *out)
+{
+    struct stats_base *stats = global->stats;
+    assert(stats);
+
+    pthread_mutex_lock(&stats->lock);
+
+    atomic_store(&stats->active, true);
+
+    update_entries(stats);
 
     node_init(out, MPV_FORMAT_NODE_ARRAY, NULL);
 
@@ -154,6 +182,15 @@ void stats_global_query(struct mpv_global *global, struct mpv_node *out)
         node_map_add_double(ne, "value", t_ms);
         node_map_add_string(ne, "text", mp_tprintf(80, "%.2f ms", t_ms));
 
+        if (global->config) {
+            uint64_t checks, scans;
+            m_config_shadow_get_stats(global->config, &checks, &scans);
+            add_rate(out, "options/cache-checks",
+                     checks - stats->last_option_checks, t_ms);
+            add_rate(out, "options/cache-scans",
+                     scans - stats->last_option_scans, t_ms);
+        }
+
         // Very dirty way to reset everything if the stats.lua page was probably
         // closed. Not enough energy left for clean solution. Fuck it.
         if (t_ms > 2000) {
@@ -162,12 +199,17 @@ void stats_global_query(struct mpv_global *global, struct mpv_node *out)
 
                 e->cpu_start_ns = 0;
                 e->val_rt = e->val_th = 0;
-                if (e->type != VAL_THREAD_CPU_TIME)
+                if (e->type != VAL_THREAD_CPU_TIME && e->type != VAL_LATENCY &&
+                    e->type != VAL_HANDLER)
                     e->type = 0;
             }
         }
     }
     stats->last_time = now;
+    if (global->config) {
+        m_config_shadow_get_stats(global->config, &stats->last_option_checks,
+                                  &stats->last_option_scans);
+    }
 
     for (int n = 0; n < stats->num_entries; n++) {
         struct stat_entry *e = stats->entries[n];
@@ -210,6 +252,120 @@ void stats_global_query(struct mpv_global *global, struct mpv_node *out)
     pthread_mutex_unlock(&stats->lock);
 }
 
+static void add_latency(struct mpv_node *list, const char *name,
+                        struct mp_histogram *h)
+{
+    struct mpv_node *ne = node_map_add(list, name, MPV_FORMAT_NODE_MAP);
+    node_map_add_int64(ne, "count", h->count);
+    node_map_add_double(ne, "min", h->min / 1e3);
+    node_map_add_double(ne, "max", h->max / 1e3);
+    node_map_add_double(ne, "mean", h->sum / h->count / 1e3);
+    static const struct { const char *name; double p; } percentiles[] = {
+        {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p99.9", 0.999},
+    };
+    for (int n = 0; n < MP_ARRAY_SIZE(percentiles); n++) {
+        node_map_add_double(ne, percentiles[n].name,
+                    mp_histogram_percentile(h, percentiles[n].p) / 1e3);
+    }
+}
+
+void stats_global_query_latency(struct mpv_global *global, struct mpv_node *out)
+{
+    struct stats_base *stats = global->stats;
+    assert(stats);
+
+    pthread_mutex_lock(&stats->lock);
+
+    atomic_store(&stats->active, true);
+
+    update_entries(stats);
+
+    node_init(out, MPV_FORMAT_NODE_MAP, NULL);
+
+    // Entries with the same name (e.g. from multiple decoders of the same
+    // type) are sorted next to each other, and are reported as one.
+    struct mp_histogram *h = talloc_zero(NULL, struct mp_histogram);
+    for (int n = 0; n < stats->num_entries; n++) {
+        struct stat_entry *e = stats->entries[n];
+        if (e->type != VAL_LATENCY)
+            continue;
+        mp_histogram_merge(h, e->hist);
+        struct stat_entry *next =
+            n + 1 < stats->num_entries ? stats->entries[n + 1] : NULL;
+        if (next && strcmp(next->full_name, e->full_name) == 0)
+            continue;
+        if (h->count)
+            add_latency(out, e->full_name, h);
+        *h = (struct mp_histogram){0};
+    }
+    talloc_free(h);
+
+    pthread_mutex_unlock(&stats->lock);
+}
+
+void stats_global_query_handlers(struct mpv_global *global,
+                                 struct mpv_node *out)
+{
+    struct stats_base *stats = global->stats;
+    assert(stats);
+
+    pthread_mutex_lock(&stats->lock);
+
+    atomic_store(&stats->active, true);
+    atomic_store(&stats->handlers_active, true);
+
+    update_entries(stats);
+
+    node_init(out, MPV_FORMAT_NODE_MAP, NULL);
+
+    for (int n = 0; n < stats->num_entries; n++) {
+        struct stat_entry *e = stats->entries[n];
+        if (e->type != VAL_HANDLER)
+            continue;
+        struct mpv_node *ne = node_map_add(out, e->full_name,
+                                           MPV_FORMAT_NODE_MAP);
+        node_map_add_int64(ne, "calls", e->calls);
+        node_map_add_double(ne, "time", e->total_us / 1e3);
+        node_map_add_double(ne, "max-time", e->max_us / 1e3);
+        node_map_add_double(ne, "max-latency", e->max_latency_us / 1e3);
+    }
+
+    pthread_mutex_unlock(&stats->lock);
+}
+
+void stats_global_enable_handlers(struct mpv_global *global, bool enable)
+{
+    struct stats_base *stats = global->stats;
+    assert(stats);
+
+    if (enable)
+        atomic_store(&stats->active, true);
+    atomic_store(&stats->handlers_active, enable);
+}
+
+void stats_global_query_thread_cputime(struct mpv_global *global,
+                                       struct mpv_node *out)
+{
+    struct stats_base *stats = global->stats;
+    assert(stats);
+
+    pthread_mutex_lock(&stats->lock);
+
+    update_entries(stats);
+
+    node_init(out, MPV_FORMAT_NODE_MAP, NULL);
+
+    for (int n = 0; n < stats->num_entries; n++) {
+        struct stat_entry *e = stats->entries[n];
+        if (e->type == VAL_THREAD_CPU_TIME) {
+            node_map_add_double(out, e->full_name,
+                                get_thread_cpu_time_ns(e->thread) / 1e9);
+        }
+    }
+
+    pthread_mutex_unlock(&stats->lock);
+}
+
 static void stats_ctx_destroy(void *p)
 {
     struct stats_ctx *ctx = p;
@@ -319,6 +475,46 @@ void stats_event(struct stats_ctx *ctx, const char *name)
     pthread_mutex_unlock(&ctx->base->lock);
 }
 
+void stats_latency(struct stats_ctx *ctx, const char *name, int64_t start_us)
+{
+    if (!IS_ACTIVE(ctx) || start_us <= 0)
+        return;
+    int64_t t = mp_time_us() - start_us;
+    pthread_mutex_lock(&ctx->base->lock);
+    struct stat_entry *e = find_entry(ctx, name);
+    if (!e->hist)
+        e->hist = talloc_zero(e, struct mp_histogram);
+    mp_histogram_add(e->hist, t);
+    e->type = VAL_LATENCY;
+    pthread_mutex_unlock(&ctx->base->lock);
+}
+
+bool stats_handlers_enabled(struct stats_ctx *ctx)
+{
+    return HANDLERS_ACTIVE(ctx);
+}
+
+void stats_handler(struct stats_ctx *ctx, const char *name, int64_t start_us,
+                   int64_t queued_us)
+{
+    if (!HANDLERS_ACTIVE(ctx))
+        return;
+    int64_t now = mp_time_us();
+    int64_t t = now - start_us;
+    int64_t latency = now - (queued_us > 0 ? queued_us : start_us);
+    // Handler names come from scripts and can be arbitrarily long.
+    char buf[sizeof(((struct stat_entry *)NULL)->name)];
+    snprintf(buf, sizeof(buf), "%s", name);
+    pthread_mutex_lock(&ctx->base->lock);
+    struct stat_entry *e = find_entry(ctx, buf);
+    e->calls += 1;
+    e->total_us += t;
+    e->max_us = MPMAX(e->max_us, t);
+    e->max_latency_us = MPMAX(e->max_latency_us, latency);
+    e->type = VAL_HANDLER;
+    pthread_mutex_unlock(&ctx->base->lock);
+}
+
 static void register_thread(struct stats_ctx *ctx, const char *name,
                             enum val_type type)
 {
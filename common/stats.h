@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
+
 struct mpv_global;
 struct mpv_node;
 struct stats_ctx;
@@ -7,6 +9,25 @@ struct stats_ctx;
 void stats_global_init(struct mpv_global *global);
 void stats_global_query(struct mpv_global *global, struct mpv_node *out);
 
+// Return a map of all stats_latency() entries. Each value is a map with the
+// count, min, max, mean and percentiles of the recorded times in milliseconds.
+void stats_global_query_latency(struct mpv_global *global, struct mpv_node *out);
+
+// Return a map of all stats_handler() entries. Each value is a map with the
+// number of calls, and the total time, maximum time and maximum latency in
+// milliseconds. Enables stats_handler() recording.
+void stats_global_query_handlers(struct mpv_global *global,
+                                 struct mpv_node *out);
+
+// Enable or disable stats_handler() recording without a query.
+void stats_global_enable_handlers(struct mpv_global *global, bool enable);
+
+// Return a map of the total CPU time in seconds of each thread currently
+// registered with stats_register_thread_cputime(). Does not enable the other
+// stats.
+void stats_global_query_thread_cputime(struct mpv_global *global,
+                                       struct mpv_node *out);
+
 // stats_ctx can be free'd with ta_free(), or by using the ta_parent.
 struct stats_ctx *stats_ctx_create(void *ta_parent, struct mpv_global *global,
                                    const char *prefix);
@@ -22,6 +43,24 @@ void stats_size_value(struct stats_ctx *ctx, const char *name, double val);
 void stats_time_start(struct stats_ctx *ctx, const char *name);
 void stats_time_end(struct stats_ctx *ctx, const char *name);
 
+// Add the time in microseconds between start_us (a mp_time_us() timestamp) and
+// now to a histogram. Unlike the other values, the histogram is not reset
+// between queries. Ignored if start_us is 0. Used for latencies between
+// pipeline stages, for which start_us is set by the previous stage.
+void stats_latency(struct stats_ctx *ctx, const char *name, int64_t start_us);
+
+// Whether stats_handler() records anything. Callers use this to skip timing
+// the handlers at all.
+bool stats_handlers_enabled(struct stats_ctx *ctx);
+
+// Record a call of a script event handler (or similar) that started running
+// at start_us, and finished now. queued_us is the time at which the event the
+// handler reacts to was queued, or 0 if unknown; the latency is the time from
+// then until the handler finished. Like stats_latency(), the values are not
+// reset between queries.
+void stats_handler(struct stats_ctx *ctx, const char *name, int64_t start_us,
+                   int64_t queued_us);
+
 // Display number of events per poll period.
 void stats_event(struct stats_ctx *ctx, const char *name);
 
@@ -0,0 +1,387 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "misc/bstr.h"
+#include "misc/json.h"
+#include "misc/spsc_queue.h"
+#include "osdep/atomic.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
+#include "trace.h"
+
+#define THREAD_BUFFER_SIZE 8192     // records per thread
+#define NAME_CACHE_SIZE 64          // per thread, power of 2
+#define FLUSH_INTERVAL 0.1          // seconds
+
+struct trace_record {
+    int64_t time;
+    double value;
+    int name;
+    int type;
+};
+
+struct trace_name {
+    char *name;
+    char *json;                     // name as quoted JSON string
+};
+
+struct trace_thread {
+    // -- immutable
+    int tid;
+    char *name_json;
+    struct mp_spsc_queue *queue;    // produced by the thread, consumed by flush()
+    // -- atomic
+    atomic_bool exited;
+    atomic_ulong dropped;
+    // -- protected by mp_tracer.lock
+    bool announced;
+    unsigned long dropped_reported;
+    // -- owning thread only
+    struct {
+        const char *name;           // points to trace_name.name
+        int id;
+    } cache[NAME_CACHE_SIZE];
+};
+
+struct mp_tracer {
+    pthread_key_t key;
+    atomic_bool active;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+
+    // -- protected by lock
+    struct trace_name *names;
+    int num_names;
+    int *name_table;                // open addressing, name index + 1 (0: empty)
+    int name_table_size;
+    struct trace_thread **threads;
+    int num_threads;
+    int tid_alloc;
+    FILE *file;
+    bool need_comma;
+    bool terminate;
+
+    // -- only accessed by mp_tracer_set_file() caller
+    bool thread_running;
+    pthread_t thread;
+};
+
+static uint32_t hash_name(const char *name)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    for (; *name; name++)
+        h = (h ^ (unsigned char)*name) * 16777619u;
+    return h;
+}
+
+static void add_to_table(struct mp_tracer *t, int id, uint32_t hash)
+{
+    int mask = t->name_table_size - 1;
+    int i = hash & mask;
+    while (t->name_table[i])
+        i = (i + 1) & mask;
+    t->name_table[i] = id + 1;
+}
+
+// Call with lock held.
+static int intern_name(struct mp_tracer *t, const char *name, uint32_t hash)
+{
+    int mask = t->name_table_size - 1;
+    for (int i = hash & mask; t->name_table_size && t->name_table[i];
+         i = (i + 1) & mask)
+    {
+        int id = t->name_table[i] - 1;
+        if (strcmp(t->names[id].name, name) == 0)
+            return id;
+    }
+
+    if ((t->num_names + 1) * 2 > t->name_table_size) {
+        talloc_free(t->name_table);
+        t->name_table_size = MPMAX(64, t->name_table_size * 2);
+        t->name_table = talloc_zero_array(t, int, t->name_table_size);
+        for (int n = 0; n < t->num_names; n++)
+            add_to_table(t, n, hash_name(t->names[n].name));
+    }
+
+    struct trace_name entry = {.name = talloc_strdup(t, name)};
+    entry.json = talloc_strdup(t, "");
+    json_write(&entry.json, &(struct mpv_node){
+        .format = MPV_FORMAT_STRING,
+        .u.string = entry.name,
+    });
+    MP_TARRAY_APPEND(t, t->names, t->num_names, entry);
+    add_to_table(t, t->num_names - 1, hash);
+    return t->num_names - 1;
+}
+
+static void thread_exit(void *p)
+{
+    struct trace_thread *tt = p;
+    atomic_store(&tt->exited, true);
+}
+
+static struct trace_thread *new_thread(struct mp_tracer *t, const char *name)
+{
+    pthread_mutex_lock(&t->lock);
+    struct trace_thread *tt = talloc_zero(t, struct trace_thread);
+    tt->tid = ++t->tid_alloc;
+    tt->name_json = talloc_strdup(tt, "");
+    json_write(&tt->name_json, &(struct mpv_node){
+        .format = MPV_FORMAT_STRING,
+        .u.string = (char *)(name ? name : "unknown"),
+    });
+    tt->queue = mp_spsc_queue_create(tt, sizeof(struct trace_record),
+                                     THREAD_BUFFER_SIZE);
+    atomic_store(&tt->exited, false);
+    atomic_store(&tt->dropped, 0);
+    MP_TARRAY_APPEND(t, t->threads, t->num_threads, tt);
+    pthread_mutex_unlock(&t->lock);
+
+    pthread_setspecific(t->key, tt);
+    return tt;
+}
+
+static void write_record(struct mp_tracer *t, struct trace_thread *tt,
+                         struct trace_record *r)
+{
+    static const char phases[] = {
+        [MP_TRACE_BEGIN]    = 'B',
+        [MP_TRACE_END]      = 'E',
+        [MP_TRACE_INSTANT]  = 'i',
+        [MP_TRACE_VALUE]    = 'C',
+    };
+
+    if (r->type == MP_TRACE_VALUE && !isfinite(r->value))
+        return; // not representable in JSON
+
+    fprintf(t->file, "%s{\"ph\":\"%c\",\"name\":%s,\"ts\":%"PRId64","
+            "\"pid\":1,\"tid\":%d", t->need_comma ? ",\n" : "",
+            phases[r->type], t->names[r->name].json, r->time, tt->tid);
+    if (r->type == MP_TRACE_INSTANT)
+        fprintf(t->file, ",\"s\":\"t\"");
+    if (r->type == MP_TRACE_VALUE)
+        fprintf(t->file, ",\"args\":{\"value\":%f}", r->value);
+    fprintf(t->file, "}");
+    t->need_comma = true;
+}
+
+// Move all buffered records to the file, and free the state of exited threads.
+// Call with lock held. This is the only consumer of the thread buffers.
+static void flush(struct mp_tracer *t)
+{
+    for (int n = t->num_threads - 1; n >= 0; n--) {
+        struct trace_thread *tt = t->threads[n];
+        bool exited = atomic_load(&tt->exited);
+
+        if (t->file) {
+            struct trace_record *r = mp_spsc_queue_peek(tt->queue);
+            if (r && !tt->announced) {
+                fprintf(t->file, "%s{\"ph\":\"M\",\"name\":\"thread_name\","
+                        "\"pid\":1,\"tid\":%d,\"args\":{\"name\":%s}}",
+                        t->need_comma ? ",\n" : "", tt->tid, tt->name_json);
+                t->need_comma = true;
+                tt->announced = true;
+            }
+            for (; r; r = mp_spsc_queue_peek(tt->queue)) {
+                write_record(t, tt, r);
+                mp_spsc_queue_pop(tt->queue);
+            }
+            unsigned long dropped = atomic_load(&tt->dropped);
+            if (dropped != tt->dropped_reported) {
+                fprintf(t->file, "%s{\"ph\":\"C\",\"name\":\"trace-dropped\","
+                        "\"ts\":%"PRId64",\"pid\":1,\"tid\":%d,"
+                        "\"args\":{\"value\":%lu}}", t->need_comma ? ",\n" : "",
+                        mp_time_us(), tt->tid, dropped);
+                t->need_comma = true;
+                tt->dropped_reported = dropped;
+            }
+        }
+
+        if (exited) {
+            MP_TARRAY_REMOVE_AT(t->threads, t->num_threads, n);
+            talloc_free(tt);
+        }
+    }
+    if (t->file)
+        fflush(t->file);
+}
+
+static void *flush_thread(void *p)
+{
+    struct mp_tracer *t = p;
+
+    mpthread_set_name("trace");
+
+    pthread_mutex_lock(&t->lock);
+    while (!t->terminate) {
+        int64_t end = mp_add_timeout(mp_time_us(), FLUSH_INTERVAL);
+        struct timespec ts = mp_time_us_to_timespec(end);
+        pthread_cond_timedwait(&t->wakeup, &t->lock, &ts);
+        flush(t);
+    }
+    pthread_mutex_unlock(&t->lock);
+
+    return NULL;
+}
+
+static void destroy_tracer(void *p)
+{
+    struct mp_tracer *t = p;
+
+    mp_tracer_set_file(t, NULL);
+    // Threads which still exist won't call thread_exit() anymore.
+    pthread_key_delete(t->key);
+    pthread_cond_destroy(&t->wakeup);
+    pthread_mutex_destroy(&t->lock);
+}
+
+struct mp_tracer *mp_tracer_create(void *ta_parent)
+{
+    struct mp_tracer *t = talloc_zero(ta_parent, struct mp_tracer);
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->wakeup, NULL);
+    if (pthread_key_create(&t->key, thread_exit)) {
+        pthread_cond_destroy(&t->wakeup);
+        pthread_mutex_destroy(&t->lock);
+        talloc_free(t);
+        return NULL;
+    }
+    atomic_store(&t->active, false);
+    talloc_set_destructor(t, destroy_tracer);
+    return t;
+}
+
+bool mp_tracer_set_file(struct mp_tracer *t, const char *path)
+{
+    atomic_store(&t->active, false);
+
+    if (t->thread_running) {
+        pthread_mutex_lock(&t->lock);
+        t->terminate = true;
+        pthread_cond_signal(&t->wakeup);
+        pthread_mutex_unlock(&t->lock);
+        pthread_join(t->thread, NULL);
+        t->thread_running = false;
+    }
+
+    pthread_mutex_lock(&t->lock);
+    if (t->file) {
+        flush(t);
+        fprintf(t->file, "\n]\n");
+        fclose(t->file);
+        t->file = NULL;
+    }
+    pthread_mutex_unlock(&t->lock);
+
+    if (!path)
+        return true;
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    pthread_mutex_lock(&t->lock);
+    t->file = f;
+    t->need_comma = false;
+    t->terminate = false;
+    for (int n = 0; n < t->num_threads; n++)
+        t->threads[n]->announced = false;
+    fprintf(t->file, "[\n");
+    pthread_mutex_unlock(&t->lock);
+
+    if (pthread_create(&t->thread, NULL, flush_thread, t)) {
+        mp_tracer_set_file(t, NULL);
+        return false;
+    }
+    t->thread_running = true;
+
+    atomic_store(&t->active, true);
+    return true;
+}
+
+bool mp_tracer_active(struct mp_tracer *t)
+{
+    return t && atomic_load(&t->active);
+}
+
+void mp_tracer_add(struct mp_tracer *t, const char *thread_name,
+                   enum mp_trace_type type, const char *name, double value)
+{
+    if (!mp_tracer_active(t))
+        return;
+
+    int64_t now = mp_time_us();
+
+    struct trace_thread *tt = pthread_getspecific(t->key);
+    if (!tt)
+        tt = new_thread(t, thread_name);
+
+    uint32_t hash = hash_name(name);
+    int slot = hash & (NAME_CACHE_SIZE - 1);
+    if (!tt->cache[slot].name || strcmp(tt->cache[slot].name, name) != 0) {
+        pthread_mutex_lock(&t->lock);
+        int id = intern_name(t, name, hash);
+        tt->cache[slot].name = t->names[id].name;
+        tt->cache[slot].id = id;
+        pthread_mutex_unlock(&t->lock);
+    }
+
+    struct trace_record *r = mp_spsc_queue_write_slot(tt->queue);
+    if (!r) {
+        atomic_fetch_add(&tt->dropped, 1);
+        return;
+    }
+    *r = (struct trace_record){
+        .time = now,
+        .value = value,
+        .name = tt->cache[slot].id,
+        .type = type,
+    };
+    mp_spsc_queue_push(tt->queue);
+}
+
+void mp_tracer_add_stats(struct mp_tracer *t, const char *thread_name,
+                         const char *text)
+{
+    if (!mp_tracer_active(t))
+        return;
+
+    bstr rest = bstr0(text);
+    if (bstr_eatstart0(&rest, "start ")) {
+        mp_tracer_add(t, thread_name, MP_TRACE_BEGIN, rest.start, 0);
+    } else if (bstr_eatstart0(&rest, "end ")) {
+        mp_tracer_add(t, thread_name, MP_TRACE_END, rest.start, 0);
+    } else if (bstr_eatstart0(&rest, "signal ")) {
+        mp_tracer_add(t, thread_name, MP_TRACE_INSTANT, rest.start, 0);
+    } else if (bstr_eatstart0(&rest, "value ")) {
+        char *end;
+        double v = strtod(rest.start, &end);
+        if (end != rest.start && end[0] == ' ')
+            mp_tracer_add(t, thread_name, MP_TRACE_VALUE, end + 1, v);
+    } else {
+        mp_tracer_add(t, thread_name, MP_TRACE_INSTANT, text, 0);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Records timed events into per-thread lock-free buffers, and writes them as
+// Chrome trace event JSON (chrome://tracing, https://ui.perfetto.dev) from a
+// background thread. Used by --dump-trace.
+struct mp_tracer;
+
+enum mp_trace_type {
+    MP_TRACE_BEGIN,     // start of a named duration
+    MP_TRACE_END,       // end of the last started duration with the same name
+    MP_TRACE_INSTANT,   // singular event
+    MP_TRACE_VALUE,     // numeric value, shown as counter graph
+};
+
+struct mp_tracer *mp_tracer_create(void *ta_parent);
+
+// Start writing to the given file (truncating it), or stop if path is NULL.
+// Returns false if the file could not be opened.
+bool mp_tracer_set_file(struct mp_tracer *t, const char *path);
+
+bool mp_tracer_active(struct mp_tracer *t);
+
+// Thread-safe and lock-free, unless this is the first use of name on the
+// calling thread. thread_name is used to label the calling thread in the
+// output if this is its first event. Events are dropped if the thread's
+// buffer is full.
+void mp_tracer_add(struct mp_tracer *t, const char *thread_name,
+                   enum mp_trace_type type, const char *name, double value);
+
+// Parse the text of a MP_STATS() call (see TOOLS/stats-conv.py), and add it.
+void mp_tracer_add_stats(struct mp_tracer *t, const char *thread_name,
+                         const char *text);
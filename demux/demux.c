@@ -103,6 +103,7 @@ struct demux_opts {
     double back_seek_size;
     char *meta_cp;
     int force_retry_eof;
+    int background_audio;
 };
 
 #define OPT_BASE_STRUCT struct demux_opts
@@ -138,6 +139,7 @@ const struct m_sub_options demux_conf = {
         {"demuxer-backward-playback-step", OPT_DOUBLE(back_seek_size),
             M_RANGE(0, DBL_MAX)},
         {"metadata-codepage", OPT_STRING(meta_cp)},
+        {"demuxer-background-audio", OPT_FLAG(background_audio)},
         {"demuxer-force-retry-on-eof", OPT_FLAG(force_retry_eof),
          .deprecation_message = "temporary debug option, no replacement"},
         {0}
@@ -390,6 +392,8 @@ struct demux_stream {
                             // read (like subtitles)
     bool still_image;       // stream has still video images
     bool refreshing;        // finding old position after track switches
+    bool background;        // not selected, but still demuxed and queued, so
+                            // that it can be selected without refresh seek
     bool eof;               // end of demuxed stream? (true if no more packets)
 
     bool global_correct_dts;// all observed so far
@@ -881,6 +885,14 @@ static void wakeup_ds(struct demux_stream *ds)
     }
 }
 
+// Whether the stream should be demuxed in the background while unselected.
+static bool want_background(struct demux_internal *in, struct demux_stream *ds)
+{
+    return !ds->selected && ds->type == STREAM_AUDIO &&
+           !ds->sh->attached_picture && !in->back_demuxing &&
+           in->opts->background_audio;
+}
+
 static void update_stream_selection_state(struct demux_internal *in,
                                           struct demux_stream *ds)
 {
@@ -898,6 +910,7 @@ static void update_stream_selection_state(struct demux_internal *in,
 
         s->still_image = s->sh->still_image;
         s->eager = s->selected && !s->sh->attached_picture;
+        s->background = want_background(in, s);
         if (s->eager && !s->still_image)
             any_av_streams |= s->type != STREAM_SUB;
         any_streams |= s->selected;
@@ -926,7 +939,7 @@ static void update_stream_selection_state(struct demux_internal *in,
     for (int n = 0; n < in->num_ranges; n++) {
         struct demux_cached_range *range = in->ranges[n];
 
-        if (!ds->selected)
+        if (!ds->selected && !ds->background)
             clear_queue(range->streams[ds->index]);
 
         update_seek_ranges(range);
@@ -937,6 +950,36 @@ static void update_stream_selection_state(struct demux_internal *in,
     wakeup_ds(ds);
 }
 
+// Apply a runtime change of --demuxer-background-audio to the currently
+// unselected streams.
+static void update_background_state(struct demux_internal *in)
+{
+    bool changed = false;
+    for (int n = 0; n < in->num_streams; n++) {
+        struct demux_stream *ds = in->streams[n]->ds;
+        bool background = want_background(in, ds);
+        if (ds->background == background)
+            continue;
+        ds->background = background;
+        changed = true;
+        if (!background) {
+            ds_clear_reader_state(ds, true);
+            for (int r = 0; r < in->num_ranges; r++)
+                clear_queue(in->ranges[r]->streams[n]);
+        }
+    }
+
+    if (!changed)
+        return;
+
+    for (int n = 0; n < in->num_ranges; n++)
+        update_seek_ranges(in->ranges[n]);
+    free_empty_cached_ranges(in);
+
+    // Let the low level demuxer start or stop reading the streams.
+    in->tracks_switched = true;
+}
+
 void demux_set_ts_offset(struct demuxer *demuxer, double offset)
 {
     struct demux_internal *in = demuxer->in;
@@ -2009,6 +2052,8 @@ static void add_packet_locked(struct sh_stream *stream, demux_packet_t *dp)
 
     struct demux_internal *in = ds->in;
 
+    dp->recv_time = mp_time_us();
+
     in->after_seek = false;
     in->after_seek_to_start = false;
 
@@ -2021,7 +2066,8 @@ static void add_packet_locked(struct sh_stream *stream, demux_packet_t *dp)
 
     struct demux_queue *queue = ds->queue;
 
-    bool drop = !ds->selected || in->seeking || ds->sh->attached_picture;
+    bool drop = !(ds->selected || ds->background) || in->seeking ||
+                ds->sh->attached_picture;
 
     if (!drop) {
         // If libavformat splits packets, some packets will have pos unset, so
@@ -2185,6 +2231,8 @@ static bool read_packet(struct demux_internal *in)
             read_more |= !ds->reader_head;
             if (in->back_demuxing)
                 read_more |= ds->back_restarting || ds->back_resuming;
+        } else if (ds->background) {
+            // Passively demuxed along with the other streams.
         } else {
             if (lazy_stream_needs_wait(ds)) {
                 read_more = true;
@@ -2509,6 +2557,8 @@ static void update_opts(struct demux_internal *in)
         in->enable_recording = in->can_record;
     }
 
+    update_background_state(in);
+
     // In case the cache was reduced in size.
     prune_old_packets(in);
 
@@ -2592,6 +2642,72 @@ static struct demux_packet *advance_reader_head(struct demux_stream *ds)
     return pkt;
 }
 
+// Move the reader position of background streams along with the position of
+// the eagerly read streams. Packets before it become part of the back buffer,
+// and are pruned as usual, so background streams keep only a rolling window of
+// packets around the current playback position.
+static void update_background_streams(struct demux_internal *in)
+{
+    double ts = MP_NOPTS_VALUE;
+    for (int n = 0; n < in->num_streams; n++) {
+        struct demux_stream *ds = in->streams[n]->ds;
+        if (ds->eager && ds->type != STREAM_SUB)
+            ts = MP_PTS_MIN(ts, ds->base_ts);
+    }
+    if (ts == MP_NOPTS_VALUE)
+        return;
+
+    for (int n = 0; n < in->num_streams; n++) {
+        struct demux_stream *ds = in->streams[n]->ds;
+        if (!ds->background)
+            continue;
+        while (ds->reader_head) {
+            struct demux_packet *dp = ds->reader_head;
+            double pkt_ts = MP_PTS_OR_DEF(dp->dts, dp->pts);
+            if (pkt_ts != MP_NOPTS_VALUE && pkt_ts >= ts)
+                break;
+            advance_reader_head(ds);
+        }
+    }
+}
+
+// Set the reader position to a seek target (or NULL if there is none).
+static void ds_set_reader_head(struct demux_stream *ds,
+                               struct demux_packet *target)
+{
+    ds->reader_head = target;
+    ds->skip_to_keyframe = !target;
+    if (ds->reader_head)
+        ds->base_ts = MP_PTS_OR_DEF(ds->reader_head->pts, ds->reader_head->dts);
+}
+
+// Let a stream that was demuxed in the background start returning packets
+// from ref_pts on. Returns false if the queue does not contain packets for
+// this position, in which case a refresh seek is needed.
+// The reader state must have been reset with update_stream_selection_state().
+static bool resume_background_stream(struct demux_stream *ds, double ref_pts)
+{
+    if (ref_pts == MP_NOPTS_VALUE)
+        return false;
+
+    struct demux_packet *target = find_seek_target(ds->queue, ref_pts, 0);
+    if (!target)
+        return false;
+
+    // find_seek_target() falls back to a later packet if there is none before
+    // ref_pts, in which case the packets for this position were pruned.
+    double target_pts;
+    compute_keyframe_times(target, &target_pts, NULL);
+    if (target_pts == MP_NOPTS_VALUE || target_pts > ref_pts)
+        return false;
+
+    MP_VERBOSE(ds->in, "resume background track %d at %f\n", ds->index,
+               target_pts);
+    ds_set_reader_head(ds, target);
+    wakeup_ds(ds);
+    return true;
+}
+
 // Return a newly allocated new packet. The pkt parameter may be either a
 // in-memory packet (then a new reference is made), or a reference to
 // packet in the disk cache (then the packet is read from disk).
@@ -2723,6 +2839,8 @@ static int dequeue_packet(struct demux_stream *ds, double min_pts,
     if (ts != MP_NOPTS_VALUE)
         ds->base_ts = ts;
 
+    update_background_streams(in);
+
     if (pkt->keyframe && ts != MP_NOPTS_VALUE) {
         // Update bitrate - only at keyframe points, because we use the
         // (possibly) reordered packet timestamps instead of realtime.
@@ -3245,6 +3363,7 @@ static struct demuxer *open_given_type(struct mpv_global *global,
         return NULL;
 
     struct demuxer *demuxer = talloc_ptrtype(NULL, demuxer);
+    ta_acct_set_tag(demuxer, "demux");
     struct m_config_cache *opts_cache =
         m_config_cache_alloc(demuxer, global, &demux_conf);
     struct demux_opts *opts = opts_cache->opts;
@@ -3702,10 +3821,7 @@ static void execute_cache_seek(struct demux_internal *in,
         struct demux_queue *queue = range->streams[n];
 
         struct demux_packet *target = find_seek_target(queue, pts, flags);
-        ds->reader_head = target;
-        ds->skip_to_keyframe = !target;
-        if (ds->reader_head)
-            ds->base_ts = MP_PTS_OR_DEF(ds->reader_head->pts, ds->reader_head->dts);
+        ds_set_reader_head(ds, target);
 
         MP_VERBOSE(in, "seeking stream %d (%s) to ",
                    n, stream_type_name(ds->type));
@@ -3954,13 +4070,15 @@ void demuxer_select_track(struct demuxer *demuxer, struct sh_stream *stream,
     // don't flush buffers if stream is already selected / unselected
     if (ds->selected != selected) {
         MP_VERBOSE(in, "%sselect track %d\n", selected ? "" : "de", stream->index);
+        bool was_background = ds->background;
         ds->selected = selected;
         update_stream_selection_state(in, ds);
         in->tracks_switched = true;
         if (ds->selected) {
             if (in->back_demuxing)
                 ds->back_seek_pos = ref_pts;
-            if (!in->after_seek)
+            if (!in->after_seek &&
+                !(was_background && resume_background_stream(ds, ref_pts)))
                 initiate_refresh_seek(in, ds, ref_pts);
         }
         if (in->threading) {
@@ -3993,16 +4111,16 @@ void demuxer_refresh_track(struct demuxer *demuxer, struct sh_stream *stream,
 }
 
 // This is for demuxer implementations only. demuxer_select_track() sets the
-// logical state, while this function returns the actual state (in case the
-// demuxer attempts to cache even unselected packets for track switching - this
-// will potentially be done in the future).
+// logical state, while this function returns the actual state (which includes
+// unselected streams that are cached for track switching, see
+// --demuxer-background-audio).
 bool demux_stream_is_selected(struct sh_stream *stream)
 {
     if (!stream)
         return false;
     bool r = false;
     pthread_mutex_lock(&stream->ds->in->lock);
-    r = stream->ds->selected;
+    r = stream->ds->selected || stream->ds->background;
     pthread_mutex_unlock(&stream->ds->in->lock);
     return r;
 }
@@ -141,6 +141,7 @@ void demux_packet_copy_attribs(struct demux_packet *dst, struct demux_packet *sr
     dst->dts = src->dts;
     dst->duration = src->duration;
     dst->pos = src->pos;
+    dst->recv_time = src->recv_time;
     dst->segmented = src->segmented;
     dst->start = src->start;
     dst->end = src->end;
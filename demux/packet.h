@@ -28,6 +28,7 @@ typedef struct demux_packet {
     double dts;
     double duration;
     int64_t pos;        // position in source file byte stream
+    int64_t recv_time;  // mp_time_us() when added to the packet queue, or 0
 
     union {
         // Normally valid for packets.
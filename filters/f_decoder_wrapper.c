@@ -40,6 +40,7 @@
 #include "common/codecs.h"
 #include "common/global.h"
 #include "common/recorder.h"
+#include "common/stats.h"
 #include "misc/dispatch.h"
 
 #include "audio/aframe.h"
@@ -151,6 +152,7 @@ const struct m_sub_options dec_wrapper_conf = {
 struct priv {
     struct mp_log *log;
     struct sh_stream *header;
+    struct stats_ctx *stats;
 
     // --- The following fields are to be accessed by dec_dispatch (or if that
     //     field is NULL, by the mp_decoder_wrapper user thread).
@@ -916,6 +918,9 @@ static void feed_packet(struct priv *p)
         packet->pts = packet->dts = MP_NOPTS_VALUE;
     }
 
+    if (packet)
+        stats_latency(p->stats, "demux-decode", packet->recv_time);
+
     mp_pin_in_write(p->decoder->f->pins[0], p->packet);
     p->packet_fed = true;
     p->packet = MP_NO_FRAME;
@@ -1050,6 +1055,7 @@ static void read_frame(struct priv *p)
 
 output_frame:
     process_output_frame(p, frame);
+    mp_frame_set_stage_time(frame, mp_time_us());
     mp_pin_in_write(pin, frame);
 }
 
@@ -1089,6 +1095,7 @@ static void *dec_thread(void *ptr)
     case STREAM_AUDIO: t_name = "adec"; break;
     }
     mpthread_set_name(t_name);
+    stats_register_thread_cputime(p->stats, "thread");
 
     while (!p->request_terminate_dec_thread) {
         mp_filter_graph_run(p->dec_root_filter);
@@ -1096,6 +1103,7 @@ static void *dec_thread(void *ptr)
         mp_dispatch_queue_process(p->dec_dispatch, INFINITY);
     }
 
+    stats_unregister_thread(p->stats, "thread");
     return NULL;
 }
 
@@ -1185,6 +1193,7 @@ struct mp_decoder_wrapper *mp_decoder_wrapper_create(struct mp_filter *parent,
 
     if (p->header->type == STREAM_VIDEO) {
         p->log = mp_log_new(p, parent->global->log, "!vd");
+        p->stats = stats_ctx_create(p, parent->global, "video");
 
         p->fps = src->codec->fps;
 
@@ -1199,6 +1208,7 @@ struct mp_decoder_wrapper *mp_decoder_wrapper_create(struct mp_filter *parent,
         p->queue_opts = p->opts->vdec_queue_opts;
     } else if (p->header->type == STREAM_AUDIO) {
         p->log = mp_log_new(p, parent->global->log, "!ad");
+        p->stats = stats_ctx_create(p, parent->global, "audio");
         p->queue_opts = p->opts->adec_queue_opts;
     } else {
         goto error;
@@ -1,6 +1,7 @@
 #include "audio/aframe.h"
 #include "audio/out/ao.h"
 #include "common/global.h"
+#include "common/stats.h"
 #include "options/m_config.h"
 #include "options/m_option.h"
 #include "video/out/vo.h"
@@ -25,6 +26,8 @@ struct chain {
 
     struct mp_stream_info stream_info;
 
+    struct stats_ctx *stats;
+
     struct mp_user_filter **pre_filters;
     int num_pre_filters;
     struct mp_user_filter **post_filters;
@@ -276,6 +279,17 @@ static void relink_filter_list(struct chain *p)
     }
 }
 
+static void update_pool_stats(struct chain *p)
+{
+    struct mp_aframe_pool_stats st;
+    mp_aframe_pool_get_stats(p->stream_info.aframe_pool, &st);
+    stats_value(p->stats, "pool-allocs", st.num_allocs);
+    if (st.num_allocs) {
+        stats_value(p->stats, "pool-hit-rate",
+                    (st.num_allocs - st.num_new) * 100.0 / st.num_allocs);
+    }
+}
+
 static void process(struct mp_filter *f)
 {
     struct chain *p = f->priv;
@@ -301,6 +315,9 @@ static void process(struct mp_filter *f)
         if (p->public.got_output_eof)
             MP_VERBOSE(p, "filter output EOF\n");
 
+        if (frame.type == MP_FRAME_AUDIO)
+            update_pool_stats(p);
+
         mp_pin_in_write(f->ppins[1], frame);
     }
 }
@@ -618,8 +635,6 @@ static void create_video_things(struct chain *p)
     p->stream_info.priv = p;
     p->stream_info.get_display_fps = get_display_fps;
 
-    p->f->stream_info = &p->stream_info;
-
     struct mp_user_filter *f = create_wrapper_filter(p);
     f->name = "userdeint";
     f->f = mp_deint_create(f->wrapper);
@@ -639,6 +654,11 @@ static void create_audio_things(struct chain *p)
 {
     p->frame_type = MP_FRAME_AUDIO;
 
+    // Let all filters in the chain allocate their output frames from the same
+    // pool, so buffers released downstream are reused upstream.
+    p->stream_info.aframe_pool = mp_aframe_pool_create(p);
+    p->stats = stats_ctx_create(p, p->f->global, "af");
+
     struct mp_user_filter *f = create_wrapper_filter(p);
     f->name = "userspeed";
     f->f = mp_autoaspeed_create(f->wrapper);
@@ -683,6 +703,8 @@ struct mp_output_chain *mp_output_chain_create(struct mp_filter *parent,
     p->input->name = "in";
     MP_TARRAY_APPEND(p, p->pre_filters, p->num_pre_filters, p->input);
 
+    p->f->stream_info = &p->stream_info;
+
     switch (type) {
     case MP_OUTPUT_CHAIN_VIDEO: create_video_things(p); break;
     case MP_OUTPUT_CHAIN_AUDIO: create_audio_things(p); break;
@@ -692,8 +692,8 @@ struct mp_swresample *mp_swresample_create(struct mp_filter *parent,
         p->opts = mp_get_config_group(p, f->global, &resample_conf);
     }
 
-    p->reorder_buffer = mp_aframe_pool_create(p);
-    p->out_pool = mp_aframe_pool_create(p);
+    p->reorder_buffer = mp_filter_get_aframe_pool(f);
+    p->out_pool = mp_filter_get_aframe_pool(f);
 
     return &p->public;
 }
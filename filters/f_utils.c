@@ -236,7 +236,13 @@ static void fixed_aframe_size_process(struct mp_filter *f)
         }
     }
 
-    if (p->in) {
+    if (p->in && !p->out && mp_aframe_get_size(p->in) == p->samples) {
+        // Input frame already has the wanted size: pass it through instead of
+        // copying it into a new buffer.
+        p->out = p->in;
+        p->in = NULL;
+        p->out_written = p->samples;
+    } else if (p->in) {
         if (!p->out) {
             p->out = mp_aframe_create();
             mp_aframe_config_copy(p->out, p->in);
@@ -305,7 +311,7 @@ struct mp_filter *mp_fixed_aframe_size_create(struct mp_filter *parent,
     struct fixed_aframe_size_priv *p = f->priv;
     p->samples = samples;
     p->pad_silence = pad_silence;
-    p->pool = mp_aframe_pool_create(p);
+    p->pool = mp_filter_get_aframe_pool(f);
 
     return f;
 }
@@ -1,6 +1,7 @@
 #include <math.h>
 #include <pthread.h>
 
+#include "audio/aframe.h"
 #include "common/common.h"
 #include "common/global.h"
 #include "common/msg.h"
@@ -682,6 +683,14 @@ struct mp_stream_info *mp_filter_find_stream_info(struct mp_filter *f)
     return NULL;
 }
 
+struct mp_aframe_pool *mp_filter_get_aframe_pool(struct mp_filter *f)
+{
+    struct mp_stream_info *info = mp_filter_find_stream_info(f);
+    if (info && info->aframe_pool)
+        return info->aframe_pool;
+    return mp_aframe_pool_create(f);
+}
+
 struct AVBufferRef *mp_filter_load_hwdec_device(struct mp_filter *f, int avtype)
 {
     struct mp_stream_info *info = mp_filter_find_stream_info(f);
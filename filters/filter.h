@@ -403,11 +403,18 @@ struct mp_stream_info {
     struct osd_state *osd;
     bool rotate90;
     struct vo *dr_vo; // for calling vo_get_image()
+    // Shared by all audio filters in the chain. Only accessed from the filter
+    // graph's thread.
+    struct mp_aframe_pool *aframe_pool;
 };
 
 // Search for a parent filter (including f) that has this set, and return it.
 struct mp_stream_info *mp_filter_find_stream_info(struct mp_filter *f);
 
+// Return the audio frame pool provided by a parent filter's mp_stream_info, or
+// create a new pool (with f as ta parent) if there is none.
+struct mp_aframe_pool *mp_filter_get_aframe_pool(struct mp_filter *f);
+
 struct AVBufferRef;
 struct AVBufferRef *mp_filter_load_hwdec_device(struct mp_filter *f, int avtype);
 
@@ -14,6 +14,8 @@ struct frame_handler {
     void *(*new_ref)(void *data);
     double (*get_pts)(void *data);
     void (*set_pts)(void *data, double pts);
+    int64_t (*get_stage_time)(void *data);
+    void (*set_stage_time)(void *data, int64_t time);
     int (*approx_size)(void *data);
     AVFrame *(*new_av_ref)(void *data);
     void *(*from_av_ref)(AVFrame *data);
@@ -35,6 +37,16 @@ static void video_set_pts(void *data, double pts)
     ((struct mp_image *)data)->pts = pts;
 }
 
+static int64_t video_get_stage_time(void *data)
+{
+    return ((struct mp_image *)data)->stage_time;
+}
+
+static void video_set_stage_time(void *data, int64_t time)
+{
+    ((struct mp_image *)data)->stage_time = time;
+}
+
 static int video_approx_size(void *data)
 {
     return mp_image_approx_byte_size(data);
@@ -65,6 +77,16 @@ static void audio_set_pts(void *data, double pts)
     mp_aframe_set_pts(data, pts);
 }
 
+static int64_t audio_get_stage_time(void *data)
+{
+    return mp_aframe_get_stage_time(data);
+}
+
+static void audio_set_stage_time(void *data, int64_t time)
+{
+    mp_aframe_set_stage_time(data, time);
+}
+
 static int audio_approx_size(void *data)
 {
     return mp_aframe_approx_byte_size(data);
@@ -85,6 +107,16 @@ static void *packet_ref(void *data)
     return demux_copy_packet(data);
 }
 
+static int64_t packet_get_stage_time(void *data)
+{
+    return ((struct demux_packet *)data)->recv_time;
+}
+
+static void packet_set_stage_time(void *data, int64_t time)
+{
+    ((struct demux_packet *)data)->recv_time = time;
+}
+
 static const struct frame_handler frame_handlers[] = {
     [MP_FRAME_NONE] = {
         .name = "none",
@@ -99,6 +131,8 @@ static const struct frame_handler frame_handlers[] = {
         .new_ref = video_ref,
         .get_pts = video_get_pts,
         .set_pts = video_set_pts,
+        .get_stage_time = video_get_stage_time,
+        .set_stage_time = video_set_stage_time,
         .approx_size = video_approx_size,
         .new_av_ref = video_new_av_ref,
         .from_av_ref = video_from_av_ref,
@@ -110,6 +144,8 @@ static const struct frame_handler frame_handlers[] = {
         .new_ref = audio_ref,
         .get_pts = audio_get_pts,
         .set_pts = audio_set_pts,
+        .get_stage_time = audio_get_stage_time,
+        .set_stage_time = audio_set_stage_time,
         .approx_size = audio_approx_size,
         .new_av_ref = audio_new_av_ref,
         .from_av_ref = audio_from_av_ref,
@@ -119,6 +155,8 @@ static const struct frame_handler frame_handlers[] = {
         .name = "packet",
         .is_data = true,
         .new_ref = packet_ref,
+        .get_stage_time = packet_get_stage_time,
+        .set_stage_time = packet_set_stage_time,
         .free = talloc_free,
     },
 };
@@ -173,6 +211,19 @@ void mp_frame_set_pts(struct mp_frame frame, double pts)
         frame_handlers[frame.type].set_pts(frame.data, pts);
 }
 
+int64_t mp_frame_get_stage_time(struct mp_frame frame)
+{
+    if (frame_handlers[frame.type].get_stage_time)
+        return frame_handlers[frame.type].get_stage_time(frame.data);
+    return 0;
+}
+
+void mp_frame_set_stage_time(struct mp_frame frame, int64_t time)
+{
+    if (frame_handlers[frame.type].set_stage_time)
+        frame_handlers[frame.type].set_stage_time(frame.data, time);
+}
+
 int mp_frame_approx_size(struct mp_frame frame)
 {
     if (frame_handlers[frame.type].approx_size)
@@ -45,6 +45,12 @@ struct mp_frame mp_frame_ref(struct mp_frame frame);
 double mp_frame_get_pts(struct mp_frame frame);
 void mp_frame_set_pts(struct mp_frame frame, double pts);
 
+// mp_time_us() timestamp of when the frame left the previous pipeline stage
+// (for packets, when the demuxer queued it), or 0. Used for latency stats
+// (see stats_latency()).
+int64_t mp_frame_get_stage_time(struct mp_frame frame);
+void mp_frame_set_stage_time(struct mp_frame frame, int64_t time);
+
 // Estimation of total size in bytes. This is for buffering purposes.
 int mp_frame_approx_size(struct mp_frame frame);
 
@@ -289,7 +289,7 @@ static bool cmd_node_map(struct mp_log *log, struct mp_cmd *cmd, mpv_node *node)
 
 struct mp_cmd *mp_input_parse_cmd_node(struct mp_log *log, mpv_node *node)
 {
-    struct mp_cmd *cmd = talloc_ptrtype(NULL, cmd);
+    struct mp_cmd *cmd = talloc_arena_zero(NULL, struct mp_cmd);
     talloc_set_destructor(cmd, destroy_cmd);
     *cmd = (struct mp_cmd) { .scale = 1, .scale_units = 1 };
 
@@ -367,7 +367,7 @@ static struct mp_cmd *parse_cmd_str(struct mp_log *log, void *tmp,
         .start = *str,
     };
 
-    struct mp_cmd *cmd = talloc_ptrtype(NULL, cmd);
+    struct mp_cmd *cmd = talloc_arena_zero(NULL, struct mp_cmd);
     talloc_set_destructor(cmd, destroy_cmd);
     *cmd = (struct mp_cmd) {
         .flags = MP_ON_OSD_AUTO | MP_EXPAND_PROPERTIES,
@@ -458,7 +458,7 @@ mp_cmd_t *mp_input_parse_cmd_str(struct mp_log *log, bstr str, const char *loc)
         // Multi-command. Since other input.c code uses queue_next for its
         // own purposes, a pseudo-command is used to wrap the command list.
         if (!p_prev) {
-            struct mp_cmd *list = talloc_ptrtype(NULL, list);
+            struct mp_cmd *list = talloc_arena_zero(NULL, struct mp_cmd);
             talloc_set_destructor(list, destroy_cmd);
             *list = (struct mp_cmd) {
                 .name = (char *)mp_cmd_list.name,
@@ -524,7 +524,8 @@ mp_cmd_t *mp_cmd_clone(mp_cmd_t *cmd)
     if (!cmd)
         return NULL;
 
-    mp_cmd_t *ret = talloc_dup(NULL, cmd);
+    mp_cmd_t *ret = talloc_arena_zero(NULL, mp_cmd_t);
+    *ret = *cmd;
     talloc_set_destructor(ret, destroy_cmd);
     ret->name = talloc_strdup(ret, cmd->name);
     ret->args = talloc_zero_array(ret, struct mp_cmd_arg, ret->nargs);
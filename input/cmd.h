@@ -95,6 +95,8 @@ struct mp_cmd_arg {
     } v;
 };
 
+// Commands are ta arenas (see ta_arena_zalloc_size()). Allocations made with a
+// mp_cmd as parent can't be moved out of it with talloc_steal().
 typedef struct mp_cmd {
     char *name;
     struct mp_cmd_arg *args;
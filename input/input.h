@@ -216,8 +216,8 @@ struct mpv_handle;
 // Platform specific implementation, provided by ipc-*.c.
 struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
                                struct mpv_global *global);
-// Start a thread for the given handle and return a socket in out_fd[0] that
-// is served by this thread. If the FD is not full-duplex, then out_fd[0] is
+// Serve the given handle on a new socket, and return the other end in
+// out_fd[0]. If the FD is not full-duplex, then out_fd[0] is
 // the user's read-end, and out_fd[1] the write-end, otherwise out_fd[1] is set
 // to -1.
 //  returns:
@@ -227,13 +227,61 @@ bool mp_ipc_start_anon_client(struct mp_ipc_ctx *ctx, struct mpv_handle *h,
                               int out_fd[2]);
 void mp_uninit_ipc(struct mp_ipc_ctx *ctx);
 
+struct mp_ipc_request;
+
+// Per-connection state of the IPC protocol.
+struct mp_ipc_conn {
+    struct mpv_handle *client;
+    void *ta_parent;        // for state that lives as long as the connection
+    bool allow_binary;      // set by the transport if it supports framing
+    bool binary;            // binary protocol was negotiated
+    // Set by the transport if executing requests must not block. Requests that
+    // need the core are then started with the async client API, and their
+    // replies are written by mp_ipc_encode_event() when the reply event is
+    // received.
+    bool async_requests;
+    int num_pending;        // started requests waiting for their reply event
+    // Requests whose replies must be sent in order (private to ipc.c).
+    struct mp_ipc_request **ordered;
+    int num_ordered;
+};
+
+// Maximum payload size of a binary IPC frame.
+#define MP_IPC_MAX_FRAME_SIZE (16 * 1024 * 1024)
+
+// With mp_ipc_conn.async_requests, the transport should stop executing input
+// while this many requests are pending.
+#define MP_IPC_MAX_PENDING 256
+
 // Serialize the given mpv_event structure to JSON. Returns an allocated string.
 struct mpv_event;
 char *mp_json_encode_event(struct mpv_event *event);
 
+// Serialize the given event for the connection (using the negotiated protocol),
+// and append it to dst (allocated with ta_parent). Reply events of requests
+// started with conn->async_requests are turned into the request's reply, or
+// are dropped if the request has no reply. Returns success.
+bool mp_ipc_encode_event(struct mp_ipc_conn *conn, void *ta_parent, bstr *dst,
+                         struct mpv_event *event);
+
 // Given the raw IPC input buffer "buf", remove the first newline-separated
 // command, execute it and return the result (if any) as an allocated string.
+// This never switches to the binary protocol.
 struct mpv_handle;
 char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *buf);
 
+// Execute a single line of IPC input, and return the result (if any) as an
+// allocated string. A trailing newline is allowed. If conn->binary is set
+// afterwards, the following input uses mp_ipc_execute_frame().
+char *mp_ipc_execute_line(struct mp_ipc_conn *conn, void *ctx, bstr line);
+
+// Execute the binary frame at the start of buf, and remove it from buf. The
+// reply frame (if any) is appended to reply (allocated with ctx).
+//  returns:
+//      1: a frame was consumed
+//      0: buf does not contain a complete frame yet
+//     -1: framing error, the connection should be closed
+int mp_ipc_execute_frame(struct mp_ipc_conn *conn, void *ctx, bstr *buf,
+                         bstr *reply);
+
 #endif /* MPLAYER_INPUT_H */
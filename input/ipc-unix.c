@@ -22,6 +22,7 @@
 #include <poll.h>
 #include <signal.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/un.h>
@@ -45,18 +46,46 @@
 #define MSG_NOSIGNAL 0
 #endif
 
+// Size of the shared read buffer.
+#define READ_BUFFER_SIZE (64 * 1024)
+
+// Maximum number of queued messages passed to a single sendmsg() call.
+#define MAX_IOV 64
+
+// If more than this many bytes are queued for a client (because it doesn't
+// read its socket), stop reading events and commands from it until the queue
+// has been drained. This leaves the rest to mpv_handle's own event queue.
+#define MAX_QUEUED_BYTES (4 * 1024 * 1024)
+
 struct mp_ipc_ctx {
     struct mp_log *log;
     struct mp_client_api *client_api;
     const char *path;
 
     pthread_t thread;
-    int death_pipe[2];
+    bool thread_started;
+    int wakeup_pipe[2];
+
+    pthread_mutex_t lock;
+    // -- protected by lock
+    bool terminate;             // stop listening, exit once all clients are gone
+    bool detached;              // thread frees the context on exit
+    struct client_arg **new_clients; // to be picked up by the thread
+    int num_new_clients;
+    int num_clients;            // including new_clients
+
+    // -- owned by the thread
+    int ipc_fd;
+    struct client_arg **clients;
+    int num_active_clients;
+    int client_num;             // for naming clients
+    char *read_buf;
 };
 
 struct client_arg {
     struct mp_log *log;
     struct mpv_handle *client;
+    struct mp_ipc_conn conn;
 
     const char *client_name;
     int client_fd;
@@ -64,164 +93,241 @@ struct client_arg {
     bool quit_on_close;
 
     bool writable;
+
+    int wakeup_fd;              // mpv_get_wakeup_pipe()
+    bstr in_buf;                // input not executed yet
+    size_t in_scan_pos;         // bytes of in_buf known to contain no newline
+    bool read_eof;              // client closed its end
+    bstr *out_msgs;             // queued messages (talloc-allocated data)
+    int num_out_msgs;
+    size_t out_pos;             // bytes of out_msgs[0] already sent
+    size_t out_bytes;           // total bytes pending in out_msgs
+    bool events_pending;        // wakeup pipe was flushed, events not read yet
+    bool dead;
 };
 
-static int ipc_write_str(struct client_arg *client, const char *buf)
+static bool client_choked(struct client_arg *client)
 {
-    size_t count = strlen(buf);
-    while (count > 0) {
-        ssize_t rc = send(client->client_fd, buf, count, MSG_NOSIGNAL);
-        if (rc <= 0) {
-            if (rc == 0)
-                return -1;
+    return client->out_bytes > MAX_QUEUED_BYTES;
+}
 
+// Whether executing more input has to wait for replies or for the client to
+// read its socket.
+static bool client_throttled(struct client_arg *client)
+{
+    return client_choked(client) ||
+           client->conn.num_pending >= MP_IPC_MAX_PENDING;
+}
+
+// Takes over ownership of msg.start (can be NULL).
+static void queue_msg(struct client_arg *client, bstr msg)
+{
+    if (!client->writable || !msg.len) {
+        talloc_free(msg.start);
+        return;
+    }
+    talloc_steal(client, msg.start);
+    MP_TARRAY_APPEND(client, client->out_msgs, client->num_out_msgs, msg);
+    client->out_bytes += msg.len;
+}
+
+// Send as much of the queued output as possible without blocking.
+static int flush_output(struct client_arg *client)
+{
+    while (client->num_out_msgs) {
+        struct iovec iov[MAX_IOV];
+        int num = MPMIN(client->num_out_msgs, MAX_IOV);
+        for (int n = 0; n < num; n++) {
+            bstr msg = client->out_msgs[n];
+            size_t skip = n == 0 ? client->out_pos : 0;
+            iov[n] = (struct iovec){msg.start + skip, msg.len - skip};
+        }
+
+        struct msghdr hdr = { .msg_iov = iov, .msg_iovlen = num };
+        ssize_t rc = sendmsg(client->client_fd, &hdr, MSG_NOSIGNAL);
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
             if (errno == EBADF || errno == ENOTSOCK) {
+                // Read-only FD passed with --input-ipc-client.
                 client->writable = false;
-                return 0;
+                rc = client->out_bytes;
+            } else {
+                return -1;
             }
-
-            if (errno == EINTR || errno == EAGAIN)
-                continue;
-
-            return rc;
         }
 
-        count -= rc;
-        buf   += rc;
+        client->out_bytes -= rc;
+        size_t done = rc;
+        int remove = 0;
+        while (remove < client->num_out_msgs) {
+            bstr msg = client->out_msgs[remove];
+            size_t left = msg.len - client->out_pos;
+            if (done < left) {
+                client->out_pos += done;
+                break;
+            }
+            done -= left;
+            client->out_pos = 0;
+            talloc_free(msg.start);
+            remove++;
+        }
+        if (remove) {
+            client->num_out_msgs -= remove;
+            memmove(client->out_msgs, client->out_msgs + remove,
+                    client->num_out_msgs * sizeof(client->out_msgs[0]));
+        }
     }
-
     return 0;
 }
 
-static void *client_thread(void *p)
+// Returns false if the client should be disconnected.
+static bool read_events(struct client_arg *client)
 {
-    pthread_detach(pthread_self());
-
-    // We don't use MSG_NOSIGNAL because the moldy fruit OS doesn't support it.
-    struct sigaction sa = { .sa_handler = SIG_IGN, .sa_flags = SA_RESTART };
-    sigfillset(&sa.sa_mask);
-    sigaction(SIGPIPE, &sa, NULL);
-
-    int rc;
-
-    struct client_arg *arg = p;
-    bstr client_msg = { talloc_strdup(NULL, ""), 0 };
-
-    mpthread_set_name(arg->client_name);
-
-    int pipe_fd = mpv_get_wakeup_pipe(arg->client);
-    if (pipe_fd < 0) {
-        MP_ERR(arg, "Could not get wakeup pipe\n");
-        goto done;
-    }
-
-    MP_VERBOSE(arg, "Client connected\n");
-
-    struct pollfd fds[2] = {
-        {.events = POLLIN, .fd = pipe_fd},
-        {.events = POLLIN, .fd = arg->client_fd},
-    };
-
-    fcntl(arg->client_fd, F_SETFL, fcntl(arg->client_fd, F_GETFL, 0) | O_NONBLOCK);
-
     while (1) {
-        rc = poll(fds, 2, 0);
-        if (rc == 0)
-            rc = poll(fds, 2, -1);
-        if (rc < 0) {
-            MP_ERR(arg, "Poll error\n");
-            continue;
+        if (client_choked(client)) {
+            // Continue once the output queue has been drained.
+            client->events_pending = true;
+            return true;
         }
 
-        if (fds[0].revents & POLLIN) {
-            mp_flush_wakeup_pipe(pipe_fd);
+        mpv_event *event = mpv_wait_event(client->client, 0);
 
-            while (1) {
-                mpv_event *event = mpv_wait_event(arg->client, 0);
+        if (event->event_id == MPV_EVENT_NONE)
+            return true;
 
-                if (event->event_id == MPV_EVENT_NONE)
-                    break;
+        if (event->event_id == MPV_EVENT_SHUTDOWN)
+            return false;
 
-                if (event->event_id == MPV_EVENT_SHUTDOWN)
-                    goto done;
+        if (!client->writable)
+            continue;
 
-                if (!arg->writable)
-                    continue;
+        bstr event_msg = {0};
+        if (!mp_ipc_encode_event(&client->conn, NULL, &event_msg, event)) {
+            talloc_free(event_msg.start);
+            MP_ERR(client, "Encoding error\n");
+            return false;
+        }
 
-                char *event_msg = mp_json_encode_event(event);
-                if (!event_msg) {
-                    MP_ERR(arg, "Encoding error\n");
-                    goto done;
-                }
+        queue_msg(client, event_msg);
+    }
+}
 
-                rc = ipc_write_str(arg, event_msg);
-                talloc_free(event_msg);
-                if (rc < 0) {
-                    MP_ERR(arg, "Write error (%s)\n", mp_strerror(errno));
-                    goto done;
-                }
+// Execute complete commands from in_buf, until it's empty or the client is
+// throttled. Requests are started asynchronously, so this never waits for the
+// core. Returns false if the client should be disconnected.
+static bool execute_input(struct client_arg *client)
+{
+    bstr buf = client->in_buf;
+    bool ok = true;
+    while (buf.len && !client_throttled(client)) {
+        if (client->conn.binary) {
+            // The binary protocol was negotiated (possibly in the middle of
+            // the buffered data).
+            bstr reply = {0};
+            int r = mp_ipc_execute_frame(&client->conn, NULL, &buf, &reply);
+            if (r < 0)
+                ok = false;
+            if (r <= 0)
+                break;
+            queue_msg(client, reply);
+        } else {
+            int nl = bstrchr(bstr_cut(buf, client->in_scan_pos), '\n');
+            if (nl < 0) {
+                client->in_scan_pos = buf.len;
+                break;
             }
+            nl += client->in_scan_pos;
+            client->in_scan_pos = 0;
+            bstr line = bstr_splice(buf, 0, nl + 1);
+            buf = bstr_cut(buf, nl + 1);
+            char *reply = mp_ipc_execute_line(&client->conn, NULL, line);
+            queue_msg(client, bstr0(reply));
         }
+    }
+    memmove(client->in_buf.start, buf.start, buf.len);
+    client->in_buf.len = buf.len;
+    return ok;
+}
 
-        if (fds[1].revents & (POLLIN | POLLHUP | POLLNVAL)) {
-            while (1) {
-                char buf[128];
-                bstr append = { buf, 0 };
-
-                ssize_t bytes = read(arg->client_fd, buf, sizeof(buf));
-                if (bytes < 0) {
-                    if (errno == EAGAIN)
-                        break;
-
-                    MP_ERR(arg, "Read error (%s)\n", mp_strerror(errno));
-                    goto done;
-                }
-
-                if (bytes == 0) {
-                    MP_VERBOSE(arg, "Client disconnected\n");
-                    goto done;
-                }
-
-                append.len = bytes;
-
-                bstr_xappend(NULL, &client_msg, append);
-
-                while (bstrchr(client_msg, '\n') != -1) {
-                    char *reply_msg = mp_ipc_consume_next_command(arg->client,
-                        NULL, &client_msg);
+// Returns false if the client should be disconnected.
+static bool read_commands(struct mp_ipc_ctx *ctx, struct client_arg *client)
+{
+    while (!client->read_eof && !client_throttled(client)) {
+        ssize_t bytes = read(client->client_fd, ctx->read_buf,
+                             READ_BUFFER_SIZE);
+        if (bytes < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
 
-                    if (reply_msg && arg->writable) {
-                        rc = ipc_write_str(arg, reply_msg);
-                        if (rc < 0) {
-                            MP_ERR(arg, "Write error (%s)\n", mp_strerror(errno));
-                            talloc_free(reply_msg);
-                            goto done;
-                        }
-                    }
+            MP_ERR(client, "Read error (%s)\n", mp_strerror(errno));
+            return false;
+        }
 
-                    talloc_free(reply_msg);
-                }
-            }
+        if (bytes == 0) {
+            MP_VERBOSE(client, "Client disconnected\n");
+            // Buffered commands are still executed.
+            client->read_eof = true;
+            break;
         }
+
+        bstr data = {(unsigned char *)ctx->read_buf, bytes};
+        bstr_xappend(client, &client->in_buf, data);
+        if (!execute_input(client))
+            return false;
     }
+    return true;
+}
 
-done:
-    if (client_msg.len > 0)
-        MP_WARN(arg, "Ignoring unterminated command on disconnect.\n");
-    talloc_free(client_msg.start);
-    if (arg->close_client_fd)
-        close(arg->client_fd);
-    struct mpv_handle *h = arg->client;
-    bool quit = arg->quit_on_close;
-    talloc_free(arg);
+static void destroy_client(struct mp_ipc_ctx *ctx, struct client_arg *client)
+{
+    if (client->in_buf.len > 0)
+        MP_WARN(client, "Ignoring unterminated command on disconnect.\n");
+    if (client->close_client_fd)
+        close(client->client_fd);
+    struct mpv_handle *h = client->client;
+    bool quit = client->quit_on_close;
+    talloc_free(client);
     if (quit) {
         mpv_terminate_destroy(h);
     } else {
         mpv_destroy(h);
     }
-    return NULL;
 }
 
+static void add_client(struct mp_ipc_ctx *ctx, struct client_arg *client)
+{
+    client->wakeup_fd = mpv_get_wakeup_pipe(client->client);
+    if (client->wakeup_fd < 0) {
+        MP_ERR(client, "Could not get wakeup pipe\n");
+        destroy_client(ctx, client);
+        pthread_mutex_lock(&ctx->lock);
+        ctx->num_clients--;
+        pthread_mutex_unlock(&ctx->lock);
+        return;
+    }
+
+    client->conn = (struct mp_ipc_conn){
+        .client = client->client,
+        .ta_parent = client,
+        .allow_binary = true,
+        .async_requests = true,
+    };
+
+    fcntl(client->client_fd, F_SETFL,
+          fcntl(client->client_fd, F_GETFL, 0) | O_NONBLOCK);
+
+    MP_VERBOSE(client, "Client connected\n");
+
+    MP_TARRAY_APPEND(ctx, ctx->clients, ctx->num_active_clients, client);
+}
+
+static bool start_thread(struct mp_ipc_ctx *ctx);
+
 static bool ipc_start_client(struct mp_ipc_ctx *ctx, struct client_arg *client,
                              bool free_on_init_fail)
 {
@@ -232,10 +338,17 @@ static bool ipc_start_client(struct mp_ipc_ctx *ctx, struct client_arg *client,
 
     client->log = mp_client_get_log(client->client);
 
-    pthread_t client_thr;
-    if (pthread_create(&client_thr, NULL, client_thread, client))
+    pthread_mutex_lock(&ctx->lock);
+    bool ok = !ctx->terminate && start_thread(ctx);
+    if (ok) {
+        MP_TARRAY_APPEND(ctx, ctx->new_clients, ctx->num_new_clients, client);
+        ctx->num_clients++;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    if (!ok)
         goto err;
 
+    (void)write(ctx->wakeup_pipe[1], &(char){0}, 1);
     return true;
 
 err:
@@ -266,9 +379,29 @@ static void ipc_start_client_json(struct mp_ipc_ctx *ctx, int id, int fd)
     ipc_start_client(ctx, client, true);
 }
 
+static void accept_clients(struct mp_ipc_ctx *ctx)
+{
+    while (1) {
+        int client_fd = accept(ctx->ipc_fd, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                MP_ERR(ctx, "Could not accept IPC client\n");
+            return;
+        }
+        mp_set_cloexec(client_fd);
+
+        ipc_start_client_json(ctx, ctx->client_num++, client_fd);
+    }
+}
+
 bool mp_ipc_start_anon_client(struct mp_ipc_ctx *ctx, struct mpv_handle *h,
                               int out_fd[2])
 {
+    if (!ctx)
+        return false;
+
     int pair[2];
     if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair))
         return false;
@@ -295,23 +428,19 @@ bool mp_ipc_start_anon_client(struct mp_ipc_ctx *ctx, struct mpv_handle *h,
     return true;
 }
 
-static void *ipc_thread(void *p)
+static int open_listener(struct mp_ipc_ctx *arg)
 {
     int rc;
 
     int ipc_fd;
     struct sockaddr_un ipc_un = {0};
 
-    struct mp_ipc_ctx *arg = p;
-
-    mpthread_set_name("ipc socket listener");
-
     MP_VERBOSE(arg, "Starting IPC master\n");
 
     ipc_fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (ipc_fd < 0) {
         MP_ERR(arg, "Could not create IPC socket\n");
-        goto done;
+        goto error;
     }
 
     fchmod(ipc_fd, 0600);
@@ -319,7 +448,7 @@ static void *ipc_thread(void *p)
     size_t path_len = strlen(arg->path);
     if (path_len >= sizeof(ipc_un.sun_path) - 1) {
         MP_ERR(arg, "Could not create IPC socket\n");
-        goto done;
+        goto error;
     }
 
     ipc_un.sun_family = AF_UNIX,
@@ -336,52 +465,195 @@ static void *ipc_thread(void *p)
     rc = bind(ipc_fd, (struct sockaddr *) &ipc_un, addr_len);
     if (rc < 0) {
         MP_ERR(arg, "Could not bind IPC socket\n");
-        goto done;
+        goto error;
     }
 
     rc = listen(ipc_fd, 10);
     if (rc < 0) {
         MP_ERR(arg, "Could not listen on IPC socket\n");
-        goto done;
+        goto error;
     }
 
+    mp_set_cloexec(ipc_fd);
+    fcntl(ipc_fd, F_SETFL, fcntl(ipc_fd, F_GETFL, 0) | O_NONBLOCK);
+
     MP_VERBOSE(arg, "Listening to IPC socket.\n");
 
-    int client_num = 0;
+    return ipc_fd;
 
-    struct pollfd fds[2] = {
-        {.events = POLLIN, .fd = arg->death_pipe[0]},
-        {.events = POLLIN, .fd = ipc_fd},
-    };
+error:
+    if (ipc_fd >= 0)
+        close(ipc_fd);
+    return -1;
+}
+
+static void free_ctx(struct mp_ipc_ctx *arg)
+{
+    close(arg->wakeup_pipe[0]);
+    close(arg->wakeup_pipe[1]);
+    pthread_mutex_destroy(&arg->lock);
+    talloc_free(arg);
+}
+
+// All clients and the listening socket are served by this thread.
+static void *ipc_thread(void *p)
+{
+    struct mp_ipc_ctx *arg = p;
+
+    mpthread_set_name("ipc");
+
+    // We don't use MSG_NOSIGNAL because the moldy fruit OS doesn't support it.
+    struct sigaction sa = { .sa_handler = SIG_IGN, .sa_flags = SA_RESTART };
+    sigfillset(&sa.sa_mask);
+    sigaction(SIGPIPE, &sa, NULL);
+
+    if (arg->path && arg->path[0])
+        arg->ipc_fd = open_listener(arg);
+
+    arg->read_buf = talloc_size(arg, READ_BUFFER_SIZE);
+
+    struct pollfd *fds = NULL;
+    int num_fds = 0;
 
     while (1) {
-        rc = poll(fds, 2, -1);
-        if (rc < 0) {
-            MP_ERR(arg, "Poll error\n");
+        pthread_mutex_lock(&arg->lock);
+        bool terminate = arg->terminate;
+        bool done = terminate && !arg->num_clients;
+        struct client_arg **new_clients = arg->new_clients;
+        int num_new_clients = arg->num_new_clients;
+        arg->new_clients = NULL;
+        arg->num_new_clients = 0;
+        pthread_mutex_unlock(&arg->lock);
+
+        if (done)
+            break;
+
+        for (int n = 0; n < num_new_clients; n++)
+            add_client(arg, new_clients[n]);
+        talloc_free(new_clients);
+
+        if (terminate && arg->ipc_fd >= 0) {
+            close(arg->ipc_fd);
+            arg->ipc_fd = -1;
+        }
+
+        // Layout: wakeup pipe, listening socket, then 2 entries per client.
+        int timeout = -1;
+        num_fds = 2 + arg->num_active_clients * 2;
+        MP_TARRAY_GROW(NULL, fds, num_fds);
+        fds[0] = (struct pollfd){.events = POLLIN, .fd = arg->wakeup_pipe[0]};
+        fds[1] = (struct pollfd){.events = POLLIN, .fd = arg->ipc_fd};
+        for (int n = 0; n < arg->num_active_clients; n++) {
+            struct client_arg *client = arg->clients[n];
+            bool choked = client_choked(client);
+            bool read = !client_throttled(client) && !client->read_eof;
+            if (!choked && client->events_pending)
+                timeout = 0;
+            fds[2 + n * 2] = (struct pollfd){
+                .events = choked ? 0 : POLLIN,
+                .fd = client->wakeup_fd,
+            };
+            fds[2 + n * 2 + 1] = (struct pollfd){
+                .events = (read ? POLLIN : 0) |
+                          (client->num_out_msgs ? POLLOUT : 0),
+                .fd = client->client_fd,
+            };
+            // Avoid waking up on POLLHUP if nothing is to be done.
+            if (!fds[2 + n * 2 + 1].events)
+                fds[2 + n * 2 + 1].fd = -1;
+        }
+
+        if (poll(fds, num_fds, timeout) < 0) {
+            if (errno != EINTR)
+                MP_ERR(arg, "Poll error\n");
             continue;
         }
 
         if (fds[0].revents & POLLIN)
-            goto done;
+            mp_flush_wakeup_pipe(arg->wakeup_pipe[0]);
+
+        if (fds[1].revents & POLLIN)
+            accept_clients(arg);
+
+        for (int n = 0; n < num_fds / 2 - 1; n++) {
+            struct client_arg *client = arg->clients[n];
+            bool ok = true;
+
+            if (fds[2 + n * 2].revents & POLLIN) {
+                mp_flush_wakeup_pipe(client->wakeup_fd);
+                client->events_pending = true;
+            }
+
+            if (fds[2 + n * 2 + 1].revents & (POLLIN | POLLHUP | POLLNVAL))
+                ok = read_commands(arg, client);
 
-        if (fds[1].revents & POLLIN) {
-            int client_fd = accept(ipc_fd, NULL, NULL);
-            if (client_fd < 0) {
-                MP_ERR(arg, "Could not accept IPC client\n");
-                goto done;
+            if (ok && client->events_pending && !client_choked(client)) {
+                client->events_pending = false;
+                ok = read_events(client);
             }
 
-            ipc_start_client_json(arg, client_num++, client_fd);
+            // Replies or written output may have unblocked buffered input.
+            if (ok && client->in_buf.len && !client_throttled(client))
+                ok = execute_input(client);
+
+            // Events and replies are written together in as few syscalls as
+            // possible. If the client doesn't keep up, its queue is drained
+            // before reading more (see MAX_QUEUED_BYTES).
+            if (ok && flush_output(client) < 0) {
+                // (Expected if the client closed the socket without waiting.)
+                MP_MSG(client, client->read_eof ? MSGL_V : MSGL_ERR,
+                       "Write error (%s)\n", mp_strerror(errno));
+                ok = false;
+            }
+
+            // After the client closed its end, wait until all replies to its
+            // requests were sent.
+            if (ok && client->read_eof && !client->conn.num_pending &&
+                !client->num_out_msgs && !client_throttled(client))
+                ok = false;
+
+            client->dead = !ok;
+        }
+
+        for (int n = arg->num_active_clients - 1; n >= 0; n--) {
+            struct client_arg *client = arg->clients[n];
+            if (!client->dead)
+                continue;
+            MP_TARRAY_REMOVE_AT(arg->clients, arg->num_active_clients, n);
+            destroy_client(arg, client);
+            pthread_mutex_lock(&arg->lock);
+            arg->num_clients--;
+            pthread_mutex_unlock(&arg->lock);
         }
     }
 
-done:
-    if (ipc_fd >= 0)
-        close(ipc_fd);
+    talloc_free(fds);
+
+    if (arg->ipc_fd >= 0)
+        close(arg->ipc_fd);
+    arg->ipc_fd = -1;
+
+    pthread_mutex_lock(&arg->lock);
+    bool detached = arg->detached;
+    pthread_mutex_unlock(&arg->lock);
+
+    if (detached)
+        free_ctx(arg);
 
     return NULL;
 }
 
+// Call with ctx->lock held.
+static bool start_thread(struct mp_ipc_ctx *ctx)
+{
+    if (!ctx->thread_started) {
+        if (pthread_create(&ctx->thread, NULL, ipc_thread, ctx))
+            return false;
+        ctx->thread_started = true;
+    }
+    return true;
+}
+
 struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
                                struct mpv_global *global)
 {
@@ -392,9 +664,25 @@ struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
         .log        = mp_log_new(arg, global->log, "ipc"),
         .client_api = client_api,
         .path       = mp_get_user_path(arg, global, opts->ipc_path),
-        .death_pipe = {-1, -1},
+        .wakeup_pipe = {-1, -1},
+        .ipc_fd     = -1,
     };
 
+    if (mp_make_wakeup_pipe(arg->wakeup_pipe) < 0) {
+        talloc_free(opts);
+        talloc_free(arg);
+        return NULL;
+    }
+
+    pthread_mutex_init(&arg->lock, NULL);
+
+    // Without a listening socket, the thread is started with the first client.
+    if (arg->path && arg->path[0]) {
+        pthread_mutex_lock(&arg->lock);
+        start_thread(arg);
+        pthread_mutex_unlock(&arg->lock);
+    }
+
     if (opts->ipc_client && opts->ipc_client[0]) {
         int fd = -1;
         if (strncmp(opts->ipc_client, "fd://", 5) == 0) {
@@ -412,24 +700,7 @@ struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
 
     talloc_free(opts);
 
-    if (!arg->path || !arg->path[0])
-        goto out;
-
-    if (mp_make_wakeup_pipe(arg->death_pipe) < 0)
-        goto out;
-
-    if (pthread_create(&arg->thread, NULL, ipc_thread, arg))
-        goto out;
-
     return arg;
-
-out:
-    if (arg->death_pipe[0] >= 0) {
-        close(arg->death_pipe[0]);
-        close(arg->death_pipe[1]);
-    }
-    talloc_free(arg);
-    return NULL;
 }
 
 void mp_uninit_ipc(struct mp_ipc_ctx *arg)
@@ -437,10 +708,25 @@ void mp_uninit_ipc(struct mp_ipc_ctx *arg)
     if (!arg)
         return;
 
-    (void)write(arg->death_pipe[1], &(char){0}, 1);
-    pthread_join(arg->thread, NULL);
+    pthread_mutex_lock(&arg->lock);
+    arg->terminate = true;
+    // Remaining clients are still served, but the caller can't wait for them.
+    arg->detached = arg->num_clients > 0;
+    bool started = arg->thread_started;
+    bool detached = arg->detached;
+    pthread_mutex_unlock(&arg->lock);
 
-    close(arg->death_pipe[0]);
-    close(arg->death_pipe[1]);
-    talloc_free(arg);
+    if (!started) {
+        free_ctx(arg);
+        return;
+    }
+
+    (void)write(arg->wakeup_pipe[1], &(char){0}, 1);
+
+    if (detached) {
+        pthread_detach(arg->thread);
+    } else {
+        pthread_join(arg->thread, NULL);
+        free_ctx(arg);
+    }
 }
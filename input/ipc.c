@@ -20,6 +20,7 @@
 #include "common/msg.h"
 #include "input/input.h"
 #include "misc/json.h"
+#include "misc/msgpack.h"
 #include "misc/node.h"
 #include "options/m_option.h"
 #include "options/options.h"
@@ -56,6 +57,29 @@ static void mpv_node_map_add(void *ta_parent, mpv_node *src, const char *key, mp
     src->u.list->num++;
 }
 
+// Like mpv_node_map_add(), but move val instead of copying it. val must have
+// been allocated according to m_option_type_node rules (like property and
+// command results), and is reset.
+static void mpv_node_map_add_steal(void *ta_parent, mpv_node *src,
+                                   const char *key, mpv_node *val)
+{
+    if (src->format != MPV_FORMAT_NODE_MAP)
+        return;
+
+    if (!src->u.list)
+        src->u.list = talloc_zero(ta_parent, mpv_node_list);
+
+    MP_TARRAY_GROW(src->u.list, src->u.list->keys, src->u.list->num);
+    MP_TARRAY_GROW(src->u.list, src->u.list->values, src->u.list->num);
+
+    src->u.list->keys[src->u.list->num] = talloc_strdup(ta_parent, key);
+    src->u.list->values[src->u.list->num] = *val;
+    talloc_steal(ta_parent, node_get_alloc(val));
+    *val = (mpv_node){.format = MPV_FORMAT_NONE};
+
+    src->u.list->num++;
+}
+
 static void mpv_node_map_add_null(void *ta_parent, mpv_node *src, const char *key)
 {
     mpv_node val_node = {.format = MPV_FORMAT_NONE};
@@ -89,19 +113,44 @@ static void mpv_format_command_reply(void *ta_parent, mpv_event *event,
     mpv_node_map_add(ta_parent, dst, "data", &cmd->result);
 }
 
-char *mp_json_encode_event(mpv_event *event)
+static void event_to_node(void *ta_parent, mpv_event *event, mpv_node *dst)
 {
-    void *ta_parent = talloc_new(NULL);
-
-    struct mpv_node event_node;
     if (event->event_id == MPV_EVENT_COMMAND_REPLY) {
-        event_node = (mpv_node){.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
-        mpv_format_command_reply(ta_parent, event, &event_node);
+        *dst = (mpv_node){.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
+        mpv_format_command_reply(ta_parent, event, dst);
     } else {
-        mpv_event_to_node(&event_node, event);
+        mpv_event_to_node(dst, event);
         // Abuse mpv_event_to_node() internals.
-        talloc_steal(ta_parent, node_get_alloc(&event_node));
+        talloc_steal(ta_parent, node_get_alloc(dst));
+    }
+}
+
+// Append a binary frame (32 bit big endian payload length, followed by the
+// MessagePack encoded node) to dst.
+static bool write_frame(void *ta_parent, bstr *dst, mpv_node *src)
+{
+    size_t start = dst->len;
+    bstr_xappend(ta_parent, dst, (bstr){(unsigned char *)"\0\0\0\0", 4});
+    if (msgpack_write(ta_parent, dst, src) < 0) {
+        dst->len = start;
+        return false;
     }
+    size_t len = dst->len - start - 4;
+    if (len > MP_IPC_MAX_FRAME_SIZE) {
+        dst->len = start;
+        return false;
+    }
+    for (int n = 0; n < 4; n++)
+        dst->start[start + n] = (len >> (24 - n * 8)) & 0xFF;
+    return true;
+}
+
+char *mp_json_encode_event(mpv_event *event)
+{
+    void *ta_parent = talloc_arena_new(NULL);
+
+    struct mpv_node event_node;
+    event_to_node(ta_parent, event, &event_node);
 
     char *output = talloc_strdup(NULL, "");
     json_write(&output, &event_node);
@@ -112,35 +161,221 @@ char *mp_json_encode_event(mpv_event *event)
     return output;
 }
 
-// Function is allowed to modify src[n].
-static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
-                                  char *src)
+// A request started with the async client API (see mp_ipc_conn.async_requests),
+// or a finished reply that has to wait for such requests. The address is used
+// as reply_userdata.
+struct mp_ipc_request {
+    struct mp_ipc_conn *conn;
+    mpv_node request_id;        // copy of "request_id" (MPV_FORMAT_NONE if unset)
+    bool send_reply;            // false for text commands
+    bool null_on_error;         // get_property_string
+    // Replies to requests that were synchronous before are sent in request
+    // order (in conn->ordered). Asynchronous commands can finish in any order.
+    bool ordered;
+    bool binary;                // protocol at the time of the request
+    bool done;                  // reply is complete and in reply
+    bstr reply;
+};
+
+static void request_destroy(void *p)
+{
+    struct mp_ipc_request *req = p;
+    req->conn->num_pending--;
+}
+
+static struct mp_ipc_request *new_request(struct mp_ipc_conn *conn,
+                                          mpv_node *reqid_node, bool ordered)
+{
+    struct mp_ipc_request *req = talloc_ptrtype(conn->ta_parent, req);
+    *req = (struct mp_ipc_request){
+        .conn = conn,
+        .send_reply = true,
+        .ordered = ordered,
+        .binary = conn->binary,
+    };
+    if (reqid_node)
+        node_copy_compact(req, &req->request_id, reqid_node);
+    talloc_set_destructor(req, request_destroy);
+    conn->num_pending++;
+    if (ordered)
+        MP_TARRAY_APPEND(conn->ta_parent, conn->ordered, conn->num_ordered, req);
+    return req;
+}
+
+static uint64_t request_id(struct mp_ipc_request *req)
+{
+    return (uintptr_t)req;
+}
+
+// Call after starting an async request with the given result. Returns whether
+// the reply is sent later.
+static bool request_started(struct mp_ipc_request *req, int rc)
+{
+    if (rc >= 0)
+        return true;
+    struct mp_ipc_conn *conn = req->conn;
+    if (req->ordered) {
+        assert(conn->ordered[conn->num_ordered - 1] == req);
+        conn->num_ordered--;
+    }
+    talloc_free(req);
+    return false;
+}
+
+// If replies to earlier requests are still missing, queue the given reply to
+// be sent after them. Returns true if the reply was queued.
+static bool defer_reply(struct mp_ipc_conn *conn, bstr reply)
+{
+    if (!conn->num_ordered)
+        return false;
+    struct mp_ipc_request *req = new_request(conn, NULL, true);
+    req->reply = bstrdup(req, reply);
+    req->done = true;
+    return true;
+}
+
+// Append the replies at the start of conn->ordered that are complete to dst.
+static void flush_ordered_replies(struct mp_ipc_conn *conn, void *ta_parent,
+                                  bstr *dst)
+{
+    int n = 0;
+    while (n < conn->num_ordered && conn->ordered[n]->done) {
+        bstr_xappend(ta_parent, dst, conn->ordered[n]->reply);
+        talloc_free(conn->ordered[n]);
+        n++;
+    }
+    conn->num_ordered -= n;
+    memmove(conn->ordered, conn->ordered + n,
+            conn->num_ordered * sizeof(conn->ordered[0]));
+}
+
+static void add_reply_status(void *ta_parent, mpv_node *reply_node,
+                             mpv_node *reqid_node, int rc)
+{
+    /* If the request contains a "request_id", copy it back into the response.
+     * This makes it easier on the requester to match up the IPC results with
+     * the original requests.
+     */
+    if (reqid_node) {
+        mpv_node_map_add(ta_parent, reply_node, "request_id", reqid_node);
+    } else {
+        mpv_node_map_add_int64(ta_parent, reply_node, "request_id", 0);
+    }
+
+    mpv_node_map_add_string(ta_parent, reply_node, "error", mpv_error_string(rc));
+}
+
+// Write the reply of a request for its reply event.
+static void request_reply(void *ta_parent, struct mp_ipc_request *req,
+                          mpv_event *event, mpv_node *reply_node)
+{
+    *reply_node = (mpv_node){.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
+
+    int rc = event->error;
+
+    if (event->event_id == MPV_EVENT_COMMAND_REPLY) {
+        // Like mpv_format_command_reply(), include the result even on errors.
+        mpv_event_command *cmd = event->data;
+        mpv_node_map_add(ta_parent, reply_node, "data", &cmd->result);
+    } else if (event->event_id == MPV_EVENT_GET_PROPERTY_REPLY) {
+        mpv_event_property *prop = event->data;
+        if (prop->format == MPV_FORMAT_NODE) {
+            mpv_node_map_add(ta_parent, reply_node, "data", prop->data);
+        } else if (prop->format == MPV_FORMAT_STRING) {
+            mpv_node_map_add_string(ta_parent, reply_node, "data",
+                                    *(char **)prop->data);
+        } else if (req->null_on_error) {
+            mpv_node_map_add_null(ta_parent, reply_node, "data");
+        }
+        // get_property_string reports errors only as null data.
+        if (req->null_on_error)
+            rc = MPV_ERROR_SUCCESS;
+    }
+
+    mpv_node *reqid_node = req->request_id.format ? &req->request_id : NULL;
+    add_reply_status(ta_parent, reply_node, reqid_node, rc);
+}
+
+static bool is_reply_event(mpv_event *event)
+{
+    return event->event_id == MPV_EVENT_COMMAND_REPLY ||
+           event->event_id == MPV_EVENT_GET_PROPERTY_REPLY ||
+           event->event_id == MPV_EVENT_SET_PROPERTY_REPLY;
+}
+
+// Append the node as JSON line or binary frame to dst.
+static bool encode_node(void *ta_parent, bstr *dst, mpv_node *node, bool binary)
+{
+    if (binary)
+        return write_frame(ta_parent, dst, node);
+
+    char *s = talloc_strdup(NULL, "");
+    bool ok = json_write(&s, node) >= 0;
+    if (ok) {
+        bstr_xappend(ta_parent, dst, bstr0(s));
+        bstr_xappend(ta_parent, dst, bstr0("\n"));
+    }
+    talloc_free(s);
+    return ok;
+}
+
+bool mp_ipc_encode_event(struct mp_ipc_conn *conn, void *ta_parent, bstr *dst,
+                         mpv_event *event)
+{
+    // All requests on such a connection are started by us, so every reply
+    // event belongs to a pending request.
+    struct mp_ipc_request *req = NULL;
+    if (conn->async_requests && is_reply_event(event))
+        req = (void *)(uintptr_t)event->reply_userdata;
+
+    void *tmp = talloc_arena_new(NULL);
+    mpv_node node;
+    bool ok = true;
+
+    if (!req) {
+        event_to_node(tmp, event, &node);
+        ok = encode_node(ta_parent, dst, &node, conn->binary);
+    } else if (req->ordered) {
+        request_reply(tmp, req, event, &node);
+        ok = encode_node(req, &req->reply, &node, req->binary);
+        req->done = true;
+        flush_ordered_replies(conn, ta_parent, dst);
+    } else {
+        if (req->send_reply) {
+            request_reply(tmp, req, event, &node);
+            ok = encode_node(ta_parent, dst, &node, conn->binary);
+        }
+        talloc_free(req);
+    }
+
+    talloc_free(tmp);
+
+    return ok;
+}
+
+// Execute the request in msg_node (which can be of any type), and write the
+// reply to reply_node. Returns false if no reply is to be sent.
+static bool execute_request(struct mp_ipc_conn *conn, void *ta_parent,
+                            mpv_node *msg_node, mpv_node *reply_node)
 {
     int rc;
     const char *cmd = NULL;
+    struct mpv_handle *client = conn->client;
     struct mp_log *log = mp_client_get_log(client);
 
-    mpv_node msg_node;
-    mpv_node reply_node = {.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
     mpv_node *reqid_node = NULL;
     int64_t reqid = 0;
     mpv_node *async_node = NULL;
     bool async = false;
     bool send_reply = true;
+    struct mp_ipc_request *req = NULL;
 
-    rc = json_parse(ta_parent, &msg_node, &src, 50);
-    if (rc < 0) {
-        mp_err(log, "malformed JSON received: '%s'\n", src);
-        rc = MPV_ERROR_INVALID_PARAMETER;
-        goto error;
-    }
-
-    if (msg_node.format != MPV_FORMAT_NODE_MAP) {
+    if (msg_node->format != MPV_FORMAT_NODE_MAP) {
         rc = MPV_ERROR_INVALID_PARAMETER;
         goto error;
     }
 
-    async_node = node_map_get(&msg_node, "async");
+    async_node = node_map_get(msg_node, "async");
     if (async_node) {
         if (async_node->format != MPV_FORMAT_FLAG) {
             rc = MPV_ERROR_INVALID_PARAMETER;
@@ -149,7 +384,7 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
         async = async_node->u.flag;
     }
 
-    reqid_node = node_map_get(&msg_node, "request_id");
+    reqid_node = node_map_get(msg_node, "request_id");
     if (reqid_node) {
         if (reqid_node->format == MPV_FORMAT_INT64) {
             reqid = reqid_node->u.int64;
@@ -163,7 +398,7 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
         }
     }
 
-    mpv_node *cmd_node = node_map_get(&msg_node, "command");
+    mpv_node *cmd_node = node_map_get(msg_node, "command");
     if (!cmd_node) {
         rc = MPV_ERROR_INVALID_PARAMETER;
         goto error;
@@ -181,15 +416,15 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
 
     if (cmd && !strcmp("client_name", cmd)) {
         const char *client_name = mpv_client_name(client);
-        mpv_node_map_add_string(ta_parent, &reply_node, "data", client_name);
+        mpv_node_map_add_string(ta_parent, reply_node, "data", client_name);
         rc = MPV_ERROR_SUCCESS;
     } else if (cmd && !strcmp("get_time_us", cmd)) {
         int64_t time_us = mpv_get_time_us(client);
-        mpv_node_map_add_int64(ta_parent, &reply_node, "data", time_us);
+        mpv_node_map_add_int64(ta_parent, reply_node, "data", time_us);
         rc = MPV_ERROR_SUCCESS;
     } else if (cmd && !strcmp("get_version", cmd)) {
         int64_t ver = mpv_client_api_version();
-        mpv_node_map_add_int64(ta_parent, &reply_node, "data", ver);
+        mpv_node_map_add_int64(ta_parent, reply_node, "data", ver);
         rc = MPV_ERROR_SUCCESS;
     } else if (cmd && !strcmp("get_property", cmd)) {
         mpv_node result_node;
@@ -204,11 +439,17 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             goto error;
         }
 
-        rc = mpv_get_property(client, cmd_node->u.list->values[1].u.string,
-                              MPV_FORMAT_NODE, &result_node);
-        if (rc >= 0) {
-            mpv_node_map_add(ta_parent, &reply_node, "data", &result_node);
-            mpv_free_node_contents(&result_node);
+        if (conn->async_requests) {
+            req = new_request(conn, reqid_node, true);
+            rc = mpv_get_property_async(client, request_id(req),
+                                        cmd_node->u.list->values[1].u.string,
+                                        MPV_FORMAT_NODE);
+            send_reply = !request_started(req, rc);
+        } else {
+            rc = mpv_get_property(client, cmd_node->u.list->values[1].u.string,
+                                  MPV_FORMAT_NODE, &result_node);
+            if (rc >= 0)
+                mpv_node_map_add_steal(ta_parent, reply_node, "data", &result_node);
         }
     } else if (cmd && !strcmp("get_property_string", cmd)) {
         if (cmd_node->u.list->num != 2) {
@@ -221,13 +462,23 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             goto error;
         }
 
-        char *result = mpv_get_property_string(client,
-                                        cmd_node->u.list->values[1].u.string);
-        if (result) {
-            mpv_node_map_add_string(ta_parent, &reply_node, "data", result);
-            mpv_free(result);
+        if (conn->async_requests) {
+            req = new_request(conn, reqid_node, true);
+            req->null_on_error = true;
+            rc = mpv_get_property_async(client, request_id(req),
+                                        cmd_node->u.list->values[1].u.string,
+                                        MPV_FORMAT_STRING);
+            send_reply = !request_started(req, rc);
         } else {
-            mpv_node_map_add_null(ta_parent, &reply_node, "data");
+            char *result = mpv_get_property_string(client,
+                                        cmd_node->u.list->values[1].u.string);
+            if (result) {
+                mpv_node_map_add_string(ta_parent, reply_node, "data", result);
+                mpv_free(result);
+            } else {
+                mpv_node_map_add_null(ta_parent, reply_node, "data");
+            }
+            rc = MPV_ERROR_SUCCESS;
         }
     } else if (cmd && (!strcmp("set_property", cmd) ||
                        !strcmp("set_property_string", cmd)))
@@ -242,8 +493,17 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             goto error;
         }
 
-        rc = mpv_set_property(client, cmd_node->u.list->values[1].u.string,
-                              MPV_FORMAT_NODE, &cmd_node->u.list->values[2]);
+        if (conn->async_requests) {
+            req = new_request(conn, reqid_node, true);
+            rc = mpv_set_property_async(client, request_id(req),
+                                        cmd_node->u.list->values[1].u.string,
+                                        MPV_FORMAT_NODE,
+                                        &cmd_node->u.list->values[2]);
+            send_reply = !request_started(req, rc);
+        } else {
+            rc = mpv_set_property(client, cmd_node->u.list->values[1].u.string,
+                                  MPV_FORMAT_NODE, &cmd_node->u.list->values[2]);
+        }
     } else if (cmd && !strcmp("observe_property", cmd)) {
         if (cmd_node->u.list->num != 3) {
             rc = MPV_ERROR_INVALID_PARAMETER;
@@ -297,6 +557,82 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
 
         rc = mpv_unobserve_property(client,
                                     cmd_node->u.list->values[1].u.int64);
+    } else if (cmd && !strcmp("limit_property_rate", cmd)) {
+        if (cmd_node->u.list->num != 3) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        if (cmd_node->u.list->values[1].format != MPV_FORMAT_INT64) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        mpv_node *rate_node = &cmd_node->u.list->values[2];
+        double rate;
+        if (rate_node->format == MPV_FORMAT_DOUBLE) {
+            rate = rate_node->u.double_;
+        } else if (rate_node->format == MPV_FORMAT_INT64) {
+            rate = rate_node->u.int64;
+        } else {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        rc = mpv_limit_property_rate(client,
+                                     cmd_node->u.list->values[1].u.int64, rate);
+    } else if (cmd && !strcmp("batch", cmd)) {
+        if (cmd_node->u.list->num != 2 ||
+            cmd_node->u.list->values[1].format != MPV_FORMAT_NODE_ARRAY)
+        {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        // The reply is sent when the batch completes, like with async.
+        if (reqid_node && reqid_node->format != MPV_FORMAT_INT64) {
+            mp_err(log, "'request_id' must be an integer for batch commands.\n");
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        // Turn ["set_property", name, value] items into the form expected by
+        // mpv_command_batch_async(). Everything else is passed as command.
+        mpv_node_list *items = cmd_node->u.list->values[1].u.list;
+        mpv_node batch;
+        node_init(&batch, MPV_FORMAT_NODE_ARRAY, NULL);
+        talloc_steal(ta_parent, batch.u.list);
+        for (int n = 0; n < items->num; n++) {
+            mpv_node *item = &items->values[n];
+            mpv_node *name = mpv_node_array_get(item, 0);
+            mpv_node *dst = node_array_add(&batch, MPV_FORMAT_NONE);
+            if (name && name->format == MPV_FORMAT_STRING &&
+                (!strcmp(name->u.string, "set_property") ||
+                 !strcmp(name->u.string, "set_property_string")))
+            {
+                if (item->u.list->num != 3) {
+                    rc = MPV_ERROR_INVALID_PARAMETER;
+                    goto error;
+                }
+                node_init(dst, MPV_FORMAT_NODE_MAP, &batch);
+                mpv_node_map_add(ta_parent, dst, "set_property",
+                                 &item->u.list->values[1]);
+                mpv_node_map_add(ta_parent, dst, "value",
+                                 &item->u.list->values[2]);
+            } else {
+                *dst = *item;
+            }
+        }
+
+        if (conn->async_requests) {
+            req = new_request(conn, reqid_node, false);
+            rc = mpv_command_batch_async(client, request_id(req), &batch);
+            send_reply = !request_started(req, rc);
+        } else {
+            rc = mpv_command_batch_async(client, reqid, &batch);
+            if (rc >= 0)
+                send_reply = false;
+        }
     } else if (cmd && !strcmp("request_log_messages", cmd)) {
         if (cmd_node->u.list->num != 2) {
             rc = MPV_ERROR_INVALID_PARAMETER;
@@ -310,6 +646,30 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
 
         rc = mpv_request_log_messages(client,
                                       cmd_node->u.list->values[1].u.string);
+    } else if (cmd && !strcmp("switch_protocol", cmd)) {
+        if (cmd_node->u.list->num != 2) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        if (cmd_node->u.list->values[1].format != MPV_FORMAT_STRING) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        // The reply is still sent with the old protocol. Switching back to
+        // JSON is not supported.
+        char *name = cmd_node->u.list->values[1].u.string;
+        if (strcmp(name, "json") == 0 && !conn->binary) {
+            rc = MPV_ERROR_SUCCESS;
+        } else if (strcmp(name, "msgpack") == 0 && conn->allow_binary) {
+            conn->binary = true;
+            rc = MPV_ERROR_SUCCESS;
+        } else if (strcmp(name, "json") == 0 || strcmp(name, "msgpack") == 0) {
+            rc = MPV_ERROR_NOT_IMPLEMENTED;
+        } else {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+        }
     } else if (cmd && (!strcmp("enable_event", cmd) ||
                        !strcmp("disable_event", cmd)))
     {
@@ -346,58 +706,77 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
     } else {
         mpv_node result_node = {0};
 
-        if (async) {
+        if (conn->async_requests) {
+            // Synchronous commands become async too; the reply looks the same.
+            req = new_request(conn, reqid_node, !async);
+            rc = mpv_command_node_async(client, request_id(req), cmd_node);
+            send_reply = !request_started(req, rc);
+        } else if (async) {
             rc = mpv_command_node_async(client, reqid, cmd_node);
             if (rc >= 0)
                 send_reply = false;
         } else {
             rc = mpv_command_node(client, cmd_node, &result_node);
             if (rc >= 0)
-                mpv_node_map_add(ta_parent, &reply_node, "data", &result_node);
+                mpv_node_map_add_steal(ta_parent, reply_node, "data", &result_node);
         }
 
         mpv_free_node_contents(&result_node);
     }
 
 error:
-    /* If the request contains a "request_id", copy it back into the response.
-     * This makes it easier on the requester to match up the IPC results with
-     * the original requests.
-     */
-    if (reqid_node) {
-        mpv_node_map_add(ta_parent, &reply_node, "request_id", reqid_node);
-    } else {
-        mpv_node_map_add_int64(ta_parent, &reply_node, "request_id", 0);
-    }
+    add_reply_status(ta_parent, reply_node, reqid_node, rc);
 
-    mpv_node_map_add_string(ta_parent, &reply_node, "error", mpv_error_string(rc));
+    return send_reply;
+}
 
-    char *output = talloc_strdup(ta_parent, "");
+// Function is allowed to modify src[n]. The returned string is not allocated
+// with ta_parent, which is an arena.
+static char *json_execute_command(struct mp_ipc_conn *conn, void *ta_parent,
+                                  char *src)
+{
+    struct mp_log *log = mp_client_get_log(conn->client);
+
+    mpv_node msg_node;
+    mpv_node reply_node = {.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
 
-    if (send_reply) {
+    if (json_parse(ta_parent, &msg_node, &src, 50) < 0) {
+        mp_err(log, "malformed JSON received: '%s'\n", src);
+        msg_node = (mpv_node){.format = MPV_FORMAT_NONE};
+    }
+
+    char *output = talloc_strdup(NULL, "");
+
+    if (execute_request(conn, ta_parent, &msg_node, &reply_node)) {
         json_write(&output, &reply_node);
         output = ta_talloc_strdup_append(output, "\n");
+        if (defer_reply(conn, bstr0(output)))
+            TA_FREEP(&output);
     }
 
     return output;
 }
 
-static char *text_execute_command(struct mpv_handle *client, void *tmp, char *src)
+static char *text_execute_command(struct mp_ipc_conn *conn, void *tmp, char *src)
 {
-    mpv_command_string(client, src);
+    if (conn->async_requests) {
+        struct mp_ipc_request *req = new_request(conn, NULL, false);
+        req->send_reply = false;
+        request_started(req,
+            mp_client_command_string_async(conn->client, request_id(req), src));
+    } else {
+        mpv_command_string(conn->client, src);
+    }
 
     return NULL;
 }
 
-char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *buf)
+char *mp_ipc_execute_line(struct mp_ipc_conn *conn, void *ctx, bstr line)
 {
-    void *tmp = talloc_new(NULL);
+    // All the nodes created for a request are thrown away at once.
+    void *tmp = talloc_arena_new(NULL);
 
-    bstr rest;
-    bstr line = bstr_getline(*buf, &rest);
     char *line0 = bstrto0(tmp, line);
-    talloc_steal(tmp, buf->start);
-    *buf = bstrdup(NULL, rest);
 
     json_skip_whitespace(&line0);
 
@@ -405,12 +784,69 @@ char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *bu
     if (line0[0] == '\0' || line0[0] == '#') {
         // skip
     } else if (line0[0] == '{') {
-        reply_msg = json_execute_command(client, tmp, line0);
+        reply_msg = json_execute_command(conn, tmp, line0);
     } else {
-        reply_msg = text_execute_command(client, tmp, line0);
+        reply_msg = text_execute_command(conn, tmp, line0);
     }
 
     talloc_steal(ctx, reply_msg);
     talloc_free(tmp);
     return reply_msg;
 }
+
+char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *buf)
+{
+    bstr rest;
+    bstr line = bstr_getline(*buf, &rest);
+    struct mp_ipc_conn conn = {.client = client};
+    char *reply_msg = mp_ipc_execute_line(&conn, ctx, line);
+    void *old = buf->start;
+    *buf = bstrdup(NULL, rest);
+    talloc_free(old);
+    return reply_msg;
+}
+
+int mp_ipc_execute_frame(struct mp_ipc_conn *conn, void *ctx, bstr *buf,
+                         bstr *reply)
+{
+    struct mp_log *log = mp_client_get_log(conn->client);
+
+    if (buf->len < 4)
+        return 0;
+
+    size_t len = 0;
+    for (int n = 0; n < 4; n++)
+        len = (len << 8) | buf->start[n];
+    if (len > MP_IPC_MAX_FRAME_SIZE) {
+        mp_err(log, "IPC frame too large (%zu bytes).\n", len);
+        return -1;
+    }
+    if (buf->len - 4 < len)
+        return 0;
+
+    bstr payload = bstr_splice(*buf, 4, 4 + len);
+    *buf = bstr_cut(*buf, 4 + len);
+
+    void *tmp = talloc_arena_new(NULL);
+
+    mpv_node msg_node;
+    mpv_node reply_node = {.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
+
+    if (msgpack_parse(tmp, &msg_node, &payload, 50) < 0 || payload.len) {
+        mp_err(log, "malformed MessagePack frame received\n");
+        msg_node = (mpv_node){.format = MPV_FORMAT_NONE};
+    }
+
+    if (execute_request(conn, tmp, &msg_node, &reply_node)) {
+        bstr frame = {0};
+        if (!write_frame(tmp, &frame, &reply_node)) {
+            mp_err(log, "Encoding error\n");
+        } else if (!defer_reply(conn, frame)) {
+            bstr_xappend(ctx, reply, frame);
+        }
+    }
+
+    talloc_free(tmp);
+
+    return 1;
+}
@@ -235,7 +235,7 @@ extern "C" {
  * relational operators (<, >, <=, >=).
  */
 #define MPV_MAKE_VERSION(major, minor) (((major) << 16) | (minor) | 0UL)
-#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(1, 109)
+#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(1, 113)
 
 /**
  * The API user is allowed to "#define MPV_ENABLE_DEPRECATED 0" before
@@ -1064,12 +1064,54 @@ int mpv_command_async(mpv_handle *ctx, uint64_t reply_userdata,
 int mpv_command_node_async(mpv_handle *ctx, uint64_t reply_userdata,
                            mpv_node *args);
 
+/**
+ * Run a list of commands and property sets as a single asynchronous request.
+ * Compared to calling mpv_command_node_async() and mpv_set_property_async()
+ * for each of them, the whole list is passed to the playback thread at once,
+ * and is run without releasing the core lock between items. This means no
+ * other client or player activity can run between the items. (Commands which
+ * complete asynchronously, like "subprocess", are started in order, but may
+ * complete at any later time.)
+ *
+ * args must be a MPV_FORMAT_NODE_ARRAY. Each item is either:
+ *  - a command, in any form accepted by mpv_command_node()
+ *  - a MPV_FORMAT_NODE_MAP with a "set_property" entry set to the property
+ *    name (MPV_FORMAT_STRING), and a "value" entry with the new value. This
+ *    is equivalent to mpv_set_property() with MPV_FORMAT_NODE.
+ *
+ * All items are validated before anything is run. If any of them is invalid,
+ * nothing is run, and MPV_ERROR_INVALID_PARAMETER is returned. Otherwise, all
+ * items are run in order, even if some of them fail. This is not transactional:
+ * items which succeeded are not undone if a later one fails.
+ *
+ * A single MPV_EVENT_COMMAND_REPLY is sent once all items have completed.
+ * mpv_event.error is set to the error of the first item that completed with
+ * an error, or 0 if all succeeded. mpv_event_command.result is a MPV_FORMAT_NODE_ARRAY with one
+ * MPV_FORMAT_NODE_MAP per item, in the same order as args, with the entries:
+ *
+ *      "error"     MPV_FORMAT_INT64 (error code of this item, 0 on success)
+ *      "result"    the command result, if the command returned any
+ *
+ * mpv_abort_async_command() with the same reply_userdata aborts all commands
+ * of the batch that support it.
+ *
+ * Safe to be called from mpv render API threads.
+ *
+ * @param reply_userdata the value mpv_event.reply_userdata of the reply will
+ *                       be set to (see section about asynchronous calls)
+ * @param args list of commands and property sets, as described above
+ * @return error code (if parsing or queuing the request fails)
+ */
+int mpv_command_batch_async(mpv_handle *ctx, uint64_t reply_userdata,
+                            mpv_node *args);
+
 /**
  * Signal to all async requests with the matching ID to abort. This affects
  * the following API calls:
  *
  *      mpv_command_async
  *      mpv_command_node_async
+ *      mpv_command_batch_async
  *
  * All of these functions take a reply_userdata parameter. This API function
  * tells all requests with the matching reply_userdata value to try to return
@@ -1285,6 +1327,75 @@ int mpv_observe_property(mpv_handle *mpv, uint64_t reply_userdata,
  */
 int mpv_unobserve_property(mpv_handle *mpv, uint64_t registered_reply_userdata);
 
+/**
+ * Limit the rate of MPV_EVENT_PROPERTY_CHANGE events for all properties which
+ * were observed with the given reply_userdata. If a property changes again
+ * within 1/max_rate seconds of the last change event, the new event is
+ * delayed until that time has passed. Intermediate values are skipped, so the
+ * event always contains the most recent value.
+ *
+ * This is useful for properties which change very often (like "time-pos"), if
+ * the client doesn't need every single update.
+ *
+ * The limit applies only to properties which are currently observed. Use 0
+ * to remove the limit again.
+ *
+ * Safe to be called from mpv render API threads.
+ *
+ * @param registered_reply_userdata ID that was passed to mpv_observe_property
+ * @param max_rate maximum number of change events per second and property
+ * @return negative value is an error code, >=0 is number of affected
+ *         properties on success
+ */
+int mpv_limit_property_rate(mpv_handle *mpv, uint64_t registered_reply_userdata,
+                            double max_rate);
+
+/**
+ * Opaque reference to a property, as returned by mpv_resolve_property().
+ */
+typedef struct mpv_property_ref mpv_property_ref;
+
+/**
+ * Look up a property by name, and return a reference to it. Accessing the
+ * property through the reference with mpv_get_property_ref() and related
+ * functions skips the name lookup, which is useful if the same property is
+ * read very often (e.g. polling "time-pos" on each rendered frame).
+ *
+ * Resolving the same name again on the same mpv_handle returns the same
+ * reference. References belong to the mpv_handle, and are valid until the
+ * handle is destroyed. There is no function to free them.
+ *
+ * The name can include a sub-property path (e.g. "video-params/w").
+ *
+ * Safe to be called from mpv render API threads.
+ *
+ * @param name The property name.
+ * @return the reference, or NULL if there is no such property (or on OOM)
+ */
+mpv_property_ref *mpv_resolve_property(mpv_handle *ctx, const char *name);
+
+/**
+ * Same as mpv_get_property(), but with a property resolved with
+ * mpv_resolve_property() on the same mpv_handle.
+ */
+int mpv_get_property_ref(mpv_handle *ctx, mpv_property_ref *prop,
+                         mpv_format format, void *data);
+
+/**
+ * Same as mpv_set_property(), but with a property resolved with
+ * mpv_resolve_property() on the same mpv_handle.
+ */
+int mpv_set_property_ref(mpv_handle *ctx, mpv_property_ref *prop,
+                         mpv_format format, void *data);
+
+/**
+ * Same as mpv_observe_property(), but with a property resolved with
+ * mpv_resolve_property() on the same mpv_handle. The returned events still
+ * contain the property name, and mpv_unobserve_property() works as usual.
+ */
+int mpv_observe_property_ref(mpv_handle *mpv, uint64_t reply_userdata,
+                             mpv_property_ref *prop, mpv_format format);
+
 typedef enum mpv_event_id {
     /**
      * Nothing happened. Happens on timeouts or sporadic wakeups.
@@ -1312,7 +1423,8 @@ typedef enum mpv_event_id {
      */
     MPV_EVENT_SET_PROPERTY_REPLY = 4,
     /**
-     * Reply to a mpv_command_async() or mpv_command_node_async() request.
+     * Reply to a mpv_command_async(), mpv_command_node_async(), or
+     * mpv_command_batch_async() request.
      * See also mpv_event and mpv_event_command.
      */
     MPV_EVENT_COMMAND_REPLY     = 5,
@@ -1849,6 +1961,31 @@ int mpv_request_log_messages(mpv_handle *ctx, const char *min_level);
  */
 mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout);
 
+/**
+ * Resize the event queue of this handle to the given number of entries, and
+ * let mpv_wait_event() read queued events without taking any locks. This is
+ * meant for clients which consume a large number of events, and use a single
+ * thread for mpv_wait_event().
+ *
+ * Events are returned in the same order and with the same contents as
+ * without calling this function. Only events which are queued internally use
+ * the lock-free path: property change and log message events are generated
+ * on the fly and still go through the normal path.
+ *
+ * After this call, mpv_wait_event() must never be called concurrently on the
+ * same handle (not even as described in the mpv_wait_event() "race
+ * conditions" remark), or the queue will be corrupted. This function itself
+ * must not be called concurrently with mpv_wait_event() either.
+ *
+ * This function can be called multiple times to change the queue size.
+ *
+ * @param size maximum number of queued events (default: 1000, must be between
+ *             1 and 1048576)
+ * @return error code; MPV_ERROR_EVENT_QUEUE_FULL if more events are currently
+ *         queued or reserved for replies than fit into the new size
+ */
+int mpv_enable_event_ring(mpv_handle *ctx, int size);
+
 /**
  * Interrupt the current mpv_wait_event() call. This will wake up the thread
  * currently waiting in mpv_wait_event(). If no thread is waiting, the next
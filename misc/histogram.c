@@ -0,0 +1,92 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "common/common.h"
+#include "histogram.h"
+
+#define SUB_COUNT (1 << MP_HISTOGRAM_SUB_BITS)
+#define MAX_VALUE ((INT64_C(1) << MP_HISTOGRAM_MAX_BITS) - 1)
+
+static int log2_64(uint64_t v)
+{
+    return v >> 32 ? mp_log2(v >> 32) + 32 : mp_log2(v);
+}
+
+// Buckets 0..SUB_COUNT-1 are the exact values. After that, every group of
+// SUB_COUNT buckets covers one power of 2: with m = log2(v) - SUB_BITS, the
+// value v falls into bucket m * SUB_COUNT + (v >> m), where (v >> m) is in
+// [SUB_COUNT, 2 * SUB_COUNT).
+static int bucket_index(int64_t v)
+{
+    if (v < SUB_COUNT)
+        return v;
+    int m = log2_64(v) - MP_HISTOGRAM_SUB_BITS;
+    return m * SUB_COUNT + (int)(v >> m);
+}
+
+// Largest value that maps to the given bucket.
+static int64_t bucket_max(int idx)
+{
+    if (idx < SUB_COUNT)
+        return idx;
+    int m = idx / SUB_COUNT - 1;
+    int64_t top = idx - m * SUB_COUNT;
+    return ((top + 1) << m) - 1;
+}
+
+void mp_histogram_add(struct mp_histogram *h, int64_t value)
+{
+    value = MPCLAMP(value, 0, MAX_VALUE);
+    if (!h->count || value < h->min)
+        h->min = value;
+    if (!h->count || value > h->max)
+        h->max = value;
+    h->count++;
+    h->sum += value;
+    h->buckets[bucket_index(value)]++;
+}
+
+void mp_histogram_merge(struct mp_histogram *dst, struct mp_histogram *src)
+{
+    if (!src->count)
+        return;
+    if (!dst->count || src->min < dst->min)
+        dst->min = src->min;
+    if (!dst->count || src->max > dst->max)
+        dst->max = src->max;
+    dst->count += src->count;
+    dst->sum += src->sum;
+    for (int n = 0; n < MP_HISTOGRAM_BUCKETS; n++)
+        dst->buckets[n] += src->buckets[n];
+}
+
+int64_t mp_histogram_percentile(struct mp_histogram *h, double p)
+{
+    if (!h->count)
+        return 0;
+    uint64_t rank = ceil(MPCLAMP(p, 0.0, 1.0) * h->count);
+    rank = MPMAX(rank, 1);
+    uint64_t seen = 0;
+    for (int n = 0; n < MP_HISTOGRAM_BUCKETS; n++) {
+        seen += h->buckets[n];
+        if (seen >= rank)
+            return MPCLAMP(bucket_max(n), h->min, h->max);
+    }
+    return h->max;
+}
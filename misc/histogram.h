@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+// Values below 2^SUB_BITS are counted exactly. Each power of 2 above that is
+// split into 2^SUB_BITS linear buckets, so a bucket's width is at most 1/16 of
+// its values. (Same idea as HdrHistogram.) Values are clamped to 2^MAX_BITS-1.
+#define MP_HISTOGRAM_SUB_BITS 4
+#define MP_HISTOGRAM_MAX_BITS 40
+#define MP_HISTOGRAM_BUCKETS \
+    ((MP_HISTOGRAM_MAX_BITS - MP_HISTOGRAM_SUB_BITS + 1) << MP_HISTOGRAM_SUB_BITS)
+
+// Counts non-negative integer values (such as latencies in microseconds). Can
+// be zero-initialized, and copied by value.
+struct mp_histogram {
+    uint64_t count;
+    int64_t min, max;
+    double sum;
+    uint64_t buckets[MP_HISTOGRAM_BUCKETS];
+};
+
+void mp_histogram_add(struct mp_histogram *h, int64_t value);
+void mp_histogram_merge(struct mp_histogram *dst, struct mp_histogram *src);
+
+// Return a value v such that the fraction p (0-1) of all values is <= v. The
+// result is exact within the bucket width. Returns 0 if the histogram is empty.
+int64_t mp_histogram_percentile(struct mp_histogram *h, double p);
+
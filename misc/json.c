@@ -29,6 +29,9 @@
  *    and contain only characters in [A-Za-z0-9_]
  *  - byte escapes with "\xAB" are allowed (with AB being a 2 digit hex number)
  *
+ * json_next_token() provides the same parser as a stream of tokens, which lets
+ * callers convert the data without building a mpv_node tree first.
+ *
  * Also see: http://tools.ietf.org/html/rfc8259
  *
  * JSON writer:
@@ -130,64 +133,73 @@ static int read_str(void *ta_parent, struct mpv_node *dst, char **src)
     return 0;
 }
 
-static int read_sub(void *ta_parent, struct mpv_node *dst, char **src,
-                    int max_depth)
+void json_tokenizer_init(struct json_tokenizer *t, void *ta_parent, char *src,
+                         int max_depth)
 {
-    bool is_arr = eat_c(src, '[');
-    bool is_obj = !is_arr && eat_c(src, '{');
-    if (!is_arr && !is_obj)
-        return -1; // not an array or object
-    char term = is_obj ? '}' : ']';
-    struct mpv_node_list *list = talloc_zero(ta_parent, struct mpv_node_list);
-    while (1) {
-        eat_ws(src);
-        if (eat_c(src, term))
-            break;
-        if (list->num > 0 && !eat_c(src, ','))
-            return -1; // missing ','
-        eat_ws(src);
-        // non-standard extension: allow a trailing ","
-        if (eat_c(src, term))
-            break;
-        if (is_obj) {
-            struct mpv_node keynode;
-            // non-standard extension: allow unquoted strings as keys
-            if (read_id(list, &keynode, src) < 0 &&
-                read_str(list, &keynode, src) < 0)
-                return -1; // key is not a string
-            eat_ws(src);
-            // non-standard extension: allow "=" instead of ":"
-            if (!eat_c(src, ':') && !eat_c(src, '='))
-                return -1; // ':' missing
-            eat_ws(src);
-            MP_TARRAY_GROW(list, list->keys, list->num);
-            list->keys[list->num] = keynode.u.string;
-        }
-        MP_TARRAY_GROW(list, list->values, list->num);
-        if (json_parse(ta_parent, &list->values[list->num], src, max_depth) < 0)
-            return -1;
-        list->num++;
+    *t = (struct json_tokenizer){
+        .src = src,
+        .ta_parent = ta_parent,
+        .max_depth = MPMIN(max_depth, JSON_MAX_DEPTH),
+    };
+}
+
+// Parse plain decimal integers directly, and leave everything else (floats,
+// hex/octal numbers, overflows) to the libc functions.
+static bool read_simple_int(struct json_token *tok, char **src)
+{
+    char *cur = *src;
+    bool neg = eat_c(&cur, '-');
+    char *digits = cur;
+    uint64_t v = 0;
+    while (*cur >= '0' && *cur <= '9' && cur - digits < 18)
+        v = v * 10 + (*cur++ - '0');
+    if (cur == digits || (digits[0] == '0' && cur - digits > 1))
+        return false;
+    char c = *cur;
+    if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' ||
+        c == 'x' || c == 'X')
+        return false;
+    *src = cur;
+    tok->type = JSON_TOKEN_INT64;
+    tok->u.int64 = neg ? -(int64_t)v : (int64_t)v;
+    return true;
+}
+
+static int read_number(struct json_token *tok, char **src)
+{
+    if (read_simple_int(tok, src))
+        return 0;
+    // The number could be either a float or an int. JSON doesn't make a
+    // difference, but the client API does.
+    char *nsrci = *src, *nsrcf = *src;
+    errno = 0;
+    long long int numi = strtoll(*src, &nsrci, 0);
+    if (errno)
+        nsrci = *src;
+    errno = 0;
+    double numf = strtod(*src, &nsrcf);
+    if (errno)
+        nsrcf = *src;
+    if (nsrci >= nsrcf) {
+        *src = nsrci;
+        tok->type = JSON_TOKEN_INT64; // long long is usually 64 bits
+        tok->u.int64 = numi;
+        return 0;
     }
-    dst->format = is_obj ? MPV_FORMAT_NODE_MAP : MPV_FORMAT_NODE_ARRAY;
-    dst->u.list = list;
-    return 0;
+    if (nsrcf > *src && isfinite(numf)) {
+        *src = nsrcf;
+        tok->type = JSON_TOKEN_DOUBLE;
+        tok->u.double_ = numf;
+        return 0;
+    }
+    return -1;
 }
 
-/* Parse the string in *src as JSON, and write the result into *dst.
- * max_depth limits the recursion and JSON tree depth.
- * Warning: this overwrites the input string (what *src points to)!
- * Returns:
- *   0: success, *dst is valid, *src points to the end (the caller must check
- *      whether *src really terminates)
- *  -1: failure, *dst is invalid, there may be dead allocs under ta_parent
- *      (ta_free_children(ta_parent) is the only way to free them)
- * The input string can be mutated in both cases. *dst might contain string
- * elements, which point into the (mutated) input string.
- */
-int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
+static int read_value(struct json_tokenizer *t, struct json_token *tok)
 {
-    max_depth -= 1;
-    if (max_depth < 0)
+    char **src = &t->src;
+
+    if (t->depth >= t->max_depth)
         return -1;
 
     eat_ws(src);
@@ -197,53 +209,211 @@ int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
         return -1; // early EOF
     if (c == 'n' && strncmp(*src, "null", 4) == 0) {
         *src += 4;
-        dst->format = MPV_FORMAT_NONE;
+        tok->type = JSON_TOKEN_NULL;
         return 0;
     } else if (c == 't' && strncmp(*src, "true", 4) == 0) {
         *src += 4;
-        dst->format = MPV_FORMAT_FLAG;
-        dst->u.flag = 1;
+        tok->type = JSON_TOKEN_FLAG;
+        tok->u.flag = true;
         return 0;
     } else if (c == 'f' && strncmp(*src, "false", 5) == 0) {
         *src += 5;
-        dst->format = MPV_FORMAT_FLAG;
-        dst->u.flag = 0;
+        tok->type = JSON_TOKEN_FLAG;
+        tok->u.flag = false;
         return 0;
     } else if (c == '"') {
-        return read_str(ta_parent, dst, src);
+        struct mpv_node node;
+        if (read_str(t->ta_parent, &node, src) < 0)
+            return -1;
+        tok->type = JSON_TOKEN_STRING;
+        tok->u.string = node.u.string;
+        return 0;
     } else if (c == '[' || c == '{') {
-        return read_sub(ta_parent, dst, src, max_depth);
+        *src += 1;
+        if (c == '{') {
+            t->map_levels |= 1ULL << t->depth;
+        } else {
+            t->map_levels &= ~(1ULL << t->depth);
+        }
+        t->depth++;
+        t->have_item = false;
+        tok->type = c == '{' ? JSON_TOKEN_MAP_START : JSON_TOKEN_ARRAY_START;
+        return 0;
     } else if (c == '-' || (c >= '0' && c <= '9')) {
-        // The number could be either a float or an int. JSON doesn't make a
-        // difference, but the client API does.
-        char *nsrci = *src, *nsrcf = *src;
-        errno = 0;
-        long long int numi = strtoll(*src, &nsrci, 0);
-        if (errno)
-            nsrci = *src;
-        errno = 0;
-        double numf = strtod(*src, &nsrcf);
-        if (errno)
-            nsrcf = *src;
-        if (nsrci >= nsrcf) {
-            *src = nsrci;
-            dst->format = MPV_FORMAT_INT64; // long long is usually 64 bits
-            dst->u.int64 = numi;
-            return 0;
+        return read_number(tok, src);
+    }
+    return -1; // character doesn't start a valid token
+}
+
+static int next_token(struct json_tokenizer *t, struct json_token *tok)
+{
+    char **src = &t->src;
+
+    if (!t->depth) {
+        if (t->have_item)
+            return JSON_TOKEN_END;
+        t->have_item = true;
+        return read_value(t, tok) < 0 ? -1 : tok->type;
+    }
+
+    bool is_obj = t->map_levels & (1ULL << (t->depth - 1));
+    char term = is_obj ? '}' : ']';
+    eat_ws(src);
+    if (!eat_c(src, term)) {
+        if (t->have_item && !eat_c(src, ','))
+            return -1; // missing ','
+        eat_ws(src);
+        // non-standard extension: allow a trailing ","
+        if (!eat_c(src, term)) {
+            if (is_obj) {
+                struct mpv_node keynode;
+                // non-standard extension: allow unquoted strings as keys
+                if (read_id(t->ta_parent, &keynode, src) < 0 &&
+                    read_str(t->ta_parent, &keynode, src) < 0)
+                    return -1; // key is not a string
+                eat_ws(src);
+                // non-standard extension: allow "=" instead of ":"
+                if (!eat_c(src, ':') && !eat_c(src, '='))
+                    return -1; // ':' missing
+                tok->key = keynode.u.string;
+            }
+            t->have_item = true;
+            return read_value(t, tok) < 0 ? -1 : tok->type;
         }
-        if (nsrcf > *src && isfinite(numf)) {
-            *src = nsrcf;
-            dst->format = MPV_FORMAT_DOUBLE;
-            dst->u.double_ = numf;
-            return 0;
+    }
+
+    // The container is an item of its parent.
+    t->depth--;
+    t->have_item = true;
+    tok->type = is_obj ? JSON_TOKEN_MAP_END : JSON_TOKEN_ARRAY_END;
+    return tok->type;
+}
+
+/* Read the next token from the input. The tokenizer returns a single value
+ * (which can be an array or object with nested values), and then returns
+ * JSON_TOKEN_END. t->src then points to the end of the value (the caller must
+ * check whether it really terminates). Values within an object have the key
+ * set in tok->key.
+ * Returns the token type (also written to tok->type), or JSON_TOKEN_ERROR.
+ * After an error, all further calls return JSON_TOKEN_ERROR.
+ * Like json_parse(), this mutates the input string, and strings point into it
+ * (or are allocated with t->ta_parent if they contain escapes).
+ */
+int json_next_token(struct json_tokenizer *t, struct json_token *tok)
+{
+    *tok = (struct json_token){0};
+    if (t->error)
+        return JSON_TOKEN_ERROR;
+    int r = next_token(t, tok);
+    if (r < 0) {
+        t->error = true;
+        r = JSON_TOKEN_ERROR;
+    }
+    tok->type = r;
+    return r;
+}
+
+static int parse_token(struct json_tokenizer *t, struct json_token *tok,
+                       struct mpv_node *dst)
+{
+    switch (tok->type) {
+    case JSON_TOKEN_NULL:
+        dst->format = MPV_FORMAT_NONE;
+        return 0;
+    case JSON_TOKEN_FLAG:
+        dst->format = MPV_FORMAT_FLAG;
+        dst->u.flag = tok->u.flag;
+        return 0;
+    case JSON_TOKEN_INT64:
+        dst->format = MPV_FORMAT_INT64;
+        dst->u.int64 = tok->u.int64;
+        return 0;
+    case JSON_TOKEN_DOUBLE:
+        dst->format = MPV_FORMAT_DOUBLE;
+        dst->u.double_ = tok->u.double_;
+        return 0;
+    case JSON_TOKEN_STRING:
+        dst->format = MPV_FORMAT_STRING;
+        dst->u.string = tok->u.string;
+        return 0;
+    case JSON_TOKEN_ARRAY_START:
+    case JSON_TOKEN_MAP_START: {
+        bool is_obj = tok->type == JSON_TOKEN_MAP_START;
+        int end = is_obj ? JSON_TOKEN_MAP_END : JSON_TOKEN_ARRAY_END;
+        struct mpv_node_list *list =
+            talloc_zero(t->ta_parent, struct mpv_node_list);
+        while (1) {
+            struct json_token item;
+            int r = json_next_token(t, &item);
+            if (r == end)
+                break;
+            if (r < 0)
+                return -1;
+            if (is_obj) {
+                MP_TARRAY_GROW(list, list->keys, list->num);
+                list->keys[list->num] = item.key;
+            }
+            MP_TARRAY_GROW(list, list->values, list->num);
+            if (parse_token(t, &item, &list->values[list->num]) < 0)
+                return -1;
+            list->num++;
         }
+        dst->format = is_obj ? MPV_FORMAT_NODE_MAP : MPV_FORMAT_NODE_ARRAY;
+        dst->u.list = list;
+        return 0;
+    }
+    default:
         return -1;
     }
-    return -1; // character doesn't start a valid token
+}
+
+/* Parse the string in *src as JSON, and write the result into *dst.
+ * max_depth limits the recursion and JSON tree depth.
+ * Warning: this overwrites the input string (what *src points to)!
+ * Returns:
+ *   0: success, *dst is valid, *src points to the end (the caller must check
+ *      whether *src really terminates)
+ *  -1: failure, *dst is invalid, there may be dead allocs under ta_parent
+ *      (ta_free_children(ta_parent) is the only way to free them)
+ * The input string can be mutated in both cases. *dst might contain string
+ * elements, which point into the (mutated) input string.
+ */
+int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
+{
+    struct json_tokenizer t;
+    json_tokenizer_init(&t, ta_parent, *src, max_depth);
+    struct json_token tok;
+    json_next_token(&t, &tok);
+    int r = parse_token(&t, &tok, dst);
+    *src = t.src;
+    return r;
 }
 
 
-#define APPEND(b, s) bstr_xappend(NULL, (b), bstr0(s))
+// Output buffer; buf is a talloc allocation with size bytes (or NULL).
+struct out {
+    char *buf;
+    size_t len, size;
+};
+
+static void out_grow(struct out *o, size_t append)
+{
+    if (append >= SIZE_MAX / 4 || o->len >= SIZE_MAX / 4)
+        abort(); // oom
+    o->size = MPMAX(o->size * 2, o->len + append + 1);
+    o->buf = talloc_realloc_size(NULL, o->buf, o->size);
+}
+
+// Append the data. Always leaves room for a terminating \0.
+static inline void out_append(struct out *o, const void *data, size_t len)
+{
+    if (o->size - o->len <= len)
+        out_grow(o, len);
+    memcpy(o->buf + o->len, data, len);
+    o->len += len;
+}
+
+#define APPEND(o, s) out_append((o), (s), strlen(s))
 
 static const char special_escape[] = {
     ['\b'] = 'b',
@@ -253,78 +423,106 @@ static const char special_escape[] = {
     ['\t'] = 't',
 };
 
-static void write_json_str(bstr *b, unsigned char *str)
+static void write_json_str(struct out *o, unsigned char *str)
 {
-    APPEND(b, "\"");
+    static const char hex[] = "0123456789abcdef";
+    APPEND(o, "\"");
     while (1) {
         unsigned char *cur = str;
         while (cur[0] >= 32 && cur[0] != '"' && cur[0] != '\\')
             cur++;
+        out_append(o, str, cur - str);
         if (!cur[0])
             break;
-        bstr_xappend(NULL, b, (bstr){str, cur - str});
-        if (cur[0] == '\"') {
-            bstr_xappend(NULL, b, (bstr){"\\\"", 2});
-        } else if (cur[0] == '\\') {
-            bstr_xappend(NULL, b, (bstr){"\\\\", 2});
-        } else if (cur[0] < sizeof(special_escape) && special_escape[cur[0]]) {
-            bstr_xappend_asprintf(NULL, b, "\\%c", special_escape[cur[0]]);
-        } else {
-            bstr_xappend_asprintf(NULL, b, "\\u%04x", (unsigned char)cur[0]);
+        char esc[6] = {'\\', cur[0]};
+        int esc_len = 2;
+        if (cur[0] < sizeof(special_escape) && special_escape[cur[0]]) {
+            esc[1] = special_escape[cur[0]];
+        } else if (cur[0] < 32) {
+            memcpy(esc, (char[]){'\\', 'u', '0', '0', hex[cur[0] >> 4],
+                                 hex[cur[0] & 15]}, 6);
+            esc_len = 6;
         }
+        out_append(o, esc, esc_len);
         str = cur + 1;
     }
-    APPEND(b, str);
-    APPEND(b, "\"");
+    APPEND(o, "\"");
+}
+
+static void write_int(struct out *o, int64_t v)
+{
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    uint64_t u = v < 0 ? -(uint64_t)v : v;
+    do {
+        *--p = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    if (v < 0)
+        *--p = '-';
+    out_append(o, p, end - p);
+}
+
+static void write_double(struct out *o, double v)
+{
+    const char *px = isfinite(v) ? "" : "\"";
+    char buf[64];
+    int len = snprintf(buf, sizeof(buf), "%s%f%s", px, v, px);
+    if (len >= 0 && len < sizeof(buf)) {
+        out_append(o, buf, len);
+    } else {
+        char *s = talloc_asprintf(NULL, "%s%f%s", px, v, px);
+        APPEND(o, s);
+        talloc_free(s);
+    }
 }
 
-static void add_indent(bstr *b, int indent)
+static void add_indent(struct out *o, int indent)
 {
     if (indent < 0)
         return;
-    bstr_xappend(NULL, b, bstr0("\n"));
+    APPEND(o, "\n");
     for (int n = 0; n < indent; n++)
-        bstr_xappend(NULL, b, bstr0(" "));
+        APPEND(o, " ");
 }
 
-static int json_append(bstr *b, const struct mpv_node *src, int indent)
+static int json_append(struct out *o, const struct mpv_node *src, int indent)
 {
     switch (src->format) {
     case MPV_FORMAT_NONE:
-        APPEND(b, "null");
+        APPEND(o, "null");
         return 0;
     case MPV_FORMAT_FLAG:
-        APPEND(b, src->u.flag ? "true" : "false");
+        APPEND(o, src->u.flag ? "true" : "false");
         return 0;
     case MPV_FORMAT_INT64:
-        bstr_xappend_asprintf(NULL, b, "%"PRId64, src->u.int64);
+        write_int(o, src->u.int64);
         return 0;
-    case MPV_FORMAT_DOUBLE: {
-        const char *px = isfinite(src->u.double_) ? "" : "\"";
-        bstr_xappend_asprintf(NULL, b, "%s%f%s", px, src->u.double_, px);
+    case MPV_FORMAT_DOUBLE:
+        write_double(o, src->u.double_);
         return 0;
-    }
     case MPV_FORMAT_STRING:
-        write_json_str(b, src->u.string);
+        write_json_str(o, src->u.string);
         return 0;
     case MPV_FORMAT_NODE_ARRAY:
     case MPV_FORMAT_NODE_MAP: {
         struct mpv_node_list *list = src->u.list;
         bool is_obj = src->format == MPV_FORMAT_NODE_MAP;
-        APPEND(b, is_obj ? "{" : "[");
+        APPEND(o, is_obj ? "{" : "[");
         int next_indent = indent >= 0 ? indent + 1 : -1;
         for (int n = 0; n < list->num; n++) {
             if (n)
-                APPEND(b, ",");
-            add_indent(b, next_indent);
+                APPEND(o, ",");
+            add_indent(o, next_indent);
             if (is_obj) {
-                write_json_str(b, list->keys[n]);
-                APPEND(b, ":");
+                write_json_str(o, list->keys[n]);
+                APPEND(o, ":");
             }
-            json_append(b, &list->values[n], next_indent);
+            json_append(o, &list->values[n], next_indent);
         }
-        add_indent(b, indent);
-        APPEND(b, is_obj ? "}" : "]");
+        add_indent(o, indent);
+        APPEND(o, is_obj ? "}" : "]");
         return 0;
     }
     }
@@ -333,9 +531,15 @@ static int json_append(bstr *b, const struct mpv_node *src, int indent)
 
 static int json_append_str(char **dst, struct mpv_node *src, int indent)
 {
-    bstr buffer = bstr0(*dst);
-    int r = json_append(&buffer, src, indent);
-    *dst = buffer.start;
+    struct out o = {
+        .buf = *dst,
+        .len = *dst ? strlen(*dst) : 0,
+        .size = talloc_get_size(*dst),
+    };
+    int r = json_append(&o, src, indent);
+    out_append(&o, "", 0);
+    o.buf[o.len] = '\0';
+    *dst = o.buf;
     return r;
 }
 
@@ -21,6 +21,51 @@
 // We reuse mpv_node.
 #include "libmpv/client.h"
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#define JSON_MAX_DEPTH 64
+
+enum json_token_type {
+    JSON_TOKEN_ERROR = -1,
+    JSON_TOKEN_END = 0,     // after the complete value was read
+    JSON_TOKEN_NULL,
+    JSON_TOKEN_FLAG,        // u.flag
+    JSON_TOKEN_INT64,       // u.int64
+    JSON_TOKEN_DOUBLE,      // u.double_
+    JSON_TOKEN_STRING,      // u.string
+    JSON_TOKEN_ARRAY_START,
+    JSON_TOKEN_ARRAY_END,
+    JSON_TOKEN_MAP_START,
+    JSON_TOKEN_MAP_END,
+};
+
+struct json_token {
+    enum json_token_type type;
+    char *key;              // for values within a map (else NULL)
+    union {
+        bool flag;
+        int64_t int64;
+        double double_;
+        char *string;
+    } u;
+};
+
+struct json_tokenizer {
+    char *src;              // current position in the input
+    // Internal.
+    void *ta_parent;
+    int max_depth;
+    int depth;
+    uint64_t map_levels;    // bit n set => nesting level n is a map
+    bool have_item;         // current level has at least 1 item
+    bool error;
+};
+
+void json_tokenizer_init(struct json_tokenizer *t, void *ta_parent, char *src,
+                         int max_depth);
+int json_next_token(struct json_tokenizer *t, struct json_token *tok);
+
 int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth);
 void json_skip_whitespace(char **src);
 int json_write(char **s, struct mpv_node *src);
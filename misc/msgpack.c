@@ -0,0 +1,335 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* MessagePack parser and writer for mpv_node.
+ *
+ * Only the subset of MessagePack that maps to mpv_node is supported:
+ *  - nil, bool, int (up to INT64_MAX for unsigned values), float 32/64
+ *  - str, which is mapped to MPV_FORMAT_STRING (embedded 0 bytes are not
+ *    supported, and truncate the string)
+ *  - bin, which is mapped to MPV_FORMAT_BYTE_ARRAY
+ *  - array, and map with str keys
+ * ext types are rejected.
+ *
+ * The writer always uses the shortest encoding for a value.
+ *
+ * Also see: https://github.com/msgpack/msgpack/blob/master/spec.md
+ */
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "common/common.h"
+#include "misc/bstr.h"
+
+#include "msgpack.h"
+
+static bool read_bytes(bstr *src, size_t len, bstr *out)
+{
+    if (src->len < len)
+        return false;
+    *out = bstr_splice(*src, 0, len);
+    *src = bstr_cut(*src, len);
+    return true;
+}
+
+static bool read_uint(bstr *src, int bytes, uint64_t *out)
+{
+    bstr d;
+    if (!read_bytes(src, bytes, &d))
+        return false;
+    uint64_t v = 0;
+    for (int n = 0; n < bytes; n++)
+        v = (v << 8) | d.start[n];
+    *out = v;
+    return true;
+}
+
+static int read_str(void *ta_parent, struct mpv_node *dst, bstr *src,
+                    size_t len)
+{
+    bstr s;
+    if (!read_bytes(src, len, &s))
+        return -1;
+    dst->format = MPV_FORMAT_STRING;
+    dst->u.string = bstrdup0(ta_parent, s);
+    return 0;
+}
+
+static int read_bin(void *ta_parent, struct mpv_node *dst, bstr *src,
+                    size_t len)
+{
+    bstr s;
+    if (!read_bytes(src, len, &s))
+        return -1;
+    struct mpv_byte_array *ba = talloc_zero(ta_parent, struct mpv_byte_array);
+    ba->data = talloc_memdup(ba, s.start, s.len);
+    ba->size = s.len;
+    dst->format = MPV_FORMAT_BYTE_ARRAY;
+    dst->u.ba = ba;
+    return 0;
+}
+
+static int read_sub(void *ta_parent, struct mpv_node *dst, bstr *src,
+                    size_t num, bool is_obj, int max_depth)
+{
+    // Each element takes at least 1 byte; don't allocate based on bogus sizes.
+    if (num > src->len)
+        return -1;
+    struct mpv_node_list *list = talloc_zero(ta_parent, struct mpv_node_list);
+    dst->format = is_obj ? MPV_FORMAT_NODE_MAP : MPV_FORMAT_NODE_ARRAY;
+    dst->u.list = list;
+    list->values = talloc_array(list, struct mpv_node, num);
+    if (is_obj)
+        list->keys = talloc_array(list, char *, num);
+    for (size_t n = 0; n < num; n++) {
+        if (is_obj) {
+            struct mpv_node key;
+            if (msgpack_parse(list, &key, src, max_depth) < 0)
+                return -1;
+            if (key.format != MPV_FORMAT_STRING)
+                return -1;
+            list->keys[n] = key.u.string;
+        }
+        if (msgpack_parse(list, &list->values[n], src, max_depth) < 0)
+            return -1;
+        list->num++;
+    }
+    return 0;
+}
+
+/* Parse the MessagePack value at *src into *dst, and advance *src past it.
+ * Returns:
+ *   0: success, *dst is valid
+ *  -1: failure, *dst is invalid, there may be dead allocs under ta_parent
+ *      (ta_free_children(ta_parent) is the only way to free them)
+ * All data is copied; *dst does not point into the input.
+ */
+int msgpack_parse(void *ta_parent, struct mpv_node *dst, bstr *src,
+                  int max_depth)
+{
+    max_depth -= 1;
+    if (max_depth < 0)
+        return -1;
+
+    if (!src->len)
+        return -1; // early EOF
+    uint8_t c = src->start[0];
+    *src = bstr_cut(*src, 1);
+
+    uint64_t v;
+
+    if (c <= 0x7f || c >= 0xe0) {
+        dst->format = MPV_FORMAT_INT64;
+        dst->u.int64 = (int8_t)c;
+        return 0;
+    } else if (c >= 0xa0 && c <= 0xbf) {
+        return read_str(ta_parent, dst, src, c & 0x1f);
+    } else if (c >= 0x90 && c <= 0x9f) {
+        return read_sub(ta_parent, dst, src, c & 0x0f, false, max_depth);
+    } else if (c >= 0x80 && c <= 0x8f) {
+        return read_sub(ta_parent, dst, src, c & 0x0f, true, max_depth);
+    }
+
+    switch (c) {
+    case 0xc0:
+        dst->format = MPV_FORMAT_NONE;
+        return 0;
+    case 0xc2:
+    case 0xc3:
+        dst->format = MPV_FORMAT_FLAG;
+        dst->u.flag = c == 0xc3;
+        return 0;
+    case 0xc4:
+    case 0xc5:
+    case 0xc6:
+        if (!read_uint(src, 1 << (c - 0xc4), &v))
+            return -1;
+        return read_bin(ta_parent, dst, src, v);
+    case 0xca: {
+        if (!read_uint(src, 4, &v))
+            return -1;
+        union { uint32_t i; float f; } u = { .i = v };
+        dst->format = MPV_FORMAT_DOUBLE;
+        dst->u.double_ = u.f;
+        return 0;
+    }
+    case 0xcb: {
+        if (!read_uint(src, 8, &v))
+            return -1;
+        union { uint64_t i; double f; } u = { .i = v };
+        dst->format = MPV_FORMAT_DOUBLE;
+        dst->u.double_ = u.f;
+        return 0;
+    }
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf:
+        if (!read_uint(src, 1 << (c - 0xcc), &v) || v > INT64_MAX)
+            return -1;
+        dst->format = MPV_FORMAT_INT64;
+        dst->u.int64 = v;
+        return 0;
+    case 0xd0:
+    case 0xd1:
+    case 0xd2:
+    case 0xd3: {
+        int bytes = 1 << (c - 0xd0);
+        if (!read_uint(src, bytes, &v))
+            return -1;
+        // Sign-extend.
+        int shift = 64 - bytes * 8;
+        dst->format = MPV_FORMAT_INT64;
+        dst->u.int64 = shift ? (int64_t)(v << shift) >> shift : (int64_t)v;
+        return 0;
+    }
+    case 0xd9:
+    case 0xda:
+    case 0xdb:
+        if (!read_uint(src, 1 << (c - 0xd9), &v))
+            return -1;
+        return read_str(ta_parent, dst, src, v);
+    case 0xdc:
+    case 0xdd:
+        if (!read_uint(src, c == 0xdc ? 2 : 4, &v))
+            return -1;
+        return read_sub(ta_parent, dst, src, v, false, max_depth);
+    case 0xde:
+    case 0xdf:
+        if (!read_uint(src, c == 0xde ? 2 : 4, &v))
+            return -1;
+        return read_sub(ta_parent, dst, src, v, true, max_depth);
+    }
+    return -1; // ext types and reserved bytes
+}
+
+static void write_uint(void *ta_parent, bstr *dst, uint8_t tag, int bytes,
+                       uint64_t v)
+{
+    uint8_t buf[9] = {tag};
+    for (int n = 0; n < bytes; n++)
+        buf[1 + n] = v >> ((bytes - 1 - n) * 8);
+    bstr_xappend(ta_parent, dst, (bstr){buf, 1 + bytes});
+}
+
+// Write a length for a type with fix-variant (fix_tag, 0 if none) and 8/16/32
+// bit variants (tag8, 0 if none; tag16 and tag32 follow it).
+static void write_len(void *ta_parent, bstr *dst, uint64_t len, uint8_t fix_tag,
+                      int fix_max, uint8_t tag8, uint8_t tag16)
+{
+    if (fix_tag && len <= fix_max) {
+        write_uint(ta_parent, dst, fix_tag | len, 0, 0);
+    } else if (tag8 && len <= UINT8_MAX) {
+        write_uint(ta_parent, dst, tag8, 1, len);
+    } else if (len <= UINT16_MAX) {
+        write_uint(ta_parent, dst, tag16, 2, len);
+    } else {
+        write_uint(ta_parent, dst, tag16 + 1, 4, len);
+    }
+}
+
+static void write_int(void *ta_parent, bstr *dst, int64_t v)
+{
+    if (v >= 0) {
+        if (v <= 0x7f) {
+            write_uint(ta_parent, dst, v, 0, 0);
+        } else if (v <= UINT8_MAX) {
+            write_uint(ta_parent, dst, 0xcc, 1, v);
+        } else if (v <= UINT16_MAX) {
+            write_uint(ta_parent, dst, 0xcd, 2, v);
+        } else if (v <= UINT32_MAX) {
+            write_uint(ta_parent, dst, 0xce, 4, v);
+        } else {
+            write_uint(ta_parent, dst, 0xcf, 8, v);
+        }
+    } else {
+        if (v >= -32) {
+            write_uint(ta_parent, dst, (uint8_t)v, 0, 0);
+        } else if (v >= INT8_MIN) {
+            write_uint(ta_parent, dst, 0xd0, 1, (uint8_t)v);
+        } else if (v >= INT16_MIN) {
+            write_uint(ta_parent, dst, 0xd1, 2, (uint16_t)v);
+        } else if (v >= INT32_MIN) {
+            write_uint(ta_parent, dst, 0xd2, 4, (uint32_t)v);
+        } else {
+            write_uint(ta_parent, dst, 0xd3, 8, v);
+        }
+    }
+}
+
+static void write_str(void *ta_parent, bstr *dst, bstr s)
+{
+    if (s.len > UINT32_MAX)
+        s.len = UINT32_MAX;
+    write_len(ta_parent, dst, s.len, 0xa0, 31, 0xd9, 0xda);
+    bstr_xappend(ta_parent, dst, s);
+}
+
+/* Append the MessagePack encoding of src to *dst. *dst must be NULL or
+ * allocated with talloc (parent ta_parent), and is reallocated as needed.
+ * Returns 0 on success, and -1 if src contains unsupported node formats.
+ */
+int msgpack_write(void *ta_parent, bstr *dst, struct mpv_node *src)
+{
+    switch (src->format) {
+    case MPV_FORMAT_NONE:
+        write_uint(ta_parent, dst, 0xc0, 0, 0);
+        return 0;
+    case MPV_FORMAT_FLAG:
+        write_uint(ta_parent, dst, src->u.flag ? 0xc3 : 0xc2, 0, 0);
+        return 0;
+    case MPV_FORMAT_INT64:
+        write_int(ta_parent, dst, src->u.int64);
+        return 0;
+    case MPV_FORMAT_DOUBLE: {
+        union { uint64_t i; double f; } u = { .f = src->u.double_ };
+        write_uint(ta_parent, dst, 0xcb, 8, u.i);
+        return 0;
+    }
+    case MPV_FORMAT_STRING:
+        write_str(ta_parent, dst, bstr0(src->u.string));
+        return 0;
+    case MPV_FORMAT_BYTE_ARRAY: {
+        struct mpv_byte_array *ba = src->u.ba;
+        if (ba->size > UINT32_MAX)
+            return -1;
+        write_len(ta_parent, dst, ba->size, 0, 0, 0xc4, 0xc5);
+        bstr_xappend(ta_parent, dst, (bstr){ba->data, ba->size});
+        return 0;
+    }
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP: {
+        struct mpv_node_list *list = src->u.list;
+        bool is_obj = src->format == MPV_FORMAT_NODE_MAP;
+        int num = list ? list->num : 0;
+        if (is_obj) {
+            write_len(ta_parent, dst, num, 0x80, 15, 0, 0xde);
+        } else {
+            write_len(ta_parent, dst, num, 0x90, 15, 0, 0xdc);
+        }
+        for (int n = 0; n < num; n++) {
+            if (is_obj)
+                write_str(ta_parent, dst, bstr0(list->keys[n]));
+            if (msgpack_write(ta_parent, dst, &list->values[n]) < 0)
+                return -1;
+        }
+        return 0;
+    }
+    }
+    return -1;
+}
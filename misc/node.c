@@ -1,4 +1,5 @@
 #include "common/common.h"
+#include "osdep/atomic.h"
 
 #include "node.h"
 
@@ -146,3 +147,165 @@ bool equal_mpv_node(const struct mpv_node *a, const struct mpv_node *b)
         return false;
     return equal_mpv_value(&a->u, &b->u, a->format);
 }
+
+// Compact copies put all structs (which need alignment) at the start of the
+// allocation, followed by all strings.
+#define COMPACT_ALIGN 8
+
+struct compact_layout {
+    size_t structs;         // size/position of the struct part
+    size_t strings;         // size/position of the string part
+    char *mem;
+};
+
+static size_t compact_struct(size_t size)
+{
+    return MP_ALIGN_UP(size, COMPACT_ALIGN);
+}
+
+static void compact_measure(struct compact_layout *l, const struct mpv_node *src)
+{
+    switch (src->format) {
+    case MPV_FORMAT_STRING:
+        l->strings += strlen(src->u.string) + 1;
+        break;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP: {
+        struct mpv_node_list *list = src->u.list;
+        l->structs += compact_struct(sizeof(struct mpv_node_list));
+        l->structs += compact_struct(sizeof(struct mpv_node) * list->num);
+        if (src->format == MPV_FORMAT_NODE_MAP) {
+            l->structs += compact_struct(sizeof(char *) * list->num);
+            for (int n = 0; n < list->num; n++)
+                l->strings += strlen(list->keys[n]) + 1;
+        }
+        for (int n = 0; n < list->num; n++)
+            compact_measure(l, &list->values[n]);
+        break;
+    }
+    default: ;
+    }
+}
+
+static void *compact_alloc_struct(struct compact_layout *l, size_t size)
+{
+    void *p = l->mem + l->structs;
+    l->structs += compact_struct(size);
+    return p;
+}
+
+static char *compact_strdup(struct compact_layout *l, const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *p = l->mem + l->strings;
+    memcpy(p, s, len);
+    l->strings += len;
+    return p;
+}
+
+static void compact_copy(struct compact_layout *l, struct mpv_node *dst,
+                         const struct mpv_node *src)
+{
+    *dst = *src;
+    switch (src->format) {
+    case MPV_FORMAT_STRING:
+        dst->u.string = compact_strdup(l, src->u.string);
+        break;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP: {
+        struct mpv_node_list *old = src->u.list;
+        struct mpv_node_list *new =
+            compact_alloc_struct(l, sizeof(struct mpv_node_list));
+        *new = (struct mpv_node_list){
+            .num = old->num,
+            .values = compact_alloc_struct(l, sizeof(struct mpv_node) * old->num),
+        };
+        if (src->format == MPV_FORMAT_NODE_MAP) {
+            new->keys = compact_alloc_struct(l, sizeof(char *) * old->num);
+            for (int n = 0; n < old->num; n++)
+                new->keys[n] = compact_strdup(l, old->keys[n]);
+        }
+        for (int n = 0; n < old->num; n++)
+            compact_copy(l, &new->values[n], &old->values[n]);
+        dst->u.list = new;
+        break;
+    }
+    case MPV_FORMAT_NONE:
+    case MPV_FORMAT_FLAG:
+    case MPV_FORMAT_INT64:
+    case MPV_FORMAT_DOUBLE:
+        break;
+    default:
+        // unknown entry - mark as invalid (same as m_option_type_node)
+        dst->format = (mpv_format)-1;
+    }
+}
+
+// Copy src to dst, such that the entire tree uses a single allocation (with
+// ta_parent as parent), instead of one per list, key, and string. This is much
+// faster to create and free for large trees.
+// The result follows m_option_type_node memory management rules (it can be
+// freed with m_option_free()/mpv_free_node_contents()), but lists must not be
+// extended in-place, e.g. with node_map_add().
+void node_copy_compact(void *ta_parent, struct mpv_node *dst,
+                       const struct mpv_node *src)
+{
+    struct compact_layout l = {0};
+    compact_measure(&l, src);
+    size_t size = l.structs + l.strings;
+    if (!size) {
+        compact_copy(&l, dst, src);
+        return;
+    }
+    l = (struct compact_layout){
+        .mem = talloc_size(ta_parent, size),
+        .strings = l.structs,
+    };
+    // The first allocation is the root list or string, which is what
+    // node_get_alloc() returns for dst.
+    compact_copy(&l, dst, src);
+}
+
+struct node_snapshot {
+    struct mpv_node node;
+    atomic_int refcount;
+};
+
+// Create an immutable, refcounted copy of src. Like node_copy_compact(), the
+// copy uses a single allocation. Snapshots can be shared between threads.
+struct node_snapshot *node_snapshot_new(const struct mpv_node *src)
+{
+    struct compact_layout l = {0};
+    compact_measure(&l, src);
+    size_t header = compact_struct(sizeof(struct node_snapshot));
+    struct node_snapshot *snap = talloc_size(NULL, header + l.structs + l.strings);
+    *snap = (struct node_snapshot){
+        .refcount = ATOMIC_VAR_INIT(1),
+    };
+    l = (struct compact_layout){
+        .mem = (char *)snap,
+        .structs = header,
+        .strings = header + l.structs,
+    };
+    compact_copy(&l, &snap->node, src);
+    return snap;
+}
+
+struct node_snapshot *node_snapshot_ref(struct node_snapshot *snap)
+{
+    if (snap)
+        atomic_fetch_add(&snap->refcount, 1);
+    return snap;
+}
+
+void node_snapshot_unref(struct node_snapshot *snap)
+{
+    if (snap && atomic_fetch_add(&snap->refcount, -1) == 1)
+        talloc_free(snap);
+}
+
+// The returned node is valid as long as a reference to snap is held.
+const struct mpv_node *node_snapshot_get(struct node_snapshot *snap)
+{
+    return &snap->node;
+}
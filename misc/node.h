@@ -13,5 +13,13 @@ void node_map_add_flag(struct mpv_node *dst, const char *key, bool v);
 mpv_node *node_map_get(mpv_node *src, const char *key);
 bool equal_mpv_value(const void *a, const void *b, mpv_format format);
 bool equal_mpv_node(const struct mpv_node *a, const struct mpv_node *b);
+void node_copy_compact(void *ta_parent, struct mpv_node *dst,
+                       const struct mpv_node *src);
+
+struct node_snapshot;
+struct node_snapshot *node_snapshot_new(const struct mpv_node *src);
+struct node_snapshot *node_snapshot_ref(struct node_snapshot *snap);
+void node_snapshot_unref(struct node_snapshot *snap);
+const struct mpv_node *node_snapshot_get(struct node_snapshot *snap);
 
 #endif
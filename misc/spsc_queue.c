@@ -0,0 +1,107 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+
+#include "common/common.h"
+#include "osdep/atomic.h"
+#include "spsc_queue.h"
+
+struct mp_spsc_queue {
+    char *slots;
+    size_t elem_size;
+    unsigned long mask;     // number of slots - 1 (power of 2)
+    unsigned long capacity; // usable number of slots, <= mask + 1
+
+    // Positions wrap around; only the difference and (pos & mask) matter.
+    // The producer writes write_pos, the consumer writes read_pos. Each side
+    // keeps its own position in a non-atomic copy to avoid reloading it. The
+    // padding keeps the two sides on separate cache lines.
+    atomic_ulong write_pos;
+    unsigned long producer_pos;
+    char pad[64];
+    atomic_ulong read_pos;
+    unsigned long consumer_pos;
+};
+
+// capacity is the maximum number of queued elements. The queue allocates
+// at least that many slots, rounded up to a power of 2.
+struct mp_spsc_queue *mp_spsc_queue_create(void *ta_parent, size_t elem_size,
+                                           int capacity)
+{
+    assert(capacity > 0 && capacity <= (1 << 30));
+    unsigned long slots = 1;
+    while (slots < capacity)
+        slots <<= 1;
+
+    struct mp_spsc_queue *q = talloc_zero(ta_parent, struct mp_spsc_queue);
+    q->slots = talloc_zero_size(q, slots * elem_size);
+    q->elem_size = elem_size;
+    q->mask = slots - 1;
+    q->capacity = capacity;
+    atomic_store(&q->write_pos, 0);
+    atomic_store(&q->read_pos, 0);
+    return q;
+}
+
+int mp_spsc_queue_capacity(struct mp_spsc_queue *q)
+{
+    return q->capacity;
+}
+
+// Number of queued elements. If called from the producer or consumer, this is
+// an upper or lower bound respectively, since the other side can run
+// concurrently.
+int mp_spsc_queue_count(struct mp_spsc_queue *q)
+{
+    unsigned long r = atomic_load(&q->read_pos);
+    unsigned long w = atomic_load(&q->write_pos);
+    return w - r;
+}
+
+// Return the slot the next element should be written to, or NULL if the queue
+// is full. The slot becomes visible to the consumer with mp_spsc_queue_push().
+void *mp_spsc_queue_write_slot(struct mp_spsc_queue *q)
+{
+    if (q->producer_pos - atomic_load(&q->read_pos) >= q->capacity)
+        return NULL;
+    return q->slots + (q->producer_pos & q->mask) * q->elem_size;
+}
+
+// Make the slot returned by mp_spsc_queue_write_slot() available.
+void mp_spsc_queue_push(struct mp_spsc_queue *q)
+{
+    q->producer_pos += 1;
+    atomic_store(&q->write_pos, q->producer_pos);
+}
+
+// Return the oldest element, or NULL if the queue is empty. The element stays
+// valid and is not overwritten until mp_spsc_queue_pop() is called.
+void *mp_spsc_queue_peek(struct mp_spsc_queue *q)
+{
+    if (q->consumer_pos == atomic_load(&q->write_pos))
+        return NULL;
+    return q->slots + (q->consumer_pos & q->mask) * q->elem_size;
+}
+
+// Remove the element returned by mp_spsc_queue_peek().
+void mp_spsc_queue_pop(struct mp_spsc_queue *q)
+{
+    assert(q->consumer_pos != atomic_load(&q->write_pos));
+    q->consumer_pos += 1;
+    atomic_store(&q->read_pos, q->consumer_pos);
+}
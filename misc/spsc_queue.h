@@ -0,0 +1,24 @@
+#ifndef MP_SPSC_QUEUE_H_
+#define MP_SPSC_QUEUE_H_
+
+#include <stddef.h>
+
+// Bounded lock-free FIFO of fixed size elements, with exactly one producer and
+// one consumer thread at a time. (Multiple producers are fine as long as they
+// are serialized by the caller, e.g. with a mutex.)
+struct mp_spsc_queue;
+
+struct mp_spsc_queue *mp_spsc_queue_create(void *ta_parent, size_t elem_size,
+                                           int capacity);
+int mp_spsc_queue_capacity(struct mp_spsc_queue *q);
+int mp_spsc_queue_count(struct mp_spsc_queue *q);
+
+// Producer side.
+void *mp_spsc_queue_write_slot(struct mp_spsc_queue *q);
+void mp_spsc_queue_push(struct mp_spsc_queue *q);
+
+// Consumer side.
+void *mp_spsc_queue_peek(struct mp_spsc_queue *q);
+void mp_spsc_queue_pop(struct mp_spsc_queue *q);
+
+#endif
@@ -45,8 +45,20 @@ struct m_config_shadow {
     // Invariant: a parent is always at a lower index than any of its children.
     struct m_config_group *groups;
     int num_groups;
+    // Per group (indexed like groups[]): value of ts at the last change of an
+    // option in the group or any of its sub groups. Always written before ts
+    // is incremented, so a reader that sees the new ts also sees this.
+    mp_atomic_uint64 *tree_ts;
+    // Statistics for m_config_shadow_get_stats().
+    mp_atomic_uint64 num_checks, num_scans;
     // -- protected by lock
-    struct m_config_data *data; // protected shadow copy of the option data
+    // Per option (indexed with m_config_group.opt_ts_index + option index):
+    // value of ts at the last change of the option.
+    uint64_t *opt_ts;
+    // Protected shadow copy of the option data. Groups are allocated only once
+    // an option in them is written (see m_config_cache_write_opt()). Until
+    // then, their udata is NULL, and they implicitly contain the defaults.
+    struct m_config_data *data;
     struct config_cache **listeners;
     int num_listeners;
 };
@@ -65,6 +77,7 @@ struct m_config_group {
                         // none
     const char *prefix; // concat_name(_, prefix, opt->name) => full name
                         // (the parent names are already included in this)
+    int opt_ts_index;   // start index into m_config_shadow.opt_ts[]
 };
 
 // A copy of option data. Used for the main option struct, the shadow data,
@@ -87,6 +100,7 @@ struct config_cache {
     bool in_list;                   // part of m_config_shadow->listeners[]
     int upd_group;                  // for "incremental" change notification
     int upd_opt;
+    uint64_t upd_ts;                // all changes up to this ts are in data
 
 
     // --- Implicitly synchronized by setting/unsetting wakeup_cb.
@@ -101,7 +115,8 @@ struct config_cache {
 
 // Per m_config_data state for each m_config_group.
 struct m_group_data {
-    char *udata;        // pointer to group user option struct
+    char *udata;        // pointer to group user option struct (can be NULL
+                        // in m_config_shadow.data, see there)
     uint64_t ts;        // timestamp of the data copy
 };
 
@@ -319,16 +334,16 @@ static void init_opt_inplace(const struct m_option *opt, void *dst,
     }
 }
 
-static void alloc_group(struct m_config_data *data, int group_index,
-                        struct m_config_data *copy)
+// Allocate the user option struct of an already added group, and init it with
+// the data from copy, or the defaults if copy is NULL or doesn't have it.
+static void init_group(struct m_config_data *data, int group_index,
+                       struct m_config_data *copy)
 {
-    assert(group_index == data->group_index + data->num_gdata);
-    assert(group_index < data->shadow->num_groups);
     struct m_config_group *group = &data->shadow->groups[group_index];
     const struct m_sub_options *opts = group->group;
 
-    MP_TARRAY_GROW(data, data->gdata, data->num_gdata);
-    struct m_group_data *gdata = &data->gdata[data->num_gdata++];
+    struct m_group_data *gdata = m_config_gdata(data, group_index);
+    assert(gdata && !gdata->udata);
 
     struct m_group_data *copy_gdata =
         copy ? m_config_gdata(copy, group_index) : NULL;
@@ -363,16 +378,48 @@ static void alloc_group(struct m_config_data *data, int group_index,
             m_config_gdata(data, group->parent_group);
         assert(parent_gdata);
 
-        substruct_write_ptr(parent_gdata->udata + group->parent_ptr, gdata->udata);
+        if (parent_gdata->udata) {
+            substruct_write_ptr(parent_gdata->udata + group->parent_ptr,
+                                gdata->udata);
+        }
+    }
+
+    // Children which were initialized before this group (only possible for
+    // lazily initialized data).
+    for (int n = group_index + 1; n < group_index + group->group_count; n++) {
+        struct m_config_group *child = &data->shadow->groups[n];
+        struct m_group_data *child_gdata = m_config_gdata(data, n);
+        if (child->parent_group == group_index && child->parent_ptr >= 0 &&
+            child_gdata && child_gdata->udata)
+        {
+            substruct_write_ptr(gdata->udata + child->parent_ptr,
+                                child_gdata->udata);
+        }
     }
 }
 
+// Add the next group to data. If lazy is set, leave it uninitialized.
+static void alloc_group(struct m_config_data *data, int group_index,
+                        struct m_config_data *copy, bool lazy)
+{
+    assert(group_index == data->group_index + data->num_gdata);
+    assert(group_index < data->shadow->num_groups);
+
+    MP_TARRAY_GROW(data, data->gdata, data->num_gdata);
+    data->gdata[data->num_gdata++] = (struct m_group_data){0};
+
+    if (!lazy)
+        init_group(data, group_index, copy);
+}
+
 static void free_option_data(void *p)
 {
     struct m_config_data *data = p;
 
     for (int i = 0; i < data->num_gdata; i++) {
         struct m_group_data *gdata = &data->gdata[i];
+        if (!gdata->udata)
+            continue;
         struct m_config_group *group =
             &data->shadow->groups[data->group_index + i];
         const struct m_option *opts = group->group->opts;
@@ -390,10 +437,12 @@ static void free_option_data(void *p)
 // (index into m_config.groups[]).
 // If copy is not NULL, copy all data from there (for groups which are in both
 // m_config_data instances), in all other cases init the data with the defaults.
+// If lazy is set, the groups are not allocated (see m_config_shadow.data).
 static struct m_config_data *allocate_option_data(void *ta_parent,
                                                   struct m_config_shadow *shadow,
                                                   int group_index,
-                                                  struct m_config_data *copy)
+                                                  struct m_config_data *copy,
+                                                  bool lazy)
 {
     assert(group_index >= 0 && group_index < shadow->num_groups);
     struct m_config_data *data = talloc_zero(ta_parent, struct m_config_data);
@@ -406,7 +455,7 @@ static struct m_config_data *allocate_option_data(void *ta_parent,
     assert(root_group->group_count > 0);
 
     for (int n = group_index; n < group_index + root_group->group_count; n++)
-        alloc_group(data, n, copy);
+        alloc_group(data, n, copy, lazy);
 
     return data;
 }
@@ -430,10 +479,21 @@ struct m_config_shadow *m_config_shadow_new(const struct m_sub_options *root)
 
     add_sub_group(shadow, NULL, -1, -1, root);
 
+    shadow->tree_ts = talloc_zero_array(shadow, mp_atomic_uint64,
+                                        shadow->num_groups);
+    int num_opts = 0;
+    for (int n = 0; n < shadow->num_groups; n++) {
+        shadow->groups[n].opt_ts_index = num_opts;
+        num_opts += shadow->groups[n].opt_count;
+    }
+    shadow->opt_ts = talloc_zero_array(shadow, uint64_t, num_opts);
+
     if (!root->size)
         return shadow;
 
-    shadow->data = allocate_option_data(shadow, shadow, 0, NULL);
+    // Most groups (e.g. those of unused VOs and filters) are never changed from
+    // their defaults, so don't spend time copying them.
+    shadow->data = allocate_option_data(shadow, shadow, 0, NULL, true);
 
     return shadow;
 }
@@ -569,7 +629,8 @@ struct m_config_cache *m_config_cache_from_shadow(void *ta_parent,
     in->src = shadow->data;
 
     pthread_mutex_lock(&shadow->lock);
-    in->data = allocate_option_data(cache, shadow, group_index, in->src);
+    in->data = allocate_option_data(cache, shadow, group_index, in->src, false);
+    in->ts = atomic_load(&shadow->ts);
     pthread_mutex_unlock(&shadow->lock);
 
     cache->opts = in->data->gdata[0].udata;
@@ -595,29 +656,42 @@ static void update_next_option(struct m_config_cache *cache, void **p_opt)
     struct config_cache *in = cache->internal;
     struct m_config_data *dst = in->data;
     struct m_config_data *src = in->src;
+    struct m_config_shadow *shadow = in->shadow;
 
     assert(src->group_index == 0); // must be the option root currently
 
     *p_opt = NULL;
 
     while (in->upd_group < dst->group_index + dst->num_gdata) {
+        struct m_config_group *g = &shadow->groups[in->upd_group];
+
+        // Skip the group and its sub groups if nothing changed in them.
+        if (!in->upd_opt &&
+            atomic_load(&shadow->tree_ts[in->upd_group]) <= in->upd_ts)
+        {
+            in->upd_group += g->group_count;
+            continue;
+        }
+
         struct m_group_data *gsrc = m_config_gdata(src, in->upd_group);
         struct m_group_data *gdst = m_config_gdata(dst, in->upd_group);
         assert(gsrc && gdst);
 
         if (gdst->ts < gsrc->ts) {
-            struct m_config_group *g = &dst->shadow->groups[in->upd_group];
             const struct m_option *opts = g->group->opts;
+            uint64_t *opt_ts = &shadow->opt_ts[g->opt_ts_index];
 
             while (opts && opts[in->upd_opt].name) {
                 const struct m_option *opt = &opts[in->upd_opt];
 
-                if (opt->offset >= 0 && opt->type->size) {
+                if (opt->offset >= 0 && opt->type->size &&
+                    opt_ts[in->upd_opt] > gdst->ts)
+                {
                     void *dsrc = gsrc->udata + opt->offset;
                     void *ddst = gdst->udata + opt->offset;
 
                     if (!m_option_equal(opt, ddst, dsrc)) {
-                        uint64_t ch = get_opt_change_mask(dst->shadow,
+                        uint64_t ch = get_opt_change_mask(shadow,
                                         in->upd_group, dst->group_index, opt);
 
                         if (cache->debug) {
@@ -663,6 +737,22 @@ static bool cache_check_update(struct m_config_cache *cache)
     if (in->ts >= new_ts)
         return false;
 
+    atomic_fetch_add(&shadow->num_checks, 1);
+
+    // Changes outside of the cache's groups don't need a scan.
+    if (in->upd_group < 0 &&
+        atomic_load(&shadow->tree_ts[in->data->group_index]) <= in->ts)
+    {
+        in->ts = new_ts;
+        return false;
+    }
+
+    atomic_fetch_add(&shadow->num_scans, 1);
+
+    // If a previous scan was not finished, changes before its start may still
+    // be missing, so keep using its start as reference.
+    if (in->upd_group < 0)
+        in->upd_ts = in->ts;
     in->ts = new_ts;
     in->upd_group = in->data->group_index;
     in->upd_opt = 0;
@@ -752,11 +842,19 @@ bool m_config_cache_write_opt(struct m_config_cache *cache, void *ptr)
     struct m_group_data *gsrc = m_config_gdata(in->src, group_idx);
     assert(gdst && gsrc);
 
+    if (!gsrc->udata)
+        init_group(in->src, group_idx, NULL);
+
     bool changed = !m_option_equal(opt, gsrc->udata + opt->offset, ptr);
     if (changed) {
         m_option_copy(opt, gsrc->udata + opt->offset, ptr);
 
-        gsrc->ts = atomic_fetch_add(&shadow->ts, 1) + 1;
+        uint64_t ts = atomic_load(&shadow->ts) + 1;
+        gsrc->ts = ts;
+        shadow->opt_ts[g->opt_ts_index + opt_idx] = ts;
+        for (int n = group_idx; n >= 0; n = shadow->groups[n].parent_group)
+            atomic_store(&shadow->tree_ts[n], ts);
+        atomic_store(&shadow->ts, ts);
 
         for (int n = 0; n < shadow->num_listeners; n++) {
             struct config_cache *listener = shadow->listeners[n];
@@ -840,6 +938,13 @@ void m_config_cache_set_dispatch_change_cb(struct m_config_cache *cache,
     }
 }
 
+void m_config_shadow_get_stats(struct m_config_shadow *shadow,
+                               uint64_t *num_checks, uint64_t *num_scans)
+{
+    *num_checks = atomic_load(&shadow->num_checks);
+    *num_scans = atomic_load(&shadow->num_scans);
+}
+
 void *mp_get_config_group(void *ta_parent, struct mpv_global *global,
                           const struct m_sub_options *group)
 {
@@ -867,14 +972,17 @@ void mp_read_option_raw(struct mpv_global *global, const char *name,
             int group_index, opt_index;
             get_opt_from_id(shadow, optid, &group_index, &opt_index);
 
-            struct m_group_data *gdata = m_config_gdata(shadow->data, group_index);
-            assert(gdata);
-
             assert(opt->offset >= 0);
             assert(opt->type == type);
 
+            pthread_mutex_lock(&shadow->lock);
+            struct m_group_data *gdata = m_config_gdata(shadow->data, group_index);
+            assert(gdata);
+            const void *src = gdata->udata ? gdata->udata + opt->offset
+                            : m_config_shadow_get_opt_default(shadow, optid);
             memset(dst, 0, opt->type->size);
-            m_option_copy(opt, dst, gdata->udata + opt->offset);
+            m_option_copy(opt, dst, src);
+            pthread_mutex_unlock(&shadow->lock);
             return;
         }
     }
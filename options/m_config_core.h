@@ -198,4 +198,10 @@ void *m_config_cache_get_opt_data(struct m_config_cache *cache, int32_t id);
 uint64_t m_config_cache_get_option_change_mask(struct m_config_cache *cache,
                                                int32_t id);
 
+// Return the total number of times any cache noticed an option change
+// (num_checks), and how often this required scanning its groups for changed
+// options (num_scans). A cache doesn't scan if none of its options changed.
+void m_config_shadow_get_stats(struct m_config_shadow *shadow,
+                               uint64_t *num_checks, uint64_t *num_scans);
+
 #endif /* MPLAYER_M_CONFIG_H */
@@ -568,6 +568,10 @@ static inline int m_option_get_node(const m_option_t *opt, void *ta_parent,
     return M_OPT_UNKNOWN;
 }
 
+// Return the root allocation of a node allocated according to
+// m_option_type_node rules (NULL for scalars).
+void *node_get_alloc(struct mpv_node *node);
+
 static inline bool m_option_equal(const m_option_t *opt, void *a, void *b)
 {
     // Handle trivial equivalence.
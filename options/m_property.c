@@ -37,15 +37,14 @@
 #include "common/common.h"
 
 static int m_property_multiply(struct mp_log *log,
-                               const struct m_property *prop_list,
-                               const char *property, double f, void *ctx)
+                               const struct m_property_ref *ref,
+                               double f, void *ctx)
 {
     union m_option_value val = {0};
     struct m_option opt = {0};
     int r;
 
-    r = m_property_do(log, prop_list, property, M_PROPERTY_GET_CONSTRICTED_TYPE,
-                      &opt, ctx);
+    r = m_property_do_ref(log, ref, M_PROPERTY_GET_CONSTRICTED_TYPE, &opt, ctx);
     if (r != M_PROPERTY_OK)
         return r;
     assert(opt.type);
@@ -53,68 +52,121 @@ static int m_property_multiply(struct mp_log *log,
     if (!opt.type->multiply)
         return M_PROPERTY_NOT_IMPLEMENTED;
 
-    r = m_property_do(log, prop_list, property, M_PROPERTY_GET, &val, ctx);
+    r = m_property_do_ref(log, ref, M_PROPERTY_GET, &val, ctx);
     if (r != M_PROPERTY_OK)
         return r;
     opt.type->multiply(&opt, &val, f);
-    r = m_property_do(log, prop_list, property, M_PROPERTY_SET, &val, ctx);
+    r = m_property_do_ref(log, ref, M_PROPERTY_SET, &val, ctx);
     m_option_free(&opt, &val);
     return r;
 }
 
-struct m_property *m_property_list_find(const struct m_property *list,
-                                        const char *name)
+struct m_property_index {
+    struct m_property **entries;    // sorted by name
+    int num_entries;
+};
+
+static int compare_prop(const void *a, const void *b)
+{
+    struct m_property *pa = *(struct m_property **)a;
+    struct m_property *pb = *(struct m_property **)b;
+    int r = strcmp(pa->name, pb->name);
+    // Keep list order for duplicates, so the first entry wins.
+    if (r == 0)
+        r = pa < pb ? -1 : (pa > pb);
+    return r;
+}
+
+struct m_property_index *m_property_index_create(void *ta_parent,
+                                                 const struct m_property *list)
 {
+    struct m_property_index *index = talloc_zero(ta_parent,
+                                                 struct m_property_index);
     for (int n = 0; list && list[n].name; n++) {
-        if (strcmp(list[n].name, name) == 0)
-            return (struct m_property *)&list[n];
+        MP_TARRAY_APPEND(index, index->entries, index->num_entries,
+                         (struct m_property *)&list[n]);
+    }
+    if (index->num_entries) {
+        qsort(index->entries, index->num_entries, sizeof(index->entries[0]),
+              compare_prop);
+    }
+    return index;
+}
+
+struct m_property *m_property_index_find(const struct m_property_index *index,
+                                         bstr name)
+{
+    // Binary search for the first entry >= name.
+    int lo = 0, hi = index->num_entries;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (bstrcmp(bstr0(index->entries[mid]->name), name) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
+    if (lo < index->num_entries && bstr_equals0(name, index->entries[lo]->name))
+        return index->entries[lo];
     return NULL;
 }
 
-static int do_action(const struct m_property *prop_list, const char *name,
-                     int action, void *arg, void *ctx)
+bool m_property_resolve(const struct m_property_index *index, const char *name,
+                        struct m_property_ref *ref)
 {
-    struct m_property *prop;
-    struct m_property_action_arg ka;
     const char *sep = strchr(name, '/');
+    bstr base = bstr0(name);
+    const char *key = "";
     if (sep && sep[1]) {
-        char base[128];
-        snprintf(base, sizeof(base), "%.*s", (int)(sep - name), name);
-        prop = m_property_list_find(prop_list, base);
+        base = bstr_splice(base, 0, sep - name);
+        key = sep + 1;
+    }
+    struct m_property *prop = m_property_index_find(index, base);
+    if (!prop)
+        return false;
+    *ref = (struct m_property_ref){
+        .prop = prop,
+        .key = key,
+        .name = name,
+    };
+    return true;
+}
+
+static int do_action(const struct m_property_ref *ref, int action, void *arg,
+                     void *ctx)
+{
+    struct m_property_action_arg ka;
+    if (ref->key[0]) {
         ka = (struct m_property_action_arg) {
-            .key = sep + 1,
+            .key = ref->key,
             .action = action,
             .arg = arg,
         };
         action = M_PROPERTY_KEY_ACTION;
         arg = &ka;
-    } else
-        prop = m_property_list_find(prop_list, name);
-    if (!prop)
-        return M_PROPERTY_UNKNOWN;
-    return prop->call(ctx, prop, action, arg);
+    }
+    return ref->prop->call(ctx, ref->prop, action, arg);
 }
 
 // (as a hack, log can be NULL on read-only paths)
-int m_property_do(struct mp_log *log, const struct m_property *prop_list,
-                  const char *name, int action, void *arg, void *ctx)
+int m_property_do_ref(struct mp_log *log, const struct m_property_ref *ref,
+                      int action, void *arg, void *ctx)
 {
     union m_option_value val = {0};
     int r;
 
     struct m_option opt = {0};
-    r = do_action(prop_list, name, M_PROPERTY_GET_TYPE, &opt, ctx);
+    r = do_action(ref, M_PROPERTY_GET_TYPE, &opt, ctx);
     if (r <= 0)
         return r;
     assert(opt.type);
 
     switch (action) {
     case M_PROPERTY_PRINT: {
-        if ((r = do_action(prop_list, name, M_PROPERTY_PRINT, arg, ctx)) >= 0)
+        if ((r = do_action(ref, M_PROPERTY_PRINT, arg, ctx)) >= 0)
             return r;
         // Fallback to m_option
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET, &val, ctx)) <= 0)
+        if ((r = do_action(ref, M_PROPERTY_GET, &val, ctx)) <= 0)
             return r;
         char *str = m_option_pretty_print(&opt, &val);
         m_option_free(&opt, &val);
@@ -122,7 +174,7 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
         return str != NULL;
     }
     case M_PROPERTY_GET_STRING: {
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET, &val, ctx)) <= 0)
+        if ((r = do_action(ref, M_PROPERTY_GET, &val, ctx)) <= 0)
             return r;
         char *str = m_option_print(&opt, &val);
         m_option_free(&opt, &val);
@@ -131,49 +183,49 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
     }
     case M_PROPERTY_SET_STRING: {
         struct mpv_node node = { .format = MPV_FORMAT_STRING, .u.string = arg };
-        return m_property_do(log, prop_list, name, M_PROPERTY_SET_NODE, &node, ctx);
+        return m_property_do_ref(log, ref, M_PROPERTY_SET_NODE, &node, ctx);
     }
     case M_PROPERTY_MULTIPLY: {
-        return m_property_multiply(log, prop_list, name, *(double *)arg, ctx);
+        return m_property_multiply(log, ref, *(double *)arg, ctx);
     }
     case M_PROPERTY_SWITCH: {
         if (!log)
             return M_PROPERTY_ERROR;
         struct m_property_switch_arg *sarg = arg;
-        if ((r = do_action(prop_list, name, M_PROPERTY_SWITCH, arg, ctx)) !=
+        if ((r = do_action(ref, M_PROPERTY_SWITCH, arg, ctx)) !=
             M_PROPERTY_NOT_IMPLEMENTED)
             return r;
         // Fallback to m_option
-        r = m_property_do(log, prop_list, name, M_PROPERTY_GET_CONSTRICTED_TYPE,
-                          &opt, ctx);
+        r = m_property_do_ref(log, ref, M_PROPERTY_GET_CONSTRICTED_TYPE, &opt,
+                              ctx);
         if (r <= 0)
             return r;
         assert(opt.type);
         if (!opt.type->add)
             return M_PROPERTY_NOT_IMPLEMENTED;
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET, &val, ctx)) <= 0)
+        if ((r = do_action(ref, M_PROPERTY_GET, &val, ctx)) <= 0)
             return r;
         opt.type->add(&opt, &val, sarg->inc, sarg->wrap);
-        r = do_action(prop_list, name, M_PROPERTY_SET, &val, ctx);
+        r = do_action(ref, M_PROPERTY_SET, &val, ctx);
         m_option_free(&opt, &val);
         return r;
     }
     case M_PROPERTY_GET_CONSTRICTED_TYPE: {
-        r = do_action(prop_list, name, action, arg, ctx);
+        r = do_action(ref, action, arg, ctx);
         if (r >= 0 || r == M_PROPERTY_UNAVAILABLE)
             return r;
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET_TYPE, arg, ctx)) >= 0)
+        if ((r = do_action(ref, M_PROPERTY_GET_TYPE, arg, ctx)) >= 0)
             return r;
         return M_PROPERTY_NOT_IMPLEMENTED;
     }
     case M_PROPERTY_SET: {
-        return do_action(prop_list, name, M_PROPERTY_SET, arg, ctx);
+        return do_action(ref, M_PROPERTY_SET, arg, ctx);
     }
     case M_PROPERTY_GET_NODE: {
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET_NODE, arg, ctx)) !=
+        if ((r = do_action(ref, M_PROPERTY_GET_NODE, arg, ctx)) !=
             M_PROPERTY_NOT_IMPLEMENTED)
             return r;
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET, &val, ctx)) <= 0)
+        if ((r = do_action(ref, M_PROPERTY_GET, &val, ctx)) <= 0)
             return r;
         struct mpv_node *node = arg;
         int err = m_option_get_node(&opt, NULL, node, &val);
@@ -190,25 +242,34 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
     case M_PROPERTY_SET_NODE: {
         if (!log)
             return M_PROPERTY_ERROR;
-        if ((r = do_action(prop_list, name, M_PROPERTY_SET_NODE, arg, ctx)) !=
+        if ((r = do_action(ref, M_PROPERTY_SET_NODE, arg, ctx)) !=
             M_PROPERTY_NOT_IMPLEMENTED)
             return r;
-        int err = m_option_set_node_or_string(log, &opt, name, &val, arg);
+        int err = m_option_set_node_or_string(log, &opt, ref->name, &val, arg);
         if (err == M_OPT_UNKNOWN) {
             r = M_PROPERTY_NOT_IMPLEMENTED;
         } else if (err < 0) {
             r = M_PROPERTY_INVALID_FORMAT;
         } else {
-            r = do_action(prop_list, name, M_PROPERTY_SET, &val, ctx);
+            r = do_action(ref, M_PROPERTY_SET, &val, ctx);
         }
         m_option_free(&opt, &val);
         return r;
     }
     default:
-        return do_action(prop_list, name, action, arg, ctx);
+        return do_action(ref, action, arg, ctx);
     }
 }
 
+int m_property_do(struct mp_log *log, const struct m_property_index *index,
+                  const char *name, int action, void *arg, void *ctx)
+{
+    struct m_property_ref ref;
+    if (!m_property_resolve(index, name, &ref))
+        return M_PROPERTY_UNKNOWN;
+    return m_property_do_ref(log, &ref, action, arg, ctx);
+}
+
 bool m_property_split_path(const char *path, bstr *prefix, char **rem)
 {
     char *next = strchr(path, '/');
@@ -236,14 +297,14 @@ static void m_property_unkey(int *action, void **arg)
     }
 }
 
-static int m_property_do_bstr(const struct m_property *prop_list, bstr name,
+static int m_property_do_bstr(const struct m_property_index *index, bstr name,
                               int action, void *arg, void *ctx)
 {
     char name0[64];
     if (name.len >= sizeof(name0))
         return M_PROPERTY_UNKNOWN;
     snprintf(name0, sizeof(name0), "%.*s", BSTR_P(name));
-    return m_property_do(NULL, prop_list, name0, action, arg, ctx);
+    return m_property_do(NULL, index, name0, action, arg, ctx);
 }
 
 static void append_str(char **s, int *len, bstr append)
@@ -254,7 +315,7 @@ static void append_str(char **s, int *len, bstr append)
     *len = *len + append.len;
 }
 
-static int expand_property(const struct m_property *prop_list, char **ret,
+static int expand_property(const struct m_property_index *index, char **ret,
                            int *ret_len, bstr prop, bool silent_error, void *ctx)
 {
     bool cond_yes = bstr_eatstart0(&prop, "?");
@@ -268,7 +329,7 @@ static int expand_property(const struct m_property *prop_list, char **ret,
     int method = raw ? M_PROPERTY_GET_STRING : M_PROPERTY_PRINT;
 
     char *s = NULL;
-    int r = m_property_do_bstr(prop_list, prop, method, &s, ctx);
+    int r = m_property_do_bstr(index, prop, method, &s, ctx);
     bool skip;
     if (comp) {
         skip = ((s && bstr_equals0(comp_with, s)) != cond_yes);
@@ -285,7 +346,7 @@ static int expand_property(const struct m_property *prop_list, char **ret,
     return skip;
 }
 
-char *m_properties_expand_string(const struct m_property *prop_list,
+char *m_properties_expand_string(const struct m_property_index *index,
                                  const char *str0, void *ctx)
 {
     char *ret = NULL;
@@ -311,7 +372,7 @@ char *m_properties_expand_string(const struct m_property *prop_list,
             bool have_fallback = bstr_eatstart0(&str, ":");
 
             if (!skip) {
-                skip = expand_property(prop_list, &ret, &ret_len, name,
+                skip = expand_property(index, &ret, &ret_len, name,
                                        have_fallback, ctx);
                 if (skip)
                     skip_level = level;
@@ -446,17 +507,31 @@ int m_property_read_sub(const struct m_sub_property *props, int action, void *ar
     case M_PROPERTY_GET_TYPE:
         *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
         return M_PROPERTY_OK;
+    case M_PROPERTY_GET_NODE_CHILD:
+    case M_PROPERTY_GET_NODE: // same as GET, because type==mpv_node
     case M_PROPERTY_GET: {
         struct mpv_node node;
         node.format = MPV_FORMAT_NODE_MAP;
-        node.u.list = talloc_zero(NULL, mpv_node_list);
+        if (action == M_PROPERTY_GET_NODE_CHILD) {
+            struct m_property_node_arg *na = arg;
+            node.u.list = talloc_zero(na->ta_parent, mpv_node_list);
+            arg = na->node;
+        } else {
+            // Short-lived and made of many small allocations, so use an arena.
+            node.u.list = talloc_arena_zero(NULL, mpv_node_list);
+        }
         mpv_node_list *list = node.u.list;
+        // Allocate the arrays only once (this is called for each entry of
+        // large lists like "playlist").
+        int num = 0;
+        for (int n = 0; props && props[n].name; n++)
+            num += !props[n].unavailable;
+        list->values = talloc_array(list, mpv_node, num);
+        list->keys = talloc_array(list, char *, num);
         for (int n = 0; props && props[n].name; n++) {
             const struct m_sub_property *prop = &props[n];
             if (prop->unavailable)
                 continue;
-            MP_TARRAY_GROW(list, list->values, list->num);
-            MP_TARRAY_GROW(list, list->keys, list->num);
             mpv_node *val = &list->values[list->num];
             if (m_option_get_node(&prop->type, list, val, (void*)&prop->value) < 0)
             {
@@ -532,17 +607,31 @@ int m_property_read_list(int action, void *arg, int count,
     case M_PROPERTY_GET_TYPE:
         *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
         return M_PROPERTY_OK;
+    case M_PROPERTY_GET_NODE_CHILD:
+    case M_PROPERTY_GET_NODE: // same as GET, because type==mpv_node
     case M_PROPERTY_GET: {
         struct mpv_node node;
         node.format = MPV_FORMAT_NODE_ARRAY;
-        node.u.list = talloc_zero(NULL, mpv_node_list);
+        if (action == M_PROPERTY_GET_NODE_CHILD) {
+            struct m_property_node_arg *na = arg;
+            node.u.list = talloc_zero(na->ta_parent, mpv_node_list);
+            arg = na->node;
+        } else {
+            node.u.list = talloc_arena_zero(NULL, mpv_node_list);
+        }
         node.u.list->num = count;
         node.u.list->values = talloc_array(node.u.list, mpv_node, count);
         for (int n = 0; n < count; n++) {
             struct mpv_node *sub = &node.u.list->values[n];
             sub->format = MPV_FORMAT_NONE;
-            int r;
-            r = get_item(n, M_PROPERTY_GET_NODE, sub, ctx);
+            // Items are allocated in the list's arena.
+            struct m_property_node_arg na = {node.u.list, sub};
+            int r = get_item(n, M_PROPERTY_GET_NODE_CHILD, &na, ctx);
+            if (r == M_PROPERTY_NOT_IMPLEMENTED) {
+                r = get_item(n, M_PROPERTY_GET_NODE, sub, ctx);
+                if (r == M_PROPERTY_OK)
+                    talloc_steal(node.u.list, node_get_alloc(sub));
+            }
             if (r == M_PROPERTY_NOT_IMPLEMENTED) {
                 struct m_option opt = {0};
                 r = get_item(n, M_PROPERTY_GET_TYPE, &opt, ctx);
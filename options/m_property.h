@@ -86,6 +86,12 @@ enum mp_property_action {
     // Pass down an action to a sub-property.
     //  arg: struct m_property_action_arg*
     M_PROPERTY_KEY_ACTION,
+
+    // Like M_PROPERTY_GET_NODE, but allocate the value as child of an existing
+    // talloc tree. Used by m_property_read_list() for its items, so that they
+    // end up in the list's arena.
+    //  arg: struct m_property_node_arg*
+    M_PROPERTY_GET_NODE_CHILD,
 };
 
 // Argument for M_PROPERTY_SWITCH
@@ -101,6 +107,12 @@ struct m_property_action_arg {
     void* arg;
 };
 
+// Argument for M_PROPERTY_GET_NODE_CHILD
+struct m_property_node_arg {
+    void *ta_parent;
+    struct mpv_node *node;
+};
+
 enum mp_property_return {
     // Returned on success.
     M_PROPERTY_OK = 1,
@@ -135,16 +147,42 @@ struct m_property {
     bool is_option;
 };
 
-struct m_property *m_property_list_find(const struct m_property *list,
-                                        const char *name);
+// Lookup table for a property list, sorted by name.
+struct m_property_index;
+
+// Create a lookup table for the given {0}-terminated list. The list is
+// referenced, and must not be changed or freed while the index is in use.
+struct m_property_index *m_property_index_create(void *ta_parent,
+                                                 const struct m_property *list);
+
+// Return the property with exactly the given name, or NULL.
+struct m_property *m_property_index_find(const struct m_property_index *index,
+                                         bstr name);
+
+// A property name resolved to its list entry, so that repeated accesses can
+// skip the lookup.
+struct m_property_ref {
+    struct m_property *prop;
+    const char *key;        // sub-property path ("a/b/c" => "b/c"), or ""
+    const char *name;       // full name as passed to m_property_resolve()
+};
+
+// Find the property for name, which can be a sub-property path. The strings
+// in ref point into name. Returns false if there is no such property.
+bool m_property_resolve(const struct m_property_index *index, const char *name,
+                        struct m_property_ref *ref);
 
 // Access a property.
 // action: one of m_property_action
 // ctx: opaque value passed through to property implementation
 // returns: one of mp_property_return
-int m_property_do(struct mp_log *log, const struct m_property* prop_list,
+int m_property_do(struct mp_log *log, const struct m_property_index *index,
                   const char* property_name, int action, void* arg, void *ctx);
 
+// Same as m_property_do(), but with an already resolved property.
+int m_property_do_ref(struct mp_log *log, const struct m_property_ref *ref,
+                      int action, void *arg, void *ctx);
+
 // Given a path of the form "a/b/c", this function will set *prefix to "a",
 // and rem to "b/c", and return true.
 // If there is no '/' in the path, set prefix to path, and rem to "", and
@@ -167,7 +205,7 @@ void m_properties_print_help_list(struct mp_log *log,
 // STR is recursively expanded using the same rules.
 // "$$" can be used to escape "$", and "$}" to escape "}".
 // "$>" disables parsing of "$" for the rest of the string.
-char* m_properties_expand_string(const struct m_property *prop_list,
+char* m_properties_expand_string(const struct m_property_index *index,
                                  const char *str, void *ctx);
 
 // Trivial helpers for implementing properties.
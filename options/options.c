@@ -388,6 +388,12 @@ static const m_option_t mp_opts[] = {
     {"unittest", OPT_STRING(test_mode), .flags = CONF_NOCFG | M_OPT_NOPROP},
 #endif
 
+    {"benchmark", OPT_STRING(benchmark_file),
+        .flags = CONF_NOCFG | M_OPT_NOPROP | M_OPT_FILE},
+    {"benchmark-seeks", OPT_INT(benchmark_seeks), M_RANGE(0, 10000)},
+    {"memory-accounting", OPT_FLAG(memory_accounting)},
+    {"script-profile", OPT_FLAG(script_profile)},
+
     {"player-operation-mode", OPT_CHOICE(operation_mode,
         {"cplayer", 0}, {"pseudo-gui", 1}),
         .flags = M_OPT_PRE_PARSE | M_OPT_NOPROP},
@@ -403,6 +409,8 @@ static const m_option_t mp_opts[] = {
         .flags = CONF_PRE_PARSE | UPDATE_TERM},
     {"dump-stats", OPT_STRING(dump_stats),
         .flags = UPDATE_TERM | CONF_PRE_PARSE | M_OPT_FILE},
+    {"dump-trace", OPT_STRING(dump_trace),
+        .flags = UPDATE_TERM | CONF_PRE_PARSE | M_OPT_FILE},
     {"msg-color", OPT_FLAG(msg_color), .flags = CONF_PRE_PARSE | UPDATE_TERM},
     {"log-file", OPT_STRING(log_file),
         .flags = CONF_PRE_PARSE | M_OPT_FILE | UPDATE_TERM},
@@ -628,6 +636,7 @@ static const m_option_t mp_opts[] = {
     {"replaygain-clip", OPT_FLAG(rgain_clip), .flags = UPDATE_VOL},
     {"replaygain-fallback", OPT_FLOAT(rgain_fallback), .flags = UPDATE_VOL,
         M_RANGE(-200, 60)},
+    {"replaygain-cache", OPT_FLAG(rgain_cache)},
     {"gapless-audio", OPT_CHOICE(gapless_audio,
         {"no", 0},
         {"yes", 1},
@@ -131,6 +131,7 @@ typedef struct MPOpts {
     int property_print_help;
     int use_terminal;
     char *dump_stats;
+    char *dump_trace;
     int verbose;
     int msg_really_quiet;
     char **msg_levels;
@@ -140,6 +141,10 @@ typedef struct MPOpts {
     char *log_file;
 
     char *test_mode;
+    char *benchmark_file;
+    int benchmark_seeks;
+    int memory_accounting;
+    int script_profile;
     int operation_mode;
 
     char **reset_options;
@@ -165,6 +170,7 @@ typedef struct MPOpts {
     float rgain_preamp;         // Set replaygain pre-amplification
     int rgain_clip;             // Enable/disable clipping prevention
     float rgain_fallback;
+    int rgain_cache;
     int softvol_mute;
     float softvol_max;
     int gapless_audio;
@@ -40,6 +40,8 @@ int mpthread_mutex_init_recursive(pthread_mutex_t *mutex)
 
 void mpthread_set_name(const char *name)
 {
+    ta_acct_set_thread_tag(name);
+
     char tname[80];
     snprintf(tname, sizeof(tname), "mpv/%s", name);
 #if HAVE_GLIBC_THREAD_NAME
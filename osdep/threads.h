@@ -7,7 +7,8 @@
 // Helper to reduce boiler plate.
 int mpthread_mutex_init_recursive(pthread_mutex_t *mutex);
 
-// Set thread name (for debuggers).
+// Set thread name (for debuggers). Also used as tag for memory accounting of
+// the thread's allocations (see ta_acct_set_thread_tag()).
 void mpthread_set_name(const char *name);
 
 int mp_ptwrap_check(const char *file, int line, int res);
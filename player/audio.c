@@ -27,11 +27,13 @@
 
 #include "common/msg.h"
 #include "common/encode.h"
+#include "common/stats.h"
 #include "options/options.h"
 #include "common/common.h"
 #include "osdep/timer.h"
 
 #include "audio/format.h"
+#include "audio/loudness.h"
 #include "audio/out/ao.h"
 #include "demux/demux.h"
 #include "filters/f_async_queue.h"
@@ -126,6 +128,8 @@ static float compute_replaygain(struct MPContext *mpctx)
     struct track *track = mpctx->current_track[0][STREAM_AUDIO];
     if (track)
         rg = track->stream->codec->replaygain_data;
+    if (!rg && mpctx->ao_chain)
+        rg = mpctx->ao_chain->cached_rg;
     if (opts->rgain_mode && rg) {
         MP_VERBOSE(mpctx, "Replaygain: Track=%f/%f Album=%f/%f\n",
                    rg->track_gain, rg->track_peak,
@@ -246,14 +250,33 @@ static void ao_chain_uninit(struct ao_chain *ao_c)
     if (ao_c->filter_src)
         mp_pin_disconnect(ao_c->filter_src);
 
+    talloc_free(ao_c->loudness_filter);
     talloc_free(ao_c->filter->f);
     talloc_free(ao_c->ao_filter);
     talloc_free(ao_c);
 }
 
+// Store the loudness measured with --replaygain-cache, if the measurement
+// covered (almost) the whole track.
+static void write_loudness_cache(struct MPContext *mpctx)
+{
+    struct ao_chain *ao_c = mpctx->ao_chain;
+    struct mp_loudness_result res;
+    if (!ao_c->loudness || !ao_c->track || !ao_c->track->demuxer ||
+        !mp_loudness_get(ao_c->loudness, &res))
+        return;
+
+    double duration = ao_c->track->demuxer->duration;
+    if (duration <= 0 || res.duration < duration * 0.9)
+        return;
+
+    mp_write_loudness_cache(mpctx, ao_c->track, &res);
+}
+
 void uninit_audio_chain(struct MPContext *mpctx)
 {
     if (mpctx->ao_chain) {
+        write_loudness_cache(mpctx);
         ao_chain_uninit(mpctx->ao_chain);
         mpctx->ao_chain = NULL;
 
@@ -525,6 +548,25 @@ void reinit_audio_chain(struct MPContext *mpctx)
     reinit_audio_chain_src(mpctx, track);
 }
 
+static void loudness_process(struct mp_filter *f)
+{
+    struct ao_chain *ao_c = f->priv;
+
+    if (!mp_pin_can_transfer_data(f->ppins[1], f->ppins[0]))
+        return;
+
+    struct mp_frame frame = mp_pin_out_read(f->ppins[0]);
+    if (frame.type == MP_FRAME_AUDIO && ao_c->mpctx->play_dir > 0)
+        mp_loudness_add(ao_c->loudness, frame.data);
+    mp_pin_in_write(f->ppins[1], frame);
+}
+
+// Passes through the decoded audio, and measures it for --replaygain-cache.
+static const struct mp_filter_info loudness_filter = {
+    .name = "loudness",
+    .process = loudness_process,
+};
+
 static const struct mp_filter_info ao_filter = {
     .name = "ao",
     .process = ao_process,
@@ -541,6 +583,7 @@ void reinit_audio_chain_src(struct MPContext *mpctx, struct track *track)
     mpctx->ao_chain = ao_c;
     ao_c->mpctx = mpctx;
     ao_c->log = mpctx->log;
+    ao_c->stats = stats_ctx_create(ao_c, mpctx->global, "audio");
     ao_c->filter =
         mp_output_chain_create(mpctx->filter_root, MP_OUTPUT_CHAIN_AUDIO);
     ao_c->spdif_passthrough = true;
@@ -561,7 +604,27 @@ void reinit_audio_chain_src(struct MPContext *mpctx, struct track *track)
         if (!init_audio_decoder(mpctx, track))
             goto init_error;
         ao_c->dec_src = track->dec->f->pins[0];
-        mp_pin_connect(ao_c->filter->f->pins[0], ao_c->dec_src);
+        struct mp_pin *src = ao_c->dec_src;
+
+        if (mpctx->opts->rgain_cache && !track->stream->codec->replaygain_data) {
+            ao_c->cached_rg = mp_load_loudness_cache(ao_c, mpctx, track);
+            if (!ao_c->cached_rg) {
+                // Measure the decoded audio, before user filters and speed
+                // changes.
+                ao_c->loudness = mp_loudness_create(ao_c);
+                ao_c->loudness_filter =
+                    mp_filter_create(mpctx->filter_root, &loudness_filter);
+                if (!ao_c->loudness_filter)
+                    goto init_error;
+                ao_c->loudness_filter->priv = ao_c;
+                mp_filter_add_pin(ao_c->loudness_filter, MP_PIN_IN, "in");
+                mp_filter_add_pin(ao_c->loudness_filter, MP_PIN_OUT, "out");
+                mp_pin_connect(ao_c->loudness_filter->pins[0], src);
+                src = ao_c->loudness_filter->pins[1];
+            }
+        }
+
+        mp_pin_connect(ao_c->filter->f->pins[0], src);
     }
 
     reset_audio_state(mpctx);
@@ -698,6 +761,10 @@ static void ao_process(struct mp_filter *f)
             return;
         }
 
+        stats_latency(ao_c->stats, "decode-filter",
+                      mp_aframe_get_stage_time(af));
+        mp_aframe_set_stage_time(af, mp_time_us());
+
         mpctx->shown_aframes += samples;
         double real_samplerate = mp_aframe_get_rate(af) / mpctx->audio_speed;
         mpctx->delay += samples / real_samplerate;
@@ -0,0 +1,291 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "config.h"
+
+#if HAVE_POSIX
+#include <sys/resource.h>
+#endif
+
+#include "mpv_talloc.h"
+
+#include "common/common.h"
+#include "common/msg.h"
+#include "common/stats.h"
+#include "demux/demux.h"
+#include "misc/histogram.h"
+#include "misc/json.h"
+#include "misc/node.h"
+#include "options/path.h"
+#include "osdep/timer.h"
+
+#include "core.h"
+
+// --benchmark drives the player through these states for each file.
+enum benchmark_state {
+    BENCH_INIT,         // waiting for the first playback restart
+    BENCH_SEEKING,      // doing the --benchmark-seeks seeks
+    BENCH_RETURNING,    // seeking back to the start position
+    BENCH_MEASURING,    // playing the file as fast as possible
+};
+
+struct mp_benchmark {
+    struct mpv_node results; // array of per-file result maps
+
+    // Reset for each file.
+    enum benchmark_state state;
+    int seeks_done;
+    int64_t seek_start;
+    double start_pts;
+    struct mp_histogram seek_latency;
+    int64_t start_time;
+    int64_t start_vframes, start_aframes;
+    double start_cpu;
+    struct mpv_node start_threads;
+    struct ta_dbg_stats start_ta;
+};
+
+// Total user+system CPU time of the process in seconds, or -1.
+static double get_process_cpu_time(void)
+{
+#if HAVE_POSIX
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+               ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    }
+#endif
+    return -1;
+}
+
+// Peak resident set size in bytes, or -1.
+static int64_t get_peak_rss(void)
+{
+#if HAVE_POSIX
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#ifdef __APPLE__
+        return ru.ru_maxrss;
+#else
+        return ru.ru_maxrss * (int64_t)1024;
+#endif
+    }
+#endif
+    return -1;
+}
+
+void benchmark_init(struct MPContext *mpctx)
+{
+    struct mp_benchmark *b = talloc_zero(mpctx, struct mp_benchmark);
+    node_init(&b->results, MPV_FORMAT_NODE_ARRAY, NULL);
+    talloc_steal(b, b->results.u.list);
+    mpctx->benchmark = b;
+
+    // Enable collection of the pipeline latency stats.
+    struct mpv_node tmp;
+    stats_global_query_latency(mpctx->global, &tmp);
+    talloc_free(tmp.u.list);
+}
+
+void benchmark_start_file(struct MPContext *mpctx)
+{
+    struct mp_benchmark *b = mpctx->benchmark;
+    if (!b)
+        return;
+
+    b->state = BENCH_INIT;
+    b->seeks_done = 0;
+    b->seek_start = 0;
+    b->start_pts = MP_NOPTS_VALUE;
+    b->seek_latency = (struct mp_histogram){0};
+    talloc_free(b->start_threads.u.list);
+    b->start_threads = (struct mpv_node){0};
+}
+
+static void start_measuring(struct MPContext *mpctx)
+{
+    struct mp_benchmark *b = mpctx->benchmark;
+
+    b->state = BENCH_MEASURING;
+    b->start_time = mp_time_us();
+    b->start_vframes = mpctx->shown_vframes;
+    b->start_aframes = mpctx->shown_aframes;
+    b->start_cpu = get_process_cpu_time();
+    stats_global_query_thread_cputime(mpctx->global, &b->start_threads);
+    talloc_steal(b, b->start_threads.u.list);
+    ta_dbg_get_stats(&b->start_ta);
+}
+
+// Called on every playloop iteration. Issues the benchmark seeks, and starts
+// the measurement once they're done.
+void benchmark_update(struct MPContext *mpctx)
+{
+    struct mp_benchmark *b = mpctx->benchmark;
+    if (!b || b->state == BENCH_MEASURING || mpctx->seek.type ||
+        !mpctx->restart_complete)
+        return;
+
+    int64_t now = mp_time_us();
+    if (b->seek_start) {
+        mp_histogram_add(&b->seek_latency, now - b->seek_start);
+        b->seek_start = 0;
+    }
+
+    if (b->state == BENCH_INIT) {
+        b->start_pts = mpctx->playback_pts;
+        b->state = BENCH_SEEKING;
+    }
+
+    if (b->state == BENCH_SEEKING) {
+        int num = mpctx->opts->benchmark_seeks;
+        double len = get_time_length(mpctx);
+        if (num && (len == MP_NOPTS_VALUE || len <= 0 ||
+                    !mpctx->demuxer->seekable))
+        {
+            MP_WARN(mpctx, "Benchmark: file is not seekable, skipping seeks.\n");
+            num = 0;
+        }
+        if (b->seeks_done < num) {
+            // Spread the seeks over the file, but jump back and forth so that
+            // they don't hit the demuxer cache.
+            int n = b->seeks_done++;
+            int pos = n % 2 ? num - 1 - n / 2 : n / 2;
+            double target = get_start_time(mpctx, 1) + len * (pos + 0.5) / num;
+            queue_seek(mpctx, MPSEEK_ABSOLUTE, target, MPSEEK_DEFAULT, 0);
+            b->seek_start = now;
+            return;
+        }
+        b->state = BENCH_RETURNING;
+        if (num && b->start_pts != MP_NOPTS_VALUE) {
+            queue_seek(mpctx, MPSEEK_ABSOLUTE, b->start_pts, MPSEEK_EXACT, 0);
+            return;
+        }
+    }
+
+    start_measuring(mpctx);
+}
+
+static void add_seconds_map(struct mpv_node *dst, const char *key,
+                            struct mpv_node *end, struct mpv_node *start)
+{
+    struct mpv_node *m = node_map_add(dst, key, MPV_FORMAT_NODE_MAP);
+    for (int n = 0; n < end->u.list->num; n++) {
+        double t = end->u.list->values[n].u.double_;
+        struct mpv_node *s = start->u.list ?
+            node_map_get(start, end->u.list->keys[n]) : NULL;
+        if (s)
+            t -= s->u.double_;
+        node_map_add_double(m, end->u.list->keys[n], t);
+    }
+}
+
+static void write_results(struct MPContext *mpctx)
+{
+    struct mp_benchmark *b = mpctx->benchmark;
+    void *tmp = talloc_new(NULL);
+
+    char *path = mp_get_user_path(tmp, mpctx->global,
+                                  mpctx->opts->benchmark_file);
+    char *s = talloc_strdup(tmp, "");
+    json_write_pretty(&s, &b->results);
+
+    FILE *f = fopen(path, "wb");
+    bool ok = f && fprintf(f, "%s\n", s) >= 0;
+    if (f && fclose(f))
+        ok = false;
+    if (!ok)
+        MP_ERR(mpctx, "Benchmark: could not write '%s'.\n", path);
+
+    talloc_free(tmp);
+}
+
+void benchmark_end_file(struct MPContext *mpctx)
+{
+    struct mp_benchmark *b = mpctx->benchmark;
+    if (!b)
+        return;
+
+    struct mpv_node *r = node_array_add(&b->results, MPV_FORMAT_NODE_MAP);
+    node_map_add_string(r, "file", mpctx->filename ? mpctx->filename : "");
+    node_map_add_flag(r, "completed", b->state == BENCH_MEASURING &&
+                                      mpctx->stop_play == AT_END_OF_FILE);
+
+    if (b->state == BENCH_MEASURING) {
+        double t = (mp_time_us() - b->start_time) / 1e6;
+        int64_t vframes = mpctx->shown_vframes - b->start_vframes;
+        node_map_add_double(r, "time", t);
+        node_map_add_int64(r, "video-frames", vframes);
+        node_map_add_double(r, "fps", t > 0 ? vframes / t : 0);
+        node_map_add_int64(r, "audio-samples",
+                           mpctx->shown_aframes - b->start_aframes);
+
+        double cpu = get_process_cpu_time();
+        if (cpu >= 0 && b->start_cpu >= 0)
+            node_map_add_double(r, "cpu-time", cpu - b->start_cpu);
+
+        struct mpv_node threads;
+        stats_global_query_thread_cputime(mpctx->global, &threads);
+        add_seconds_map(r, "thread-cpu-time", &threads, &b->start_threads);
+        talloc_free(threads.u.list);
+
+        MP_INFO(mpctx, "Benchmark: %"PRId64" frames in %.3f s (%.2f fps)\n",
+                vframes, t, t > 0 ? vframes / t : 0);
+    }
+
+    int64_t rss = get_peak_rss();
+    if (rss >= 0)
+        node_map_add_int64(r, "peak-rss", rss);
+
+    struct ta_dbg_stats ta;
+    if (ta_dbg_get_stats(&ta)) {
+        struct mpv_node *m = node_map_add(r, "allocations", MPV_FORMAT_NODE_MAP);
+        node_map_add_int64(m, "count", ta.num_allocs - b->start_ta.num_allocs);
+        node_map_add_int64(m, "live-blocks", ta.live_blocks);
+        node_map_add_int64(m, "live-bytes", ta.live_bytes);
+    }
+
+    if (mpctx->demuxer) {
+        struct demux_reader_state s;
+        demux_get_reader_state(mpctx->demuxer, &s);
+        struct mpv_node *m = node_map_add(r, "cache", MPV_FORMAT_NODE_MAP);
+        node_map_add_int64(m, "total-bytes", s.total_bytes);
+        node_map_add_int64(m, "fw-bytes", s.fw_bytes);
+        node_map_add_int64(m, "file-cache-bytes", s.file_cache_bytes);
+        node_map_add_int64(m, "low-level-seeks", s.low_level_seeks);
+        node_map_add_int64(m, "byte-level-seeks", s.byte_level_seeks);
+    }
+
+    struct mp_histogram *h = &b->seek_latency;
+    if (h->count) {
+        struct mpv_node *m = node_map_add(r, "seeks", MPV_FORMAT_NODE_MAP);
+        node_map_add_int64(m, "count", h->count);
+        node_map_add_double(m, "min", h->min / 1e3);
+        node_map_add_double(m, "max", h->max / 1e3);
+        node_map_add_double(m, "mean", h->sum / h->count / 1e3);
+        node_map_add_double(m, "p50", mp_histogram_percentile(h, 0.5) / 1e3);
+        node_map_add_double(m, "p90", mp_histogram_percentile(h, 0.9) / 1e3);
+    }
+
+    struct mpv_node latency;
+    stats_global_query_latency(mpctx->global, &latency);
+    *node_map_add(r, "pipeline-latency", MPV_FORMAT_NONE) = latency;
+    talloc_steal(r->u.list, latency.u.list);
+
+    write_results(mpctx);
+}
@@ -33,6 +33,7 @@
 #include "misc/dispatch.h"
 #include "misc/node.h"
 #include "misc/rendezvous.h"
+#include "misc/spsc_queue.h"
 #include "misc/thread_tools.h"
 #include "options/m_config.h"
 #include "options/m_option.h"
@@ -83,18 +84,56 @@ struct mp_client_api {
     int num_custom_protocols;
 
     struct mpv_render_context *render_context;
+
+    // Incremented on every property change notification. Values in prop_cache
+    // read with an older value are stale.
+    mp_atomic_uint64 prop_cache_gen;
+
+    // -- only accessed by mp_client_send_property_changes() (core thread)
+    // Observed property values read in the current update pass. All observers
+    // of a property share a single read.
+    struct prop_cache_entry **prop_cache;
+    int num_prop_cache;
+    // Hash table of prop_cache indexes+1, keyed by name and format.
+    int *prop_cache_table;
+    int prop_cache_table_size; // power of 2, or 0
+};
+
+struct prop_cache_entry {
+    char *name;
+    uint32_t hash;          // ==hash_name(name)
+    mpv_format format;
+    const struct m_option *type;
+    uint64_t gen;           // prop_cache_gen at the time of reading
+    int status;
+    union m_option_value value;
+    struct node_snapshot *snapshot; // for MPV_FORMAT_NODE (instead of value)
+};
+
+struct mpv_property_ref {
+    // -- immutable
+    char *name;
+    struct m_property_ref ref; // strings point into name
+    // -- protected by the owner's lock
+    int refcount;           // number of observe_property using it
+    bool pinned;            // returned by mpv_resolve_property()
 };
 
 struct observe_property {
     // -- immutable
     struct mpv_handle *owner;
     char *name;
+    const struct m_property_ref *ref; // NULL if the property is unknown
+    struct mpv_property_ref *prop_ref; // owner of ref (reference held)
     int id;                 // ==mp_get_property_id(name)
+    uint32_t hash;          // ==hash_name(name)
     uint64_t event_mask;    // ==mp_get_property_event_mask(name)
     int64_t reply_id;
     mpv_format format;
     const struct m_option *type;
     // -- protected by owner->lock
+    double update_interval; // minimum time between change events (0: none)
+    double next_update;     // mp_time_sec() before which events are delayed
     size_t refcount;
     uint64_t change_ts;     // logical timestamp incremented on each change
     uint64_t value_ts;      // logical timestamp for value contents
@@ -102,9 +141,19 @@ struct observe_property {
     union m_option_value value;
     uint64_t value_ret_ts;  // logical timestamp of value returned to user
     union m_option_value value_ret;
+    // For MPV_FORMAT_NODE, the values are shared between all observers of
+    // the property, and these are used instead of value/value_ret.
+    struct node_snapshot *value_snap;
+    struct node_snapshot *value_ret_snap;
     bool waiting_for_hook;  // flag for draining old property changes on a hook
 };
 
+// Entry in mpv_handle.events.
+struct queued_event {
+    struct mpv_event event;
+    int64_t time;           // mp_time_us() when it was queued
+};
+
 struct mpv_handle {
     // -- immmutable
     char name[MAX_CLIENT_NAME];
@@ -115,6 +164,7 @@ struct mpv_handle {
 
     // -- not thread-safe
     struct mpv_event *cur_event;
+    int64_t cur_event_time; // see mp_client_get_event_time()
     struct mpv_event_property cur_property_event;
     struct observe_property *cur_property;
 
@@ -134,10 +184,11 @@ struct mpv_handle {
     uint64_t event_mask;
     bool queued_wakeup;
 
-    mpv_event *events;      // ringbuffer of max_events entries
-    int max_events;         // allocated number of entries in events
-    int first_event;        // events[first_event] is the first readable event
-    int num_events;         // number of readable events
+    // Queued mpv_event entries. Producers write it with lock held. The
+    // consumer (mpv_wait_event()) reads it with lock held, or without it if
+    // event_ring is set.
+    struct mp_spsc_queue *events;
+    bool event_ring;        // lock-free reads enabled (mpv_enable_event_ring())
     int reserved_events;    // number of entries reserved for replies
     size_t async_counter;   // pending other async events
     bool choked;            // recovering from queue overflow
@@ -156,6 +207,14 @@ struct mpv_handle {
     // the array did not change.
     uint64_t properties_change_ts;
 
+    // Resolved properties. Entries are removed once they are neither pinned
+    // nor used by an observer. prop_ref_table is a hash table of indexes+1
+    // into prop_refs (0 means free slot).
+    struct mpv_property_ref **prop_refs;
+    int num_prop_refs;
+    int *prop_ref_table;
+    int prop_ref_table_size; // power of 2, or 0
+
     bool fuzzy_initialized; // see scripting.c wait_loaded()
     bool is_weak;           // can not keep core alive on its own
     struct mp_log_buffer *messages;
@@ -282,8 +341,6 @@ struct mpv_handle *mp_new_client(struct mp_client_api *clients, const char *name
         return NULL;
     }
 
-    int num_events = 1000;
-
     struct mpv_handle *client = talloc_ptrtype(NULL, client);
     *client = (struct mpv_handle){
         .log = mp_log_new(client, clients->mpctx->log, nname),
@@ -291,8 +348,8 @@ struct mpv_handle *mp_new_client(struct mp_client_api *clients, const char *name
         .clients = clients,
         .id = ++(clients->id_alloc),
         .cur_event = talloc_zero(client, struct mpv_event),
-        .events = talloc_array(client, mpv_event, num_events),
-        .max_events = num_events,
+        .events = mp_spsc_queue_create(client, sizeof(struct queued_event),
+                                       1000),
         .event_mask = (1ULL << INTERNAL_EVENT_BASE) - 1, // exclude internal events
         .wakeup_pipe = {-1, -1},
     };
@@ -342,6 +399,11 @@ struct mpv_global *mp_client_get_global(struct mpv_handle *ctx)
     return ctx->mpctx->global;
 }
 
+int64_t mp_client_get_event_time(struct mpv_handle *ctx)
+{
+    return ctx->cur_event_time;
+}
+
 static void wakeup_client(struct mpv_handle *ctx)
 {
     pthread_mutex_lock(&ctx->wakeup_lock);
@@ -482,10 +544,10 @@ static void mp_destroy_client(mpv_handle *ctx, bool terminate)
         if (clients->clients[n] == ctx) {
             clients->clients_list_change_ts += 1;
             MP_TARRAY_REMOVE_AT(clients->clients, clients->num_clients, n);
-            while (ctx->num_events) {
-                talloc_free(ctx->events[ctx->first_event].data);
-                ctx->first_event = (ctx->first_event + 1) % ctx->max_events;
-                ctx->num_events--;
+            struct queued_event *ev;
+            while ((ev = mp_spsc_queue_peek(ctx->events))) {
+                talloc_free(ev->event.data);
+                mp_spsc_queue_pop(ctx->events);
             }
             mp_msg_log_buffer_destroy(ctx->messages);
             pthread_cond_destroy(&ctx->wakeup);
@@ -721,7 +783,8 @@ static int reserve_reply(struct mpv_handle *ctx)
 {
     int res = MPV_ERROR_EVENT_QUEUE_FULL;
     pthread_mutex_lock(&ctx->lock);
-    if (ctx->reserved_events + ctx->num_events < ctx->max_events && !ctx->choked)
+    if (ctx->reserved_events + mp_spsc_queue_count(ctx->events) <
+            mp_spsc_queue_capacity(ctx->events) && !ctx->choked)
     {
         ctx->reserved_events++;
         res = 0;
@@ -732,12 +795,14 @@ static int reserve_reply(struct mpv_handle *ctx)
 
 static int append_event(struct mpv_handle *ctx, struct mpv_event event, bool copy)
 {
-    if (ctx->num_events + ctx->reserved_events >= ctx->max_events)
+    if (mp_spsc_queue_count(ctx->events) + ctx->reserved_events >=
+            mp_spsc_queue_capacity(ctx->events))
         return -1;
     if (copy)
         dup_event_data(&event);
-    ctx->events[(ctx->first_event + ctx->num_events) % ctx->max_events] = event;
-    ctx->num_events++;
+    struct queued_event *slot = mp_spsc_queue_write_slot(ctx->events);
+    *slot = (struct queued_event){event, mp_time_us()};
+    mp_spsc_queue_push(ctx->events);
     wakeup_client(ctx);
     if (event.event_id == MPV_EVENT_SHUTDOWN)
         ctx->event_mask &= ctx->event_mask & ~(1ULL << MPV_EVENT_SHUTDOWN);
@@ -913,10 +978,37 @@ static bool check_for_for_hook_flags(mpv_handle *ctx)
     return false;
 }
 
+// Return the next queued event without locking, if possible. This works only
+// for events that are returned as they are. Everything else (property changes,
+// log messages, hook ordering, queue overflow, waiting) needs the lock.
+static bool read_event_ring(mpv_handle *ctx, mpv_event *event)
+{
+    // Both fields are written only by the consumer thread.
+    if (!ctx->event_ring || !ctx->fuzzy_initialized)
+        return false;
+
+    struct queued_event *ev = mp_spsc_queue_peek(ctx->events);
+    if (!ev || ev->event.event_id == MPV_EVENT_HOOK)
+        return false;
+
+    *event = ev->event;
+    ctx->cur_event_time = ev->time;
+    mp_spsc_queue_pop(ctx->events);
+    talloc_steal(event, event->data);
+    return true;
+}
+
 mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout)
 {
     mpv_event *event = ctx->cur_event;
 
+    *event = (mpv_event){0};
+    ctx->cur_event_time = 0;
+    talloc_free_children(event);
+
+    if (read_event_ring(ctx, event))
+        return event;
+
     pthread_mutex_lock(&ctx->lock);
 
     if (!ctx->fuzzy_initialized)
@@ -928,21 +1020,17 @@ mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout)
 
     int64_t deadline = mp_add_timeout(mp_time_us(), timeout);
 
-    *event = (mpv_event){0};
-    talloc_free_children(event);
-
     while (1) {
         if (ctx->queued_wakeup)
             deadline = 0;
         // Recover from overflow.
-        if (ctx->choked && !ctx->num_events) {
+        if (ctx->choked && !mp_spsc_queue_count(ctx->events)) {
             ctx->choked = false;
             event->event_id = MPV_EVENT_QUEUE_OVERFLOW;
             break;
         }
-        struct mpv_event *ev =
-            ctx->num_events ? &ctx->events[ctx->first_event] : NULL;
-        if (ev && ev->event_id == MPV_EVENT_HOOK) {
+        struct queued_event *ev = mp_spsc_queue_peek(ctx->events);
+        if (ev && ev->event.event_id == MPV_EVENT_HOOK) {
             // Give old property notifications priority over hooks. This is a
             // guarantee given to clients to simplify their logic. New property
             // changes after this are treated normally, so
@@ -957,9 +1045,9 @@ mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout)
             }
         }
         if (ev) {
-            *event = *ev;
-            ctx->first_event = (ctx->first_event + 1) % ctx->max_events;
-            ctx->num_events--;
+            *event = ev->event;
+            ctx->cur_event_time = ev->time;
+            mp_spsc_queue_pop(ctx->events);
             talloc_steal(event, event->data);
             break;
         }
@@ -980,6 +1068,33 @@ mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout)
     return event;
 }
 
+int mpv_enable_event_ring(mpv_handle *ctx, int size)
+{
+    if (size < 1 || size > (1 << 20))
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    int r = 0;
+    pthread_mutex_lock(&ctx->lock);
+    int num = mp_spsc_queue_count(ctx->events);
+    if (num + ctx->reserved_events > size) {
+        r = MPV_ERROR_EVENT_QUEUE_FULL;
+    } else {
+        struct mp_spsc_queue *old = ctx->events;
+        ctx->events = mp_spsc_queue_create(ctx, sizeof(struct queued_event),
+                                           size);
+        for (int n = 0; n < num; n++) {
+            struct queued_event *ev = mp_spsc_queue_write_slot(ctx->events);
+            *ev = *(struct queued_event *)mp_spsc_queue_peek(old);
+            mp_spsc_queue_push(ctx->events);
+            mp_spsc_queue_pop(old);
+        }
+        talloc_free(old);
+        ctx->event_ring = true;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return r;
+}
+
 void mpv_wakeup(mpv_handle *ctx)
 {
     pthread_mutex_lock(&ctx->lock);
@@ -1272,6 +1387,13 @@ int mpv_command_node_async(mpv_handle *ctx, uint64_t ud, mpv_node *args)
     return run_async_cmd(ctx, ud, mp_input_parse_cmd_node(ctx->log, args));
 }
 
+int mp_client_command_string_async(mpv_handle *ctx, uint64_t ud,
+                                   const char *args)
+{
+    return run_async_cmd(ctx, ud,
+        mp_input_parse_cmd(ctx->mpctx->input, bstr0((char*)args), ctx->name));
+}
+
 void mpv_abort_async_command(mpv_handle *ctx, uint64_t reply_userdata)
 {
     abort_async(ctx->mpctx, ctx, MPV_EVENT_COMMAND_REPLY, reply_userdata);
@@ -1291,9 +1413,105 @@ static int translate_property_error(int errc)
     }
 }
 
+static uint32_t hash_name(const char *name)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    for (; *name; name++)
+        h = (h ^ (unsigned char)*name) * 16777619u;
+    return h;
+}
+
+// Return the prop_ref_table slot for the given name. It's either the slot
+// of the entry with this name, or the free slot where it would be added.
+static int *find_prop_ref_slot(mpv_handle *ctx, const char *name)
+{
+    int mask = ctx->prop_ref_table_size - 1;
+    int i = hash_name(name) & mask;
+    while (ctx->prop_ref_table[i] &&
+           strcmp(ctx->prop_refs[ctx->prop_ref_table[i] - 1]->name, name) != 0)
+        i = (i + 1) & mask;
+    return &ctx->prop_ref_table[i];
+}
+
+static void rebuild_prop_ref_table(mpv_handle *ctx)
+{
+    int size = 64;
+    while (size < ctx->num_prop_refs * 2)
+        size *= 2;
+    talloc_free(ctx->prop_ref_table);
+    ctx->prop_ref_table = talloc_zero_array(ctx, int, size);
+    ctx->prop_ref_table_size = size;
+    for (int n = 0; n < ctx->num_prop_refs; n++)
+        *find_prop_ref_slot(ctx, ctx->prop_refs[n]->name) = n + 1;
+}
+
+// Call with ctx->lock held.
+static struct mpv_property_ref *resolve_property(mpv_handle *ctx,
+                                                 const char *name)
+{
+    if (ctx->prop_ref_table_size) {
+        int idx = *find_prop_ref_slot(ctx, name);
+        if (idx)
+            return ctx->prop_refs[idx - 1];
+    }
+
+    struct mpv_property_ref *prop = talloc_zero(ctx, struct mpv_property_ref);
+    prop->name = talloc_strdup(prop, name);
+    if (!mp_property_resolve(ctx->mpctx, prop->name, &prop->ref)) {
+        talloc_free(prop);
+        return NULL;
+    }
+    MP_TARRAY_APPEND(ctx, ctx->prop_refs, ctx->num_prop_refs, prop);
+    if (ctx->num_prop_refs * 2 > ctx->prop_ref_table_size) {
+        rebuild_prop_ref_table(ctx);
+    } else {
+        *find_prop_ref_slot(ctx, name) = ctx->num_prop_refs;
+    }
+    return prop;
+}
+
+// Call with ctx->lock held.
+static void release_property_ref(mpv_handle *ctx, struct mpv_property_ref *prop)
+{
+    if (!prop)
+        return;
+
+    assert(prop->refcount > 0);
+    prop->refcount -= 1;
+    if (prop->refcount || prop->pinned)
+        return;
+
+    int idx = *find_prop_ref_slot(ctx, prop->name) - 1;
+    assert(idx >= 0 && ctx->prop_refs[idx] == prop);
+    MP_TARRAY_REMOVE_AT(ctx->prop_refs, ctx->num_prop_refs, idx);
+    talloc_free(prop);
+    // Removal from a linear probing table would need to move the following
+    // entries. Unobserving is rare enough that rebuilding it is simpler.
+    rebuild_prop_ref_table(ctx);
+}
+
+mpv_property_ref *mpv_resolve_property(mpv_handle *ctx, const char *name)
+{
+    pthread_mutex_lock(&ctx->lock);
+    struct mpv_property_ref *prop = resolve_property(ctx, name);
+    if (prop)
+        prop->pinned = true;
+    pthread_mutex_unlock(&ctx->lock);
+    return prop;
+}
+
+static int property_do(struct MPContext *mpctx, const char *name,
+                       const struct m_property_ref *ref, int action, void *val)
+{
+    if (ref)
+        return mp_property_do_ref(ref, action, val, mpctx);
+    return mp_property_do(name, action, val, mpctx);
+}
+
 struct setproperty_request {
     struct MPContext *mpctx;
     const char *name;
+    const struct m_property_ref *ref; // optional, resolved name
     int format;
     void *data;
     int status;
@@ -1316,7 +1534,8 @@ static void setproperty_fn(void *arg)
         node = &tmp;
     }
 
-    int err = mp_property_do(req->name, M_PROPERTY_SET_NODE, node, req->mpctx);
+    int err = property_do(req->mpctx, req->name, req->ref, M_PROPERTY_SET_NODE,
+                          node);
 
     req->status = translate_property_error(err);
 
@@ -1330,8 +1549,9 @@ static void setproperty_fn(void *arg)
     }
 }
 
-int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format,
-                     void *data)
+static int set_property(mpv_handle *ctx, const char *name,
+                        const struct m_property_ref *ref, mpv_format format,
+                        void *data)
 {
     if (!ctx->mpctx->initialized) {
         int r = mpv_set_option(ctx, name, format, data);
@@ -1351,6 +1571,7 @@ int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format,
     struct setproperty_request req = {
         .mpctx = ctx->mpctx,
         .name = name,
+        .ref = ref,
         .format = format,
         .data = data,
     };
@@ -1358,6 +1579,18 @@ int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format,
     return req.status;
 }
 
+int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format,
+                     void *data)
+{
+    return set_property(ctx, name, NULL, format, data);
+}
+
+int mpv_set_property_ref(mpv_handle *ctx, mpv_property_ref *prop,
+                         mpv_format format, void *data)
+{
+    return set_property(ctx, prop->name, &prop->ref, format, data);
+}
+
 int mpv_set_property_string(mpv_handle *ctx, const char *name, const char *data)
 {
     return mpv_set_property(ctx, name, MPV_FORMAT_STRING, &data);
@@ -1395,9 +1628,167 @@ int mpv_set_property_async(mpv_handle *ctx, uint64_t ud, const char *name,
     return run_async(ctx, setproperty_fn, req);
 }
 
+struct batch_item {
+    struct batch_request *req;
+    int index;
+    struct mp_cmd *cmd;         // if NULL, this is a property set
+    const char *name;
+    struct mpv_node *value;
+};
+
+struct batch_request {
+    struct MPContext *mpctx;
+    struct mpv_node args;       // compact copy, owns names/values
+    struct batch_item *items;
+    int num_items;
+    struct mpv_node result;     // array with 1 map per item
+    int pending;                // number of uncompleted items, +1 while starting
+    int error;                  // first error, or 0
+    struct mpv_handle *reply_ctx;
+    uint64_t userdata;
+};
+
+static void batch_unref(struct batch_request *req)
+{
+    req->pending -= 1;
+    if (req->pending)
+        return;
+
+    struct mpv_event_command *data = talloc_zero(NULL, struct mpv_event_command);
+    data->result = req->result;
+    req->result = (mpv_node){0};
+    talloc_steal(data, node_get_alloc(&data->result));
+
+    struct mpv_event reply = {
+        .event_id = MPV_EVENT_COMMAND_REPLY,
+        .data = data,
+        .error = req->error,
+    };
+    send_reply(req->reply_ctx, req->userdata, &reply);
+
+    talloc_free(req);
+}
+
+static void batch_item_done(struct batch_item *item, int err,
+                            struct mpv_node *res)
+{
+    struct batch_request *req = item->req;
+    struct mpv_node *dst = &req->result.u.list->values[item->index];
+
+    node_map_add_int64(dst, "error", err);
+    if (res && res->format != MPV_FORMAT_NONE) {
+        struct mpv_node *r = node_map_add(dst, "result", MPV_FORMAT_NONE);
+        *r = *res;
+        *res = (mpv_node){0};
+        talloc_steal(dst->u.list, node_get_alloc(r));
+    }
+    if (err < 0 && !req->error)
+        req->error = err;
+
+    batch_unref(req);
+}
+
+static void batch_cmd_complete(struct mp_cmd_ctx *cmd)
+{
+    struct batch_item *item = cmd->on_completion_priv;
+
+    batch_item_done(item, cmd->success ? 0 : MPV_ERROR_COMMAND, &cmd->result);
+}
+
+static void batch_fn(void *data)
+{
+    struct batch_request *req = data;
+
+    for (int n = 0; n < req->num_items; n++)
+        node_array_add(&req->result, MPV_FORMAT_NODE_MAP);
+
+    // Keep req alive until all items have been started, even if all of them
+    // complete synchronously.
+    req->pending = req->num_items + 1;
+
+    for (int n = 0; n < req->num_items; n++) {
+        struct batch_item *item = &req->items[n];
+
+        if (!item->cmd) {
+            int err = property_do(req->mpctx, item->name, NULL,
+                                  M_PROPERTY_SET_NODE, item->value);
+            batch_item_done(item, translate_property_error(err), NULL);
+            continue;
+        }
+
+        struct mp_cmd *cmd = item->cmd;
+        ta_set_parent(cmd, NULL);
+        item->cmd = NULL;
+
+        struct mp_abort_entry *abort = NULL;
+        if (cmd->def->can_abort) {
+            abort = talloc_zero(NULL, struct mp_abort_entry);
+            abort->client = req->reply_ctx;
+            abort->client_work_type = MPV_EVENT_COMMAND_REPLY;
+            abort->client_work_id = req->userdata;
+        }
+
+        run_command(req->mpctx, cmd, abort, batch_cmd_complete, item);
+    }
+
+    batch_unref(req);
+}
+
+int mpv_command_batch_async(mpv_handle *ctx, uint64_t ud, mpv_node *args)
+{
+    if (!ctx->mpctx->initialized)
+        return MPV_ERROR_UNINITIALIZED;
+    if (!args || args->format != MPV_FORMAT_NODE_ARRAY)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    struct batch_request *req = talloc_ptrtype(NULL, req);
+    *req = (struct batch_request){
+        .mpctx = ctx->mpctx,
+        .reply_ctx = ctx,
+        .userdata = ud,
+    };
+    node_copy_compact(req, &req->args, args);
+    node_init(&req->result, MPV_FORMAT_NODE_ARRAY, NULL);
+    talloc_steal(req, node_get_alloc(&req->result));
+
+    // Validate everything before anything is run.
+    struct mpv_node_list *list = req->args.u.list;
+    req->items = talloc_zero_array(req, struct batch_item, list->num);
+    req->num_items = list->num;
+    for (int n = 0; n < list->num; n++) {
+        struct batch_item *item = &req->items[n];
+        struct mpv_node *arg = &list->values[n];
+        item->req = req;
+        item->index = n;
+
+        struct mpv_node *name = NULL;
+        if (arg->format == MPV_FORMAT_NODE_MAP)
+            name = node_map_get(arg, "set_property");
+        if (name) {
+            item->value = node_map_get(arg, "value");
+            if (name->format != MPV_FORMAT_STRING || !item->value)
+                goto invalid;
+            item->name = name->u.string;
+        } else {
+            item->cmd = mp_input_parse_cmd_node(ctx->log, arg);
+            if (!item->cmd)
+                goto invalid;
+            item->cmd->sender = ctx->name;
+            talloc_steal(req, item->cmd);
+        }
+    }
+
+    return run_async(ctx, batch_fn, req);
+
+invalid:
+    talloc_free(req);
+    return MPV_ERROR_INVALID_PARAMETER;
+}
+
 struct getproperty_request {
     struct MPContext *mpctx;
     const char *name;
+    const struct m_property_ref *ref; // optional, resolved name
     mpv_format format;
     void *data;
     int status;
@@ -1423,11 +1814,13 @@ static void getproperty_fn(void *arg)
     int err = -1;
     switch (req->format) {
     case MPV_FORMAT_OSD_STRING:
-        err = mp_property_do(req->name, M_PROPERTY_PRINT, data, req->mpctx);
+        err = property_do(req->mpctx, req->name, req->ref, M_PROPERTY_PRINT,
+                          data);
         break;
     case MPV_FORMAT_STRING: {
         char *s = NULL;
-        err = mp_property_do(req->name, M_PROPERTY_GET_STRING, &s, req->mpctx);
+        err = property_do(req->mpctx, req->name, req->ref,
+                          M_PROPERTY_GET_STRING, &s);
         if (err == M_PROPERTY_OK)
             *(char **)data = s;
         break;
@@ -1437,13 +1830,14 @@ static void getproperty_fn(void *arg)
     case MPV_FORMAT_INT64:
     case MPV_FORMAT_DOUBLE: {
         struct mpv_node node = {{0}};
-        err = mp_property_do(req->name, M_PROPERTY_GET_NODE, &node, req->mpctx);
+        err = property_do(req->mpctx, req->name, req->ref,
+                          M_PROPERTY_GET_NODE, &node);
         if (err == M_PROPERTY_NOT_IMPLEMENTED) {
             // Go through explicit string conversion. Same reasoning as on the
             // GET code path.
             char *s = NULL;
-            err = mp_property_do(req->name, M_PROPERTY_GET_STRING, &s,
-                                 req->mpctx);
+            err = property_do(req->mpctx, req->name, req->ref,
+                              M_PROPERTY_GET_STRING, &s);
             if (err != M_PROPERTY_OK)
                 break;
             node.format = MPV_FORMAT_STRING;
@@ -1486,8 +1880,9 @@ static void getproperty_fn(void *arg)
     }
 }
 
-int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
-                     void *data)
+static int get_property(mpv_handle *ctx, const char *name,
+                        const struct m_property_ref *ref, mpv_format format,
+                        void *data)
 {
     if (!ctx->mpctx->initialized)
         return MPV_ERROR_UNINITIALIZED;
@@ -1499,6 +1894,7 @@ int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
     struct getproperty_request req = {
         .mpctx = ctx->mpctx,
         .name = name,
+        .ref = ref,
         .format = format,
         .data = data,
     };
@@ -1506,6 +1902,18 @@ int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
     return req.status;
 }
 
+int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
+                     void *data)
+{
+    return get_property(ctx, name, NULL, format, data);
+}
+
+int mpv_get_property_ref(mpv_handle *ctx, mpv_property_ref *prop,
+                         mpv_format format, void *data)
+{
+    return get_property(ctx, prop->name, &prop->ref, format, data);
+}
+
 char *mpv_get_property_string(mpv_handle *ctx, const char *name)
 {
     char *str = NULL;
@@ -1549,10 +1957,14 @@ static void property_free(void *p)
         m_option_free(prop->type, &prop->value);
         m_option_free(prop->type, &prop->value_ret);
     }
+    node_snapshot_unref(prop->value_snap);
+    node_snapshot_unref(prop->value_ret_snap);
+    release_property_ref(prop->owner, prop->prop_ref);
 }
 
-int mpv_observe_property(mpv_handle *ctx, uint64_t userdata,
-                         const char *name, mpv_format format)
+static int observe_property(mpv_handle *ctx, uint64_t userdata,
+                            const char *name, struct mpv_property_ref *ref,
+                            mpv_format format)
 {
     const struct m_option *type = get_mp_type_get(format);
     if (format != MPV_FORMAT_NONE && !type)
@@ -1563,12 +1975,20 @@ int mpv_observe_property(mpv_handle *ctx, uint64_t userdata,
 
     pthread_mutex_lock(&ctx->lock);
     assert(!ctx->destroying);
+    // Resolve it once, instead of on every value update.
+    if (!ref)
+        ref = resolve_property(ctx, name);
+    if (ref)
+        ref->refcount += 1;
     struct observe_property *prop = talloc_ptrtype(ctx, prop);
     talloc_set_destructor(prop, property_free);
     *prop = (struct observe_property){
         .owner = ctx,
         .name = talloc_strdup(prop, name),
+        .ref = ref ? &ref->ref : NULL,
+        .prop_ref = ref,
         .id = mp_get_property_id(ctx->mpctx, name),
+        .hash = hash_name(name),
         .event_mask = mp_get_property_event_mask(name),
         .reply_id = userdata,
         .format = format,
@@ -1587,6 +2007,18 @@ int mpv_observe_property(mpv_handle *ctx, uint64_t userdata,
     return 0;
 }
 
+int mpv_observe_property(mpv_handle *ctx, uint64_t userdata,
+                         const char *name, mpv_format format)
+{
+    return observe_property(ctx, userdata, name, NULL, format);
+}
+
+int mpv_observe_property_ref(mpv_handle *ctx, uint64_t userdata,
+                             mpv_property_ref *prop, mpv_format format)
+{
+    return observe_property(ctx, userdata, prop->name, prop, format);
+}
+
 int mpv_unobserve_property(mpv_handle *ctx, uint64_t userdata)
 {
     pthread_mutex_lock(&ctx->lock);
@@ -1607,6 +2039,31 @@ int mpv_unobserve_property(mpv_handle *ctx, uint64_t userdata)
     return count;
 }
 
+int mpv_limit_property_rate(mpv_handle *ctx, uint64_t reply_userdata,
+                            double max_rate)
+{
+    if (!(max_rate >= 0) || isinf(max_rate))
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    pthread_mutex_lock(&ctx->lock);
+    int count = 0;
+    for (int n = 0; n < ctx->num_properties; n++) {
+        struct observe_property *prop = ctx->properties[n];
+        if (prop->reply_id == reply_userdata) {
+            prop->update_interval = max_rate > 0 ? 1.0 / max_rate : 0;
+            prop->next_update = 0;
+            count++;
+        }
+    }
+    // Changes delayed by the old limit might be due now.
+    if (count)
+        ctx->has_pending_properties = true;
+    pthread_mutex_unlock(&ctx->lock);
+    if (count)
+        mp_wakeup_core(ctx->mpctx);
+    return count;
+}
+
 // Broadcast that a property has changed.
 void mp_client_property_change(struct MPContext *mpctx, const char *name)
 {
@@ -1614,6 +2071,8 @@ void mp_client_property_change(struct MPContext *mpctx, const char *name)
     int id = mp_get_property_id(mpctx, name);
     bool any_pending = false;
 
+    atomic_fetch_add(&clients->prop_cache_gen, 1);
+
     pthread_mutex_lock(&clients->lock);
 
     for (int n = 0; n < clients->num_clients; n++) {
@@ -1652,14 +2111,138 @@ static void notify_property_events(struct mpv_handle *ctx, int event)
     }
 
     // Same as in mp_client_property_change().
-    if (ctx->has_pending_properties)
+    if (ctx->has_pending_properties) {
+        atomic_fetch_add(&ctx->clients->prop_cache_gen, 1);
         mp_dispatch_adjust_timeout(ctx->mpctx->dispatch, 0);
+    }
+}
+
+// Return the prop_cache_table slot for the given property. It's either the slot
+// of the matching entry, or the free slot where it would be added.
+static int *find_prop_cache_slot(struct mp_client_api *clients, uint32_t hash,
+                                 const char *name, mpv_format format)
+{
+    int mask = clients->prop_cache_table_size - 1;
+    int i = hash & mask;
+    while (clients->prop_cache_table[i]) {
+        struct prop_cache_entry *e =
+            clients->prop_cache[clients->prop_cache_table[i] - 1];
+        if (e->hash == hash && e->format == format && strcmp(e->name, name) == 0)
+            break;
+        i = (i + 1) & mask;
+    }
+    return &clients->prop_cache_table[i];
+}
+
+static void rebuild_prop_cache_table(struct mp_client_api *clients)
+{
+    int size = 64;
+    while (size < clients->num_prop_cache * 2)
+        size *= 2;
+    talloc_free(clients->prop_cache_table);
+    clients->prop_cache_table = talloc_zero_array(clients, int, size);
+    clients->prop_cache_table_size = size;
+    for (int n = 0; n < clients->num_prop_cache; n++) {
+        struct prop_cache_entry *e = clients->prop_cache[n];
+        *find_prop_cache_slot(clients, e->hash, e->name, e->format) = n + 1;
+    }
+}
+
+// Return the current value of the observed property. It is read only once per
+// update pass, no matter how many clients observe it, unless a property change
+// was notified in the meantime.
+// Call with ctx->lock held (only). May temporarily drop the lock.
+static struct prop_cache_entry *read_observed_property(struct mpv_handle *ctx,
+                                                       struct observe_property *prop)
+{
+    struct mp_client_api *clients = ctx->clients;
+    uint64_t gen = atomic_load(&clients->prop_cache_gen);
+
+    struct prop_cache_entry *e = NULL;
+    if (clients->prop_cache_table_size) {
+        int idx = *find_prop_cache_slot(clients, prop->hash, prop->name,
+                                        prop->format);
+        if (idx)
+            e = clients->prop_cache[idx - 1];
+    }
+
+    if (e && e->gen == gen)
+        return e;
+
+    if (!e) {
+        e = talloc_ptrtype(clients, e);
+        *e = (struct prop_cache_entry){
+            .name = talloc_strdup(e, prop->name),
+            .hash = prop->hash,
+            .format = prop->format,
+            .type = prop->type,
+        };
+        MP_TARRAY_APPEND(clients, clients->prop_cache, clients->num_prop_cache,
+                         e);
+        if (clients->num_prop_cache * 2 > clients->prop_cache_table_size) {
+            rebuild_prop_cache_table(clients);
+        } else {
+            *find_prop_cache_slot(clients, e->hash, e->name, e->format) =
+                clients->num_prop_cache;
+        }
+    }
+
+    m_option_free(e->type, &e->value);
+    node_snapshot_unref(e->snapshot);
+    e->snapshot = NULL;
+
+    struct getproperty_request req = {
+        .mpctx = ctx->mpctx,
+        .name = e->name,
+        .ref = prop->ref,
+        .format = e->format,
+        .data = &e->value,
+    };
+
+    // Temporarily unlock and read the property. The very important thing is
+    // that property getters can do whatever they want, _and_ that they may
+    // wait on the client API user thread (if vo_libmpv or similar things are
+    // involved).
+    prop->refcount += 1; // keep prop alive (esp. prop->ref)
+    ctx->async_counter += 1; // keep ctx alive
+    pthread_mutex_unlock(&ctx->lock);
+    getproperty_fn(&req);
+    pthread_mutex_lock(&ctx->lock);
+    ctx->async_counter -= 1;
+    prop_unref(prop);
+
+    e->status = req.status;
+    e->gen = gen;
+
+    // Large trees (like "playlist") are then shared by reference.
+    if (e->format == MPV_FORMAT_NODE && e->status >= 0) {
+        e->snapshot = node_snapshot_new((struct mpv_node *)&e->value);
+        m_option_free(e->type, &e->value);
+    }
+
+    return e;
+}
+
+static void clear_property_cache(struct mp_client_api *clients)
+{
+    for (int n = 0; n < clients->num_prop_cache; n++) {
+        struct prop_cache_entry *e = clients->prop_cache[n];
+        m_option_free(e->type, &e->value);
+        node_snapshot_unref(e->snapshot);
+        talloc_free(e);
+    }
+    clients->num_prop_cache = 0;
+    if (clients->prop_cache_table_size) {
+        memset(clients->prop_cache_table, 0,
+               clients->prop_cache_table_size * sizeof(int));
+    }
 }
 
 // Call with ctx->lock held (only). May temporarily drop the lock.
 static void send_client_property_changes(struct mpv_handle *ctx)
 {
     uint64_t cur_ts = ctx->properties_change_ts;
+    double now = mp_time_sec();
 
     ctx->has_pending_properties = false;
 
@@ -1669,59 +2252,59 @@ static void send_client_property_changes(struct mpv_handle *ctx)
         if (prop->value_ts == prop->change_ts)
             continue;
 
+        // Rate limited: leave the change pending, and check again once the
+        // interval has passed.
+        if (prop->next_update > now && !prop->waiting_for_hook) {
+            ctx->has_pending_properties = true;
+            mp_set_timeout(ctx->mpctx, prop->next_update - now);
+            continue;
+        }
+
         bool changed = false;
         if (prop->format) {
-            const struct m_option *type = prop->type;
-            union m_option_value val = {0};
-            struct getproperty_request req = {
-                .mpctx = ctx->mpctx,
-                .name = prop->name,
-                .format = prop->format,
-                .data = &val,
-            };
-
-            // Temporarily unlock and read the property. The very important
-            // thing is that property getters can do whatever they want, _and_
-            // that they may wait on the client API user thread (if vo_libmpv
-            // or similar things are involved).
-            prop->refcount += 1; // keep prop alive (esp. prop->name)
-            ctx->async_counter += 1; // keep ctx alive
-            pthread_mutex_unlock(&ctx->lock);
-            getproperty_fn(&req);
-            pthread_mutex_lock(&ctx->lock);
-            ctx->async_counter -= 1;
-            prop_unref(prop);
+            struct prop_cache_entry *e = read_observed_property(ctx, prop);
 
             // Set if observed properties was changed or something similar
             // => start over, retry next time.
             if (cur_ts != ctx->properties_change_ts || ctx->destroying) {
-                m_option_free(type, &val);
                 mp_wakeup_core(ctx->mpctx);
                 ctx->has_pending_properties = true;
                 break;
             }
             assert(prop->refcount > 0);
 
-            bool val_valid = req.status >= 0;
+            bool val_valid = e->status >= 0;
             changed = prop->value_valid != val_valid;
-            if (prop->value_valid && val_valid)
-                changed = !equal_mpv_value(&prop->value, &val, prop->format);
+            if (prop->value_valid && val_valid) {
+                if (e->snapshot) {
+                    changed = prop->value_snap != e->snapshot &&
+                        !equal_mpv_node(node_snapshot_get(prop->value_snap),
+                                        node_snapshot_get(e->snapshot));
+                } else {
+                    changed = !equal_mpv_value(&prop->value, &e->value,
+                                               prop->format);
+                }
+            }
             if (prop->value_ts == 0)
                 changed = true; // initial event
 
             prop->value_valid = val_valid;
             if (changed && val_valid) {
-                // move val to prop->value
-                m_option_free(type, &prop->value);
-                memcpy(&prop->value, &val, type->type->size);
-                memset(&val, 0, type->type->size);
+                if (e->snapshot) {
+                    node_snapshot_unref(prop->value_snap);
+                    prop->value_snap = node_snapshot_ref(e->snapshot);
+                } else {
+                    m_option_free(prop->type, &prop->value);
+                    m_option_copy(prop->type, &prop->value, &e->value);
+                }
             }
-
-            m_option_free(prop->type, &val);
         } else {
             changed = true;
         }
 
+        if (changed && prop->update_interval > 0)
+            prop->next_update = now + prop->update_interval;
+
         if (prop->waiting_for_hook)
             ctx->new_property_events = true; // make sure to wakeup
 
@@ -1769,6 +2352,8 @@ void mp_client_send_property_changes(struct MPContext *mpctx)
     }
 
     pthread_mutex_unlock(&clients->lock);
+
+    clear_property_cache(clients);
 }
 
 // Set ctx->cur_event to a generated property change event, if there is any
@@ -1798,13 +2383,21 @@ static bool gen_property_change_event(struct mpv_handle *ctx)
             ctx->cur_property = prop;
             prop->refcount += 1;
 
-            if (prop->value_valid)
+            void *data = NULL;
+            if (prop->value_valid && prop->value_snap) {
+                node_snapshot_unref(prop->value_ret_snap);
+                prop->value_ret_snap = node_snapshot_ref(prop->value_snap);
+                // The API user must not modify the event data anyway.
+                data = (void *)node_snapshot_get(prop->value_ret_snap);
+            } else if (prop->value_valid) {
                 m_option_copy(prop->type, &prop->value_ret, &prop->value);
+                data = &prop->value_ret;
+            }
 
             ctx->cur_property_event = (struct mpv_event_property){
                 .name = prop->name,
                 .format = prop->value_valid ? prop->format : 0,
-                .data = prop->value_valid ? &prop->value_ret : NULL,
+                .data = data,
             };
             *ctx->cur_event = (struct mpv_event){
                 .event_id = MPV_EVENT_PROPERTY_CHANGE,
@@ -1939,9 +2532,12 @@ unsigned long mpv_client_api_version(void)
 
 int mpv_event_to_node(mpv_node *dst, mpv_event *event)
 {
-    *dst = (mpv_node){0};
-
-    node_init(dst, MPV_FORMAT_NODE_MAP, NULL);
+    // These are created for every event delivered to scripts and IPC clients,
+    // and freed right after, so use an arena.
+    *dst = (mpv_node){
+        .format = MPV_FORMAT_NODE_MAP,
+        .u.list = talloc_arena_zero(NULL, mpv_node_list),
+    };
     node_map_add_string(dst, "event", mpv_event_name(event->event_id));
 
     if (event->error < 0)
@@ -37,12 +37,19 @@ void mp_client_set_weak(struct mpv_handle *ctx);
 struct mp_log *mp_client_get_log(struct mpv_handle *ctx);
 struct mpv_global *mp_client_get_global(struct mpv_handle *ctx);
 
+// mp_time_us() at which the event last returned by mpv_wait_event() was
+// queued. 0 for events generated on demand (property changes, log messages,
+// timeouts). Must be called from the thread that calls mpv_wait_event().
+int64_t mp_client_get_event_time(struct mpv_handle *ctx);
+
+// Like mpv_command_string(), but reply with MPV_EVENT_COMMAND_REPLY like
+// mpv_command_async().
+int mp_client_command_string_async(struct mpv_handle *ctx, uint64_t ud,
+                                   const char *args);
+
 void mp_client_broadcast_event_external(struct mp_client_api *api, int event,
                                         void *data);
 
-// m_option.c
-void *node_get_alloc(struct mpv_node *node);
-
 // for vo_libmpv.c
 struct osd_state;
 struct mpv_render_context;
@@ -81,6 +81,7 @@
 struct command_ctx {
     // All properties, terminated with a {0} item.
     struct m_property *properties;
+    struct m_property_index *properties_index;
 
     double last_seek_time;
     double last_seek_pts;
@@ -1927,6 +1928,8 @@ static int get_track_entry(int item, int action, void *arg, void *ctx)
     if (p.par_h)
         par = p.par_w / (double) p.par_h;
 
+    double preload = track->d_sub ? sub_get_preload_progress(track->d_sub) : -1;
+
     int order = -1;
     if (track->selected) {
         for (int i = 0; i < num_ptracks[track->type]; i++) {
@@ -1985,6 +1988,8 @@ static int get_track_entry(int item, int action, void *arg, void *ctx)
                         .unavailable = !has_rg},
         {"replaygain-album-gain", SUB_PROP_FLOAT(rg.album_gain),
                         .unavailable = !has_rg},
+        {"preload-progress", SUB_PROP_DOUBLE(preload),
+                        .unavailable = preload < 0},
         {0}
     };
 
@@ -2592,6 +2597,79 @@ static int mp_property_perf_info(void *ctx, struct m_property *p, int action,
     return M_PROPERTY_NOT_IMPLEMENTED;
 }
 
+static int mp_property_pipeline_latency(void *ctx, struct m_property *p,
+                                        int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+
+    switch (action) {
+    case M_PROPERTY_GET_TYPE:
+        *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
+        return M_PROPERTY_OK;
+    case M_PROPERTY_GET: {
+        stats_global_query_latency(mpctx->global, (struct mpv_node *)arg);
+        return M_PROPERTY_OK;
+    }
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
+static int mp_property_script_profile(void *ctx, struct m_property *p,
+                                      int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+
+    switch (action) {
+    case M_PROPERTY_GET_TYPE:
+        *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
+        return M_PROPERTY_OK;
+    case M_PROPERTY_GET: {
+        stats_global_query_handlers(mpctx->global, (struct mpv_node *)arg);
+        return M_PROPERTY_OK;
+    }
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
+static int mp_property_memory_usage(void *ctx, struct m_property *p,
+                                    int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+
+    switch (action) {
+    case M_PROPERTY_GET_TYPE:
+        *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
+        return M_PROPERTY_OK;
+    case M_PROPERTY_GET: {
+        struct ta_acct_stats st[TA_ACCT_MAX_TAGS];
+        int num = ta_acct_get_stats(st);
+        if (num < 0)
+            return M_PROPERTY_UNAVAILABLE;
+
+        struct mpv_node *r = arg;
+        node_init(r, MPV_FORMAT_NODE_MAP, NULL);
+        for (int n = 0; n < num; n++) {
+            if (!st[n].bytes && !st[n].count)
+                continue;
+            struct mpv_node *e = node_map_add(r, st[n].name, MPV_FORMAT_NODE_MAP);
+            node_map_add_int64(e, "bytes", st[n].bytes);
+            node_map_add_int64(e, "allocations", st[n].count);
+        }
+
+        // Packet data is not allocated with ta.
+        if (mpctx->demuxer) {
+            struct demux_reader_state s;
+            demux_get_reader_state(mpctx->demuxer, &s);
+            struct mpv_node *e =
+                node_map_add(r, "demuxer-cache", MPV_FORMAT_NODE_MAP);
+            node_map_add_int64(e, "bytes", s.total_bytes);
+        }
+        return M_PROPERTY_OK;
+    }
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
 static int mp_property_vo(void *ctx, struct m_property *p, int action, void *arg)
 {
     MPContext *mpctx = ctx;
@@ -2921,6 +2999,13 @@ static int mp_property_playlist_playing_pos(void *ctx, struct m_property *prop,
                              playlist_entry_to_index(pl, mpctx->playing));
 }
 
+static int mp_property_playlist_generation(void *ctx, struct m_property *prop,
+                                           int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    return m_property_int64_ro(action, arg, mpctx->playlist->generation);
+}
+
 static int mp_property_playlist_pos_x(void *ctx, struct m_property *prop,
                                       int action, void *arg, int base)
 {
@@ -3001,8 +3086,9 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
         struct playlist *pl = mpctx->playlist;
         char *res = talloc_strdup(NULL, "");
 
-        for (int n = 0; n < pl->num_entries; n++) {
-            struct playlist_entry *e = pl->entries[n];
+        for (struct playlist_entry *e = playlist_get_first(pl); e;
+             e = playlist_entry_get_rel(e, 1))
+        {
             char *p = e->title;
             if (!p) {
                 p = e->filename;
@@ -3595,6 +3681,7 @@ static const struct m_property mp_properties_base[] = {
     {"playlist-pos-1", mp_property_playlist_pos_1},
     {"playlist-current-pos", mp_property_playlist_current_pos},
     {"playlist-playing-pos", mp_property_playlist_playing_pos},
+    {"playlist-generation", mp_property_playlist_generation},
     M_PROPERTY_ALIAS("playlist-count", "playlist/count"),
 
     // Audio
@@ -3627,6 +3714,9 @@ static const struct m_property mp_properties_base[] = {
     {"vo-configured", mp_property_vo_configured},
     {"vo-passes", mp_property_vo_passes},
     {"perf-info", mp_property_perf_info},
+    {"memory-usage", mp_property_memory_usage},
+    {"pipeline-latency", mp_property_pipeline_latency},
+    {"script-profile", mp_property_script_profile},
     {"current-vo", mp_property_vo},
     {"container-fps", mp_property_fps},
     {"estimated-vf-fps", mp_property_vf_fps},
@@ -3768,7 +3858,7 @@ static const char *const *const mp_event_property_change[] = {
     E(MP_EVENT_FOCUS, "focused"),
     E(MP_EVENT_CHANGE_PLAYLIST, "playlist", "playlist-pos", "playlist-pos-1",
       "playlist-count", "playlist/count", "playlist-current-pos",
-      "playlist-playing-pos"),
+      "playlist-playing-pos", "playlist-generation"),
     E(MP_EVENT_INPUT_PROCESSED, "mouse-pos"),
     E(MP_EVENT_CORE_IDLE, "core-idle", "eof-reached"),
 };
@@ -3815,11 +3905,22 @@ uint64_t mp_get_property_event_mask(const char *name)
 int mp_get_property_id(struct MPContext *mpctx, const char *name)
 {
     struct command_ctx *ctx = mpctx->command_ctx;
-    for (int n = 0; ctx->properties[n].name; n++) {
-        if (match_property(ctx->properties[n].name, name))
-            return n;
-    }
-    return -1;
+    // Same rules as match_property().
+    bstr prefix = bstr0(name);
+    bstr_eatstart0(&prefix, "options/");
+    int slash = bstrchr(prefix, '/');
+    if (slash >= 0)
+        prefix = bstr_splice(prefix, 0, slash);
+    struct m_property *prop = m_property_index_find(ctx->properties_index,
+                                                    prefix);
+    return prop ? prop - ctx->properties : -1;
+}
+
+bool mp_property_resolve(struct MPContext *mpctx, const char *name,
+                         struct m_property_ref *ref)
+{
+    struct command_ctx *ctx = mpctx->command_ctx;
+    return m_property_resolve(ctx->properties_index, name, ref);
 }
 
 static bool is_property_set(int action, void *val)
@@ -3843,8 +3944,17 @@ static bool is_property_set(int action, void *val)
 int mp_property_do(const char *name, int action, void *val,
                    struct MPContext *ctx)
 {
-    struct command_ctx *cmd = ctx->command_ctx;
-    int r = m_property_do(ctx->log, cmd->properties, name, action, val, ctx);
+    struct m_property_ref ref;
+    if (!mp_property_resolve(ctx, name, &ref))
+        return M_PROPERTY_UNKNOWN;
+    return mp_property_do_ref(&ref, action, val, ctx);
+}
+
+int mp_property_do_ref(const struct m_property_ref *ref, int action, void *val,
+                       struct MPContext *ctx)
+{
+    const char *name = ref->name;
+    int r = m_property_do_ref(ctx->log, ref, action, val, ctx);
 
     if (mp_msg_test(ctx->log, MSGL_V) && is_property_set(action, val)) {
         struct m_option ot = {0};
@@ -3869,7 +3979,7 @@ int mp_property_do(const char *name, int action, void *val,
 char *mp_property_expand_string(struct MPContext *mpctx, const char *str)
 {
     struct command_ctx *ctx = mpctx->command_ctx;
-    return m_properties_expand_string(ctx->properties, str, mpctx);
+    return m_properties_expand_string(ctx->properties_index, str, mpctx);
 }
 
 // Before expanding properties, parse C-style escapes like "\n"
@@ -5233,6 +5343,65 @@ static void cmd_playlist_unshuffle(void *p)
     mp_notify(mpctx, MP_EVENT_CHANGE_PLAYLIST, NULL);
 }
 
+static const char *const playlist_change_names[] = {
+    [PLAYLIST_CHANGE_INSERT] = "insert",
+    [PLAYLIST_CHANGE_REMOVE] = "remove",
+    [PLAYLIST_CHANGE_MOVE] = "move",
+    [PLAYLIST_CHANGE_CLEAR] = "clear",
+};
+
+static void cmd_playlist_changes(void *p)
+{
+    struct mp_cmd_ctx *cmd = p;
+    struct MPContext *mpctx = cmd->mpctx;
+    struct playlist *pl = mpctx->playlist;
+
+    struct mpv_node *res = &cmd->result;
+    node_init(res, MPV_FORMAT_NODE_MAP, NULL);
+    node_map_add_int64(res, "generation", pl->generation);
+
+    struct playlist_change *changes;
+    int num_changes = playlist_get_changes(pl, cmd->args[0].v.i64, &changes);
+    if (num_changes < 0) {
+        node_map_add_flag(res, "reset", true);
+        return;
+    }
+
+    struct mpv_node *list = node_map_add(res, "changes", MPV_FORMAT_NODE_ARRAY);
+    for (int n = 0; n < num_changes; n++) {
+        struct playlist_change *c = &changes[n];
+        struct mpv_node *e = node_array_add(list, MPV_FORMAT_NODE_MAP);
+        node_map_add_string(e, "type", playlist_change_names[c->type]);
+        if (c->type != PLAYLIST_CHANGE_CLEAR)
+            node_map_add_int64(e, "index", c->index);
+        if (c->type == PLAYLIST_CHANGE_MOVE)
+            node_map_add_int64(e, "new_index", c->new_index);
+        if (c->type == PLAYLIST_CHANGE_INSERT)
+            node_map_add_int64(e, "count", c->count);
+        if (c->id)
+            node_map_add_int64(e, "id", c->id);
+    }
+
+    // Entries that were removed again are not listed.
+    struct mpv_node *entries =
+        node_map_add(res, "entries", MPV_FORMAT_NODE_ARRAY);
+    for (int n = 0; n < num_changes; n++) {
+        struct playlist_change *c = &changes[n];
+        if (c->type != PLAYLIST_CHANGE_INSERT)
+            continue;
+        for (int i = 0; i < c->count; i++) {
+            struct playlist_entry *pe = playlist_get_added_entry(pl, c->id + i);
+            if (!pe)
+                continue;
+            struct mpv_node *e = node_array_add(entries, MPV_FORMAT_NODE_MAP);
+            node_map_add_string(e, "filename", pe->filename);
+            if (pe->title)
+                node_map_add_string(e, "title", pe->title);
+            node_map_add_int64(e, "id", pe->id);
+        }
+    }
+}
+
 static void cmd_stop(void *p)
 {
     struct mp_cmd_ctx *cmd = p;
@@ -6212,6 +6381,9 @@ const struct mp_cmd_def mp_cmds[] = {
             .flags = MP_CMD_OPT_ARG, M_RANGE(0, INT_MAX)}, }},
     { "playlist-move", cmd_playlist_move,  { {"index1", OPT_INT(v.i)},
                                              {"index2", OPT_INT(v.i)}, }},
+    { "playlist-changes", cmd_playlist_changes,
+        { {"generation", OPT_INT64(v.i64)} },
+        .is_noisy = true },
     { "run", cmd_run, { {"command", OPT_STRING(v.s)},
                         {"args", OPT_STRING(v.s)}, },
         .vararg = true,
@@ -6413,6 +6585,10 @@ void command_init(struct MPContext *mpctx)
         talloc_zero_array(ctx, struct m_property, num_base + num_opts + 1);
     memcpy(ctx->properties, mp_properties_base, sizeof(mp_properties_base));
 
+    // Covers only the manual properties (the rest of the array is still 0).
+    struct m_property_index *base_index =
+        m_property_index_create(NULL, ctx->properties);
+
     int count = num_base;
     for (int n = 0; n < num_opts; n++) {
         struct m_config_option *co = m_config_get_co_index(mpctx->mconfig, n);
@@ -6446,11 +6622,14 @@ void command_init(struct MPContext *mpctx)
         }
 
         // The option might be covered by a manual property already.
-        if (m_property_list_find(ctx->properties, prop.name))
+        if (m_property_index_find(base_index, bstr0(prop.name)))
             continue;
 
         ctx->properties[count++] = prop;
     }
+
+    talloc_free(base_index);
+    ctx->properties_index = m_property_index_create(ctx, ctx->properties);
 }
 
 static void command_event(struct MPContext *mpctx, int event, void *arg)
@@ -6574,6 +6753,14 @@ void mp_option_change_callback(void *ctx, struct m_config_option *co, int flags,
     if (flags & UPDATE_INPUT)
         mp_input_update_opts(mpctx->input);
 
+    if (init || opt_ptr == &opts->memory_accounting) {
+        if (!ta_acct_enable(opts->memory_accounting) && opts->memory_accounting)
+            MP_WARN(mpctx, "Memory accounting is not supported on this system.\n");
+    }
+
+    if (init || opt_ptr == &opts->script_profile)
+        stats_global_enable_handlers(mpctx->global, opts->script_profile);
+
     if (init || opt_ptr == &opts->ipc_path || opt_ptr == &opts->ipc_client) {
         mp_uninit_ipc(mpctx->ipc_ctx);
         mpctx->ipc_ctx = mp_init_ipc(mpctx->clients, mpctx->global);
@@ -16,6 +16,7 @@
  */
 
 #include <errno.h>
+#include <math.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <sys/types.h>
@@ -42,6 +43,9 @@
 #include "options/options.h"
 #include "options/m_property.h"
 
+#include "audio/loudness.h"
+#include "demux/demux.h"
+#include "demux/stheader.h"
 #include "stream/stream.h"
 
 #include "core.h"
@@ -192,6 +196,16 @@ static bool copy_mtime(const char *f1, const char *f2)
     return true;
 }
 
+static char *md5_hex(void *ta_ctx, const char *s)
+{
+    uint8_t md5[16];
+    av_md5_sum(md5, s, strlen(s));
+    char *res = talloc_strdup(ta_ctx, "");
+    for (int i = 0; i < 16; i++)
+        res = talloc_asprintf_append(res, "%02X", md5[i]);
+    return res;
+}
+
 static char *mp_get_playback_resume_config_filename(struct MPContext *mpctx,
                                                     const char *fname)
 {
@@ -210,11 +224,7 @@ static char *mp_get_playback_resume_config_filename(struct MPContext *mpctx,
             realpath = mp_path_join(tmp, cwd, fname);
         }
     }
-    uint8_t md5[16];
-    av_md5_sum(md5, realpath, strlen(realpath));
-    char *conf = talloc_strdup(tmp, "");
-    for (int i = 0; i < 16; i++)
-        conf = talloc_asprintf_append(conf, "%02X", md5[i]);
+    char *conf = md5_hex(tmp, realpath);
 
     if (!mpctx->cached_watch_later_configdir) {
         char *wl_dir = mpctx->opts->watch_later_directory;
@@ -483,8 +493,9 @@ struct playlist_entry *mp_check_playlist_resume(struct MPContext *mpctx,
 {
     if (!mpctx->opts->position_resume)
         return NULL;
-    for (int n = 0; n < playlist->num_entries; n++) {
-        struct playlist_entry *e = playlist->entries[n];
+    for (struct playlist_entry *e = playlist_get_first(playlist); e;
+         e = playlist_entry_get_rel(e, 1))
+    {
         char *conf = mp_get_playback_resume_config_filename(mpctx, e->filename);
         bool exists = conf && mp_path_exists(conf);
         talloc_free(conf);
@@ -494,3 +505,101 @@ struct playlist_entry *mp_check_playlist_resume(struct MPContext *mpctx,
     return NULL;
 }
 
+
+#define MP_LOUDNESS_CONF "loudness"
+
+// Return the name of the file caching the loudness of the given audio track,
+// or NULL if not possible.
+static char *get_loudness_cache_filename(void *ta_ctx, struct MPContext *mpctx,
+                                         struct track *track)
+{
+    void *tmp = talloc_new(NULL);
+    char *res = NULL;
+
+    const char *fname = track->is_external ? track->external_filename
+                                           : mpctx->filename;
+    if (!fname)
+        goto exit;
+    if (!mp_is_url(bstr0(fname))) {
+        char *cwd = mp_getcwd(tmp);
+        if (!cwd)
+            goto exit;
+        fname = mp_path_join(tmp, cwd, fname);
+    }
+
+    char *dir = mp_find_user_config_file(tmp, mpctx->global, MP_LOUDNESS_CONF);
+    if (!dir)
+        goto exit;
+    mp_mk_config_dir(mpctx->global, dir);
+
+    char *id = talloc_asprintf(tmp, "%s#%d", fname, track->ff_index);
+    res = mp_path_join(ta_ctx, dir, md5_hex(tmp, id));
+
+exit:
+    talloc_free(tmp);
+    return res;
+}
+
+// Load the loudness of the track measured in a previous playback (see
+// --replaygain-cache) as replaygain data. Returns NULL if there is none.
+struct replaygain_data *mp_load_loudness_cache(void *ta_parent,
+                                               struct MPContext *mpctx,
+                                               struct track *track)
+{
+    void *tmp = talloc_new(NULL);
+    struct replaygain_data *rg = NULL;
+
+    char *conffile = get_loudness_cache_filename(tmp, mpctx, track);
+    if (!conffile || !mp_path_exists(conffile))
+        goto exit;
+
+    bstr data = stream_read_file(conffile, tmp, mpctx->global, 4096);
+    double gain = NAN, peak = NAN;
+    while (data.len) {
+        bstr line = bstr_strip_linebreaks(bstr_getline(data, &data));
+        if (bstr_eatstart0(&line, "track-gain="))
+            gain = bstrtod(line, NULL);
+        if (bstr_eatstart0(&line, "track-peak="))
+            peak = bstrtod(line, NULL);
+    }
+    if (!isfinite(gain) || !isfinite(peak) || peak <= 0) {
+        MP_WARN(mpctx, "Invalid loudness cache file %s\n", conffile);
+        goto exit;
+    }
+
+    MP_VERBOSE(mpctx, "Using cached loudness from %s\n", conffile);
+    rg = talloc_ptrtype(ta_parent, rg);
+    *rg = (struct replaygain_data){
+        .track_gain = gain,
+        .track_peak = peak,
+        .album_gain = gain,
+        .album_peak = peak,
+    };
+
+exit:
+    talloc_free(tmp);
+    return rg;
+}
+
+// Store the loudness measured during playback of the track. The gain is
+// relative to the ReplayGain 2.0 reference level of -18 LUFS.
+void mp_write_loudness_cache(struct MPContext *mpctx, struct track *track,
+                             struct mp_loudness_result *res)
+{
+    char *conffile = get_loudness_cache_filename(NULL, mpctx, track);
+    if (!conffile)
+        return;
+
+    FILE *file = fopen(conffile, "wb");
+    if (file) {
+        MP_VERBOSE(mpctx, "Writing loudness %f LUFS to %s\n", res->integrated,
+                   conffile);
+        write_filename(mpctx, file, track->is_external ?
+                       track->external_filename : mpctx->filename);
+        fprintf(file, "track-gain=%f\n", -18.0 - res->integrated);
+        fprintf(file, "track-peak=%f\n", res->peak);
+        fclose(file);
+    }
+
+    talloc_free(conffile);
+}
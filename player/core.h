@@ -185,6 +185,8 @@ struct vo_chain {
 
     bool underrun;
     bool underrun_signaled;
+
+    struct stats_ctx *stats; // for "video/..." latency stats
 };
 
 // Like vo_chain, for audio.
@@ -217,6 +219,13 @@ struct ao_chain {
 
     bool ao_underrun;   // last known AO state
     bool underrun;      // for cache pause logic
+
+    // --replaygain-cache
+    struct replaygain_data *cached_rg;
+    struct mp_loudness *loudness;
+    struct mp_filter *loudness_filter;
+
+    struct stats_ctx *stats; // for "audio/..." latency stats
 };
 
 /* Note that playback can be paused, stopped, etc. at any time. While paused,
@@ -445,6 +454,7 @@ typedef struct MPContext {
     struct screenshot_ctx *screenshot_ctx;
     struct command_ctx *command_ctx;
     struct encode_lavc_context *encode_lavc_ctx;
+    struct mp_benchmark *benchmark;
 
     struct mp_ipc_ctx *ipc_ctx;
 
@@ -508,6 +518,12 @@ void audio_update_balance(struct MPContext *mpctx);
 void reload_audio_output(struct MPContext *mpctx);
 void audio_start_ao(struct MPContext *mpctx);
 
+// benchmark.c
+void benchmark_init(struct MPContext *mpctx);
+void benchmark_start_file(struct MPContext *mpctx);
+void benchmark_update(struct MPContext *mpctx);
+void benchmark_end_file(struct MPContext *mpctx);
+
 // configfiles.c
 void mp_parse_cfgfiles(struct MPContext *mpctx);
 void mp_load_auto_profiles(struct MPContext *mpctx);
@@ -517,6 +533,12 @@ void mp_write_watch_later_conf(struct MPContext *mpctx);
 void mp_delete_watch_later_conf(struct MPContext *mpctx, const char *file);
 struct playlist_entry *mp_check_playlist_resume(struct MPContext *mpctx,
                                                 struct playlist *playlist);
+struct replaygain_data *mp_load_loudness_cache(void *ta_parent,
+                                               struct MPContext *mpctx,
+                                               struct track *track);
+struct mp_loudness_result;
+void mp_write_loudness_cache(struct MPContext *mpctx, struct track *track,
+                             struct mp_loudness_result *res);
 
 // loadfile.c
 void mp_abort_playback_async(struct MPContext *mpctx);
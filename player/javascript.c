@@ -769,6 +769,32 @@ static void script_get_time_ms(js_State *J)
     js_pushnumber(J, mpv_get_time_us(jclient(J)) / (double)(1000));
 }
 
+// args: none, result: whether handler calls should be timed for script-profile
+static void script__profiling(js_State *J)
+{
+    js_pushboolean(J, stats_handlers_enabled(jctx(J)->stats));
+}
+
+// args: none, result in millisec, or undefined if unknown
+static void script__event_time_ms(js_State *J)
+{
+    int64_t queued = mp_client_get_event_time(jclient(J));
+    if (queued) {
+        js_pushnumber(J, queued / (double)(1000));
+    } else {
+        js_pushundefined(J);
+    }
+}
+
+// args: handler name, start time in ms, event time in ms (optional)
+static void script__record_handler(js_State *J)
+{
+    int64_t start = js_tonumber(J, 2) * 1000;
+    int64_t queued = js_isnumber(J, 3) ? js_tonumber(J, 3) * 1000 : 0;
+    stats_handler(jctx(J)->stats, js_tostring(J, 1), start, queued);
+    js_pushundefined(J); // doesn't touch last_error
+}
+
 // push object with properties names (NULL terminated) with respective vals
 static void push_nums_obj(js_State *J, const char * const names[],
                           const double vals[])
@@ -1159,6 +1185,9 @@ static const struct fn_entry main_fns[] = {
     FN_ENTRY(_observe_property, 3),
     FN_ENTRY(_unobserve_property, 1),
     FN_ENTRY(get_time_ms, 0),
+    FN_ENTRY(_profiling, 0),
+    FN_ENTRY(_event_time_ms, 0),
+    FN_ENTRY(_record_handler, 3),
     AF_ENTRY(format_time, 2),
     FN_ENTRY(enable_messages, 1),
     FN_ENTRY(get_wakeup_pipe, 0),
@@ -42,10 +42,32 @@ mp.unregister_event = function(fn) {
     }
 }
 
+// name of the handlers of an event in the script-profile property
+function handler_name(e) {
+    if (e.event == "property-change")
+        return "property/" + e.name;
+    if (e.event == "client-message" && e.args[0] == "key-binding")
+        return "binding/" + e.args[1];
+    if (e.event == "client-message")
+        return "message/" + e.args[0];
+    return "event/" + e.event;
+}
+
 // call only pre-registered handlers, but not ones which got unregistered
 function dispatch_event(e) {
     var handlers = ehandlers[e.event];
-    if (handlers) {
+    if (handlers && mp._profiling()) {
+        var name = handler_name(e),
+            queued = mp._event_time_ms();
+        for (var len = handlers.length, i = 0; i < len; i++) {
+            var cb = handlers[i].cb;
+            if (cb) {
+                var start = mp.get_time_ms();
+                cb(e);
+                mp._record_handler(name, start, queued);
+            }
+        }
+    } else if (handlers) {
         for (var len = handlers.length, i = 0; i < len; i++) {
             var cb = handlers[i].cb;  // 'handlers' won't mutate, but unregister
             if (cb)                   // could remove cb from some items
@@ -54,17 +76,24 @@ function dispatch_event(e) {
     }
 }
 
+// name of a timer or idle callback in the script-profile property. MuJS can't
+// tell where a function was defined (which the Lua version uses), so use its
+// name. Computed on the first call while profiling, and cached by the caller.
+function callback_name(kind, fn) {
+    return kind + "/" + (fn.name || "anonymous");
+}
+
 //  ----- idle observers -----
-var iobservers = [],  // array of callbacks
+var iobservers = [],  // array of {cb: fn, name: script-profile name or 0}
     ideleted = false;
 
 mp.register_idle = function(fn) {
-    iobservers.push(fn);
+    iobservers.push({cb: fn, name: 0});
 }
 
 mp.unregister_idle = function(fn) {
-    iobservers.forEach(function(f, i) {
-        if (f == fn)
+    iobservers.forEach(function(o, i) {
+        if (o.cb == fn)
              delete iobservers[i];  // -> same length but [more] sparse
     });
     ideleted = true;
@@ -72,7 +101,17 @@ mp.unregister_idle = function(fn) {
 
 function notify_idle_observers() {
     // forEach and filter skip deleted items and newly added items
-    iobservers.forEach(function(f) { f() });
+    if (iobservers.length && mp._profiling()) {
+        iobservers.forEach(function(o) {
+            var start = mp.get_time_ms();
+            o.cb();
+            if (!o.name)
+                o.name = callback_name("idle", o.cb);
+            mp._record_handler(o.name, start);
+        });
+    } else {
+        iobservers.forEach(function(o) { o.cb() });
+    }
     if (ideleted) {
         iobservers = iobservers.filter(function() { return true });
         ideleted = false;
@@ -385,6 +424,7 @@ function set_timer(repeat, args) {
             interval: repeat ? duration : -1,
             callback: (typeof fos == "function") ? fos : Function(fos),
             args: (args.length < 3) ? false : [].slice.call(args, 2),
+            name: 0,  // for script-profile, set on first use
         };
 
     if (tset_is_push) {
@@ -425,17 +465,24 @@ function process_timers() {
     var actives = timers;  // only process those already inserted by now
     timers = [];  // we'll handle added new timers at the end of processing.
     tset_is_push = true;  // signal set_timer to just push-insert
+    var profiling = mp._profiling();
 
     do {
         var t = actives.pop();
         if (tcanceled && tcanceled[t.id])
             continue;
 
+        var start = profiling && now();
         if (t.args) {
             t.callback.apply(null, t.args);
         } else {
             (0, t.callback)();  // faster, nicer stack trace than t.cb.call()
         }
+        if (profiling) {
+            if (!t.name)
+                t.name = callback_name("timer", t.callback);
+            mp._record_handler(t.name, start, t.when);
+        }
 
         if (t.interval >= 0) {
             // allow 20 ms delay/clock-resolution/gc before we skip and reset
@@ -1670,9 +1670,11 @@ static void play_current_file(struct MPContext *mpctx)
     playback_start = mp_time_sec();
     mpctx->error_playing = 0;
     mpctx->in_playloop = true;
+    benchmark_start_file(mpctx);
     while (!mpctx->stop_play)
         run_playloop(mpctx);
     mpctx->in_playloop = false;
+    benchmark_end_file(mpctx);
 
     MP_VERBOSE(mpctx, "EOF code: %d  \n", mpctx->stop_play);
 
@@ -1819,8 +1821,9 @@ struct playlist_entry *mp_next_file(struct MPContext *mpctx, int direction,
         if (!force && next && next->init_failed && !ignore_failures) {
             // Don't endless loop if no file in playlist is playable
             bool all_failed = true;
-            for (int n = 0; n < mpctx->playlist->num_entries; n++) {
-                all_failed &= mpctx->playlist->entries[n]->init_failed;
+            struct playlist_entry *e = playlist_get_first(mpctx->playlist);
+            for (; e; e = playlist_entry_get_rel(e, 1)) {
+                all_failed &= e->init_failed;
                 if (!all_failed)
                     break;
             }
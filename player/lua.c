@@ -174,12 +174,16 @@ static void *mp_lua_alloc(void *ud, void *ptr, size_t osize, size_t nsize)
     if (!ptr)
         osize = 0;
 
+    void *old = ptr;
     ptr = ctx->lua_allocf(ctx->lua_alloc_ud, ptr, osize, nsize);
     if (nsize && !ptr)
         return NULL; // allocation failed, so original memory left untouched
 
     ctx->lua_malloc_size = ctx->lua_malloc_size - osize + nsize;
     stats_size_value(ctx->stats, "mem", ctx->lua_malloc_size);
+    // (Runs on the script thread, so it goes to the script's tag.)
+    ta_acct_add_external((long long)nsize - (long long)osize,
+                         (!old && nsize) - (old && !nsize));
 
     return ptr;
 }
@@ -554,8 +558,15 @@ static int script_raw_wait_event(lua_State *L, void *tmp)
 
     pushnode(L, &rn); // event
 
-    // return event
-    return 1;
+    if (!stats_handlers_enabled(ctx->stats))
+        return 1; // return event
+
+    // 0 if unknown
+    int64_t queued = mp_client_get_event_time(ctx->client);
+    lua_pushnumber(L, queued / (double)(1000 * 1000)); // event time
+
+    // return event, time
+    return 2;
 }
 
 static int script_request_event(lua_State *L)
@@ -997,6 +1008,16 @@ static int script_get_time(lua_State *L)
     return 1;
 }
 
+static int script_raw_record_handler(lua_State *L)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    const char *name = luaL_checkstring(L, 1);
+    int64_t start = luaL_checknumber(L, 2) * (1000 * 1000);
+    int64_t queued = luaL_optnumber(L, 3, 0) * (1000 * 1000);
+    stats_handler(ctx->stats, name, start, queued);
+    return 0;
+}
+
 static int script_input_set_section_mouse_area(lua_State *L)
 {
     struct MPContext *mpctx = get_mpctx(L);
@@ -1145,23 +1166,81 @@ static int script_join_path(lua_State *L)
     return 1;
 }
 
+// Push the JSON value starting with tok, like pushnode() would push the result
+// of json_parse(). Returns false on syntax errors.
+static bool pushjson(lua_State *L, struct json_tokenizer *t,
+                     struct json_token *tok)
+{
+    luaL_checkstack(L, 6, "stack overflow");
+
+    switch (tok->type) {
+    case JSON_TOKEN_STRING:
+        lua_pushstring(L, tok->u.string);
+        return true;
+    case JSON_TOKEN_INT64:
+        lua_pushnumber(L, tok->u.int64);
+        return true;
+    case JSON_TOKEN_DOUBLE:
+        lua_pushnumber(L, tok->u.double_);
+        return true;
+    case JSON_TOKEN_NULL:
+        lua_pushnil(L);
+        return true;
+    case JSON_TOKEN_FLAG:
+        lua_pushboolean(L, tok->u.flag);
+        return true;
+    case JSON_TOKEN_ARRAY_START:
+    case JSON_TOKEN_MAP_START: {
+        bool is_obj = tok->type == JSON_TOKEN_MAP_START;
+        int end = is_obj ? JSON_TOKEN_MAP_END : JSON_TOKEN_ARRAY_END;
+        lua_newtable(L); // table
+        lua_getfield(L, LUA_REGISTRYINDEX, is_obj ? "MAP" : "ARRAY"); // table mt
+        lua_setmetatable(L, -2); // table
+        for (int n = 1; ; n++) {
+            struct json_token item;
+            int r = json_next_token(t, &item);
+            if (r == end)
+                return true;
+            if (is_obj && r >= 0)
+                lua_pushstring(L, item.key); // table key
+            if (r < 0 || !pushjson(L, t, &item))
+                return false;
+            if (is_obj) {
+                lua_rawset(L, -3); // table
+            } else {
+                lua_rawseti(L, -2, n); // table
+            }
+        }
+    }
+    default:
+        return false;
+    }
+}
+
 static int script_parse_json(lua_State *L, void *tmp)
 {
     mp_lua_optarg(L, 2);
     char *text = talloc_strdup(tmp, luaL_checkstring(L, 1));
     bool trail = lua_toboolean(L, 2);
     bool ok = false;
-    struct mpv_node node;
-    if (json_parse(tmp, &node, &text, 32) >= 0) {
+    // Convert directly to Lua values, instead of creating a mpv_node first.
+    struct json_tokenizer t;
+    json_tokenizer_init(&t, tmp, text, 32);
+    struct json_token tok;
+    json_next_token(&t, &tok);
+    int top = lua_gettop(L);
+    if (pushjson(L, &t, &tok)) {
+        text = t.src;
         json_skip_whitespace(&text);
         ok = !text[0] || trail;
     }
     if (ok) {
-        pushnode(L, &node);
         lua_pushnil(L);
     } else {
+        lua_settop(L, top);
         lua_pushnil(L);
         lua_pushstring(L, "error");
+        text = t.src;
     }
     lua_pushstring(L, text);
     return 3;
@@ -1226,6 +1305,7 @@ static const struct fn_entry main_fns[] = {
     FN_ENTRY(raw_observe_property),
     FN_ENTRY(raw_unobserve_property),
     FN_ENTRY(get_time),
+    FN_ENTRY(raw_record_handler),
     FN_ENTRY(input_set_section_mouse_area),
     FN_ENTRY(format_time),
     FN_ENTRY(enable_messages),
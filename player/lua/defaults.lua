@@ -330,6 +330,29 @@ function mp.get_next_timeout()
     return timer.next_deadline - now
 end
 
+-- Whether handler calls are timed for the script-profile property. Updated by
+-- mp.wait_event(), since the C side returns the event time only if enabled.
+local profiling = false
+
+-- Name of a timer or idle callback in the script-profile property, which is
+-- its kind plus the location where the function was defined.
+local callback_names = setmetatable({}, { __mode = "k" })
+
+local function callback_name(kind, cb)
+    local names = callback_names[cb]
+    if not names then
+        names = {}
+        callback_names[cb] = names
+    end
+    local name = names[kind]
+    if not name then
+        local info = debug.getinfo(cb, "S")
+        name = kind .. "/" .. info.short_src .. ":" .. info.linedefined
+        names[kind] = name
+    end
+    return name
+end
+
 -- Run timers that have met their deadline.
 -- Return: next absolute time a timer expires as number, or nil if no timers
 local function process_timers()
@@ -343,12 +366,17 @@ local function process_timers()
         if wait > 0 then
             return wait
         else
+            local deadline = timer.next_deadline
             if timer.oneshot then
                 timer:kill()
             else
                 timer.next_deadline = now + timer.timeout
             end
             timer.cb()
+            if profiling then
+                mp.raw_record_handler(callback_name("timer", timer.cb), now,
+                                      deadline)
+            end
         end
     end
 end
@@ -480,8 +508,14 @@ _G.print = mp.msg.info
 package.loaded["mp"] = mp
 package.loaded["mp.msg"] = mp.msg
 
+-- time at which the event last returned by mp.wait_event() was queued (0 if
+-- unknown), or nil if profiling is disabled
+local event_time
+
 function mp.wait_event(t)
-    local r = mp.raw_wait_event(t)
+    local r
+    r, event_time = mp.raw_wait_event(t)
+    profiling = event_time ~= nil
     if r and r.file_error and not r.error then
         -- compat; deprecated
         r.error = r.file_error
@@ -493,9 +527,28 @@ _G.mp_event_loop = function()
     mp.dispatch_events(true)
 end
 
+-- Name of the handlers of an event in the script-profile property.
+local function handler_name(e)
+    if e.event == "property-change" then
+        return "property/" .. e.name
+    elseif e.event == "client-message" and e.args[1] == "key-binding" then
+        return "binding/" .. tostring(e.args[2])
+    elseif e.event == "client-message" then
+        return "message/" .. tostring(e.args[1])
+    end
+    return "event/" .. e.event
+end
+
 local function call_event_handlers(e)
     local handlers = event_handlers[e.event]
-    if handlers then
+    if handlers and profiling then
+        local name, queued = handler_name(e), event_time
+        for _, handler in ipairs(handlers) do
+            local start = mp.get_time()
+            handler(e)
+            mp.raw_record_handler(name, start, queued)
+        end
+    elseif handlers then
         for _, handler in ipairs(handlers) do
             handler(e)
         end
@@ -519,7 +572,13 @@ function mp.dispatch_events(allow_wait)
         if not more_events then
             wait = process_timers() or 1e20 -- infinity for all practical purposes
             for _, handler in ipairs(idle_handlers) do
-                handler()
+                if profiling then
+                    local start = mp.get_time()
+                    handler()
+                    mp.raw_record_handler(callback_name("idle", handler), start)
+                else
+                    handler()
+                end
             end
             -- Resume playloop - important especially if an error happened while
             -- suspended, and the error was handled, but no resume was done.
@@ -264,6 +264,8 @@ struct MPContext *mp_create(void)
         .play_dir = 1,
     };
 
+    mpctx->playlist->track_changes = true;
+
     pthread_mutex_init(&mpctx->abort_lock, NULL);
 
     mpctx->global = talloc_zero(mpctx, struct mpv_global);
@@ -353,6 +355,12 @@ int mp_initialize(struct MPContext *mpctx, char **options)
         m_config_set_profile(mpctx->mconfig, "pseudo-gui", 0);
     }
 
+    if (opts->benchmark_file && opts->benchmark_file[0]) {
+        m_config_set_profile(mpctx->mconfig, "builtin-benchmark",
+                             M_SETOPT_NO_OVERWRITE);
+        benchmark_init(mpctx);
+    }
+
     mp_get_resume_defaults(mpctx);
 
     mp_input_load_config(mpctx->input);
@@ -415,6 +423,9 @@ int mp_initialize(struct MPContext *mpctx, char **options)
 
 int mpv_main(int argc, char *argv[])
 {
+    // Like core_thread() does for libmpv (the main thread is not renamed).
+    ta_acct_set_thread_tag("mpv core");
+
     struct MPContext *mpctx = mp_create();
     if (!mpctx)
         return 1;
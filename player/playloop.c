@@ -1208,6 +1208,8 @@ void run_playloop(struct MPContext *mpctx)
 
     handle_playback_restart(mpctx);
 
+    benchmark_update(mpctx);
+
     handle_playback_time(mpctx);
 
     handle_dummy_ticks(mpctx);
@@ -98,7 +98,7 @@ static bool update_subtitle(struct MPContext *mpctx, double video_pts,
         // Assume fully_read implies no interleaved audio/video streams.
         // (Reading packets will change the demuxer position.)
         demux_seek(track->demuxer, 0, 0);
-        sub_preload(dec_sub);
+        sub_preload(dec_sub, video_pts);
     }
 
     if (!sub_read_packets(dec_sub, video_pts))
@@ -30,6 +30,7 @@
 #include "options/m_option.h"
 #include "common/common.h"
 #include "common/encode.h"
+#include "common/stats.h"
 #include "options/m_property.h"
 #include "osdep/timer.h"
 
@@ -246,6 +247,7 @@ void reinit_video_chain_src(struct MPContext *mpctx, struct track *track)
     mpctx->vo_chain = vo_c;
     vo_c->log = mpctx->log;
     vo_c->vo = mpctx->video_out;
+    vo_c->stats = stats_ctx_create(vo_c, mpctx->global, "video");
     vo_c->filter =
         mp_output_chain_create(mpctx->filter_root, MP_OUTPUT_CHAIN_VIDEO);
     mp_output_chain_set_vo(vo_c->filter, vo_c->vo);
@@ -505,6 +507,8 @@ static int video_output_image(struct MPContext *mpctx, bool *logical_eof)
             r = VD_EOF;
         } else if (frame.type == MP_FRAME_VIDEO) {
             img = frame.data;
+            stats_latency(vo_c->stats, "decode-filter", img->stage_time);
+            img->stage_time = mp_time_us();
         } else {
             MP_ERR(mpctx, "unexpected frame type %s\n",
                    mp_frame_type_str(frame.type));
@@ -1203,6 +1207,10 @@ void write_video(struct MPContext *mpctx)
     mpctx->osd_force_update = true;
     update_osd_msg(mpctx);
 
+    struct mp_image *cur = frame->frames[0];
+    stats_latency(vo_c->stats, "filter-queue", cur->stage_time);
+    cur->stage_time = mp_time_us();
+
     vo_queue_frame(vo, frame);
 
     check_framedrop(mpctx, vo_c);
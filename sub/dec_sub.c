@@ -32,7 +32,9 @@
 #include "common/msg.h"
 #include "common/recorder.h"
 #include "misc/dispatch.h"
+#include "osdep/atomic.h"
 #include "osdep/threads.h"
+#include "osdep/timer.h"
 
 extern const struct sd_functions sd_ass;
 extern const struct sd_functions sd_lavc;
@@ -45,6 +47,8 @@ static const struct sd_functions *const sd_list[] = {
 
 struct dec_sub {
     pthread_mutex_t lock;
+    atomic_int lock_waiters;        // threads waiting in lock_sub()
+    pthread_cond_t preload_wakeup;  // signaled when lock_waiters drops to 0
 
     struct mp_log *log;
     struct mpv_global *global;
@@ -69,8 +73,21 @@ struct dec_sub {
     struct sd *sd;
 
     struct demux_packet *new_segment;
+
+    // Background preloading (see sub_preload()). The packets are decoded by
+    // preload_thread in short batches with the lock held.
+    pthread_t preload_thread;
+    bool preload_thread_valid;
+    bool preload_abort;
+    struct demux_packet **preload_packets;
+    int num_preload_packets;
+    int preload_start;      // index of the first packet to decode
+    int preload_pos;        // number of packets decoded so far
 };
 
+// Maximum time the preload thread holds the lock at once.
+#define PRELOAD_BATCH_US 2000
+
 static void update_subtitle_speed(struct dec_sub *sub)
 {
     struct mp_subtitle_opts *opts = sub->opts;
@@ -115,10 +132,36 @@ static void wakeup_demux(void *ctx)
     mp_dispatch_interrupt(q);
 }
 
+// Lock sub->lock. The preload thread lets threads that wait here go first.
+static void lock_sub(struct dec_sub *sub)
+{
+    atomic_fetch_add(&sub->lock_waiters, 1);
+    pthread_mutex_lock(&sub->lock);
+    if (atomic_fetch_add(&sub->lock_waiters, -1) == 1)
+        pthread_cond_signal(&sub->preload_wakeup);
+}
+
+static void stop_preload(struct dec_sub *sub)
+{
+    lock_sub(sub);
+    sub->preload_abort = true;
+    pthread_mutex_unlock(&sub->lock);
+    if (sub->preload_thread_valid)
+        pthread_join(sub->preload_thread, NULL);
+    sub->preload_thread_valid = false;
+    for (int n = sub->preload_pos; n < sub->num_preload_packets; n++) {
+        int i = (sub->preload_start + n) % sub->num_preload_packets;
+        talloc_free(sub->preload_packets[i]);
+    }
+    TA_FREEP(&sub->preload_packets);
+    sub->num_preload_packets = sub->preload_pos = 0;
+}
+
 void sub_destroy(struct dec_sub *sub)
 {
     if (!sub)
         return;
+    stop_preload(sub);
     demux_set_stream_wakeup_cb(sub->sh, NULL, NULL);
     if (sub->sd) {
         sub_reset(sub);
@@ -126,6 +169,7 @@ void sub_destroy(struct dec_sub *sub)
     }
     talloc_free(sub->sd);
     pthread_mutex_destroy(&sub->lock);
+    pthread_cond_destroy(&sub->preload_wakeup);
     talloc_free(sub);
 }
 
@@ -166,6 +210,7 @@ struct dec_sub *sub_create(struct mpv_global *global, struct sh_stream *sh,
     assert(sh && sh->type == STREAM_SUB);
 
     struct dec_sub *sub = talloc(NULL, struct dec_sub);
+    ta_acct_set_tag(sub, "subtitles");
     *sub = (struct dec_sub){
         .log = mp_log_new(sub, global->log, "sub"),
         .global = global,
@@ -181,6 +226,7 @@ struct dec_sub *sub_create(struct mpv_global *global, struct sh_stream *sh,
     };
     sub->opts = sub->opts_cache->opts;
     mpthread_mutex_init_recursive(&sub->lock);
+    pthread_cond_init(&sub->preload_wakeup, NULL);
 
     sub->sd = init_decoder(sub);
     if (sub->sd) {
@@ -224,21 +270,68 @@ static void update_segment(struct dec_sub *sub)
 bool sub_can_preload(struct dec_sub *sub)
 {
     bool r;
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     r = sub->sd->driver->accept_packets_in_advance && !sub->preload_attempted;
     pthread_mutex_unlock(&sub->lock);
     return r;
 }
 
-void sub_preload(struct dec_sub *sub)
+// Decode the next preload packets, until the batch time is up. Returns false
+// if there is nothing left to do. Called locked.
+static bool preload_batch(struct dec_sub *sub)
 {
+    int64_t end = mp_time_us() + PRELOAD_BATCH_US;
+    while (!sub->preload_abort && sub->preload_pos < sub->num_preload_packets) {
+        int i = (sub->preload_start + sub->preload_pos) %
+                sub->num_preload_packets;
+        struct demux_packet *pkt = sub->preload_packets[i];
+        sub->preload_packets[i] = NULL;
+        sub->preload_pos++;
+        sub->sd->driver->decode(sub->sd, pkt);
+        talloc_free(pkt);
+        if (mp_time_us() >= end)
+            return true;
+    }
+    return false;
+}
+
+static void *preload_thread(void *p)
+{
+    struct dec_sub *sub = p;
+    mpthread_set_name("subpreload");
+
+    int64_t start = mp_time_us();
     pthread_mutex_lock(&sub->lock);
+    while (preload_batch(sub)) {
+        // Let the player render from what was loaded so far. Unlocking alone
+        // would allow this thread to take the lock again right away.
+        while (atomic_load(&sub->lock_waiters))
+            pthread_cond_wait(&sub->preload_wakeup, &sub->lock);
+    }
+    if (sub->preload_pos == sub->num_preload_packets) {
+        MP_VERBOSE(sub, "Preloaded %d packets in %.3f seconds.\n",
+                   sub->preload_pos, (mp_time_us() - start) / 1e6);
+        TA_FREEP(&sub->preload_packets);
+    }
+    pthread_mutex_unlock(&sub->lock);
+    return NULL;
+}
+
+// Read all packets (the caller must have checked sub_can_preload()), and decode
+// them on a separate thread. Until that is done, rendering uses the subset of
+// packets decoded so far. Decoding starts with the packets at video_pts.
+void sub_preload(struct dec_sub *sub, double video_pts)
+{
+    lock_sub(sub);
 
     struct mp_dispatch_queue *demux_waiter = mp_dispatch_create(NULL);
     demux_set_stream_wakeup_cb(sub->sh, wakeup_demux, demux_waiter);
 
     sub->preload_attempted = true;
 
+    // Reading only copies the packets, which the demuxer already holds in
+    // memory (sub_can_preload() is used with fully read demuxers only).
+    // Doing this on the calling thread keeps the demuxer single-threaded.
     for (;;) {
         struct demux_packet *pkt = NULL;
         int r = demux_read_packet_async(sub->sh, &pkt);
@@ -248,16 +341,56 @@ void sub_preload(struct dec_sub *sub)
         }
         if (!pkt)
             break;
-        sub->sd->driver->decode(sub->sd, pkt);
-        talloc_free(pkt);
+        MP_TARRAY_APPEND(sub, sub->preload_packets, sub->num_preload_packets,
+                         pkt);
     }
 
     demux_set_stream_wakeup_cb(sub->sh, NULL, NULL);
     talloc_free(demux_waiter);
 
+    // Start with the first packet that may be visible at video_pts. The
+    // packets before it are decoded last, unless the decoder needs them in
+    // order.
+    bool ordered = false;
+    if (sub->sd->driver->control) {
+        sub->sd->driver->control(sub->sd, SD_CTRL_NEEDS_ORDERED_PACKETS,
+                                 &ordered);
+    }
+    video_pts = pts_to_subtitle(sub, video_pts);
+    int start = 0;
+    while (!ordered && video_pts != MP_NOPTS_VALUE &&
+           start < sub->num_preload_packets)
+    {
+        struct demux_packet *pkt = sub->preload_packets[start];
+        if (pkt->pts == MP_NOPTS_VALUE || pkt->duration < 0 ||
+            pkt->pts + pkt->duration > video_pts)
+            break;
+        start++;
+    }
+    sub->preload_start = start < sub->num_preload_packets ? start : 0;
+    sub->preload_pos = 0;
+
+    if (sub->num_preload_packets) {
+        sub->preload_thread_valid =
+            !pthread_create(&sub->preload_thread, NULL, preload_thread, sub);
+        if (!sub->preload_thread_valid) {
+            while (preload_batch(sub)) {}
+        }
+    }
+
     pthread_mutex_unlock(&sub->lock);
 }
 
+double sub_get_preload_progress(struct dec_sub *sub)
+{
+    lock_sub(sub);
+    double r = -1;
+    if (sub->num_preload_packets)
+        r = sub->preload_pos / (double)sub->num_preload_packets;
+    pthread_mutex_unlock(&sub->lock);
+    return r;
+}
+
 static bool is_new_segment(struct dec_sub *sub, struct demux_packet *p)
 {
     return p->segmented &&
@@ -270,7 +403,7 @@ static bool is_new_segment(struct dec_sub *sub, struct demux_packet *p)
 bool sub_read_packets(struct dec_sub *sub, double video_pts)
 {
     bool r = true;
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     video_pts = pts_to_subtitle(sub, video_pts);
     while (1) {
         bool read_more = true;
@@ -329,7 +462,7 @@ bool sub_read_packets(struct dec_sub *sub, double video_pts)
 struct sub_bitmaps *sub_get_bitmaps(struct dec_sub *sub, struct mp_osd_res dim,
                                     int format, double pts)
 {
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
 
     struct mp_subtitle_opts *opts = sub->opts;
 
@@ -351,7 +484,7 @@ struct sub_bitmaps *sub_get_bitmaps(struct dec_sub *sub, struct mp_osd_res dim,
 // The returned string is talloc'ed.
 char *sub_get_text(struct dec_sub *sub, double pts, enum sd_text_type type)
 {
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     char *text = NULL;
 
     pts = pts_to_subtitle(sub, pts);
@@ -367,7 +500,7 @@ char *sub_get_text(struct dec_sub *sub, double pts, enum sd_text_type type)
 
 struct sd_times sub_get_times(struct dec_sub *sub, double pts)
 {
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     struct sd_times res = { .start = MP_NOPTS_VALUE, .end = MP_NOPTS_VALUE };
 
     pts = pts_to_subtitle(sub, pts);
@@ -384,19 +517,26 @@ struct sd_times sub_get_times(struct dec_sub *sub, double pts)
 
 void sub_reset(struct dec_sub *sub)
 {
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     if (sub->sd->driver->reset)
         sub->sd->driver->reset(sub->sd);
+    // If the decoder dropped the preloaded packets, the rest of them would be
+    // duplicates of what is now read from the demuxer.
+    bool drop_preload = !sub->sd->preload_ok;
+    if (drop_preload)
+        sub->preload_abort = true;
     sub->last_pkt_pts = MP_NOPTS_VALUE;
     sub->last_vo_pts = MP_NOPTS_VALUE;
     talloc_free(sub->new_segment);
     sub->new_segment = NULL;
     pthread_mutex_unlock(&sub->lock);
+    if (drop_preload)
+        stop_preload(sub);
 }
 
 void sub_select(struct dec_sub *sub, bool selected)
 {
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     if (sub->sd->driver->select)
         sub->sd->driver->select(sub->sd, selected);
     pthread_mutex_unlock(&sub->lock);
@@ -405,7 +545,7 @@ void sub_select(struct dec_sub *sub, bool selected)
 int sub_control(struct dec_sub *sub, enum sd_ctrl cmd, void *arg)
 {
     int r = CONTROL_UNKNOWN;
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     bool propagate = false;
     switch (cmd) {
     case SD_CTRL_SET_VIDEO_DEF_FPS:
@@ -438,14 +578,14 @@ int sub_control(struct dec_sub *sub, enum sd_ctrl cmd, void *arg)
 
 void sub_set_recorder_sink(struct dec_sub *sub, struct mp_recorder_sink *sink)
 {
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     sub->recorder_sink = sink;
     pthread_mutex_unlock(&sub->lock);
 }
 
 void sub_set_play_dir(struct dec_sub *sub, int dir)
 {
-    pthread_mutex_lock(&sub->lock);
+    lock_sub(sub);
     sub->play_dir = dir;
     pthread_mutex_unlock(&sub->lock);
 }
@@ -20,6 +20,7 @@ enum sd_ctrl {
     SD_CTRL_SET_TOP,
     SD_CTRL_SET_VIDEO_DEF_FPS,
     SD_CTRL_UPDATE_OPTS,
+    SD_CTRL_NEEDS_ORDERED_PACKETS,  // bool*: must decode in pts order
 };
 
 enum sd_text_type {
@@ -42,7 +43,8 @@ struct dec_sub *sub_create(struct mpv_global *global, struct sh_stream *sh,
 void sub_destroy(struct dec_sub *sub);
 
 bool sub_can_preload(struct dec_sub *sub);
-void sub_preload(struct dec_sub *sub);
+void sub_preload(struct dec_sub *sub, double video_pts);
+double sub_get_preload_progress(struct dec_sub *sub);
 bool sub_read_packets(struct dec_sub *sub, double video_pts);
 struct sub_bitmaps *sub_get_bitmaps(struct dec_sub *sub, struct mp_osd_res dim,
                                     int format, double pts);
@@ -120,6 +120,7 @@ struct osd_state *osd_create(struct mpv_global *global)
     assert(MAX_OSD_PARTS >= OSDTYPE_COUNT);
 
     struct osd_state *osd = talloc_zero(NULL, struct osd_state);
+    ta_acct_set_tag(osd, "osd");
     *osd = (struct osd_state) {
         .opts_cache = m_config_cache_alloc(osd, global, &mp_osd_render_sub_opts),
         .global = global,
@@ -54,7 +54,10 @@ struct sd_ass_priv {
     char last_text[500];
     struct mp_image_params video_params;
     struct mp_image_params last_params;
+    // Hash set of the demux_packet.pos values of the packets decoded so far.
+    // Open addressing with linear probing; free slots are -1.
     int64_t *seen_packets;
+    int seen_packets_size;  // power of 2, or 0
     int num_seen_packets;
     bool duration_unknown;
 };
@@ -300,35 +303,68 @@ static void filter_and_add(struct sd *sd, struct demux_packet *pkt)
         talloc_free(pkt);
 }
 
+// Return the slot of pos in the seen_packets hash set, or the free slot where
+// it would be inserted.
+static int64_t *find_seen_slot(int64_t *set, int size, int64_t pos)
+{
+    unsigned mask = size - 1;
+    unsigned n = ((uint64_t)pos * 0x9E3779B97F4A7C15ULL) >> 32;
+    while (set[n & mask] != pos && set[n & mask] >= 0)
+        n++;
+    return &set[n & mask];
+}
+
 // Test if the packet with the given file position (used as unique ID) was
 // already consumed. Return false if the packet is new (and add it to the
-// internal list), and return true if it was already seen.
+// internal set), and return true if it was already seen.
 static bool check_packet_seen(struct sd *sd, int64_t pos)
 {
     struct sd_ass_priv *priv = sd->priv;
-    int a = 0;
-    int b = priv->num_seen_packets;
-    while (a < b) {
-        int mid = a + (b - a) / 2;
-        int64_t val = priv->seen_packets[mid];
-        if (pos == val)
-            return true;
-        if (pos > val) {
-            a = mid + 1;
-        } else {
-            b = mid;
+    assert(pos >= 0);
+
+    if (priv->num_seen_packets * 2 >= priv->seen_packets_size) {
+        int old_size = priv->seen_packets_size;
+        int64_t *old = priv->seen_packets;
+        priv->seen_packets_size = MPMAX(old_size * 2, 256);
+        priv->seen_packets = talloc_array(priv, int64_t,
+                                          priv->seen_packets_size);
+        memset(priv->seen_packets, 0xFF,
+               priv->seen_packets_size * sizeof(int64_t));
+        for (int n = 0; n < old_size; n++) {
+            if (old[n] >= 0) {
+                *find_seen_slot(priv->seen_packets, priv->seen_packets_size,
+                                old[n]) = old[n];
+            }
         }
+        talloc_free(old);
     }
-    MP_TARRAY_INSERT_AT(priv, priv->seen_packets, priv->num_seen_packets, a, pos);
+
+    int64_t *slot = find_seen_slot(priv->seen_packets, priv->seen_packets_size,
+                                   pos);
+    if (*slot == pos)
+        return true;
+    *slot = pos;
+    priv->num_seen_packets++;
     return false;
 }
 
+static void clear_seen_packets(struct sd_ass_priv *priv)
+{
+    if (priv->num_seen_packets) {
+        memset(priv->seen_packets, 0xFF,
+               priv->seen_packets_size * sizeof(int64_t));
+        priv->num_seen_packets = 0;
+    }
+}
+
 #define UNKNOWN_DURATION (INT_MAX / 1000)
 
 static void decode(struct sd *sd, struct demux_packet *packet)
 {
     struct sd_ass_priv *ctx = sd->priv;
     ASS_Track *track = ctx->ass_track;
+    // All events before the last one already have known durations.
+    int first_unknown = MPMAX(track->n_events - 1, 0);
     if (ctx->converter) {
         if (!sd->opts->sub_clear_on_seek && packet->pos >= 0 &&
             check_packet_seen(sd, packet->pos))
@@ -356,7 +392,7 @@ static void decode(struct sd *sd, struct demux_packet *packet)
             filter_and_add(sd, &pkt2);
         }
         if (ctx->duration_unknown) {
-            for (int n = 0; n < track->n_events - 1; n++) {
+            for (int n = first_unknown; n < track->n_events - 1; n++) {
                 if (track->events[n].Duration == UNKNOWN_DURATION * 1000) {
                     track->events[n].Duration = track->events[n + 1].Start -
                                                 track->events[n].Start;
@@ -558,7 +594,7 @@ static struct sub_bitmaps *get_bitmaps(struct sd *sd, struct mp_osd_res dim,
     long long ts = find_timestamp(sd, pts);
     if (ctx->duration_unknown && pts != MP_NOPTS_VALUE) {
         mp_ass_flush_old_events(track, ts);
-        ctx->num_seen_packets = 0;
+        clear_seen_packets(ctx);
         sd->preload_ok = false;
     }
 
@@ -769,7 +805,7 @@ static void reset(struct sd *sd)
     struct sd_ass_priv *ctx = sd->priv;
     if (sd->opts->sub_clear_on_seek || ctx->duration_unknown || ctx->clear_once) {
         ass_flush_events(ctx->ass_track);
-        ctx->num_seen_packets = 0;
+        clear_seen_packets(ctx);
         sd->preload_ok = false;
         ctx->clear_once = false;
     }
@@ -807,6 +843,11 @@ static int control(struct sd *sd, enum sd_ctrl cmd, void *arg)
     case SD_CTRL_SET_TOP:
         ctx->on_top = *(bool *)arg;
         return CONTROL_OK;
+    case SD_CTRL_NEEDS_ORDERED_PACKETS:
+        // Converted subtitles can have unknown durations, which decode() sets
+        // from the start of the next event.
+        *(bool *)arg = !!ctx->converter;
+        return CONTROL_OK;
     case SD_CTRL_UPDATE_OPTS: {
         int flags = (uintptr_t)arg;
         if (flags & UPDATE_SUB_FILT) {
@@ -14,9 +14,13 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <pthread.h>
+
+#include "osdep/atomic.h"
 
 #define TA_NO_WRAPPERS
 #include "ta.h"
@@ -41,7 +45,12 @@ struct ta_header {
     // Invariant: parent==NULL || parent->child==this
     struct ta_header *child;    // points to first child
     struct ta_header *parent;   // set for _first_ child only, NULL otherwise
-    void (*destructor)(void *);
+    union {
+        void (*destructor)(void *);
+        // Allocations within an arena (SIZE_IN_ARENA) keep their destructor
+        // in the arena's destructor list instead.
+        struct ta_arena *arena;
+    };
 #if TA_MEMORY_DEBUGGING
     unsigned int canary;
     struct ta_header *leak_next;
@@ -65,9 +74,79 @@ union aligned_header {
 #define PTR_TO_HEADER(ptr) (&((union aligned_header *)(ptr) - 1)->ta)
 #define PTR_FROM_HEADER(h) ((void *)((union aligned_header *)(h) + 1))
 
-#define MAX_ALLOC (((size_t)-1) - sizeof(union aligned_header))
+// Set in ta_header.size for the arena allocation itself. It is preceded by a
+// pointer to the arena.
+#define SIZE_ARENA ((size_t)1 << (sizeof(size_t) * 8 - 1))
+// Set in ta_header.size for allocations within an arena. These use
+// ta_header.arena instead of ta_header.destructor, so they need no more memory
+// than the header.
+#define SIZE_IN_ARENA ((size_t)1 << (sizeof(size_t) * 8 - 2))
+// Set together with SIZE_IN_ARENA if the arena's destructor list has a
+// destructor for the allocation.
+#define SIZE_DESTRUCTOR ((size_t)1 << (sizeof(size_t) * 8 - 3))
+
+// On 64 bit systems, the bits below SIZE_DESTRUCTOR store the accounting tag
+// (see ta_acct_set_tag()). Tag 0 means the allocation is not accounted.
+#if SIZE_MAX > UINT32_MAX
+#define SIZE_TAG_SHIFT (sizeof(size_t) * 8 - 11)
+#define SIZE_TAG ((size_t)(TA_ACCT_MAX_TAGS - 1) << SIZE_TAG_SHIFT)
+#else
+#define SIZE_TAG_SHIFT 0
+#define SIZE_TAG ((size_t)0)
+#endif
+
+#define SIZE_FLAGS (SIZE_ARENA | SIZE_IN_ARENA | SIZE_DESTRUCTOR | SIZE_TAG)
+
+union aligned_arena_ptr {
+    struct ta_arena *arena;
+    char align_min[MIN_ALIGN];
+};
+
+#define ARENA_PTR(h) (((union aligned_arena_ptr *)(h) - 1)->arena)
+
+#define ALIGN_SIZE(s) (((s) + MIN_ALIGN - 1) & ~(size_t)(MIN_ALIGN - 1))
+
+// Size of the memory block embedded in the arena allocation itself.
+#define ARENA_INITIAL_SIZE 1024
+// Further blocks start with this size, and double up to ARENA_MAX_BLOCK.
+#define ARENA_MIN_BLOCK 4096
+#define ARENA_MAX_BLOCK (64 * 1024)
+
+#define MAX_ALLOC (~SIZE_FLAGS - ARENA_INITIAL_SIZE - 4 * MIN_ALIGN - \
+                   sizeof(union aligned_header) - sizeof(struct ta_arena))
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+};
+
+union aligned_arena_block {
+    struct arena_block b;
+    char align_min[(sizeof(struct arena_block) + MIN_ALIGN - 1) & ~(MIN_ALIGN - 1)];
+};
+
+struct arena_destructor {
+    struct arena_destructor *next;
+    struct ta_header *h;
+    void (*destructor)(void *);     // NULL if it was run or unset
+};
+
+struct ta_arena {
+    struct ta_header *root;         // the arena allocation itself
+    char *pos, *end;                // unused part of the current block
+    char *initial;                  // start of the embedded block
+    struct ta_header *last;         // most recent allocation, if at pos
+    struct arena_block *blocks;     // additionally allocated blocks
+    size_t next_block_size;
+    // Allocations with destructors, in the order they were set.
+    struct arena_destructor *destructors, **destructors_tail;
+    // Whether a non-arena allocation was made a child of an arena allocation.
+    bool has_foreign;
+};
 
 static void ta_dbg_add(struct ta_header *h);
+static void ta_dbg_add_arena(struct ta_header *h);
+static void ta_dbg_add_block(size_t size);
 static void ta_dbg_check_header(struct ta_header *h);
 static void ta_dbg_remove(struct ta_header *h);
 
@@ -78,20 +157,141 @@ static struct ta_header *get_header(void *ptr)
     return h;
 }
 
-/* Set the parent allocation of ptr. If parent==NULL, remove the parent.
- * Setting parent==NULL (with ptr!=NULL) unsets the parent of ptr.
- * With ptr==NULL, the function does nothing.
- *
- * Warning: if ta_parent is a direct or indirect child of ptr, things will go
- *          wrong. The function will apparently succeed, but creates circular
- *          parent links, which are not allowed.
- */
-void ta_set_parent(void *ptr, void *ta_parent)
+static size_t get_size(struct ta_header *h)
+{
+    return h->size & ~SIZE_FLAGS;
+}
+
+static void set_size(struct ta_header *h, size_t size)
+{
+    h->size = size | (h->size & SIZE_FLAGS);
+}
+
+static struct ta_arena *get_arena(struct ta_header *h)
+{
+    if (!h)
+        return NULL;
+    if (h->size & SIZE_IN_ARENA)
+        return h->arena;
+    return (h->size & SIZE_ARENA) ? ARENA_PTR(h) : NULL;
+}
+
+// Whether the memory of h is owned by an arena (i.e. h is not the arena
+// allocation itself).
+static bool in_arena(struct ta_header *h)
+{
+    return h && (h->size & SIZE_IN_ARENA);
+}
+
+// The destructor list entry of an allocation within an arena.
+static struct arena_destructor *find_arena_destructor(struct ta_header *h)
+{
+    if (!(h->size & SIZE_DESTRUCTOR))
+        return NULL;
+    // (Entries of freed allocations remain, but have no destructor.)
+    for (struct arena_destructor *d = h->arena->destructors; d; d = d->next) {
+        if (d->h == h && d->destructor)
+            return d;
+    }
+    abort();
+}
+
+// Start of the memory block returned by malloc() for non-arena allocations.
+static void *get_alloc_start(struct ta_header *h)
+{
+    if (!(h->size & SIZE_ARENA))
+        return h;
+    return (char *)h - sizeof(union aligned_arena_ptr) -
+           ALIGN_SIZE(sizeof(struct ta_arena));
+}
+
+struct acct_tag {
+    const char *name;
+    mp_atomic_int64 bytes;
+    mp_atomic_int64 count;
+};
+
+#define ACCT_TAG_OTHER 1
+
+static pthread_mutex_t acct_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct acct_tag acct_tags[TA_ACCT_MAX_TAGS] = {
+    [ACCT_TAG_OTHER] = {.name = "other"},
+};
+static int acct_num_tags = ACCT_TAG_OTHER + 1;
+static atomic_bool acct_enabled;
+static pthread_once_t acct_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t acct_thread_key;
+
+static int get_tag(struct ta_header *h)
+{
+    return (h->size & SIZE_TAG) >> SIZE_TAG_SHIFT;
+}
+
+static void acct_update(int tag, int64_t bytes, int64_t count)
+{
+    if (tag) {
+        atomic_fetch_add(&acct_tags[tag].bytes, bytes);
+        atomic_fetch_add(&acct_tags[tag].count, count);
+    }
+}
+
+// Accounted size of h. (Additional arena blocks are accounted separately.)
+static int64_t acct_size(struct ta_header *h)
+{
+    return get_size(h) + ((h->size & SIZE_ARENA) ? ARENA_INITIAL_SIZE : 0);
+}
+
+// Return the tag with the given name, registering it if needed. Returns 0 if
+// there are too many tags.
+static int acct_find_tag(const char *name)
+{
+    int tag = 0;
+    pthread_mutex_lock(&acct_mutex);
+    for (int n = 1; n < acct_num_tags; n++) {
+        if (strcmp(acct_tags[n].name, name) == 0) {
+            tag = n;
+            break;
+        }
+    }
+    if (!tag && acct_num_tags < TA_ACCT_MAX_TAGS) {
+        size_t len = strlen(name) + 1;
+        char *copy = malloc(len); // never freed, like the tag itself
+        if (copy) {
+            memcpy(copy, name, len);
+            tag = acct_num_tags++;
+            acct_tags[tag].name = copy;
+        }
+    }
+    pthread_mutex_unlock(&acct_mutex);
+    return tag;
+}
+
+static void acct_init_key(void)
+{
+    pthread_key_create(&acct_thread_key, NULL);
+}
+
+// Tag for a new allocation with the given parent.
+static int acct_new_tag(struct ta_header *parent)
+{
+    if (!atomic_load(&acct_enabled))
+        return 0;
+    int tag = parent ? get_tag(parent) : 0;
+    if (!tag) {
+        pthread_once(&acct_key_once, acct_init_key);
+        tag = (intptr_t)pthread_getspecific(acct_thread_key);
+    }
+    return tag ? tag : ACCT_TAG_OTHER;
+}
+
+static void acct_add(struct ta_header *h, int tag)
+{
+    h->size |= (size_t)tag << SIZE_TAG_SHIFT;
+    acct_update(tag, acct_size(h), 1);
+}
+
+static void set_parent(struct ta_header *ch, struct ta_header *new_parent)
 {
-    struct ta_header *ch = get_header(ptr);
-    if (!ch)
-        return;
-    struct ta_header *new_parent = get_header(ta_parent);
     // Unlink from previous parent
     if (ch->prev)
         ch->prev->next = ch->next;
@@ -119,6 +319,34 @@ void ta_set_parent(void *ptr, void *ta_parent)
     }
 }
 
+/* Set the parent allocation of ptr. If parent==NULL, remove the parent.
+ * Setting parent==NULL (with ptr!=NULL) unsets the parent of ptr.
+ * With ptr==NULL, the function does nothing.
+ *
+ * Warning: if ta_parent is a direct or indirect child of ptr, things will go
+ *          wrong. The function will apparently succeed, but creates circular
+ *          parent links, which are not allowed.
+ *
+ * Allocations made within an arena (see ta_arena_zalloc_size()) can only be
+ * moved to another parent within the same arena. Anything else aborts.
+ */
+void ta_set_parent(void *ptr, void *ta_parent)
+{
+    struct ta_header *ch = get_header(ptr);
+    if (!ch)
+        return;
+    struct ta_header *new_parent = get_header(ta_parent);
+    struct ta_arena *arena = get_arena(new_parent);
+    if (in_arena(ch)) {
+        // The memory would be freed with the arena.
+        if (!arena || arena != get_arena(ch))
+            abort();
+    } else if (arena) {
+        arena->has_foreign = true;
+    }
+    set_parent(ch, new_parent);
+}
+
 /* Return the parent allocation, or NULL if none or if ptr==NULL.
  *
  * Warning: do not use this for program logic, or I'll be sad.
@@ -129,6 +357,92 @@ void *ta_get_parent(void *ptr)
     return ch ? ch->parent : NULL;
 }
 
+static bool arena_new_block(struct ta_arena *a, size_t min_size)
+{
+    size_t size = a->next_block_size;
+    if (size < min_size)
+        size = min_size;
+    struct arena_block *b = malloc(sizeof(union aligned_arena_block) + size);
+    if (!b)
+        return false;
+    b->next = a->blocks;
+    b->size = size;
+    a->blocks = b;
+    acct_update(get_tag(a->root), size, 1);
+    a->pos = (char *)((union aligned_arena_block *)b + 1);
+    a->end = a->pos + size;
+    a->last = NULL;
+    if (a->next_block_size < ARENA_MAX_BLOCK)
+        a->next_block_size *= 2;
+    ta_dbg_add_block(sizeof(union aligned_arena_block) + size);
+    return true;
+}
+
+// Allocate a new child header in the arena. Doesn't set the parent.
+static struct ta_header *arena_alloc(struct ta_arena *a, size_t size)
+{
+    size_t need = sizeof(union aligned_header) + ALIGN_SIZE(size);
+    if ((size_t)(a->end - a->pos) < need && !arena_new_block(a, need))
+        return NULL;
+    struct ta_header *h = (void *)a->pos;
+    *h = (struct ta_header) {.size = size | SIZE_IN_ARENA, .arena = a};
+    ta_dbg_add_arena(h);
+    a->pos += need;
+    a->last = h;
+    return h;
+}
+
+static void arena_free_foreign(struct ta_header *h)
+{
+    struct ta_header *ch = h->child;
+    while (ch) {
+        struct ta_header *next = ch->next;
+        if (in_arena(ch)) {
+            arena_free_foreign(ch);
+        } else {
+            ta_free(PTR_FROM_HEADER(ch));
+        }
+        ch = next;
+    }
+}
+
+// Free all children of the arena allocation: run all pending destructors, free
+// all non-arena allocations that were moved into the arena, and then release
+// the memory blocks. The arena can be used again after this.
+static void arena_free_children(struct ta_arena *a)
+{
+    // Destructors can allocate and free (even set new destructors), so
+    // restart until there's nothing left.
+    while (a->destructors) {
+        struct arena_destructor *list = a->destructors;
+        a->destructors = NULL;
+        a->destructors_tail = &a->destructors;
+        for (struct arena_destructor *d = list; d; d = d->next) {
+            void (*destructor)(void *) = d->destructor;
+            if (destructor) {
+                d->destructor = NULL;
+                d->h->size &= ~SIZE_DESTRUCTOR;
+                destructor(PTR_FROM_HEADER(d->h));
+            }
+        }
+    }
+    if (a->has_foreign) {
+        arena_free_foreign(a->root);
+        a->has_foreign = false;
+    }
+    while (a->blocks) {
+        struct arena_block *next = a->blocks->next;
+        acct_update(get_tag(a->root), -(int64_t)a->blocks->size, -1);
+        free(a->blocks);
+        a->blocks = next;
+    }
+    a->root->child = NULL;
+    a->pos = a->initial;
+    a->end = a->initial + ARENA_INITIAL_SIZE;
+    a->last = NULL;
+    a->next_block_size = ARENA_MIN_BLOCK;
+}
+
 /* Allocate size bytes of memory. If ta_parent is not NULL, this is used as
  * parent allocation (if ta_parent is freed, this allocation is automatically
  * freed as well). size==0 allocates a block of size 0 (i.e. returns non-NULL).
@@ -138,14 +452,23 @@ void *ta_alloc_size(void *ta_parent, size_t size)
 {
     if (size >= MAX_ALLOC)
         return NULL;
-    struct ta_header *h = malloc(sizeof(union aligned_header) + size);
-    if (!h)
-        return NULL;
-    *h = (struct ta_header) {.size = size};
-    ta_dbg_add(h);
-    void *ptr = PTR_FROM_HEADER(h);
-    ta_set_parent(ptr, ta_parent);
-    return ptr;
+    struct ta_header *parent = get_header(ta_parent);
+    struct ta_arena *arena = get_arena(parent);
+    struct ta_header *h;
+    if (arena) {
+        h = arena_alloc(arena, size);
+        if (!h)
+            return NULL;
+    } else {
+        h = malloc(sizeof(union aligned_header) + size);
+        if (!h)
+            return NULL;
+        *h = (struct ta_header) {.size = size};
+        acct_add(h, acct_new_tag(parent));
+        ta_dbg_add(h);
+    }
+    set_parent(h, parent);
+    return PTR_FROM_HEADER(h);
 }
 
 /* Exactly the same as ta_alloc_size(), but the returned memory block is
@@ -155,14 +478,108 @@ void *ta_zalloc_size(void *ta_parent, size_t size)
 {
     if (size >= MAX_ALLOC)
         return NULL;
+    struct ta_header *parent = get_header(ta_parent);
+    if (get_arena(parent)) {
+        void *ptr = ta_alloc_size(ta_parent, size);
+        if (ptr)
+            memset(ptr, 0, size);
+        return ptr;
+    }
     struct ta_header *h = calloc(1, sizeof(union aligned_header) + size);
     if (!h)
         return NULL;
     *h = (struct ta_header) {.size = size};
+    acct_add(h, acct_new_tag(parent));
     ta_dbg_add(h);
-    void *ptr = PTR_FROM_HEADER(h);
-    ta_set_parent(ptr, ta_parent);
-    return ptr;
+    set_parent(h, parent);
+    return PTR_FROM_HEADER(h);
+}
+
+/* Allocate size bytes of memory, initialized to 0, that also acts as an arena
+ * for its children: all allocations made with it (or any of its children) as
+ * parent are carved out of larger memory blocks owned by the arena, instead of
+ * being malloc'ed individually. Freeing the arena runs the destructors of all
+ * its allocations in the order they were set, and then frees the blocks at
+ * once. ta_free_children() on the arena does the same, but keeps the arena
+ * usable.
+ *
+ * This is meant for short-lived trees with many small allocations, and has
+ * some restrictions:
+ *  - Allocations within the arena can't be moved out of it (ta_set_parent()
+ *    aborts). Moving other allocations into it is fine.
+ *  - Freeing or shrinking an allocation doesn't release its memory until the
+ *    arena is freed, unless it is the most recent allocation. Growing an
+ *    allocation other than the most recent one copies it.
+ *  - The arena allocation itself can't be reallocated.
+ *  - Not thread-safe, just like any other operation on a ta tree.
+ */
+void *ta_arena_zalloc_size(void *ta_parent, size_t size)
+{
+    if (size >= MAX_ALLOC)
+        return NULL;
+    size_t arena_size = ALIGN_SIZE(sizeof(struct ta_arena));
+    char *mem = calloc(1, arena_size + sizeof(union aligned_arena_ptr) +
+                          sizeof(union aligned_header) + ALIGN_SIZE(size) +
+                          ARENA_INITIAL_SIZE);
+    if (!mem)
+        return NULL;
+    struct ta_arena *a = (void *)mem;
+    struct ta_header *h =
+        (void *)(mem + arena_size + sizeof(union aligned_arena_ptr));
+    ARENA_PTR(h) = a;
+    *h = (struct ta_header) {.size = size | SIZE_ARENA};
+    char *initial = (char *)PTR_FROM_HEADER(h) + ALIGN_SIZE(size);
+    *a = (struct ta_arena) {
+        .root = h,
+        .pos = initial,
+        .end = initial + ARENA_INITIAL_SIZE,
+        .initial = initial,
+        .next_block_size = ARENA_MIN_BLOCK,
+        .destructors_tail = &a->destructors,
+    };
+    acct_add(h, acct_new_tag(get_header(ta_parent)));
+    ta_dbg_add(h);
+    ta_set_parent(PTR_FROM_HEADER(h), ta_parent);
+    return PTR_FROM_HEADER(h);
+}
+
+static void relink(struct ta_header *h)
+{
+    // Relink parent
+    if (h->parent)
+        h->parent->child = h;
+    // Relink siblings
+    if (h->next)
+        h->next->prev = h;
+    if (h->prev)
+        h->prev->next = h;
+    // Relink children
+    if (h->child)
+        h->child->parent = h;
+}
+
+static struct ta_header *arena_realloc(struct ta_header *h, size_t size)
+{
+    struct ta_arena *a = h->arena;
+    char *data = PTR_FROM_HEADER(h);
+    // Resize in place if possible.
+    if (h == a->last && data + ALIGN_SIZE(size) <= a->end) {
+        a->pos = data + ALIGN_SIZE(size);
+    } else if (size > get_size(h)) {
+        struct ta_header *new_h = arena_alloc(a, size);
+        if (!new_h)
+            return NULL;
+        memcpy(PTR_FROM_HEADER(new_h), data, get_size(h));
+        *new_h = *h;
+        ta_dbg_remove(h);
+        relink(new_h);
+        struct arena_destructor *d = find_arena_destructor(h);
+        if (d)
+            d->h = new_h;
+        h = new_h;
+    }
+    set_size(h, size);
+    return h;
 }
 
 /* Reallocate the allocation given by ptr and return a new pointer. Much like
@@ -189,27 +606,23 @@ void *ta_realloc_size(void *ta_parent, void *ptr, size_t size)
         return ta_alloc_size(ta_parent, size);
     struct ta_header *h = get_header(ptr);
     struct ta_header *old_h = h;
-    if (h->size == size)
+    if (get_size(h) == size)
         return ptr;
+    if (get_arena(h)) {
+        if (!in_arena(h))
+            return NULL; // the arena allocation itself
+        h = arena_realloc(h, size);
+        return h ? PTR_FROM_HEADER(h) : NULL;
+    }
     ta_dbg_remove(h);
     h = realloc(h, sizeof(union aligned_header) + size);
     ta_dbg_add(h ? h : old_h);
     if (!h)
         return NULL;
-    h->size = size;
-    if (h != old_h) {
-        // Relink parent
-        if (h->parent)
-            h->parent->child = h;
-        // Relink siblings
-        if (h->next)
-            h->next->prev = h;
-        if (h->prev)
-            h->prev->next = h;
-        // Relink children
-        if (h->child)
-            h->child->parent = h;
-    }
+    acct_update(get_tag(h), (int64_t)size - (int64_t)get_size(h), 0);
+    set_size(h, size);
+    if (h != old_h)
+        relink(h);
     return PTR_FROM_HEADER(h);
 }
 
@@ -220,7 +633,7 @@ void *ta_realloc_size(void *ta_parent, void *ptr, size_t size)
 size_t ta_get_size(void *ptr)
 {
     struct ta_header *h = get_header(ptr);
-    return h ? h->size : 0;
+    return h ? get_size(h) : 0;
 }
 
 /* Free all allocations that (recursively) have ptr as parent allocation, but
@@ -229,6 +642,11 @@ size_t ta_get_size(void *ptr)
 void ta_free_children(void *ptr)
 {
     struct ta_header *h = get_header(ptr);
+    struct ta_arena *a = get_arena(h);
+    if (a && a->root == h) {
+        arena_free_children(a);
+        return;
+    }
     while (h && h->child)
         ta_free(PTR_FROM_HEADER(h->child));
 }
@@ -240,12 +658,33 @@ void ta_free(void *ptr)
     struct ta_header *h = get_header(ptr);
     if (!h)
         return;
-    if (h->destructor)
-        h->destructor(ptr);
+    if (in_arena(h)) {
+        // (Must not run again from the destructor list.)
+        struct arena_destructor *d = find_arena_destructor(h);
+        if (d) {
+            void (*destructor)(void *) = d->destructor;
+            d->destructor = NULL;
+            h->size &= ~SIZE_DESTRUCTOR;
+            destructor(ptr);
+        }
+    } else if (h->destructor) {
+        void (*destructor)(void *) = h->destructor;
+        h->destructor = NULL;
+        destructor(ptr);
+    }
     ta_free_children(ptr);
-    ta_set_parent(ptr, NULL);
+    set_parent(h, NULL);
+    acct_update(get_tag(h), -acct_size(h), -1);
     ta_dbg_remove(h);
-    free(h);
+    if (in_arena(h)) {
+        struct ta_arena *a = h->arena;
+        if (a->last == h) {
+            a->pos = (char *)h;
+            a->last = NULL;
+        }
+    } else {
+        free(get_alloc_start(h));
+    }
 }
 
 /* Set a destructor that is to be called when the given allocation is freed.
@@ -261,17 +700,119 @@ void ta_free(void *ptr)
 void ta_set_destructor(void *ptr, void (*destructor)(void *))
 {
     struct ta_header *h = get_header(ptr);
-    if (h)
+    if (!h)
+        return;
+    if (!in_arena(h)) {
         h->destructor = destructor;
+        return;
+    }
+    struct arena_destructor *d = find_arena_destructor(h);
+    if (!d && destructor) {
+        struct ta_arena *a = h->arena;
+        struct ta_header *dh = arena_alloc(a, sizeof(struct arena_destructor));
+        if (!dh)
+            abort();
+        d = PTR_FROM_HEADER(dh);
+        *d = (struct arena_destructor){.h = h};
+        *a->destructors_tail = d;
+        a->destructors_tail = &d->next;
+    }
+    if (d)
+        d->destructor = destructor;
+    if (destructor) {
+        h->size |= SIZE_DESTRUCTOR;
+    } else {
+        h->size &= ~SIZE_DESTRUCTOR;
+    }
 }
 
-#if TA_MEMORY_DEBUGGING
+/* Enable or disable accounting of allocations by tag. Only allocations made
+ * while it is enabled are accounted (but they stay accounted until they are
+ * freed). Returns false if not supported (on 32 bit systems).
+ */
+bool ta_acct_enable(bool enable)
+{
+    if (!SIZE_TAG)
+        return false;
+    atomic_store(&acct_enabled, enable);
+    return true;
+}
 
-#include <pthread.h>
+/* Set the tag that new allocations without parent (or whose parent is not
+ * accounted) made by the calling thread are accounted to. Other allocations
+ * are accounted to the tag of their parent. The default tag is "other".
+ */
+void ta_acct_set_thread_tag(const char *name)
+{
+    if (!SIZE_TAG)
+        return;
+    pthread_once(&acct_key_once, acct_init_key);
+    pthread_setspecific(acct_thread_key, (void *)(intptr_t)acct_find_tag(name));
+}
+
+/* Account the allocation ptr to the named tag. Only affects ptr itself and
+ * its future children, so this is typically called right after allocating
+ * a subsystem's root allocation. Does nothing if accounting is disabled.
+ */
+void ta_acct_set_tag(void *ptr, const char *name)
+{
+    struct ta_header *h = get_header(ptr);
+    if (!h || in_arena(h) || !atomic_load(&acct_enabled))
+        return;
+    int tag = acct_find_tag(name);
+    if (!tag)
+        return;
+    int64_t bytes = acct_size(h), count = 1;
+    struct ta_arena *a = get_arena(h);
+    for (struct arena_block *b = a ? a->blocks : NULL; b; b = b->next) {
+        bytes += b->size;
+        count += 1;
+    }
+    acct_update(get_tag(h), -bytes, -count);
+    h->size = (h->size & ~SIZE_TAG) | ((size_t)tag << SIZE_TAG_SHIFT);
+    acct_update(tag, bytes, count);
+}
+
+/* Account memory that was not allocated with ta (like a script VM heap) to the
+ * calling thread's tag. bytes and count are added to the totals. Unlike ta
+ * allocations, this is done even if accounting is disabled, so that callers
+ * don't need to remember what was accounted.
+ */
+void ta_acct_add_external(long long bytes, long long count)
+{
+    pthread_once(&acct_key_once, acct_init_key);
+    int tag = (intptr_t)pthread_getspecific(acct_thread_key);
+    acct_update(tag ? tag : ACCT_TAG_OTHER, bytes, count);
+}
+
+/* Write the current totals of all tags to st[], and return the number of
+ * entries. Returns -1 if accounting is disabled.
+ */
+int ta_acct_get_stats(struct ta_acct_stats st[TA_ACCT_MAX_TAGS])
+{
+    if (!atomic_load(&acct_enabled))
+        return -1;
+    pthread_mutex_lock(&acct_mutex);
+    int num = acct_num_tags - 1;
+    for (int n = 0; n < num; n++) {
+        struct acct_tag *tag = &acct_tags[n + 1];
+        st[n] = (struct ta_acct_stats){
+            .name = tag->name,
+            .bytes = atomic_load(&tag->bytes),
+            .count = atomic_load(&tag->count),
+        };
+    }
+    pthread_mutex_unlock(&acct_mutex);
+    return num;
+}
+
+#if TA_MEMORY_DEBUGGING
 
 static pthread_mutex_t ta_dbg_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bool enable_leak_check; // pretty much constant
 static struct ta_header leak_node;
+static size_t leak_num_allocs;
+static size_t leak_alloc_bytes;
 static char allocation_is_string;
 
 static void ta_dbg_add(struct ta_header *h)
@@ -283,6 +824,28 @@ static void ta_dbg_add(struct ta_header *h)
         h->leak_prev = leak_node.leak_prev;
         leak_node.leak_prev->leak_next = h;
         leak_node.leak_prev = h;
+        leak_num_allocs++;
+        leak_alloc_bytes += sizeof(union aligned_header) + get_size(h);
+        if (h->size & SIZE_ARENA) {
+            leak_alloc_bytes += ALIGN_SIZE(sizeof(struct ta_arena)) +
+                sizeof(union aligned_arena_ptr) + ARENA_INITIAL_SIZE;
+        }
+        pthread_mutex_unlock(&ta_dbg_mutex);
+    }
+}
+
+// Arena allocations are not tracked individually (see ta_dbg_add_block()).
+static void ta_dbg_add_arena(struct ta_header *h)
+{
+    h->canary = CANARY;
+}
+
+static void ta_dbg_add_block(size_t size)
+{
+    if (enable_leak_check) {
+        pthread_mutex_lock(&ta_dbg_mutex);
+        leak_num_allocs++;
+        leak_alloc_bytes += size;
         pthread_mutex_unlock(&ta_dbg_mutex);
     }
 }
@@ -315,7 +878,7 @@ static size_t get_children_size(struct ta_header *h)
 {
     size_t size = 0;
     for (struct ta_header *s = h->child; s; s = s->next)
-        size += s->size + get_children_size(s);
+        size += get_size(s) + get_children_size(s);
     return size;
 }
 
@@ -338,16 +901,16 @@ static void print_leak_report(void)
                     snprintf(name, sizeof(name), "%s", cur->name);
                 if (cur->name == &allocation_is_string) {
                     snprintf(name, sizeof(name), "'%.*s'",
-                             (int)cur->size, (char *)PTR_FROM_HEADER(cur));
+                             (int)get_size(cur), (char *)PTR_FROM_HEADER(cur));
                 }
                 for (int n = 0; n < sizeof(name); n++) {
                     if (name[n] && name[n] < 0x20)
                         name[n] = '.';
                 }
                 fprintf(stderr, "  %-20p %10zu %10zu  %s\n",
-                        cur, cur->size, c_size, name);
+                        cur, get_size(cur), c_size, name);
             }
-            size += cur->size;
+            size += get_size(cur);
             num_blocks += 1;
             // Unlink, and don't confuse valgrind by leaving live pointers.
             cur->leak_next->leak_prev = cur->leak_prev;
@@ -371,6 +934,25 @@ void ta_enable_leak_report(void)
     pthread_mutex_unlock(&ta_dbg_mutex);
 }
 
+bool ta_dbg_get_stats(struct ta_dbg_stats *st)
+{
+    *st = (struct ta_dbg_stats){0};
+    pthread_mutex_lock(&ta_dbg_mutex);
+    bool enabled = enable_leak_check;
+    if (enabled) {
+        st->num_allocs = leak_num_allocs;
+        st->alloc_bytes = leak_alloc_bytes;
+        for (struct ta_header *cur = leak_node.leak_next; cur != &leak_node;
+             cur = cur->leak_next)
+        {
+            st->live_blocks += 1;
+            st->live_bytes += get_size(cur);
+        }
+    }
+    pthread_mutex_unlock(&ta_dbg_mutex);
+    return enabled;
+}
+
 /* Set a (static) string that will be printed if the memory allocation in ptr
  * shows up on the leak report. The string must stay valid until ptr is freed.
  * Calling it on ptr==NULL does nothing.
@@ -396,10 +978,17 @@ void *ta_dbg_mark_as_string(void *ptr)
 #else
 
 static void ta_dbg_add(struct ta_header *h){}
+static void ta_dbg_add_arena(struct ta_header *h){}
+static void ta_dbg_add_block(size_t size){}
 static void ta_dbg_check_header(struct ta_header *h){}
 static void ta_dbg_remove(struct ta_header *h){}
 
 void ta_enable_leak_report(void){}
+bool ta_dbg_get_stats(struct ta_dbg_stats *st)
+{
+    *st = (struct ta_dbg_stats){0};
+    return false;
+}
 void *ta_dbg_set_loc(void *ptr, const char *loc){return ptr;}
 void *ta_dbg_mark_as_string(void *ptr){return ptr;}
 
@@ -53,6 +53,7 @@ void ta_free_children(void *ptr);
 void ta_set_destructor(void *ptr, void (*destructor)(void *));
 void ta_set_parent(void *ptr, void *ta_parent);
 void *ta_get_parent(void *ptr);
+void *ta_arena_zalloc_size(void *ta_parent, size_t size);
 
 // Utility functions
 size_t ta_calc_array_size(size_t element_size, size_t count);
@@ -96,6 +97,10 @@ bool ta_vasprintf_append_buffer(char **str, const char *fmt, va_list ap) TA_PRF(
 
 #define ta_steal(ta_parent, ptr) (TA_TYPEOF(ptr))ta_steal_(ta_parent, ptr)
 
+#define ta_arena_znew(ta_parent, type) \
+    (type *)ta_arena_zalloc_size(ta_parent, sizeof(type))
+#define ta_arena_new_context(ta_parent) ta_arena_zalloc_size(ta_parent, 0)
+
 #define ta_dup(ta_parent, ptr) \
     (TA_TYPEOF(ptr))ta_memdup(ta_parent, ptr, sizeof(*(ptr)))
 
@@ -107,6 +112,8 @@ bool ta_vasprintf_append_buffer(char **str, const char *fmt, va_list ap) TA_PRF(
 #define ta_xalloc_size(...)             ta_oom_p(ta_alloc_size(__VA_ARGS__))
 #define ta_xzalloc_size(...)            ta_oom_p(ta_zalloc_size(__VA_ARGS__))
 #define ta_xnew_context(...)            ta_oom_p(ta_new_context(__VA_ARGS__))
+#define ta_xarena_zalloc_size(...)      ta_oom_p(ta_arena_zalloc_size(__VA_ARGS__))
+#define ta_xarena_new_context(...)      ta_oom_p(ta_arena_new_context(__VA_ARGS__))
 #define ta_xstrdup_append(...)          ta_oom_b(ta_strdup_append(__VA_ARGS__))
 #define ta_xstrdup_append_buffer(...)   ta_oom_b(ta_strdup_append_buffer(__VA_ARGS__))
 #define ta_xstrndup_append(...)         ta_oom_b(ta_strndup_append(__VA_ARGS__))
@@ -125,6 +132,7 @@ bool ta_vasprintf_append_buffer(char **str, const char *fmt, va_list ap) TA_PRF(
 #define ta_xnew_ptrtype(...)            ta_oom_g(ta_new_ptrtype(__VA_ARGS__))
 #define ta_xnew_array_ptrtype(...)      ta_oom_g(ta_new_array_ptrtype(__VA_ARGS__))
 #define ta_xdup(...)                    ta_oom_g(ta_dup(__VA_ARGS__))
+#define ta_xarena_znew(...)             ta_oom_g(ta_arena_znew(__VA_ARGS__))
 
 #define ta_xrealloc(ta_parent, ptr, type, count) \
     (type *)ta_xrealloc_size(ta_parent, ptr, ta_calc_array_size(sizeof(type), count))
@@ -138,6 +146,7 @@ void *ta_xrealloc_size(void *ta_parent, void *ptr, size_t size);
 #ifndef TA_NO_WRAPPERS
 #define ta_alloc_size(...)      ta_dbg_set_loc(ta_alloc_size(__VA_ARGS__), TA_LOC)
 #define ta_zalloc_size(...)     ta_dbg_set_loc(ta_zalloc_size(__VA_ARGS__), TA_LOC)
+#define ta_arena_zalloc_size(...) ta_dbg_set_loc(ta_arena_zalloc_size(__VA_ARGS__), TA_LOC)
 #define ta_realloc_size(...)    ta_dbg_set_loc(ta_realloc_size(__VA_ARGS__), TA_LOC)
 #define ta_memdup(...)          ta_dbg_set_loc(ta_memdup(__VA_ARGS__), TA_LOC)
 #define ta_xmemdup(...)         ta_dbg_set_loc(ta_xmemdup(__VA_ARGS__), TA_LOC)
@@ -154,4 +163,32 @@ void ta_enable_leak_report(void);
 void *ta_dbg_set_loc(void *ptr, const char *name);
 void *ta_dbg_mark_as_string(void *ptr);
 
+struct ta_dbg_stats {
+    size_t num_allocs;      // allocations and reallocations so far
+    size_t alloc_bytes;     // bytes requested from malloc() for num_allocs
+    size_t live_blocks;     // currently allocated blocks
+    size_t live_bytes;      // size of all currently allocated blocks
+    // Allocations within an arena are not counted individually: each memory
+    // block of the arena counts as 1 allocation in num_allocs, and the arena's
+    // live allocations show up in neither live_blocks nor live_bytes.
+};
+
+// Returns false if the leak report is not enabled (or not compiled in).
+bool ta_dbg_get_stats(struct ta_dbg_stats *st);
+
+// Accounting of live allocations by tag (see ta_acct_set_tag()).
+#define TA_ACCT_MAX_TAGS 256
+
+struct ta_acct_stats {
+    const char *name;
+    long long bytes;        // size of the accounted allocations
+    long long count;        // number of accounted allocations
+};
+
+bool ta_acct_enable(bool enable);
+void ta_acct_set_thread_tag(const char *name);
+void ta_acct_set_tag(void *ptr, const char *name);
+void ta_acct_add_external(long long bytes, long long count);
+int ta_acct_get_stats(struct ta_acct_stats st[TA_ACCT_MAX_TAGS]);
+
 #endif
@@ -41,6 +41,8 @@
 #define talloc_enable_leak_report       ta_enable_leak_report
 #define talloc_size                     ta_xalloc_size
 #define talloc_zero_size                ta_xzalloc_size
+#define talloc_arena_new                ta_xarena_new_context
+#define talloc_arena_zero               ta_xarena_znew
 #define talloc_get_size                 ta_get_size
 #define talloc_free_children            ta_free_children
 #define talloc_free                     ta_free
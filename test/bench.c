@@ -0,0 +1,362 @@
+#include "audio/chmap_sel.h"
+#include "audio/filter/af_scaletempo2_internals.h"
+#include "common/common.h"
+#include "demux/packet.h"
+#include "input/cmd.h"
+#include "misc/bstr.h"
+#include "misc/json.h"
+#include "misc/node.h"
+#include "options/m_config.h"
+#include "options/options.h"
+#include "sub/draw_bmp.h"
+#include "sub/osd.h"
+#include "tests.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+#include "video/mp_image_pool.h"
+#include "video/repack.h"
+
+// Microbenchmarks for primitives on the playback data path. Each case is
+// measured with test_bench(), so results end up in test/out/bench.json and can
+// be compared between builds.
+
+#define IMG_W 1920
+#define IMG_H 1080
+
+struct repack_ctx {
+    struct mp_repack *rp;
+    int y, align_y;
+};
+
+static void bench_repack(void *priv)
+{
+    struct repack_ctx *c = priv;
+    repack_line(c->rp, 0, c->y, 0, c->y, IMG_W);
+    c->y = (c->y + c->align_y) % IMG_H;
+}
+
+static void run_repack(struct test_ctx *ctx, const char *name, int imgfmt,
+                       bool pack)
+{
+    struct mp_repack *rp = mp_repack_create_planar(imgfmt, pack, 0);
+    assert_true(rp);
+    struct mp_image *src = mp_image_alloc(mp_repack_get_format_src(rp),
+                                          IMG_W, IMG_H);
+    struct mp_image *dst = mp_image_alloc(mp_repack_get_format_dst(rp),
+                                          IMG_W, IMG_H);
+    assert_true(src && dst);
+    mp_image_clear(src, 0, 0, src->w, src->h);
+    assert_true(repack_config_buffers(rp, 0, dst, 0, src, NULL));
+
+    struct repack_ctx c = {.rp = rp, .align_y = mp_repack_get_align_y(rp)};
+    test_bench(ctx, name, bench_repack, &c);
+
+    talloc_free(src);
+    talloc_free(dst);
+    talloc_free(rp);
+}
+
+static void bench_image_pool(void *priv)
+{
+    struct mp_image_pool *pool = priv;
+    struct mp_image *img = mp_image_pool_get(pool, IMGFMT_420P, IMG_W, IMG_H);
+    talloc_free(img);
+}
+
+struct draw_ctx {
+    struct mp_draw_sub_cache *cache;
+    struct mp_image *dst;
+    struct sub_bitmap_list *list;
+};
+
+static void bench_draw(void *priv)
+{
+    struct draw_ctx *c = priv;
+    mp_draw_sub_bitmaps(c->cache, c->dst, c->list);
+}
+
+// A typical subtitle line: a few libass glyph runs near the bottom.
+static void run_draw(struct test_ctx *ctx, void *tmp)
+{
+    struct draw_ctx c = {
+        .cache = mp_draw_sub_alloc(tmp, ctx->global),
+        .dst = talloc_steal(tmp, mp_image_alloc(IMGFMT_420P, IMG_W, IMG_H)),
+    };
+    assert_true(c.dst);
+    mp_image_params_guess_csp(&c.dst->params);
+    mp_image_clear(c.dst, 0, 0, c.dst->w, c.dst->h);
+
+    struct sub_bitmaps *sb = talloc_zero(tmp, struct sub_bitmaps);
+    sb->format = SUBBITMAP_LIBASS;
+    sb->change_id = 1;
+    sb->num_parts = 8;
+    sb->parts = talloc_zero_array(tmp, struct sub_bitmap, sb->num_parts);
+    for (int n = 0; n < sb->num_parts; n++) {
+        struct sub_bitmap *p = &sb->parts[n];
+        p->w = p->dw = 160;
+        p->h = p->dh = 60;
+        p->stride = p->w;
+        p->x = 200 + n * (p->w + 20);
+        p->y = IMG_H - 120;
+        p->libass.color = n % 2 ? 0xFFFFFF00 : 0x00000080;
+        uint8_t *data = talloc_size(tmp, p->stride * p->h);
+        for (int i = 0; i < p->stride * p->h; i++)
+            data[i] = (i * 7) & 0xFF;
+        p->bitmap = data;
+    }
+
+    c.list = talloc_zero(tmp, struct sub_bitmap_list);
+    c.list->change_id = 1;
+    c.list->w = IMG_W;
+    c.list->h = IMG_H;
+    MP_TARRAY_APPEND(tmp, c.list->items, c.list->num_items, sb);
+
+    test_bench(ctx, "draw_sub_bitmaps/libass", bench_draw, &c);
+}
+
+static const char json_text[] =
+    "{\"event\":\"property-change\",\"id\":1,\"name\":\"time-pos\","
+    "\"data\":12.345,\"list\":[{\"id\":1,\"type\":\"video\",\"codec\":\"h264\","
+    "\"selected\":true,\"demux-w\":1920,\"demux-h\":1080},{\"id\":2,"
+    "\"type\":\"audio\",\"lang\":\"eng\",\"codec\":\"aac\",\"selected\":false,"
+    "\"title\":\"Stereo \\u00e9\\n\",\"demux-channel-count\":2}]}";
+
+static void bench_json_parse(void *priv)
+{
+    void *tmp = talloc_new(NULL);
+    char *s = talloc_strdup(tmp, json_text);
+    struct mpv_node node;
+    json_parse(tmp, &node, &s, 50);
+    talloc_free(tmp);
+}
+
+// Same as bench_json_parse(), but with an arena, like IPC does.
+static void bench_json_parse_arena(void *priv)
+{
+    void *tmp = talloc_arena_new(NULL);
+    char *s = talloc_strdup(tmp, json_text);
+    struct mpv_node node;
+    json_parse(tmp, &node, &s, 50);
+    talloc_free(tmp);
+}
+
+static void bench_json_write(void *priv)
+{
+    struct mpv_node *node = priv;
+    char *s = talloc_strdup(NULL, "");
+    json_write(&s, node);
+    talloc_free(s);
+}
+
+static void bench_ta(void *priv)
+{
+    void *parent = talloc_new(NULL);
+    for (int n = 0; n < 8; n++)
+        talloc_size(parent, 16 + n * 32);
+    talloc_strdup(parent, "a short string");
+    talloc_free(parent);
+}
+
+static void bench_ta_arena(void *priv)
+{
+    void *parent = talloc_arena_new(NULL);
+    for (int n = 0; n < 8; n++)
+        talloc_size(parent, 16 + n * 32);
+    talloc_strdup(parent, "a short string");
+    talloc_free(parent);
+}
+
+static void bench_cmd_parse(void *priv)
+{
+    struct mp_log *log = priv;
+    struct mp_cmd *cmd = mp_input_parse_cmd_str(log,
+        bstr0("no-osd seek 10 relative+exact; show-text \"${time-pos}\""),
+        "bench");
+    assert_true(cmd);
+    talloc_free(cmd);
+}
+
+static void bench_demux_packet(void *priv)
+{
+    struct demux_packet *dp = new_demux_packet(4096);
+    struct demux_packet *copy = demux_copy_packet(dp);
+    free_demux_packet(dp);
+    free_demux_packet(copy);
+}
+
+static const char bstr_text[] =
+    "Dialogue: 0,0:00:01.00,0:00:04.00,Default,,0,0,0,,{\\an8}Some subtitle "
+    "text\\Nwith a line break\n"
+    "Dialogue: 0,0:00:05.00,0:00:07.50,Default,,0,0,0,,Another line\n"
+    "Comment: 0,0:00:08.00,0:00:09.00,Default,,0,0,0,,Ignored\n";
+
+static void bench_bstr(void *priv)
+{
+    int *count = priv;
+    bstr rest = bstr0(bstr_text);
+    while (rest.len) {
+        bstr line = bstr_strip_linebreaks(bstr_getline(rest, &rest));
+        if (!bstr_eatstart0(&line, "Dialogue:"))
+            continue;
+        bstr field = {0};
+        for (int n = 0; n < 9; n++)
+            field = bstr_splitchar(line, &line, ',');
+        *count += bstr_find0(bstr_strip(line), "\\N") >= 0;
+        *count += bstr_validate_utf8(field) >= 0;
+    }
+}
+
+struct chmap_ctx {
+    struct mp_chmap_sel sel;
+    struct mp_chmap in;
+};
+
+static void bench_chmap_sel(void *priv)
+{
+    struct chmap_ctx *c = priv;
+    struct mp_chmap map = c->in;
+    mp_chmap_sel_adjust(&c->sel, &map);
+}
+
+// Option setup done at player startup.
+static void bench_config_new(void *priv)
+{
+    struct test_ctx *ctx = priv;
+    talloc_free(m_config_new(NULL, ctx->log, &mp_opt_root));
+}
+
+static void bench_config_cache(void *priv)
+{
+    struct test_ctx *ctx = priv;
+    talloc_free(m_config_cache_alloc(NULL, ctx->global, &vo_sub_opts));
+}
+
+#define NUM_CACHES 32
+
+struct config_update_ctx {
+    struct m_config_cache *root;
+    struct m_config_cache *caches[NUM_CACHES];
+};
+
+// Change a top-level option, and let a number of caches for unrelated groups
+// (like VOs and decoders have) check for updates.
+static void bench_config_update(void *priv)
+{
+    struct config_update_ctx *c = priv;
+    struct MPOpts *opts = c->root->opts;
+    opts->osd_level = (opts->osd_level + 1) % 4;
+    m_config_cache_write_opt(c->root, &opts->osd_level);
+    for (int n = 0; n < NUM_CACHES; n++)
+        m_config_cache_update(c->caches[n]);
+}
+
+static void run_config_update(struct test_ctx *ctx)
+{
+    struct m_config_shadow *shadow = m_config_shadow_new(&mp_opt_root);
+    struct config_update_ctx c = {
+        .root = m_config_cache_from_shadow(NULL, shadow, &mp_opt_root),
+    };
+    for (int n = 0; n < NUM_CACHES; n++)
+        c.caches[n] = m_config_cache_from_shadow(NULL, shadow, &vo_sub_opts);
+
+    test_bench(ctx, "m_config_cache_update", bench_config_update, &c);
+
+    for (int n = 0; n < NUM_CACHES; n++)
+        talloc_free(c.caches[n]);
+    talloc_free(c.root);
+    talloc_free(shadow);
+}
+
+#define ST_CHANNELS 2
+#define ST_RATE 48000
+#define ST_BLOCK 1024
+
+struct scaletempo_ctx {
+    struct mp_scaletempo2 st;
+    float *in[ST_CHANNELS];
+    float *out[ST_CHANNELS];
+};
+
+// Produce one overlap-and-add hop of output at 1.5x speed.
+static void bench_scaletempo2(void *priv)
+{
+    struct scaletempo_ctx *c = priv;
+    while (!mp_scaletempo2_frames_available(&c->st))
+        mp_scaletempo2_fill_input_buffer(&c->st, (uint8_t **)c->in, ST_BLOCK,
+                                         false);
+    mp_scaletempo2_fill_buffer(&c->st, c->out, c->st.ola_hop_size, 1.5);
+}
+
+static void run_scaletempo2(struct test_ctx *ctx, void *tmp)
+{
+    struct mp_scaletempo2_opts opts = {
+        .min_playback_rate = 0.25,
+        .max_playback_rate = 4.0,
+        .ola_window_size_ms = 20,
+        .wsola_search_interval_ms = 30,
+    };
+    struct scaletempo_ctx *c = talloc_zero(tmp, struct scaletempo_ctx);
+    c->st.opts = &opts;
+    mp_scaletempo2_init(&c->st, ST_CHANNELS, ST_RATE);
+    for (int ch = 0; ch < ST_CHANNELS; ch++) {
+        c->in[ch] = talloc_array(c, float, ST_BLOCK);
+        c->out[ch] = talloc_array(c, float, c->st.ola_hop_size);
+        for (int n = 0; n < ST_BLOCK; n++)
+            c->in[ch][n] = sinf(n * (ch + 1) * 0.05) * 0.5;
+    }
+
+    test_bench(ctx, "scaletempo2/1.5x", bench_scaletempo2, c);
+
+    mp_scaletempo2_destroy(&c->st);
+}
+
+static void run(struct test_ctx *ctx)
+{
+    void *tmp = talloc_new(NULL);
+
+    run_repack(ctx, "repack_line/unpack-rgb24", IMGFMT_RGB24, false);
+    run_repack(ctx, "repack_line/pack-rgb24", IMGFMT_RGB24, true);
+    run_repack(ctx, "repack_line/unpack-nv12", IMGFMT_NV12, false);
+
+    struct mp_image_pool *pool = mp_image_pool_new(tmp);
+    test_bench(ctx, "image_pool_get", bench_image_pool, pool);
+
+    run_draw(ctx, tmp);
+
+    char *s = talloc_strdup(tmp, json_text);
+    struct mpv_node node;
+    assert_true(json_parse(tmp, &node, &s, 50) >= 0);
+    test_bench(ctx, "json_parse", bench_json_parse, NULL);
+    test_bench(ctx, "json_parse/arena", bench_json_parse_arena, NULL);
+    test_bench(ctx, "json_write", bench_json_write, &node);
+
+    test_bench(ctx, "ta_alloc_free", bench_ta, NULL);
+    test_bench(ctx, "ta_alloc_free/arena", bench_ta_arena, NULL);
+    test_bench(ctx, "cmd_parse", bench_cmd_parse, ctx->log);
+    test_bench(ctx, "demux_packet_alloc_free", bench_demux_packet, NULL);
+
+    int count = 0;
+    test_bench(ctx, "bstr_parse_lines", bench_bstr, &count);
+    assert_true(count > 0);
+
+    struct chmap_ctx chmap = {0};
+    mp_chmap_sel_add_waveext_def(&chmap.sel);
+    struct mp_chmap stereo = MP_CHMAP_INIT_STEREO;
+    mp_chmap_sel_add_map(&chmap.sel, &stereo);
+    assert_true(mp_chmap_from_str(&chmap.in, bstr0("7.1(wide-side)")));
+    test_bench(ctx, "chmap_sel_adjust", bench_chmap_sel, &chmap);
+
+    test_bench(ctx, "m_config_new", bench_config_new, ctx);
+    test_bench(ctx, "m_config_cache_alloc", bench_config_cache, ctx);
+    run_config_update(ctx);
+
+    run_scaletempo2(ctx, tmp);
+
+    talloc_free(tmp);
+}
+
+const struct unittest test_bench_primitives = {
+    .name = "bench",
+    .is_complex = true,
+    .run = run,
+};
@@ -0,0 +1,65 @@
+#include <math.h>
+
+#include "common/common.h"
+#include "misc/histogram.h"
+#include "tests.h"
+
+static int cmp_int64(const void *a, const void *b)
+{
+    int64_t va = *(const int64_t *)a, vb = *(const int64_t *)b;
+    return va < vb ? -1 : va > vb;
+}
+
+static void run(struct test_ctx *ctx)
+{
+    struct mp_histogram *h = talloc_zero(NULL, struct mp_histogram);
+    assert_int_equal(mp_histogram_percentile(h, 0.5), 0);
+
+    // Small values are exact.
+    for (int n = 0; n < 10; n++)
+        mp_histogram_add(h, n);
+    assert_int_equal(h->count, 10);
+    assert_int_equal(h->min, 0);
+    assert_int_equal(h->max, 9);
+    assert_int_equal(mp_histogram_percentile(h, 0.5), 4);
+    assert_int_equal(mp_histogram_percentile(h, 1.0), 9);
+    assert_int_equal(mp_histogram_percentile(h, 0), 0);
+
+    // Out of range values are clamped.
+    mp_histogram_add(h, -5);
+    mp_histogram_add(h, INT64_MAX);
+    assert_int_equal(h->min, 0);
+    assert_true(h->max > 0);
+    assert_int_equal(mp_histogram_percentile(h, 1.0), h->max);
+
+    // Larger values are within the bucket width (1/16) of the exact result.
+    #define NUM 10000
+    int64_t *values = talloc_array(h, int64_t, NUM);
+    struct mp_histogram *a = talloc_zero(h, struct mp_histogram);
+    struct mp_histogram *b = talloc_zero(h, struct mp_histogram);
+    uint32_t seed = 1;
+    for (int n = 0; n < NUM; n++) {
+        seed = seed * 1664525 + 1013904223;
+        values[n] = (seed >> 8) % (1 << (n % 24));
+        mp_histogram_add(n % 2 ? a : b, values[n]);
+    }
+    mp_histogram_merge(a, b);
+    assert_int_equal(a->count, NUM);
+    qsort(values, NUM, sizeof(values[0]), cmp_int64);
+    assert_int_equal(a->min, values[0]);
+    assert_int_equal(a->max, values[NUM - 1]);
+    const double ps[] = {0.01, 0.1, 0.5, 0.9, 0.99, 0.999, 1.0};
+    for (int n = 0; n < MP_ARRAY_SIZE(ps); n++) {
+        int64_t exact = values[(int)ceil(ps[n] * NUM) - 1];
+        int64_t got = mp_histogram_percentile(a, ps[n]);
+        assert_true(got >= exact);
+        assert_true(got - exact <= exact / 16);
+    }
+
+    talloc_free(h);
+}
+
+const struct unittest test_histogram = {
+    .name = "histogram",
+    .run = run,
+};
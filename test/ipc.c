@@ -0,0 +1,106 @@
+#include "common/common.h"
+#include "common/global.h"
+#include "input/input.h"
+#include "libmpv/client.h"
+#include "misc/bstr.h"
+#include "misc/dispatch.h"
+#include "misc/json.h"
+#include "misc/node.h"
+#include "player/client.h"
+#include "player/core.h"
+#include "tests.h"
+
+// Run a JSON IPC request on a connection that starts requests asynchronously
+// (like the Unix socket transport), and return the parsed reply.
+static struct mpv_node *run_request(struct test_ctx *ctx,
+                                    struct mp_ipc_conn *conn, void *ta_parent,
+                                    const char *line)
+{
+    bstr out = {0};
+    char *reply = mp_ipc_execute_line(conn, ta_parent, bstr0(line));
+    if (reply)
+        bstr_xappend(ta_parent, &out, bstr0(reply));
+
+    while (conn->num_pending) {
+        mp_dispatch_queue_process(ctx->mpctx->dispatch, 0);
+        mpv_event *event = mpv_wait_event(conn->client, 0);
+        if (event->event_id != MPV_EVENT_NONE)
+            assert_true(mp_ipc_encode_event(conn, ta_parent, &out, event));
+    }
+
+    char *src = bstrto0(ta_parent, out);
+    struct mpv_node *res = talloc_zero(ta_parent, struct mpv_node);
+    assert_true(json_parse(ta_parent, res, &src, 4) >= 0);
+    assert_int_equal(res->format, MPV_FORMAT_NODE_MAP);
+    return res;
+}
+
+static const char *reply_error(struct mpv_node *reply)
+{
+    struct mpv_node *error = node_map_get(reply, "error");
+    assert_true(error && error->format == MPV_FORMAT_STRING);
+    return error->u.string;
+}
+
+static void run(struct test_ctx *ctx)
+{
+    void *ta_ctx = talloc_new(NULL);
+
+    struct mp_ipc_conn conn = {
+        .client = mp_new_client(ctx->global->client_api, "ipc-test"),
+        .ta_parent = ta_ctx,
+        .async_requests = true,
+    };
+    assert_true(conn.client);
+
+    struct mpv_node *r, *data;
+
+    // Missing properties are null data, not an error.
+    r = run_request(ctx, &conn, ta_ctx,
+        "{\"command\": [\"get_property_string\", \"nonexistent\"]}");
+    assert_string_equal(reply_error(r), "success");
+    data = node_map_get(r, "data");
+    assert_true(data && data->format == MPV_FORMAT_NONE);
+
+    r = run_request(ctx, &conn, ta_ctx,
+        "{\"command\": [\"get_property\", \"nonexistent\"]}");
+    assert_string_equal(reply_error(r),
+                        mpv_error_string(MPV_ERROR_PROPERTY_NOT_FOUND));
+    assert_false(node_map_get(r, "data"));
+
+    // Command replies always have data, even on errors.
+    r = run_request(ctx, &conn, ta_ctx,
+        "{\"command\": [\"set\", \"nonexistent\", \"1\"], \"request_id\": 5}");
+    assert_string_equal(reply_error(r), mpv_error_string(MPV_ERROR_COMMAND));
+    data = node_map_get(r, "data");
+    assert_true(data && data->format == MPV_FORMAT_NONE);
+    data = node_map_get(r, "request_id");
+    assert_true(data && data->format == MPV_FORMAT_INT64);
+    assert_int_equal(data->u.int64, 5);
+
+    // Batch replies have the item results, even if an item failed.
+    r = run_request(ctx, &conn, ta_ctx,
+        "{\"command\": [\"batch\", [[\"ignore\"],"
+        " [\"set_property\", \"nonexistent\", 1]]]}");
+    assert_string_equal(reply_error(r),
+                        mpv_error_string(MPV_ERROR_PROPERTY_NOT_FOUND));
+    data = node_map_get(r, "data");
+    assert_true(data && data->format == MPV_FORMAT_NODE_ARRAY);
+    assert_int_equal(data->u.list->num, 2);
+    int64_t errors[] = {0, MPV_ERROR_PROPERTY_NOT_FOUND};
+    for (int n = 0; n < 2; n++) {
+        struct mpv_node *item = &data->u.list->values[n];
+        assert_int_equal(item->format, MPV_FORMAT_NODE_MAP);
+        struct mpv_node *error = node_map_get(item, "error");
+        assert_true(error && error->format == MPV_FORMAT_INT64);
+        assert_int_equal(error->u.int64, errors[n]);
+    }
+
+    mpv_destroy(conn.client);
+    talloc_free(ta_ctx);
+}
+
+const struct unittest test_ipc = {
+    .name = "ipc",
+    .run = run,
+};
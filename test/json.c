@@ -1,4 +1,5 @@
 #include "common/common.h"
+#include "common/msg.h"
 #include "misc/json.h"
 #include "misc/node.h"
 #include "tests.h"
@@ -39,6 +40,11 @@ static const struct entry entries[] = {
     { "abc", .expect_fail = true},
     { "  123  ", "123", NODE_INT64(123)},
     { "123.25", "123.250000", NODE_FLOAT(123.25)},
+    { "-9223372036854775808", "-9223372036854775808", NODE_INT64(INT64_MIN)},
+    { "123456789012345678901", "123456789012345683968.000000",
+        NODE_FLOAT(123456789012345678901.0)},
+    { "0x10", "16", NODE_INT64(16)},
+    { "1e3", "1000.000000", NODE_FLOAT(1000)},
     { TEXT("a\n\\\/\\\""), TEXT("a\n\\/\\\""), NODE_STR("a\n\\/\\\"")},
     { TEXT("a\u2c29"), TEXT("aⰩ"), NODE_STR("a\342\260\251")},
     { "[1,2,3]", "[1,2,3]",
@@ -66,8 +72,46 @@ static const struct entry entries[] = {
 
 #define MAX_DEPTH 10
 
+static const int tokens[] = {
+    JSON_TOKEN_MAP_START,
+        JSON_TOKEN_ARRAY_START,
+            JSON_TOKEN_INT64, JSON_TOKEN_MAP_START, JSON_TOKEN_MAP_END,
+            JSON_TOKEN_NULL,
+        JSON_TOKEN_ARRAY_END,
+        JSON_TOKEN_STRING,
+    JSON_TOKEN_MAP_END,
+    JSON_TOKEN_END,
+    JSON_TOKEN_END,
+};
+
 static void run(struct test_ctx *ctx)
 {
+    void *tmp = talloc_new(NULL);
+    char text[] = TEXT({"a": [1, {}, null], b: "c"} x);
+    struct json_tokenizer t;
+    json_tokenizer_init(&t, tmp, text, MAX_DEPTH);
+    for (int n = 0; n < MP_ARRAY_SIZE(tokens); n++) {
+        struct json_token tok;
+        assert_int_equal(json_next_token(&t, &tok), tokens[n]);
+        assert_int_equal(tok.type, tokens[n]);
+        if (n == 1)
+            assert_string_equal(tok.key, "a");
+        if (n == 7) {
+            assert_string_equal(tok.key, "b");
+            assert_string_equal(tok.u.string, "c");
+        }
+    }
+    assert_string_equal(t.src, " x");
+
+    char deep[] = "[[[1]]]";
+    json_tokenizer_init(&t, tmp, deep, 3);
+    struct json_token tok;
+    for (int n = 0; n < 3; n++)
+        assert_int_equal(json_next_token(&t, &tok), JSON_TOKEN_ARRAY_START);
+    assert_int_equal(json_next_token(&t, &tok), JSON_TOKEN_ERROR);
+    assert_int_equal(json_next_token(&t, &tok), JSON_TOKEN_ERROR);
+    talloc_free(tmp);
+
     for (int n = 0; n < MP_ARRAY_SIZE(entries); n++) {
         const struct entry *e = &entries[n];
         void *tmp = talloc_new(NULL);
@@ -92,3 +136,103 @@ const struct unittest test_json = {
     .name = "json",
     .run = run,
 };
+
+#define BENCH_ENTRIES 10000
+
+// Something like the output of youtube-dl for a long playlist.
+static void build_bench_node(void *ta_parent, struct mpv_node *dst)
+{
+    struct mpv_node_list *list = talloc_zero(ta_parent, struct mpv_node_list);
+    *dst = (struct mpv_node){.format = MPV_FORMAT_NODE_ARRAY, .u.list = list};
+    list->num = BENCH_ENTRIES;
+    list->values = talloc_array(list, struct mpv_node, list->num);
+    for (int n = 0; n < list->num; n++) {
+        struct mpv_node *e = &list->values[n];
+        *e = (struct mpv_node){.format = MPV_FORMAT_NODE_MAP,
+                               .u.list = talloc_zero(list, struct mpv_node_list)};
+        node_map_add_string(e, "url", talloc_asprintf(list,
+            "https://www.example.com/watch?v=%08d&list=PL1234567890", n));
+        node_map_add_string(e, "title", talloc_asprintf(list,
+            "Video \"%d\"\n\tdescription", n));
+        node_map_add_int64(e, "view_count", n * 12345LL);
+        node_map_add_double(e, "duration", n / 7.0);
+        node_map_add_flag(e, "is_live", n % 2);
+        node_map_add(e, "thumbnail", MPV_FORMAT_NONE);
+    }
+}
+
+struct json_bench {
+    struct mpv_node src;
+    char *text;             // json_write() output for src
+    size_t size;
+    char *buf;              // scratch copy of text (parsing modifies it)
+};
+
+static void bench_json_write(void *priv)
+{
+    struct json_bench *b = priv;
+    char *text = talloc_strdup(NULL, "");
+    assert_true(json_write(&text, &b->src) >= 0);
+    talloc_free(text);
+}
+
+static void bench_json_next_token(void *priv)
+{
+    struct json_bench *b = priv;
+    memcpy(b->buf, b->text, b->size + 1);
+    void *tmp = talloc_new(NULL);
+    struct json_tokenizer tok;
+    json_tokenizer_init(&tok, tmp, b->buf, MAX_DEPTH);
+    int count = 0;
+    struct json_token token;
+    while (json_next_token(&tok, &token) > 0)
+        count++;
+    assert_int_equal(token.type, JSON_TOKEN_END);
+    assert_int_equal(count, 2 + BENCH_ENTRIES * 8);
+    talloc_free(tmp);
+}
+
+static void bench_json_parse(void *priv)
+{
+    struct json_bench *b = priv;
+    memcpy(b->buf, b->text, b->size + 1);
+    void *tmp = talloc_new(NULL);
+    struct mpv_node res;
+    char *s = b->buf;
+    assert_true(json_parse(tmp, &res, &s, MAX_DEPTH) >= 0);
+    assert_int_equal(res.u.list->num, BENCH_ENTRIES);
+    talloc_free(tmp);
+}
+
+static void run_bench(struct test_ctx *ctx)
+{
+    void *tmp = talloc_new(NULL);
+    struct json_bench b = {0};
+    build_bench_node(tmp, &b.src);
+    b.text = talloc_strdup(tmp, "");
+    assert_true(json_write(&b.text, &b.src) >= 0);
+    b.size = strlen(b.text);
+    b.buf = talloc_size(tmp, b.size + 1);
+    MP_INFO(ctx, "json size: %zu bytes\n", b.size);
+
+    test_bench(ctx, "json_write", bench_json_write, &b);
+    test_bench(ctx, "json_next_token", bench_json_next_token, &b);
+    test_bench(ctx, "json_parse", bench_json_parse, &b);
+
+    // The parsed data is the same as what was written.
+    memcpy(b.buf, b.text, b.size + 1);
+    struct mpv_node res;
+    char *s = b.buf;
+    assert_true(json_parse(tmp, &res, &s, MAX_DEPTH) >= 0);
+    struct mpv_node *x = node_map_get(&res.u.list->values[1], "title");
+    struct mpv_node *y = node_map_get(&b.src.u.list->values[1], "title");
+    assert_true(x && equal_mpv_node(x, y));
+
+    talloc_free(tmp);
+}
+
+const struct unittest test_json_bench = {
+    .name = "json-bench",
+    .is_complex = true,
+    .run = run_bench,
+};
@@ -0,0 +1,151 @@
+#include <pthread.h>
+
+#include "common/common.h"
+#include "common/global.h"
+#include "common/msg.h"
+#include "common/msg_control.h"
+#include "osdep/atomic.h"
+#include "tests.h"
+
+#define NUM_THREADS 4
+#define NUM_MESSAGES 2000
+
+struct thread_ctx {
+    struct mp_log *log;
+    int num_messages;
+};
+
+static void *log_thread(void *p)
+{
+    struct thread_ctx *t = p;
+    for (int n = 0; n < t->num_messages; n++) {
+        if (n % 100 == 1) {
+            // Too long for the queue: output with the lock held.
+            MP_DBG(t, "%d %0600d\n", n, 0);
+        } else if (n % 100 == 2) {
+            // Partial lines are buffered with the lock held.
+            MP_DBG(t, "%d ", n);
+            MP_DBG(t, "partial\n");
+        } else {
+            MP_DBG(t, "%d\n", n);
+        }
+    }
+    return NULL;
+}
+
+static void run(struct test_ctx *ctx)
+{
+    void *tmp = talloc_new(NULL);
+    struct mp_log_buffer *buffer =
+        mp_msg_log_buffer_new(ctx->global, NUM_THREADS * NUM_MESSAGES * 2,
+                              MSGL_DEBUG, NULL, NULL);
+
+    struct thread_ctx threads[NUM_THREADS];
+    pthread_t ids[NUM_THREADS];
+    for (int n = 0; n < NUM_THREADS; n++) {
+        threads[n] = (struct thread_ctx){
+            .log = mp_log_new(tmp, ctx->global->log,
+                              mp_tprintf(20, "!msgtest%d", n)),
+            .num_messages = NUM_MESSAGES,
+        };
+        assert_true(!pthread_create(&ids[n], NULL, log_thread, &threads[n]));
+    }
+    for (int n = 0; n < NUM_THREADS; n++)
+        pthread_join(ids[n], NULL);
+
+    // Every message arrives once, and in order per thread.
+    int next[NUM_THREADS] = {0};
+    struct mp_log_buffer_entry *e;
+    while ((e = mp_msg_log_buffer_read(buffer))) {
+        int t;
+        if (sscanf(e->prefix, "msgtest%d", &t) == 1) {
+            assert_true(t >= 0 && t < NUM_THREADS);
+            assert_int_equal(e->level, MSGL_DEBUG);
+            char expect[700];
+            if (next[t] % 100 == 1) {
+                snprintf(expect, sizeof(expect), "%d %0600d\n", next[t], 0);
+            } else if (next[t] % 100 == 2) {
+                snprintf(expect, sizeof(expect), "%d partial\n", next[t]);
+            } else {
+                snprintf(expect, sizeof(expect), "%d\n", next[t]);
+            }
+            assert_string_equal(e->text, expect);
+            next[t]++;
+        }
+        talloc_free(e);
+    }
+    for (int n = 0; n < NUM_THREADS; n++)
+        assert_int_equal(next[n], NUM_MESSAGES);
+
+    mp_msg_log_buffer_destroy(buffer);
+    talloc_free(tmp);
+}
+
+const struct unittest test_msg = {
+    .name = "msg",
+    .run = run,
+};
+
+struct bench_ctx {
+    struct mp_log *log;
+    atomic_bool *stop;
+    int n;
+};
+
+static void bench_msg(void *priv)
+{
+    struct bench_ctx *c = priv;
+    MP_DBG(c, "%d\n", c->n++);
+}
+
+// Log from another thread until stopped, to contend for the log lock.
+static void *bench_log_thread(void *p)
+{
+    struct bench_ctx *c = p;
+    while (!atomic_load(c->stop))
+        bench_msg(c);
+    return NULL;
+}
+
+static void run_bench_threads(struct test_ctx *ctx, void *tmp, int num_threads)
+{
+    atomic_bool stop = ATOMIC_VAR_INIT(false);
+    struct bench_ctx threads[NUM_THREADS];
+    pthread_t ids[NUM_THREADS];
+    for (int n = 0; n < num_threads; n++) {
+        threads[n] = (struct bench_ctx){
+            .log = mp_log_new(tmp, ctx->global->log,
+                              mp_tprintf(20, "!msgbench%d", n)),
+            .stop = &stop,
+        };
+    }
+    // threads[0] is the measured one, the others run in the background.
+    for (int n = 1; n < num_threads; n++)
+        assert_true(!pthread_create(&ids[n], NULL, bench_log_thread, &threads[n]));
+    test_bench(ctx, mp_tprintf(40, "%d thread(s)", num_threads), bench_msg,
+               &threads[0]);
+    atomic_store(&stop, true);
+    for (int n = 1; n < num_threads; n++)
+        pthread_join(ids[n], NULL);
+}
+
+// Log debug messages from multiple threads into a log buffer, like a client
+// with mpv_request_log_messages(h, "debug") does.
+static void run_bench(struct test_ctx *ctx)
+{
+    void *tmp = talloc_new(NULL);
+    struct mp_log_buffer *buffer =
+        mp_msg_log_buffer_new(ctx->global, 1000, MSGL_DEBUG, NULL, NULL);
+
+    run_bench_threads(ctx, tmp, 1);
+    run_bench_threads(ctx, tmp, NUM_THREADS);
+
+    mp_msg_log_buffer_destroy(buffer);
+    talloc_free(tmp);
+}
+
+const struct unittest test_msg_bench = {
+    .name = "msg-bench",
+    .is_complex = true,
+    .run = run_bench,
+};
@@ -0,0 +1,131 @@
+#include "common/common.h"
+#include "misc/msgpack.h"
+#include "misc/node.h"
+#include "tests.h"
+
+struct entry {
+    const char *data;
+    int size;
+    struct mpv_node node;
+    bool expect_fail;
+};
+
+#define BYTES(...) .data = (const char[]){__VA_ARGS__}, \
+                   .size = sizeof((const char[]){__VA_ARGS__})
+
+#define VAL_LIST(...) (struct mpv_node[]){__VA_ARGS__}
+
+#define L(...) __VA_ARGS__
+
+#define NODE_INT64(v) {.format = MPV_FORMAT_INT64,  .u = { .int64 = (v) }}
+#define NODE_STR(v)   {.format = MPV_FORMAT_STRING, .u = { .string = (v) }}
+#define NODE_BOOL(v)  {.format = MPV_FORMAT_FLAG,   .u = { .flag = (bool)(v) }}
+#define NODE_FLOAT(v) {.format = MPV_FORMAT_DOUBLE, .u = { .double_ = (v) }}
+#define NODE_NONE()   {.format = MPV_FORMAT_NONE }
+#define NODE_ARRAY(...) {.format = MPV_FORMAT_NODE_ARRAY, .u = { .list =    \
+    &(struct mpv_node_list) {                                               \
+        .num = sizeof(VAL_LIST(__VA_ARGS__)) / sizeof(struct mpv_node),     \
+        .values = VAL_LIST(__VA_ARGS__)}}}
+#define NODE_MAP(k, v) {.format = MPV_FORMAT_NODE_MAP, .u = { .list =       \
+    &(struct mpv_node_list) {                                               \
+        .num = sizeof(VAL_LIST(v)) / sizeof(struct mpv_node),               \
+        .values = VAL_LIST(v),                                              \
+        .keys = (char**)(const char *[]){k}}}}
+
+// All entries which don't fail must use the shortest encoding, so that
+// writing the parsed node reproduces the input.
+static const struct entry entries[] = {
+    { BYTES(0xc0), NODE_NONE()},
+    { BYTES(0xc3), NODE_BOOL(true)},
+    { BYTES(0xc2), NODE_BOOL(false)},
+    { BYTES(0x05), NODE_INT64(5)},
+    { BYTES(0xff), NODE_INT64(-1)},
+    { BYTES(0xe0), NODE_INT64(-32)},
+    { BYTES(0xd0, 0xdf), NODE_INT64(-33)},
+    { BYTES(0xcc, 0x80), NODE_INT64(128)},
+    { BYTES(0xcd, 0x12, 0x34), NODE_INT64(0x1234)},
+    { BYTES(0xd1, 0xfe, 0xdc), NODE_INT64(-0x124)},
+    { BYTES(0xce, 0x12, 0x34, 0x56, 0x78), NODE_INT64(0x12345678)},
+    { BYTES(0xd3, 0x80, 0, 0, 0, 0, 0, 0, 0), NODE_INT64(INT64_MIN)},
+    { BYTES(0xcb, 0x40, 0x5e, 0xd0, 0, 0, 0, 0, 0), NODE_FLOAT(123.25)},
+    { BYTES(0xa3, 'a', 'b', 'c'), NODE_STR("abc")},
+    { BYTES(0x93, 1, 2, 3),
+        NODE_ARRAY(NODE_INT64(1), NODE_INT64(2), NODE_INT64(3))},
+    { BYTES(0x90), NODE_ARRAY()},
+    { BYTES(0x82, 0xa1, 'a', 1, 0xa1, 'b', 0xc0),
+        NODE_MAP(L("a", "b"), L(NODE_INT64(1), NODE_NONE()))},
+    { BYTES(0x80), NODE_MAP(L(), L())},
+    { BYTES(0x81, 0xa1, 'a', 0x91, 0x81, 0xa1, 'b', 0xa0),
+        NODE_MAP(L("a"), L(NODE_ARRAY(NODE_MAP(L("b"), L(NODE_STR("")))))) },
+
+    // uint64 values which don't fit into int64
+    { BYTES(0xcf, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+        .expect_fail = true},
+    // truncated data
+    { BYTES(0xcd, 0x12), .expect_fail = true},
+    { BYTES(0xa3, 'a', 'b'), .expect_fail = true},
+    { BYTES(0x92, 1), .expect_fail = true},
+    { BYTES(0xdd, 0xff, 0xff, 0xff, 0xff), .expect_fail = true},
+    // non-string map key
+    { BYTES(0x81, 1, 2), .expect_fail = true},
+    // ext types, reserved byte
+    { BYTES(0xd4, 0, 0), .expect_fail = true},
+    { BYTES(0xc1), .expect_fail = true},
+};
+
+#define MAX_DEPTH 10
+
+static void run(struct test_ctx *ctx)
+{
+    for (int n = 0; n < MP_ARRAY_SIZE(entries); n++) {
+        const struct entry *e = &entries[n];
+        void *tmp = talloc_new(NULL);
+        bstr s = {(unsigned char *)e->data, e->size};
+        struct mpv_node res;
+        bool ok = msgpack_parse(tmp, &res, &s, MAX_DEPTH) >= 0 && !s.len;
+        assert_true(ok != e->expect_fail);
+        if (!ok) {
+            talloc_free(tmp);
+            continue;
+        }
+        assert_true(equal_mpv_node(&e->node, &res));
+        bstr d = {0};
+        assert_true(msgpack_write(tmp, &d, &res) >= 0);
+        assert_int_equal(d.len, e->size);
+        assert_memcmp(d.start, e->data, e->size);
+        talloc_free(tmp);
+    }
+
+    // float32 is parsed, but written as float64
+    void *tmp = talloc_new(NULL);
+    struct mpv_node res;
+    bstr s = bstr0("\xca\x3f\xc0\x00\x00");
+    s.len = 5;
+    assert_true(msgpack_parse(tmp, &res, &s, MAX_DEPTH) >= 0);
+    assert_int_equal(res.format, MPV_FORMAT_DOUBLE);
+    assert_float_equal(res.u.double_, 1.5, 0);
+
+    // nesting limit
+    s = bstr0("\x91\x91\x91\xc0");
+    assert_true(msgpack_parse(tmp, &res, &s, 4) >= 0);
+    s = bstr0("\x91\x91\x91\xc0");
+    assert_true(msgpack_parse(tmp, &res, &s, 3) < 0);
+
+    // long strings use the wider length fields
+    char *str = talloc_zero_size(tmp, 70000);
+    memset(str, 'x', 69999);
+    struct mpv_node big = NODE_STR(str);
+    bstr d = {0};
+    assert_true(msgpack_write(tmp, &d, &big) >= 0);
+    assert_int_equal(d.len, 5 + 69999);
+    assert_int_equal(d.start[0], 0xdb);
+    s = d;
+    assert_true(msgpack_parse(tmp, &res, &s, MAX_DEPTH) >= 0);
+    assert_true(equal_mpv_node(&big, &res));
+    talloc_free(tmp);
+}
+
+const struct unittest test_msgpack = {
+    .name = "msgpack",
+    .run = run,
+};
@@ -0,0 +1,146 @@
+#include "common/common.h"
+#include "misc/json.h"
+#include "misc/node.h"
+#include "options/m_option.h"
+#include "options/m_property.h"
+#include "tests.h"
+
+static const struct m_option node_type = {.type = CONF_TYPE_NODE};
+
+// Build something that looks like the "playlist" property.
+static int get_entry(int item, int action, void *arg, void *ctx)
+{
+    char filename[40];
+    snprintf(filename, sizeof(filename), "/some/directory/file-%d.mkv", item);
+    struct m_sub_property props[] = {
+        {"filename",    SUB_PROP_STR(filename)},
+        {"current",     SUB_PROP_FLAG(1), .unavailable = item != 1},
+        {"title",       SUB_PROP_STR("title"), .unavailable = item % 3},
+        {"id",          SUB_PROP_INT64(item + 1)},
+        {0}
+    };
+    return m_property_read_sub(props, action, arg);
+}
+
+static void build_list(struct mpv_node *dst, int count)
+{
+    int r = m_property_read_list(M_PROPERTY_GET_NODE, dst, count, get_entry,
+                                 NULL);
+    assert_int_equal(r, M_PROPERTY_OK);
+    assert_int_equal(dst->format, MPV_FORMAT_NODE_ARRAY);
+    assert_int_equal(dst->u.list->num, count);
+}
+
+static void run(struct test_ctx *ctx)
+{
+    struct mpv_node list;
+    build_list(&list, 10);
+
+    struct mpv_node copy;
+    node_copy_compact(NULL, &copy, &list);
+    assert_true(equal_mpv_node(&list, &copy));
+    // Single allocation, freed like any other node.
+    assert_true(ta_get_parent(node_get_alloc(&copy)) == NULL);
+    m_option_free(&node_type, &copy);
+
+    // Scalars and strings as root.
+    struct mpv_node str = {.format = MPV_FORMAT_STRING, .u.string = "abc"};
+    node_copy_compact(NULL, &copy, &str);
+    assert_true(equal_mpv_node(&str, &copy));
+    assert_true(copy.u.string != str.u.string);
+    m_option_free(&node_type, &copy);
+
+    struct mpv_node num = {.format = MPV_FORMAT_INT64, .u.int64 = 123};
+    node_copy_compact(NULL, &copy, &num);
+    assert_true(equal_mpv_node(&num, &copy));
+
+    struct mpv_node empty = {.format = MPV_FORMAT_NODE_MAP,
+                             .u.list = &(struct mpv_node_list){0}};
+    node_copy_compact(NULL, &copy, &empty);
+    assert_true(equal_mpv_node(&empty, &copy));
+    m_option_free(&node_type, &copy);
+
+    struct node_snapshot *snap = node_snapshot_new(&list);
+    m_option_free(&node_type, &list);
+    struct node_snapshot *snap2 = node_snapshot_ref(snap);
+    assert_true(snap2 == snap);
+    node_snapshot_unref(snap);
+    const struct mpv_node *res = node_snapshot_get(snap2);
+    assert_int_equal(res->u.list->num, 10);
+    struct mpv_node *entry = &res->u.list->values[1];
+    assert_int_equal(node_map_get(entry, "id")->u.int64, 2);
+    assert_string_equal(node_map_get(entry, "filename")->u.string,
+                        "/some/directory/file-1.mkv");
+    assert_true(node_map_get(entry, "current")->u.flag);
+    node_snapshot_unref(snap2);
+}
+
+const struct unittest test_node = {
+    .name = "node",
+    .run = run,
+};
+
+#define BENCH_ENTRIES 10000
+#define BENCH_OBSERVERS 8
+
+static void bench_build(void *priv)
+{
+    struct mpv_node list;
+    build_list(&list, BENCH_ENTRIES);
+    m_option_free(&node_type, &list);
+}
+
+static void bench_deep_copy(void *priv)
+{
+    struct mpv_node copy = {0};
+    m_option_copy(&node_type, &copy, priv);
+    m_option_free(&node_type, &copy);
+}
+
+static void bench_compact_copy(void *priv)
+{
+    struct mpv_node copy;
+    node_copy_compact(NULL, &copy, priv);
+    m_option_free(&node_type, &copy);
+}
+
+// What sharing a property value with BENCH_OBSERVERS observers costs.
+static void bench_snapshot(void *priv)
+{
+    struct node_snapshot *snap = node_snapshot_new(priv);
+    struct node_snapshot *refs[BENCH_OBSERVERS];
+    for (int n = 0; n < BENCH_OBSERVERS; n++)
+        refs[n] = node_snapshot_ref(snap);
+    node_snapshot_unref(snap);
+    for (int n = 0; n < BENCH_OBSERVERS; n++)
+        node_snapshot_unref(refs[n]);
+}
+
+static void bench_json_write(void *priv)
+{
+    char *json = talloc_strdup(NULL, "");
+    json_write(&json, priv);
+    talloc_free(json);
+}
+
+// Compare the costs of building, copying, sharing, and serializing a playlist
+// with BENCH_ENTRIES entries.
+static void run_bench(struct test_ctx *ctx)
+{
+    struct mpv_node list;
+    build_list(&list, BENCH_ENTRIES);
+
+    test_bench(ctx, "build + free", bench_build, NULL);
+    test_bench(ctx, "deep copy + free", bench_deep_copy, &list);
+    test_bench(ctx, "compact copy + free", bench_compact_copy, &list);
+    test_bench(ctx, "snapshot + refs", bench_snapshot, &list);
+    test_bench(ctx, "json_write", bench_json_write, &list);
+
+    m_option_free(&node_type, &list);
+}
+
+const struct unittest test_node_bench = {
+    .name = "node-bench",
+    .is_complex = true,
+    .run = run_bench,
+};
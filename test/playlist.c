@@ -0,0 +1,273 @@
+#include "common/common.h"
+#include "common/playlist.h"
+#include "tests.h"
+
+static struct playlist_entry *entry(struct playlist *pl, int index)
+{
+    struct playlist_entry *e = playlist_entry_from_index(pl, index);
+    assert_true(e);
+    assert_int_equal(playlist_entry_to_index(pl, e), index);
+    return e;
+}
+
+// A client-side copy of the playlist, which only knows the entry IDs.
+struct mirror {
+    uint64_t *ids;
+    int num_ids;
+    uint64_t generation;
+};
+
+static void sync_mirror(struct mirror *m, struct playlist *pl)
+{
+    struct playlist_change *changes;
+    int num = playlist_get_changes(pl, m->generation, &changes);
+    if (num < 0) {
+        m->num_ids = 0;
+        for (int n = 0; n < pl->num_entries; n++)
+            MP_TARRAY_APPEND(NULL, m->ids, m->num_ids, entry(pl, n)->id);
+        m->generation = pl->generation;
+        return;
+    }
+
+    for (int n = 0; n < num; n++) {
+        struct playlist_change *c = &changes[n];
+        assert_int_equal(c->generation, m->generation + 1);
+        m->generation = c->generation;
+        switch (c->type) {
+        case PLAYLIST_CHANGE_INSERT:
+            MP_TARRAY_INSERT_N_AT(NULL, m->ids, m->num_ids, c->index, c->count);
+            for (int i = 0; i < c->count; i++) {
+                m->ids[c->index + i] = c->id + i;
+                struct playlist_entry *e = playlist_get_added_entry(pl, c->id + i);
+                if (e) {
+                    assert_int_equal(e->id, c->id + i);
+                    assert_true(e->pl == pl);
+                }
+            }
+            break;
+        case PLAYLIST_CHANGE_REMOVE:
+            assert_int_equal(m->ids[c->index], c->id);
+            MP_TARRAY_REMOVE_AT(m->ids, m->num_ids, c->index);
+            break;
+        case PLAYLIST_CHANGE_MOVE:
+            assert_int_equal(m->ids[c->index], c->id);
+            MP_TARRAY_REMOVE_AT(m->ids, m->num_ids, c->index);
+            MP_TARRAY_INSERT_AT(NULL, m->ids, m->num_ids, c->new_index, c->id);
+            break;
+        case PLAYLIST_CHANGE_CLEAR:
+            m->num_ids = 0;
+            if (c->id)
+                MP_TARRAY_APPEND(NULL, m->ids, m->num_ids, c->id);
+            break;
+        }
+    }
+    assert_int_equal(m->generation, pl->generation);
+}
+
+static void check_mirror(struct mirror *m, struct playlist *pl)
+{
+    sync_mirror(m, pl);
+    assert_int_equal(m->num_ids, pl->num_entries);
+    for (int n = 0; n < pl->num_entries; n++)
+        assert_int_equal(m->ids[n], entry(pl, n)->id);
+}
+
+static void add_files(struct playlist *pl, int count)
+{
+    for (int n = 0; n < count; n++)
+        playlist_add_file(pl, "file");
+}
+
+static void run(struct test_ctx *ctx)
+{
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    pl->track_changes = true;
+    struct mirror m = {0};
+
+    check_mirror(&m, pl);
+    add_files(pl, 10);
+    check_mirror(&m, pl);
+
+    playlist_move(pl, entry(pl, 2), entry(pl, 7));
+    playlist_move(pl, entry(pl, 8), entry(pl, 0));
+    playlist_move(pl, entry(pl, 3), NULL);
+    struct playlist_entry *removed = entry(pl, 5);
+    uint64_t removed_id = removed->id;
+    assert_true(playlist_get_added_entry(pl, removed_id) == removed);
+    playlist_remove(pl, removed);
+    assert_true(!playlist_get_added_entry(pl, removed_id));
+    check_mirror(&m, pl);
+
+    struct playlist *add = talloc_zero(NULL, struct playlist);
+    add_files(add, 5);
+    pl->current = entry(pl, 3);
+    playlist_transfer_entries(pl, add);
+    playlist_append_entries(pl, add); // empty, no change recorded
+    talloc_free(add);
+    check_mirror(&m, pl);
+
+    playlist_clear_except_current(pl);
+    add_files(pl, 3);
+    check_mirror(&m, pl);
+
+    // Too many changes: the oldest ones are forgotten.
+    uint64_t old = m.generation;
+    add_files(pl, 1000);
+    struct playlist_change *changes;
+    assert_int_equal(playlist_get_changes(pl, old, &changes), -1);
+    check_mirror(&m, pl);
+
+    // Mix of operations that spread across multiple internal blocks.
+    srand(1);
+    add_files(pl, 5000);
+    for (int n = 0; n < 2000; n++) {
+        int num = pl->num_entries;
+        switch (rand() % 4) {
+        case 0:
+            playlist_move(pl, entry(pl, rand() % num), entry(pl, rand() % num));
+            break;
+        case 1:
+            playlist_move(pl, entry(pl, rand() % num), NULL);
+            break;
+        case 2:
+            playlist_remove(pl, entry(pl, rand() % num));
+            break;
+        case 3:
+            add = talloc_zero(NULL, struct playlist);
+            add_files(add, rand() % 2000);
+            pl->current = entry(pl, rand() % num);
+            playlist_transfer_entries(pl, add);
+            talloc_free(add);
+            break;
+        }
+        if (n % 50 == 0)
+            check_mirror(&m, pl);
+    }
+    check_mirror(&m, pl);
+
+    uint64_t *ids = talloc_memdup(NULL, m.ids, m.num_ids * sizeof(m.ids[0]));
+    playlist_shuffle(pl);
+    assert_int_equal(playlist_get_changes(pl, m.generation, &changes), -1);
+    check_mirror(&m, pl);
+    assert_int_equal(playlist_get_changes(pl, m.generation, &changes), 0);
+    playlist_unshuffle(pl);
+    check_mirror(&m, pl);
+    assert_memcmp(ids, m.ids, m.num_ids * sizeof(m.ids[0]));
+    talloc_free(ids);
+
+    // Iteration in both directions.
+    int count = 0;
+    struct playlist_entry *e = playlist_get_first(pl);
+    for (; e; e = playlist_entry_get_rel(e, 1))
+        assert_int_equal(e->id, m.ids[count++]);
+    assert_int_equal(count, pl->num_entries);
+    for (e = playlist_get_last(pl); e; e = playlist_entry_get_rel(e, -1))
+        assert_int_equal(e->id, m.ids[--count]);
+    assert_int_equal(count, 0);
+
+    playlist_clear(pl);
+    check_mirror(&m, pl);
+    assert_true(!playlist_get_first(pl));
+
+    talloc_free(m.ids);
+    talloc_free(pl);
+}
+
+const struct unittest test_playlist = {
+    .name = "playlist",
+    .run = run,
+};
+
+#define BENCH_ENTRIES 100000
+
+// Load a playlist like loadlist does, and clear it again.
+static void bench_load(void *priv)
+{
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    pl->track_changes = true;
+    struct playlist *src = talloc_zero(NULL, struct playlist);
+    add_files(src, BENCH_ENTRIES);
+    playlist_append_entries(pl, src);
+    talloc_free(src);
+    playlist_clear(pl);
+    talloc_free(pl);
+}
+
+static void bench_index_lookup(void *priv)
+{
+    struct playlist *pl = priv;
+    int index = rand() % pl->num_entries;
+    struct playlist_entry *e = playlist_entry_from_index(pl, index);
+    assert_int_equal(playlist_entry_to_index(pl, e), index);
+}
+
+static void bench_move(void *priv)
+{
+    struct playlist *pl = priv;
+    int num = pl->num_entries;
+    playlist_move(pl, playlist_entry_from_index(pl, rand() % num),
+                      playlist_entry_from_index(pl, rand() % num));
+}
+
+static void bench_insert(void *priv)
+{
+    struct playlist *pl = priv;
+    pl->current = playlist_entry_from_index(pl, rand() % pl->num_entries);
+    struct playlist *add = talloc_zero(NULL, struct playlist);
+    playlist_add_file(add, "file");
+    playlist_transfer_entries(pl, add);
+    talloc_free(add);
+}
+
+// Appends an entry too, so that the playlist size stays the same.
+static void bench_remove(void *priv)
+{
+    struct playlist *pl = priv;
+    int index = rand() % pl->num_entries;
+    playlist_remove(pl, playlist_entry_from_index(pl, index));
+    playlist_add_file(pl, "file");
+}
+
+static void bench_shuffle(void *priv)
+{
+    struct playlist *pl = priv;
+    playlist_shuffle(pl);
+    playlist_unshuffle(pl);
+}
+
+static void bench_iterate(void *priv)
+{
+    struct playlist *pl = priv;
+    int count = 0;
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+        count++;
+    assert_int_equal(count, pl->num_entries);
+}
+
+// Apply random operations of each kind to a playlist with BENCH_ENTRIES
+// entries.
+static void run_bench(struct test_ctx *ctx)
+{
+    srand(1);
+    test_bench(ctx, "load + clear", bench_load, NULL);
+
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    pl->track_changes = true;
+    add_files(pl, BENCH_ENTRIES);
+
+    test_bench(ctx, "index lookup", bench_index_lookup, pl);
+    test_bench(ctx, "move", bench_move, pl);
+    test_bench(ctx, "remove + append", bench_remove, pl);
+    test_bench(ctx, "shuffle + unshuffle", bench_shuffle, pl);
+    test_bench(ctx, "iterate", bench_iterate, pl);
+    test_bench(ctx, "insert", bench_insert, pl);
+
+    talloc_free(pl);
+}
+
+const struct unittest test_playlist_bench = {
+    .name = "playlist-bench",
+    .is_complex = true,
+    .run = run_bench,
+};
@@ -0,0 +1,161 @@
+#include "common/common.h"
+#include "demux/packet.h"
+#include "demux/stheader.h"
+#include "options/m_config.h"
+#include "options/options.h"
+#include "sub/sd.h"
+#include "tests.h"
+
+extern const struct sd_functions sd_ass;
+
+// SRT-like packets, 2 seconds apart. Packet n has the text "line n".
+static struct demux_packet **make_packets(void *ta_parent, int num,
+                                          bool unknown_duration)
+{
+    struct demux_packet **pkts = talloc_array(ta_parent, struct demux_packet *,
+                                              num);
+    for (int n = 0; n < num; n++) {
+        char text[40];
+        snprintf(text, sizeof(text), "line %d", n);
+        struct demux_packet *pkt = new_demux_packet_from(text, strlen(text));
+        pkt->pts = n * 2.0;
+        pkt->duration = unknown_duration ? -1 : 1.5;
+        pkt->pos = n * 40;
+        pkts[n] = talloc_steal(pkts, pkt);
+    }
+    return pkts;
+}
+
+static struct sd *create_sd(struct test_ctx *ctx, void *ta_parent)
+{
+    struct mp_codec_params *codec = talloc_zero(ta_parent,
+                                                struct mp_codec_params);
+    codec->type = STREAM_SUB;
+    codec->codec = "subrip";
+    struct m_config_cache *opts =
+        m_config_cache_alloc(ta_parent, ctx->global, &mp_subtitle_sub_opts);
+    struct sd *sd = talloc_zero(ta_parent, struct sd);
+    *sd = (struct sd){
+        .global = ctx->global,
+        .log = mp_log_new(sd, ctx->log, "sd"),
+        .opts = opts->opts,
+        .driver = &sd_ass,
+        .codec = codec,
+        .preload_ok = true,
+    };
+    assert_int_equal(sd->driver->init(sd), 0);
+    return sd;
+}
+
+static void destroy_sd(struct sd *sd)
+{
+    sd->driver->uninit(sd);
+}
+
+// Check that line n is shown (once) at its timestamp.
+static void check_line(struct sd *sd, int n)
+{
+    char *text = sd->driver->get_text(sd, n * 2.0 + 0.5, SD_TEXT_TYPE_PLAIN);
+    assert_string_equal(text, mp_tprintf(40, "line %d", n));
+    talloc_free(text);
+}
+
+// Feed the packets to the decoder in the given order.
+static void decode_packets(struct sd *sd, struct demux_packet **pkts,
+                           int start, int end, int step)
+{
+    for (int n = start; n != end; n += step)
+        sd->driver->decode(sd, pkts[n]);
+}
+
+static void run(struct test_ctx *ctx)
+{
+    void *tmp = talloc_new(NULL);
+    int num = 1000;
+
+    // Duplicates (e.g. after seeking back) are ignored, in any order.
+    struct demux_packet **pkts = make_packets(tmp, num, false);
+    struct sd *sd = create_sd(ctx, tmp);
+    decode_packets(sd, pkts, num / 2, num, 1);
+    decode_packets(sd, pkts, num - 1, -1, -1);
+    decode_packets(sd, pkts, 0, num, 1);
+    for (int n = 0; n < num; n++)
+        check_line(sd, n);
+    destroy_sd(sd);
+
+    // Unknown durations last until the next line.
+    pkts = make_packets(tmp, num, true);
+    sd = create_sd(ctx, tmp);
+    decode_packets(sd, pkts, 0, num, 1);
+    for (int n = 0; n < num; n++)
+        check_line(sd, n);
+    char *text = sd->driver->get_text(sd, 3.9, SD_TEXT_TYPE_PLAIN);
+    assert_string_equal(text, "line 1");
+    talloc_free(text);
+    destroy_sd(sd);
+
+    talloc_free(tmp);
+}
+
+const struct unittest test_sd_ass = {
+    .name = "sd-ass",
+    .run = run,
+};
+
+#define BENCH_LINES 10000
+
+struct bench_ctx {
+    struct test_ctx *ctx;
+    struct demux_packet **pkts;
+    bool reverse;
+    bool seek_back;
+};
+
+static void bench_decode(void *priv)
+{
+    struct bench_ctx *b = priv;
+    void *tmp = talloc_new(NULL);
+    struct sd *sd = create_sd(b->ctx, tmp);
+
+    if (b->seek_back)
+        decode_packets(sd, b->pkts, BENCH_LINES / 2, BENCH_LINES, 1);
+    if (b->reverse) {
+        decode_packets(sd, b->pkts, BENCH_LINES - 1, -1, -1);
+    } else {
+        decode_packets(sd, b->pkts, 0, BENCH_LINES, 1);
+    }
+
+    check_line(sd, BENCH_LINES - 1);
+    destroy_sd(sd);
+    talloc_free(tmp);
+}
+
+// Ingestion time of a 10k line SRT file, as read by a subtitle preload or by
+// playback with seeks.
+static void run_bench(struct test_ctx *ctx)
+{
+    void *tmp = talloc_new(NULL);
+
+    struct bench_ctx b = {
+        .ctx = ctx,
+        .pkts = make_packets(tmp, BENCH_LINES, false),
+    };
+    test_bench(ctx, "in order", bench_decode, &b);
+    b.reverse = true;
+    test_bench(ctx, "reverse order", bench_decode, &b);
+    b.reverse = false;
+    b.seek_back = true;
+    test_bench(ctx, "seek back", bench_decode, &b);
+    b.seek_back = false;
+
+    b.pkts = make_packets(tmp, BENCH_LINES, true);
+    test_bench(ctx, "unknown duration", bench_decode, &b);
+
+    talloc_free(tmp);
+}
+
+const struct unittest test_sd_ass_bench = {
+    .name = "sd-ass-bench",
+    .is_complex = true,
+    .run = run_bench,
+};
@@ -0,0 +1,235 @@
+#include <pthread.h>
+#include <sched.h>
+
+#include "common/common.h"
+#include "common/msg.h"
+#include "libmpv/client.h"
+#include "misc/spsc_queue.h"
+#include "osdep/atomic.h"
+#include "tests.h"
+
+#define NUM_ITEMS 1000000
+
+static void *producer(void *p)
+{
+    struct mp_spsc_queue *q = p;
+    for (int64_t n = 0; n < NUM_ITEMS; n++) {
+        int64_t *slot;
+        while (!(slot = mp_spsc_queue_write_slot(q)))
+            sched_yield();
+        *slot = n;
+        mp_spsc_queue_push(q);
+    }
+    return NULL;
+}
+
+static void run(struct test_ctx *ctx)
+{
+    struct mp_spsc_queue *q = mp_spsc_queue_create(NULL, sizeof(int64_t), 5);
+    assert_int_equal(mp_spsc_queue_capacity(q), 5);
+    assert_true(!mp_spsc_queue_peek(q));
+
+    // Wrap around the 8 internal slots a few times.
+    int64_t next_write = 0, next_read = 0;
+    for (int round = 0; round < 10; round++) {
+        int64_t *slot;
+        while ((slot = mp_spsc_queue_write_slot(q))) {
+            *slot = next_write++;
+            mp_spsc_queue_push(q);
+        }
+        assert_int_equal(mp_spsc_queue_count(q), 5);
+        for (int n = 0; n < round % 5 + 1; n++) {
+            int64_t *v = mp_spsc_queue_peek(q);
+            assert_true(v);
+            assert_int_equal(*v, next_read++);
+            mp_spsc_queue_pop(q);
+        }
+    }
+    int64_t *v;
+    while ((v = mp_spsc_queue_peek(q))) {
+        assert_int_equal(*v, next_read++);
+        mp_spsc_queue_pop(q);
+    }
+    assert_int_equal(next_read, next_write);
+    assert_int_equal(mp_spsc_queue_count(q), 0);
+    talloc_free(q);
+
+    // Concurrent use: everything arrives exactly once and in order.
+    q = mp_spsc_queue_create(NULL, sizeof(int64_t), 100);
+    pthread_t thread;
+    assert_true(!pthread_create(&thread, NULL, producer, q));
+    for (int64_t n = 0; n < NUM_ITEMS; n++) {
+        while (!(v = mp_spsc_queue_peek(q)))
+            sched_yield();
+        assert_int_equal(*v, n);
+        mp_spsc_queue_pop(q);
+    }
+    pthread_join(thread, NULL);
+    assert_true(!mp_spsc_queue_peek(q));
+    talloc_free(q);
+}
+
+const struct unittest test_spsc_queue = {
+    .name = "spsc_queue",
+    .run = run,
+};
+
+#define BENCH_QUEUE_SIZE 1000
+
+// Mutex protected ring buffer, like the mpv_handle event queue used to be.
+struct locked_queue {
+    pthread_mutex_t lock;
+    mpv_event events[BENCH_QUEUE_SIZE];
+    int first, num;
+};
+
+struct bench_queues {
+    bool locked;
+    struct locked_queue *lq[2];
+    struct mp_spsc_queue *q[2];
+    atomic_bool stop;
+    uint64_t next;          // expected reply_userdata of the next event
+};
+
+static bool bench_push(struct bench_queues *b, int i, mpv_event *ev)
+{
+    if (b->locked) {
+        struct locked_queue *lq = b->lq[i];
+        pthread_mutex_lock(&lq->lock);
+        bool ok = lq->num < BENCH_QUEUE_SIZE;
+        if (ok) {
+            lq->events[(lq->first + lq->num) % BENCH_QUEUE_SIZE] = *ev;
+            lq->num++;
+        }
+        pthread_mutex_unlock(&lq->lock);
+        return ok;
+    }
+    mpv_event *slot = mp_spsc_queue_write_slot(b->q[i]);
+    if (!slot)
+        return false;
+    *slot = *ev;
+    mp_spsc_queue_push(b->q[i]);
+    return true;
+}
+
+static bool bench_pop(struct bench_queues *b, int i, mpv_event *ev)
+{
+    if (b->locked) {
+        struct locked_queue *lq = b->lq[i];
+        pthread_mutex_lock(&lq->lock);
+        bool ok = lq->num > 0;
+        if (ok) {
+            *ev = lq->events[lq->first];
+            lq->first = (lq->first + 1) % BENCH_QUEUE_SIZE;
+            lq->num--;
+        }
+        pthread_mutex_unlock(&lq->lock);
+        return ok;
+    }
+    mpv_event *slot = mp_spsc_queue_peek(b->q[i]);
+    if (!slot)
+        return false;
+    *ev = *slot;
+    mp_spsc_queue_pop(b->q[i]);
+    return true;
+}
+
+// Send events as fast as possible until stopped.
+static void *bench_producer(void *p)
+{
+    struct bench_queues *b = p;
+    mpv_event ev = {.event_id = MPV_EVENT_CLIENT_MESSAGE};
+    while (!atomic_load(&b->stop)) {
+        if (bench_push(b, 0, &ev)) {
+            ev.reply_userdata++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Send every event straight back until stopped.
+static void *bench_echo(void *p)
+{
+    struct bench_queues *b = p;
+    mpv_event ev;
+    while (!atomic_load(&b->stop)) {
+        if (!bench_pop(b, 0, &ev)) {
+            sched_yield();
+            continue;
+        }
+        while (!bench_push(b, 1, &ev))
+            sched_yield();
+    }
+    return NULL;
+}
+
+// Throughput: receive one event from the producer thread.
+static void bench_receive(void *priv)
+{
+    struct bench_queues *b = priv;
+    mpv_event ev;
+    while (!bench_pop(b, 0, &ev))
+        sched_yield();
+    assert_int_equal(ev.reply_userdata, b->next);
+    b->next++;
+}
+
+// Latency: one round trip through the echo thread, both sides polling.
+static void bench_round_trip(void *priv)
+{
+    struct bench_queues *b = priv;
+    mpv_event ev = {.event_id = MPV_EVENT_CLIENT_MESSAGE,
+                    .reply_userdata = b->next};
+    while (!bench_push(b, 0, &ev))
+        sched_yield();
+    while (!bench_pop(b, 1, &ev))
+        sched_yield();
+    assert_int_equal(ev.reply_userdata, b->next);
+    b->next++;
+}
+
+static void run_bench_thread(struct test_ctx *ctx, const char *name,
+                             void *(*thread_fn)(void *), void (*fn)(void *),
+                             bool locked)
+{
+    struct bench_queues b = {.locked = locked};
+    for (int i = 0; i < 2; i++) {
+        b.lq[i] = talloc_zero(NULL, struct locked_queue);
+        pthread_mutex_init(&b.lq[i]->lock, NULL);
+        b.q[i] = mp_spsc_queue_create(NULL, sizeof(mpv_event), BENCH_QUEUE_SIZE);
+    }
+
+    pthread_t thread;
+    assert_true(!pthread_create(&thread, NULL, thread_fn, &b));
+    test_bench(ctx, name, fn, &b);
+    atomic_store(&b.stop, true);
+    pthread_join(thread, NULL);
+
+    for (int i = 0; i < 2; i++) {
+        pthread_mutex_destroy(&b.lq[i]->lock);
+        talloc_free(b.lq[i]);
+        talloc_free(b.q[i]);
+    }
+}
+
+// Compare the event queue against a mutex protected queue with the same size
+// and element type.
+static void run_bench(struct test_ctx *ctx)
+{
+    for (int n = 0; n < 2; n++) {
+        bool locked = n == 0;
+        const char *mode = locked ? "mutex" : "lock-free";
+        run_bench_thread(ctx, mp_tprintf(40, "%s throughput", mode),
+                         bench_producer, bench_receive, locked);
+        run_bench_thread(ctx, mp_tprintf(40, "%s round trip", mode),
+                         bench_echo, bench_round_trip, locked);
+    }
+}
+
+const struct unittest test_spsc_queue_bench = {
+    .name = "spsc_queue-bench",
+    .is_complex = true,
+    .run = run_bench,
+};
@@ -0,0 +1,139 @@
+#include "common/common.h"
+#include "tests.h"
+
+static int destroyed[8], num_destroyed;
+
+static void destroy_int(void *p)
+{
+    destroyed[num_destroyed++] = *(int *)p;
+}
+
+static int *new_int(void *ta_parent, int val, bool destructor)
+{
+    int *p = talloc(ta_parent, int);
+    *p = val;
+    if (destructor)
+        talloc_set_destructor(p, destroy_int);
+    return p;
+}
+
+static void test_arena(void)
+{
+    num_destroyed = 0;
+    void *arena = talloc_arena_new(NULL);
+
+    // Enough data to need additional blocks.
+    char *s = talloc_strdup(arena, "");
+    for (int n = 0; n < 2000; n++)
+        s = talloc_asprintf_append_buffer(s, "%d,", n);
+    assert_true(strncmp(s, "0,1,2,3,", 8) == 0);
+
+    int *a = new_int(arena, 1, true);
+    int *b = new_int(a, 2, true);
+    int *c = new_int(arena, 3, true);
+    talloc_free(c);
+    assert_int_equal(num_destroyed, 1);
+    assert_int_equal(destroyed[0], 3);
+
+    // Not the most recent allocation, so this copies it.
+    a = talloc_realloc_size(NULL, a, 10000);
+    assert_int_equal(*a, 1);
+    assert_int_equal(talloc_get_size(a), 10000);
+
+    // Non-arena allocations can be moved into the arena.
+    int *d = new_int(NULL, 4, true);
+    talloc_steal(b, d);
+
+    // Destructors run in the order they were set.
+    talloc_free_children(arena);
+    assert_int_equal(num_destroyed, 4);
+    assert_int_equal(destroyed[1], 1);
+    assert_int_equal(destroyed[2], 2);
+    assert_int_equal(destroyed[3], 4);
+
+    // Still usable after that.
+    void *ctx = talloc_new(arena);
+    s = talloc_strdup(ctx, "abc");
+    talloc_steal(arena, s);
+    talloc_free(ctx);
+    assert_string_equal(s, "abc");
+
+    // Arenas can be nested.
+    void *inner = talloc_arena_new(arena);
+    new_int(inner, 5, true);
+    talloc_free(arena);
+    assert_int_equal(num_destroyed, 5);
+    assert_int_equal(destroyed[4], 5);
+}
+
+static bool get_acct(const char *name, long long *bytes, long long *count)
+{
+    struct ta_acct_stats st[TA_ACCT_MAX_TAGS];
+    int num = ta_acct_get_stats(st);
+    for (int n = 0; n < num; n++) {
+        if (strcmp(st[n].name, name) == 0) {
+            *bytes = st[n].bytes;
+            *count = st[n].count;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_acct(void)
+{
+    if (!ta_acct_enable(true))
+        return;
+
+    long long bytes, count;
+    void *root = talloc_size(NULL, 100);
+    ta_acct_set_tag(root, "test");
+    assert_true(get_acct("test", &bytes, &count));
+    assert_int_equal(bytes, 100);
+    assert_int_equal(count, 1);
+
+    // Children inherit the tag.
+    char *s = talloc_strdup(root, "abc");
+    s = talloc_realloc_size(NULL, s, 50);
+    assert_true(get_acct("test", &bytes, &count));
+    assert_int_equal(bytes, 150);
+    assert_int_equal(count, 2);
+
+    void *arena = talloc_arena_new(root);
+    for (int n = 0; n < 100; n++)
+        talloc_strdup(arena, "some string which is not too short");
+    assert_true(get_acct("test", &bytes, &count));
+    assert_true(bytes > 150 + 100 * 35);
+
+    talloc_free(root);
+    assert_true(get_acct("test", &bytes, &count));
+    assert_int_equal(bytes, 0);
+    assert_int_equal(count, 0);
+
+    // Allocations made while disabled are not accounted, and must not break
+    // the totals when freed.
+    root = talloc_size(NULL, 100);
+    ta_acct_set_tag(root, "test");
+    ta_acct_enable(false);
+    talloc_size(root, 100);
+    ta_acct_enable(true);
+    assert_true(get_acct("test", &bytes, &count));
+    assert_int_equal(bytes, 100);
+    talloc_free(root);
+    assert_true(get_acct("test", &bytes, &count));
+    assert_int_equal(bytes, 0);
+    assert_int_equal(count, 0);
+
+    ta_acct_enable(false);
+}
+
+static void run(struct test_ctx *ctx)
+{
+    test_arena();
+    test_acct();
+}
+
+const struct unittest test_ta = {
+    .name = "ta",
+    .run = run,
+};
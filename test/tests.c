@@ -1,16 +1,37 @@
+#include "misc/json.h"
+#include "misc/node.h"
 #include "options/path.h"
 #include "osdep/subprocess.h"
+#include "osdep/timer.h"
 #include "player/core.h"
 #include "tests.h"
 
 static const struct unittest *unittests[] = {
+    &test_bench_primitives,
     &test_chmap,
     &test_gl_video,
+    &test_histogram,
     &test_img_format,
+    &test_ipc,
     &test_json,
+    &test_json_bench,
     &test_linked_list,
+    &test_msg,
+    &test_msg_bench,
+    &test_msgpack,
+    &test_node,
+    &test_node_bench,
     &test_paths,
+    &test_playlist,
+    &test_playlist_bench,
     &test_repack_sws,
+    &test_sd_ass,
+    &test_sd_ass_bench,
+    &test_spsc_queue,
+    &test_spsc_queue_bench,
+    &test_ta,
+    &test_trace,
+    &test_trace_bench,
 #if HAVE_ZIMG
     &test_repack, // zimg only due to cross-checking with zimg.c
     &test_repack_zimg,
@@ -34,6 +55,7 @@ bool run_tests(struct MPContext *mpctx)
     struct test_ctx ctx = {
         .global = mpctx->global,
         .log = mpctx->log,
+        .mpctx = mpctx,
         .ref_path = "test/ref",
         .out_path = "test/out",
     };
@@ -45,6 +67,10 @@ bool run_tests(struct MPContext *mpctx)
     mp_mkdirp(ctx.out_path);
     assert(mp_path_isdir(ctx.out_path));
 
+    struct mpv_node bench_results;
+    node_init(&bench_results, MPV_FORMAT_NODE_MAP, NULL);
+    ctx.bench_results = &bench_results;
+
     int num_run = 0;
 
     for (int n = 0; unittests[n]; n++) {
@@ -59,12 +85,30 @@ bool run_tests(struct MPContext *mpctx)
         run |= strcmp(sel, t->name) == 0;
 
         if (run) {
+            ctx.test_name = t->name;
             if (t->run)
                 t->run(&ctx);
             num_run++;
         }
     }
 
+    if (bench_results.u.list->num) {
+        struct mpv_node root;
+        node_init(&root, MPV_FORMAT_NODE_MAP, NULL);
+        node_map_add_string(&root, "version", mpv_version);
+        *node_map_add(&root, "results", MPV_FORMAT_NONE) = bench_results;
+        talloc_steal(root.u.list, bench_results.u.list);
+
+        char *s = talloc_strdup(root.u.list, "");
+        json_write_pretty(&s, &root);
+        FILE *f = test_open_out(&ctx, "bench.json");
+        fprintf(f, "%s\n", s);
+        fclose(f);
+        talloc_free(root.u.list);
+    } else {
+        talloc_free(bench_results.u.list);
+    }
+
     MP_INFO(mpctx, "%d unittests successfully run.\n", num_run);
 
     return num_run > 0; // still error if none
@@ -111,6 +155,76 @@ FILE *test_open_out(struct test_ctx *ctx, const char *name)
     return f;
 }
 
+#define BENCH_WARMUP_US 50000
+#define BENCH_BATCH_US 2000
+#define BENCH_BATCHES 25
+
+static int cmp_double(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return da < db ? -1 : da > db;
+}
+
+void test_bench(struct test_ctx *ctx, const char *name,
+                void (*fn)(void *priv), void *priv)
+{
+    // Warmup, and estimate how many calls fit into a batch.
+    int64_t calls = 0;
+    int64_t start = mp_time_us();
+    int64_t t;
+    do {
+        fn(priv);
+        calls++;
+        t = mp_time_us() - start;
+    } while (t < BENCH_WARMUP_US);
+    int64_t batch = MPMAX(1, calls * BENCH_BATCH_US / MPMAX(t, 1));
+
+    // Count allocations too, if the leak report is enabled (MPV_LEAK_REPORT=1).
+    struct ta_dbg_stats ta_start, ta_end;
+    bool have_ta = ta_dbg_get_stats(&ta_start);
+
+    double ns[BENCH_BATCHES];
+    double sum = 0;
+    for (int n = 0; n < BENCH_BATCHES; n++) {
+        start = mp_time_us();
+        for (int64_t i = 0; i < batch; i++)
+            fn(priv);
+        ns[n] = (mp_time_us() - start) * 1e3 / batch;
+        sum += ns[n];
+    }
+    have_ta = have_ta && ta_dbg_get_stats(&ta_end);
+    double mean = sum / BENCH_BATCHES;
+    double var = 0;
+    for (int n = 0; n < BENCH_BATCHES; n++)
+        var += (ns[n] - mean) * (ns[n] - mean);
+    double stddev = sqrt(var / (BENCH_BATCHES - 1));
+    qsort(ns, BENCH_BATCHES, sizeof(ns[0]), cmp_double);
+    double median = ns[BENCH_BATCHES / 2];
+
+    MP_INFO(ctx, "%-32s %12.1f ns/call (min %.1f, mean %.1f, stddev %.1f)\n",
+            name, median, ns[0], mean, stddev);
+
+    char *key = mp_tprintf(80, "%s/%s", ctx->test_name, name);
+    struct mpv_node *r = node_map_add(ctx->bench_results, key,
+                                      MPV_FORMAT_NODE_MAP);
+    node_map_add_double(r, "median", median);
+    node_map_add_double(r, "min", ns[0]);
+    node_map_add_double(r, "mean", mean);
+    node_map_add_double(r, "stddev", stddev);
+    node_map_add_int64(r, "calls", batch * BENCH_BATCHES);
+
+    if (have_ta) {
+        double allocs = (ta_end.num_allocs - ta_start.num_allocs) /
+                        (double)(batch * BENCH_BATCHES);
+        double bytes = (ta_end.alloc_bytes - ta_start.alloc_bytes) /
+                       (double)(batch * BENCH_BATCHES);
+        MP_INFO(ctx, "%-32s %12.1f allocations/call, %.0f bytes/call\n", "",
+                allocs, bytes);
+        node_map_add_double(r, "allocs", allocs);
+        node_map_add_double(r, "alloc-bytes", bytes);
+    }
+}
+
 void assert_text_files_equal_impl(const char *file, int line,
                                   struct test_ctx *ctx, const char *ref,
                                   const char *new, const char *err)
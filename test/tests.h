@@ -14,11 +14,21 @@ struct test_ctx {
     struct mpv_global *global;
     struct mp_log *log;
 
+    // The player core, for tests that use the client API. Nothing else runs
+    // the core's dispatch queue while the tests run.
+    struct MPContext *mpctx;
+
     // Path for ref files, without trailing "/".
     const char *ref_path;
 
     // Path for result files, without trailing "/".
     const char *out_path;
+
+    // Name of the running unittest.
+    const char *test_name;
+
+    // Map of test_bench() results, written to out_path/bench.json.
+    struct mpv_node *bench_results;
 };
 
 struct unittest {
@@ -36,15 +46,33 @@ struct unittest {
     void (*run)(struct test_ctx *ctx);
 };
 
+extern const struct unittest test_bench_primitives;
 extern const struct unittest test_chmap;
 extern const struct unittest test_gl_video;
+extern const struct unittest test_histogram;
 extern const struct unittest test_img_format;
+extern const struct unittest test_ipc;
 extern const struct unittest test_json;
+extern const struct unittest test_json_bench;
 extern const struct unittest test_linked_list;
+extern const struct unittest test_msg;
+extern const struct unittest test_msg_bench;
+extern const struct unittest test_msgpack;
+extern const struct unittest test_node;
+extern const struct unittest test_node_bench;
 extern const struct unittest test_repack_sws;
 extern const struct unittest test_repack_zimg;
 extern const struct unittest test_repack;
 extern const struct unittest test_paths;
+extern const struct unittest test_playlist;
+extern const struct unittest test_playlist_bench;
+extern const struct unittest test_sd_ass;
+extern const struct unittest test_sd_ass_bench;
+extern const struct unittest test_spsc_queue;
+extern const struct unittest test_spsc_queue_bench;
+extern const struct unittest test_ta;
+extern const struct unittest test_trace;
+extern const struct unittest test_trace_bench;
 
 #define assert_true(x) assert(x)
 #define assert_false(x) assert(!(x))
@@ -80,6 +108,13 @@ void assert_memcmp_impl(const char *file, int line,
 // Open a new file in the out_path. Always succeeds.
 FILE *test_open_out(struct test_ctx *ctx, const char *name);
 
+// Measure the time a call of fn(priv) takes. fn is called repeatedly for a
+// warmup period, and then in timed batches. The minimum, median, mean and
+// standard deviation of the per call time over all batches are logged, and
+// stored as "<test name>/<name>" in out_path/bench.json after all tests ran.
+void test_bench(struct test_ctx *ctx, const char *name,
+                void (*fn)(void *priv), void *priv);
+
 // Sorted list of valid imgfmts. Call init_imgfmts_list() before use.
 extern int imgfmts[];
 extern int num_imgfmts;
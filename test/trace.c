@@ -0,0 +1,180 @@
+#include <pthread.h>
+#include <stdio.h>
+
+#include "common/common.h"
+#include "common/msg.h"
+#include "common/trace.h"
+#include "misc/json.h"
+#include "misc/node.h"
+#include "osdep/timer.h"
+#include "tests.h"
+
+#define WORKER_EVENTS 1000
+
+static void *worker(void *p)
+{
+    struct mp_tracer *t = p;
+    for (int n = 0; n < WORKER_EVENTS; n++) {
+        mp_tracer_add(t, "worker", MP_TRACE_BEGIN, "work", 0);
+        mp_tracer_add(t, "worker", MP_TRACE_END, "work", 0);
+    }
+    return NULL;
+}
+
+static char *read_file(void *ta_parent, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    assert_true(f);
+    char *data = talloc_strdup(ta_parent, "");
+    char buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), f)))
+        data = talloc_strndup_append_buffer(data, buf, len);
+    fclose(f);
+    return data;
+}
+
+static const char *get_str(struct mpv_node *ev, const char *key)
+{
+    struct mpv_node *v = node_map_get(ev, key);
+    return v && v->format == MPV_FORMAT_STRING ? v->u.string : "";
+}
+
+static void run(struct test_ctx *ctx)
+{
+    char *path = mp_tprintf(4096, "%s/trace.json", ctx->out_path);
+
+    struct mp_tracer *t = mp_tracer_create(NULL);
+    assert_true(t);
+    assert_false(mp_tracer_active(t));
+    mp_tracer_add(t, "main", MP_TRACE_INSTANT, "ignored", 0);
+
+    assert_true(mp_tracer_set_file(t, path));
+    assert_true(mp_tracer_active(t));
+
+    mp_tracer_add_stats(t, "main", "start decode");
+    mp_tracer_add_stats(t, "main", "value 1.500000 vsync-jitter");
+    mp_tracer_add_stats(t, "main", "end decode");
+    mp_tracer_add_stats(t, "main", "signal flip");
+    mp_tracer_add_stats(t, "main", "vo-delayed");
+    mp_tracer_add(t, "main", MP_TRACE_INSTANT, "quote\"d", 0);
+
+    pthread_t thread;
+    assert_true(!pthread_create(&thread, NULL, worker, t));
+    pthread_join(thread, NULL);
+
+    assert_true(mp_tracer_set_file(t, NULL));
+    assert_false(mp_tracer_active(t));
+    mp_tracer_add(t, "main", MP_TRACE_INSTANT, "ignored", 0);
+    talloc_free(t);
+
+    void *tmp = talloc_new(NULL);
+    char *data = read_file(tmp, path);
+    struct mpv_node root;
+    assert_true(json_parse(tmp, &root, &data, 4) >= 0);
+    assert_int_equal(root.format, MPV_FORMAT_NODE_ARRAY);
+
+    int counts[256] = {0};
+    int64_t last_ts = 0;
+    bool found_quoted = false, found_value = false, found_worker = false;
+    for (int n = 0; n < root.u.list->num; n++) {
+        struct mpv_node *ev = &root.u.list->values[n];
+        assert_int_equal(ev->format, MPV_FORMAT_NODE_MAP);
+        const char *ph = get_str(ev, "ph");
+        const char *name = get_str(ev, "name");
+        assert_true(strcmp(name, "ignored") != 0);
+        counts[(unsigned char)ph[0]]++;
+        if (strcmp(ph, "M") == 0) {
+            struct mpv_node *args = node_map_get(ev, "args");
+            found_worker |= strcmp(get_str(args, "name"), "worker") == 0;
+            continue;
+        }
+        if (strcmp(name, "work") == 0) {
+            struct mpv_node *ts = node_map_get(ev, "ts");
+            assert_int_equal(ts->format, MPV_FORMAT_INT64);
+            assert_true(ts->u.int64 >= last_ts);
+            last_ts = ts->u.int64;
+        }
+        found_quoted |= strcmp(name, "quote\"d") == 0;
+        if (strcmp(name, "vsync-jitter") == 0) {
+            assert_string_equal(ph, "C");
+            struct mpv_node *v = node_map_get(node_map_get(ev, "args"), "value");
+            assert_float_equal(v->u.double_, 1.5, 1e-9);
+            found_value = true;
+        }
+    }
+    assert_int_equal(counts['M'], 2);
+    assert_int_equal(counts['B'], WORKER_EVENTS + 1);
+    assert_int_equal(counts['E'], WORKER_EVENTS + 1);
+    assert_int_equal(counts['i'], 3);
+    assert_int_equal(counts['C'], 1);
+    assert_true(found_quoted && found_value && found_worker);
+
+    talloc_free(tmp);
+}
+
+const struct unittest test_trace = {
+    .name = "trace",
+    .run = run,
+};
+
+static void bench_tracer(void *priv)
+{
+    struct mp_tracer *t = priv;
+    mp_tracer_add(t, "bench", MP_TRACE_BEGIN, "event", 0);
+    mp_tracer_add(t, "bench", MP_TRACE_END, "event", 0);
+}
+
+static void bench_tracer_stats(void *priv)
+{
+    struct mp_tracer *t = priv;
+    char text[256];
+    snprintf(text, sizeof(text), "start %s", "event");
+    mp_tracer_add_stats(t, "bench", text);
+    snprintf(text, sizeof(text), "end %s", "event");
+    mp_tracer_add_stats(t, "bench", text);
+}
+
+struct locked_file {
+    pthread_mutex_t lock;
+    FILE *f;
+};
+
+static void bench_fprintf(void *priv)
+{
+    struct locked_file *lf = priv;
+    pthread_mutex_lock(&lf->lock);
+    fprintf(lf->f, "%"PRId64" start %s\n", mp_time_us(), "event");
+    pthread_mutex_unlock(&lf->lock);
+    pthread_mutex_lock(&lf->lock);
+    fprintf(lf->f, "%"PRId64" end %s\n", mp_time_us(), "event");
+    pthread_mutex_unlock(&lf->lock);
+}
+
+// Compare recording a begin/end pair with the tracer against writing text
+// lines under a mutex, which is what --dump-stats does.
+static void run_bench(struct test_ctx *ctx)
+{
+    struct mp_tracer *t = mp_tracer_create(NULL);
+    assert_true(mp_tracer_set_file(t, mp_tprintf(4096, "%s/trace-bench.json",
+                                                 ctx->out_path)));
+
+    // Events beyond the buffer size are dropped if the flusher can't keep up,
+    // which is part of the cost being measured.
+    test_bench(ctx, "tracer", bench_tracer, t);
+    test_bench(ctx, "tracer (MP_STATS text)", bench_tracer_stats, t);
+
+    talloc_free(t);
+
+    struct locked_file lf = {.lock = PTHREAD_MUTEX_INITIALIZER};
+    lf.f = fopen(mp_tprintf(4096, "%s/stats-bench.txt", ctx->out_path), "wb");
+    assert_true(lf.f);
+    test_bench(ctx, "locked fprintf", bench_fprintf, &lf);
+    fclose(lf.f);
+}
+
+const struct unittest test_trace_bench = {
+    .name = "trace-bench",
+    .is_complex = true,
+    .run = run_bench,
+};
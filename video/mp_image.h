@@ -92,6 +92,8 @@ typedef struct mp_image {
     double dts, pkt_duration;
     /* container reported FPS; can be incorrect, or 0 if unknown */
     double nominal_fps;
+    /* mp_time_us() when the last pipeline stage passed it on (for stats), or 0 */
+    int64_t stage_time;
     /* for private use */
     void* priv;
 
@@ -170,6 +170,7 @@ struct vo_internal {
     double reported_display_fps;
 
     struct stats_ctx *stats;
+    struct stats_ctx *latency_stats;
 };
 
 extern const struct m_sub_options gl_video_conf;
@@ -303,6 +304,7 @@ static struct vo *vo_create(bool probing, struct mpv_global *global,
         .req_frames = 1,
         .estimated_vsync_jitter = -1,
         .stats = stats_ctx_create(vo, global, "vo"),
+        .latency_stats = stats_ctx_create(vo, global, "video"),
     };
     mp_dispatch_set_wakeup_fn(vo->in->dispatch, dispatch_wakeup_cb, vo);
     pthread_mutex_init(&vo->in->lock, NULL);
@@ -980,6 +982,11 @@ static bool render_frame(struct vo *vo)
 
         stats_time_end(in->stats, "video-flip");
 
+        if (!frame->repeat && frame->current) {
+            stats_latency(in->latency_stats, "queue-flip",
+                          frame->current->stage_time);
+        }
+
         pthread_mutex_lock(&in->lock);
         in->dropped_frame = prev_drop_count < vo->in->drop_count;
         in->rendering = false;
@@ -1082,6 +1089,8 @@ static void *vo_thread(void *ptr)
     if (r < 0)
         goto done;
 
+    stats_register_thread_cputime(in->stats, "thread");
+
     read_opts(vo);
     update_display_fps(vo);
     vo_event(vo, VO_EVENT_WIN_STATE);
@@ -1134,6 +1143,7 @@ static void *vo_thread(void *ptr)
     talloc_free(in->current_frame);
     in->current_frame = NULL;
     vo->driver->uninit(vo);
+    stats_unregister_thread(in->stats, "thread");
 done:
     TA_FREEP(&in->dr_helper);
     return NULL;
@@ -230,6 +230,7 @@ def build(ctx):
         ( "audio/filter/af_scaletempo2_internals.c" ),
         ( "audio/fmt-conversion.c" ),
         ( "audio/format.c" ),
+        ( "audio/loudness.c" ),
         ( "audio/out/ao.c" ),
         ( "audio/out/ao_alsa.c",                 "alsa" ),
         ( "audio/out/ao_audiotrack.c",           "android" ),
@@ -264,6 +265,7 @@ def build(ctx):
         ( "common/recorder.c" ),
         ( "common/stats.c" ),
         ( "common/tags.c" ),
+        ( "common/trace.c" ),
         ( "common/version.c" ),
 
         ## Demuxers
@@ -315,11 +317,14 @@ def build(ctx):
         ( "misc/bstr.c" ),
         ( "misc/charset_conv.c" ),
         ( "misc/dispatch.c" ),
+        ( "misc/histogram.c" ),
         ( "misc/jni.c",                          "android" ),
         ( "misc/json.c" ),
+        ( "misc/msgpack.c" ),
         ( "misc/natural_sort.c" ),
         ( "misc/node.c" ),
         ( "misc/rendezvous.c" ),
+        ( "misc/spsc_queue.c" ),
         ( "misc/thread_pool.c" ),
         ( "misc/thread_tools.c" ),
 
@@ -335,6 +340,7 @@ def build(ctx):
 
         ## Player
         ( "player/audio.c" ),
+        ( "player/benchmark.c" ),
         ( "player/client.c" ),
         ( "player/command.c" ),
         ( "player/configfiles.c" ),
@@ -385,17 +391,28 @@ def build(ctx):
         ( "sub/sd_lavc.c" ),
 
         ## Tests
+        ( "test/bench.c",                        "tests" ),
         ( "test/chmap.c",                        "tests" ),
         ( "test/gl_video.c",                     "tests" ),
+        ( "test/histogram.c",                    "tests" ),
         ( "test/img_format.c",                   "tests" ),
+        ( "test/ipc.c",                          "tests" ),
         ( "test/json.c",                         "tests" ),
         ( "test/linked_list.c",                  "tests" ),
+        ( "test/msg.c",                          "tests" ),
+        ( "test/msgpack.c",                      "tests" ),
+        ( "test/node.c",                         "tests" ),
         ( "test/paths.c",                        "tests" ),
+        ( "test/playlist.c",                     "tests" ),
         ( "test/repack.c",                       "tests && zimg" ),
         ( "test/scale_sws.c",                    "tests" ),
         ( "test/scale_test.c",                   "tests" ),
         ( "test/scale_zimg.c",                   "tests && zimg" ),
+        ( "test/sd_ass.c",                       "tests" ),
+        ( "test/spsc_queue.c",                   "tests" ),
+        ( "test/ta.c",                           "tests" ),
         ( "test/tests.c",                        "tests" ),
+        ( "test/trace.c",                        "tests" ),
 
         ## Video
         ( "video/csputils.c" ),